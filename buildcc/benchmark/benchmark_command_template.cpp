@@ -0,0 +1,169 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares constructing a compile command per source with Command::Construct
+// against rendering a pre-parsed CommandTemplate
+//
+// Usage: benchmark_command_template [num_sources] [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "fmt/ranges.h"
+
+#include "env/command.h"
+#include "env/command_template.h"
+
+#include "target/common/target_config.h"
+
+namespace {
+
+constexpr std::size_t kDefaultNumSources = 100000;
+constexpr std::size_t kDefaultIterations = 3;
+
+template <typename Func> double MeasureMs(Func &&func) {
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Default arguments of a typical target, see `Target::Initialize`
+buildcc::env::Command CreateCommand() {
+  buildcc::env::Command command;
+  std::vector<std::string> include_dirs;
+  for (std::size_t i = 0; i < 20; i++) {
+    include_dirs.push_back(
+        fmt::format("-I/home/user/project/include/module{}", i));
+  }
+  command.AddDefaultArguments({
+      {"include_dirs", fmt::format("{}", fmt::join(include_dirs, " "))},
+      {"lib_dirs", "-L/home/user/project/lib"},
+      {"preprocessor_flags", "-DNDEBUG -DPROJECT_VERSION=3"},
+      {"common_compile_flags", "-Wall -Wextra -O2 -g"},
+      {"pch_compile_flags", ""},
+      {"pch_object_flags", ""},
+      {"asm_compile_flags", ""},
+      {"c_compile_flags", "-std=c11"},
+      {"cpp_compile_flags", "-std=c++17 -fno-rtti"},
+      {"link_flags", ""},
+      {"target_root_dir", "/home/user/project"},
+      {"target_build_dir", "/home/user/project/_build/gcc/benchmark"},
+      {"assembler", "as"},
+      {"c_compiler", "gcc"},
+      {"cpp_compiler", "g++"},
+      {"archiver", "ar"},
+      {"linker", "ld"},
+  });
+  return command;
+}
+
+struct Source {
+  std::string input;
+  std::string output;
+  std::string dep_file;
+};
+
+std::vector<Source> CreateSources(std::size_t num_sources) {
+  std::vector<Source> sources;
+  sources.reserve(num_sources);
+  for (std::size_t i = 0; i < num_sources; i++) {
+    const std::string relative =
+        fmt::format("src/module{}/file{}.cpp", i / 100, i);
+    std::string output = fmt::format(
+        "/home/user/project/_build/gcc/benchmark/{}.o", relative);
+    std::string dep_file = output + ".d";
+    sources.push_back({fmt::format("/home/user/project/{}", relative),
+                       std::move(output), std::move(dep_file)});
+  }
+  return sources;
+}
+
+void Report(const char *name, double ms, std::size_t iterations,
+            std::size_t num_sources) {
+  const double ms_per_iteration = ms / static_cast<double>(iterations);
+  fmt::print("{:<10} {:>10.2f} ms/iteration {:>10.1f} ns/source\n", name,
+             ms_per_iteration,
+             ms_per_iteration * 1e6 / static_cast<double>(num_sources));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t num_sources =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : kDefaultNumSources;
+  const std::size_t iterations =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : kDefaultIterations;
+
+  fmt::print("{} sources, {} iterations\n", num_sources, iterations);
+  const buildcc::env::Command command = CreateCommand();
+  const std::vector<Source> sources = CreateSources(num_sources);
+  const std::string &pattern = buildcc::TargetConfig().compile_command;
+  const std::vector<std::string> cpp_compile_flags = {"-std=c++17",
+                                                      "-fno-rtti"};
+
+  // Compile flags are aggregated and every argument is stored for each source
+  std::size_t construct_size = 0;
+  double ms = MeasureMs([&]() {
+    for (std::size_t i = 0; i < iterations; i++) {
+      for (const auto &source : sources) {
+        const std::string compile_flags =
+            fmt::format("{}", fmt::join(cpp_compile_flags, " "));
+        construct_size += command
+                              .Construct(pattern, {
+                                                      {"compiler", "g++"},
+                                                      {"compile_flags",
+                                                       compile_flags},
+                                                      {"output", source.output},
+                                                      {"input", source.input},
+                                                      {"dep_file",
+                                                       source.dep_file},
+                                                  })
+                              .size();
+      }
+    }
+  });
+  Report("construct", ms, iterations, num_sources);
+
+  // Compile flags are aggregated and bound once per target
+  std::size_t render_size = 0;
+  ms = MeasureMs([&]() {
+    for (std::size_t i = 0; i < iterations; i++) {
+      buildcc::env::CommandTemplate compile_command =
+          command.CreateTemplate(pattern);
+      compile_command.Bind({
+          {"compiler", "g++"},
+          {"compile_flags",
+           fmt::format("{}", fmt::join(cpp_compile_flags, " "))},
+      });
+      for (const auto &source : sources) {
+        render_size += compile_command
+                           .Render({
+                               {"output", source.output},
+                               {"input", source.input},
+                               {"dep_file", source.dep_file},
+                           })
+                           .size();
+      }
+    }
+  });
+  Report("template", ms, iterations, num_sources);
+
+  return construct_size == render_size ? 0 : 1;
+}
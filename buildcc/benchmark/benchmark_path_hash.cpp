@@ -0,0 +1,135 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares PathHashStrategy::Timestamp and PathHashStrategy::Content on a
+// generated source tree
+//
+// Usage: benchmark_path_hash [num_files] [file_size] [directory]
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "fmt/format.h"
+
+#include "env/util.h"
+
+#include "schema/path.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t kDefaultNumFiles = 10000;
+constexpr std::size_t kDefaultFileSize = 4096;
+constexpr const char *const kDefaultDirectory = "_benchmark_path_hash";
+
+template <typename Func> double MeasureMs(Func &&func) {
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+buildcc::internal::PathInfoList CreateTree(const fs::path &dir,
+                                           std::size_t num_files,
+                                           std::size_t file_size) {
+  fs::create_directories(dir);
+  buildcc::internal::PathInfoList paths;
+  std::string data(file_size, ' ');
+  for (std::size_t i = 0; i < num_files; i++) {
+    // 100 files per directory
+    const fs::path file =
+        dir / fmt::format("d{}", i / 100) / fmt::format("f{}.cpp", i);
+    fs::create_directories(file.parent_path());
+    auto content = fmt::format("// {}\n", i);
+    data.replace(0, content.size(), content);
+    buildcc::env::save_file(file.string().c_str(), data, true);
+    paths.Emplace(file, "");
+  }
+  return paths;
+}
+
+void TouchTree(const buildcc::internal::PathInfoList &paths) {
+  for (const auto &info : paths.GetPathInfos()) {
+    fs::last_write_time(info.path, fs::last_write_time(info.path) +
+                                       std::chrono::seconds(1));
+  }
+}
+
+void Report(const char *name, double ms, std::size_t num_files,
+            bool rebuild) {
+  fmt::print("{:<42} {:>10.2f} ms {:>8.2f} us/file   rebuild: {}\n", name, ms,
+             ms * 1000.0 / static_cast<double>(num_files), rebuild);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using buildcc::PathHashStrategy;
+  using buildcc::internal::PathInfoList;
+
+  const std::size_t num_files =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : kDefaultNumFiles;
+  const std::size_t file_size =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : kDefaultFileSize;
+  const fs::path dir = argc > 3 ? argv[3] : kDefaultDirectory;
+
+  fmt::print("Generating {} files of {} bytes in {}\n", num_files, file_size,
+             dir.string());
+  fs::remove_all(dir);
+  const PathInfoList user = CreateTree(dir, num_files, file_size);
+
+  // Timestamp
+  PathInfoList::SetHashStrategy(PathHashStrategy::Timestamp);
+  PathInfoList ts_previous = user;
+  Report("timestamp: full scan",
+         MeasureMs([&]() { ts_previous.ComputeHashForAll(); }), num_files,
+         true);
+
+  PathInfoList ts_current = user;
+  double ms = MeasureMs([&]() { ts_current.ComputeHashForAll(ts_previous); });
+  Report("timestamp: no change", ms, num_files,
+         !ts_current.IsEqual(ts_previous));
+
+  TouchTree(user);
+  ts_current = user;
+  ms = MeasureMs([&]() { ts_current.ComputeHashForAll(ts_previous); });
+  Report("timestamp: touched (same content)", ms, num_files,
+         !ts_current.IsEqual(ts_previous));
+
+  // Content
+  PathInfoList::SetHashStrategy(PathHashStrategy::Content);
+  PathInfoList ct_previous = user;
+  Report("content: full scan (no previous)",
+         MeasureMs([&]() { ct_previous.ComputeHashForAll(); }), num_files,
+         true);
+
+  PathInfoList ct_current = user;
+  ms = MeasureMs([&]() { ct_current.ComputeHashForAll(ct_previous); });
+  Report("content: no change (stamp prefilter)", ms, num_files,
+         !ct_current.IsEqual(ct_previous));
+
+  TouchTree(user);
+  ct_current = user;
+  ms = MeasureMs([&]() { ct_current.ComputeHashForAll(ct_previous); });
+  Report("content: touched (same content)", ms, num_files,
+         !ct_current.IsEqual(ct_previous));
+
+  fs::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the binary target serialization against the JSON export
+//
+// Usage: benchmark_target_serialization [num_sources] [headers_per_source]
+// [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "fmt/format.h"
+
+#include "env/util.h"
+
+#include "schema/target_serialization.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t kDefaultNumSources = 10000;
+constexpr std::size_t kDefaultHeadersPerSource = 20;
+constexpr std::size_t kDefaultIterations = 5;
+
+constexpr const char *const kBinaryFile = "_benchmark_target.bin";
+constexpr const char *const kJsonFile = "_benchmark_target.json";
+
+template <typename Func> double MeasureMs(Func &&func) {
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+buildcc::internal::TargetSchema CreateSchema(std::size_t num_sources,
+                                             std::size_t headers_per_source) {
+  buildcc::internal::TargetSchema schema;
+  schema.name = "benchmark";
+  schema.type = buildcc::TargetType::Executable;
+  for (std::size_t i = 0; i < num_sources; i++) {
+    const auto source =
+        fmt::format("/home/user/project/src/module{}/file{}.cpp", i / 100, i);
+    buildcc::internal::PathInfo info(source, fmt::format("{:016x}", i));
+    info.stamp = fmt::format("{}:{}", 1650000000000 + i, 4096 + i);
+    schema.sources.Emplace(info);
+
+    buildcc::internal::TargetSchema::ObjectInfo object;
+    for (std::size_t h = 0; h < headers_per_source; h++) {
+      buildcc::internal::PathInfo header(
+          fmt::format("/home/user/project/include/module{}/header{}.h", h,
+                      (i + h) % 1000),
+          fmt::format("{:016x}", i * 31 + h));
+      header.stamp = fmt::format("{}:{}", 1650000000000 + h, 1024 + h);
+      object.headers.Emplace(header);
+    }
+    schema.objects.emplace(source, std::move(object));
+  }
+  schema.include_dirs.Emplace("/home/user/project/include");
+  schema.common_compile_flags = {"-Wall", "-Wextra", "-O2"};
+  schema.cpp_compile_flags = {"-std=c++17"};
+  schema.pch_compiled = false;
+  schema.target_linked = true;
+  return schema;
+}
+
+void Report(const char *name, double ms, std::size_t iterations,
+            std::uintmax_t bytes) {
+  fmt::print("{:<16} {:>10.2f} ms/iteration {:>12} bytes\n", name,
+             ms / static_cast<double>(iterations), bytes);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using buildcc::internal::TargetSchema;
+  using buildcc::internal::TargetSerialization;
+
+  const std::size_t num_sources =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : kDefaultNumSources;
+  const std::size_t headers_per_source =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+               : kDefaultHeadersPerSource;
+  const std::size_t iterations =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10) : kDefaultIterations;
+
+  fmt::print("Target with {} sources, {} headers per source, {} iterations\n",
+             num_sources, headers_per_source, iterations);
+  const TargetSchema schema = CreateSchema(num_sources, headers_per_source);
+
+  // JSON
+  double ms = MeasureMs([&]() {
+    for (std::size_t i = 0; i < iterations; i++) {
+      json j = schema;
+      buildcc::env::save_file(kJsonFile, j.dump(4), false);
+    }
+  });
+  Report("json: store", ms, iterations, fs::file_size(kJsonFile));
+
+  ms = MeasureMs([&]() {
+    for (std::size_t i = 0; i < iterations; i++) {
+      std::string data;
+      buildcc::env::load_file(kJsonFile, false, &data);
+      TargetSchema load = json::parse(data).get<TargetSchema>();
+      (void)load;
+    }
+  });
+  Report("json: load", ms, iterations, fs::file_size(kJsonFile));
+
+  // Binary
+  TargetSerialization serialization(kBinaryFile);
+  serialization.UpdateStore(schema);
+  for (const auto &info : schema.sources.GetPathInfos()) {
+    serialization.AddSource(info.path, info.hash);
+  }
+  for (const auto &[source, object] : schema.objects) {
+    serialization.AddObjectInfo(source, object);
+  }
+
+  ms = MeasureMs([&]() {
+    for (std::size_t i = 0; i < iterations; i++) {
+      serialization.StoreToFile();
+    }
+  });
+  Report("binary: store", ms, iterations, fs::file_size(kBinaryFile));
+
+  bool loaded = true;
+  ms = MeasureMs([&]() {
+    for (std::size_t i = 0; i < iterations; i++) {
+      TargetSerialization load(kBinaryFile);
+      loaded = loaded && load.LoadFromFile();
+    }
+  });
+  Report("binary: load", ms, iterations, fs::file_size(kBinaryFile));
+
+  fs::remove(kJsonFile);
+  fs::remove(kBinaryFile);
+  return loaded ? 0 : 1;
+}
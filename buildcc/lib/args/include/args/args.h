@@ -17,7 +17,10 @@
 #ifndef ARGS_ARGS_H_
 #define ARGS_ARGS_H_
 
+#include <cstdint>
 #include <filesystem>
+#include <string>
+#include <vector>
 
 // Third Party
 #include "CLI/CLI.hpp"
@@ -25,6 +28,8 @@
 // BuildCC
 #include "env/logging.h"
 
+#include "schema/object_cache.h"
+
 #include "toolchains/toolchain_specialized.h"
 
 #include "target/common/target_config.h"
@@ -108,6 +113,33 @@ public:
   static bool IsParsed();
   static bool Clean();
   static env::LogLevel GetLogLevel();
+  static PathHashStrategy GetHashStrategy();
+  static bool ExportJson();
+  // 0 when the number of jobs should be detected
+  static unsigned int GetJobs();
+  static bool DisableJobServer();
+  // 0 when the number of child processes is limited by the number of jobs
+  static unsigned int GetMaxProcesses();
+  static bool DisableOutputGrouping();
+  // KiB, 0 when the buffered output of commands is not limited
+  static std::uint64_t GetOutputLimit();
+  static bool FailFast();
+  static bool KeepGoing();
+  // MiB, 0 when the memory of parallel jobs is not limited
+  static std::uint64_t GetMemoryBudget();
+  static bool CheckMeminfo();
+  // Empty when the object cache is disabled
+  static const fs::path &GetObjectCacheDir();
+  // MiB, 0 when the size of the object cache is not limited
+  static std::uint64_t GetObjectCacheSize();
+  static ObjectCacheLink GetObjectCacheLink();
+  // Empty when absolute paths are cached
+  static const fs::path &GetObjectCacheBaseDir();
+  // Empty when the remote cache is disabled
+  static const std::string &GetRemoteCacheUrl();
+  static bool RemoteCacheReadOnly();
+  // Empty when compiles are not distributed
+  static const std::vector<std::string> &GetDistWorkers();
 
   static const fs::path &GetProjectRootDir();
   static const fs::path &GetProjectBuildDir();
@@ -17,8 +17,12 @@
 #ifndef ARGS_REGISTER_H_
 #define ARGS_REGISTER_H_
 
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "args.h"
 #include "args/register/test_info.h"
@@ -32,8 +36,10 @@
 namespace buildcc {
 
 class Reg {
-private:
+public:
   class Instance;
+
+private:
   class CallbackInstance;
   class ToolchainInstance;
 
@@ -50,6 +56,7 @@ public:
   static ToolchainInstance Toolchain(const ArgToolchainState &condition);
 
   static const tf::Taskflow &GetTaskflow();
+  static tf::Executor &GetExecutor();
 
 private:
   static Instance &Ref();
@@ -58,8 +65,16 @@ private:
   static std::unique_ptr<Instance> instance_;
 };
 
+/**
+ * @brief Targets, Generators and Tests of a single build
+ * `Reg` uses an Instance of the Global BuildContext, independent builds in
+ * the same process create an Instance for their own BuildContext
+ */
 class Reg::Instance {
 public:
+  explicit Instance(BuildContext &context = BuildContext::Global())
+      : context_(context) {}
+
   /**
    * @brief Generic register callback with variable arguments
    * Can be used to organize code into functional chunks
@@ -88,17 +103,32 @@ public:
         std::is_base_of_v<internal::BuilderInterface, T>;
     static_assert(is_supported_base,
                   "Build only supports Generator, Target and derivatives");
+    env::assert_fatal(&builder.GetContext() == &context_,
+                      "Builder belongs to a different BuildContext");
 
+    // Objects of targets are stored on the executor that runs them
+    if constexpr (std::is_base_of_v<BaseTarget, T>) {
+      builder.SetExecutor(GetExecutor());
+    }
     build_cb(builder, std::forward<Params>(params)...);
-    tf::Task task = BuildTask(builder);
-    BuildStoreTask(builder.GetUniqueId(), task);
+    BuildTasks tasks = BuildTask(builder);
+    tasks.builder = &builder;
+    if constexpr (std::is_base_of_v<BaseTarget, T>) {
+      tasks.target = &builder;
+    }
+    BuildStoreTask(builder.GetUniqueId(), tasks);
   }
 
   /**
    * @brief Setup dependency between 2 Targets
    * PreReq: Call `Reg::Instance::Build` before calling `Reg::Instance::Dep`
    *
-   * Target runs after dependency is built
+   * Target links after the dependency is built, compiling the target can
+   * overlap with building the dependency.
+   * Generated files may be consumed while compiling, targets that depend on a
+   * generator, directly or through the dependency, compile after the
+   * generator completes
+   * Target is skipped when the dependency fails
    */
   void Dep(const internal::BuilderInterface &target,
            const internal::BuilderInterface &dependency);
@@ -132,19 +162,61 @@ public:
 
   // Getters
   const tf::Taskflow &GetTaskflow() const { return build_tf_; }
+  BuildContext &GetContext() const { return context_; }
+
+  /**
+   * @brief Executor shared by `RunBuild` and `RunTest`
+   * Created on first use with `Args::GetJobs` workers, or with
+   * `env::get_available_concurrency` workers when jobs are not specified
+   */
+  tf::Executor &GetExecutor();
+
+private:
+  /**
+   * @brief Registered tasks of a builder
+   * Targets are split into a compile and a link task, generators use the same
+   * task for both
+   */
+  struct BuildTasks {
+    tf::Task compile;
+    tf::Task link;
+    bool generator{false};
+    internal::BuilderInterface *builder{nullptr};
+    // nullptr for generators
+    BaseTarget *target{nullptr};
+    // Generators that the compile task succeeds, directly (true) or through
+    // the dependencies of the builder (false)
+    std::unordered_map<std::string, bool> generators;
+    // Builders that link against this builder
+    std::vector<std::string> dependents;
+  };
 
 private:
   // BuildTasks
-  tf::Task BuildTask(BaseTarget &target);
-  tf::Task BuildTask(CustomGenerator &generator);
-  void BuildStoreTask(const std::string &unique_id, const tf::Task &task);
+  BuildTasks BuildTask(BaseTarget &target);
+  BuildTasks BuildTask(CustomGenerator &generator);
+  void BuildStoreTask(const std::string &unique_id, const BuildTasks &tasks);
+
+  // Dep
+  void DepGenerators(BuildTasks &tasks,
+                     const std::vector<std::string> &generators);
+
+  // Run
+  void SetDownstreamDurations();
+  std::uint64_t
+  DownstreamDuration(const std::string &unique_id,
+                     std::unordered_map<std::string, std::uint64_t> &durations);
 
 private:
+  BuildContext &context_;
+
   // Build
   tf::Taskflow build_tf_{"Targets"};
 
-  std::unordered_map<std::string, tf::Task> build_;
+  std::unordered_map<std::string, BuildTasks> build_;
   std::unordered_map<std::string, TestInfo> tests_;
+
+  std::unique_ptr<tf::Executor> executor_;
 };
 
 class Reg::CallbackInstance {
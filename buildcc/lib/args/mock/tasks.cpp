@@ -4,13 +4,23 @@
 
 namespace buildcc {
 
-tf::Task Reg::Instance::BuildTask(BaseTarget &target) {
+Reg::Instance::BuildTasks Reg::Instance::BuildTask(BaseTarget &target) {
   mock().actualCall(fmt::format("BuildTask_{}", target.GetName()).c_str());
-  return build_tf_.placeholder().name(target.GetUniqueId());
+  BuildTasks tasks;
+  tasks.compile = build_tf_.placeholder().name(
+      fmt::format("{} Compile", target.GetUniqueId()));
+  tasks.link = build_tf_.placeholder().name(target.GetUniqueId());
+  tasks.compile.precede(tasks.link);
+  return tasks;
 }
-tf::Task Reg::Instance::BuildTask(CustomGenerator &generator) {
+Reg::Instance::BuildTasks
+Reg::Instance::BuildTask(CustomGenerator &generator) {
   mock().actualCall(fmt::format("BuildTask_{}", generator.GetName()).c_str());
-  return build_tf_.placeholder().name(generator.GetUniqueId());
+  BuildTasks tasks;
+  tasks.compile = build_tf_.placeholder().name(generator.GetUniqueId());
+  tasks.link = tasks.compile;
+  tasks.generator = true;
+  return tasks;
 }
 
 void Reg::Instance::RunBuild() {}
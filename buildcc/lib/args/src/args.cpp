@@ -40,6 +40,87 @@ constexpr const char *const kCleanDesc = "Clean artifacts";
 constexpr const char *const kLoglevelParam = "--loglevel";
 constexpr const char *const kLoglevelDesc = "LogLevel settings";
 
+constexpr const char *const kHashStrategyParam = "--hash_strategy";
+constexpr const char *const kHashStrategyDesc =
+    "File change detection strategy";
+
+constexpr const char *const kExportJsonParam = "--export_json";
+constexpr const char *const kExportJsonDesc =
+    "Export a JSON copy of every serialized target for debugging";
+
+constexpr const char *const kJobsParam = "-j,--jobs";
+constexpr const char *const kJobsDesc =
+    "Number of parallel jobs (0 detects the CPUs available to the process)";
+
+constexpr const char *const kDisableJobServerParam = "--disable_jobserver";
+constexpr const char *const kDisableJobServerDesc =
+    "Do not use or provide a GNU make jobserver";
+
+constexpr const char *const kMaxProcessesParam = "--max_processes";
+constexpr const char *const kMaxProcessesDesc =
+    "Maximum number of child processes in flight (0 uses the number of jobs)";
+
+constexpr const char *const kDisableOutputGroupingParam =
+    "--disable_output_grouping";
+constexpr const char *const kDisableOutputGroupingDesc =
+    "Print the output of commands as it is produced instead of once they exit";
+
+constexpr const char *const kOutputLimitParam = "--output_limit";
+constexpr const char *const kOutputLimitDesc =
+    "Maximum buffered output per command and stream in KiB (0 for no limit)";
+
+constexpr const char *const kFailFastParam = "--fail_fast";
+constexpr const char *const kFailFastDesc =
+    "Terminate the jobs in flight when a job fails";
+
+constexpr const char *const kKeepGoingParam = "-k,--keep_going";
+constexpr const char *const kKeepGoingDesc =
+    "Keep building the targets that do not depend on a failed target";
+
+constexpr const char *const kMemoryBudgetParam = "--memory_budget";
+constexpr const char *const kMemoryBudgetDesc =
+    "Memory budget in MiB for parallel jobs (0 for no limit)";
+
+constexpr const char *const kCheckMeminfoParam = "--check_meminfo";
+constexpr const char *const kCheckMeminfoDesc =
+    "Hold back jobs while /proc/meminfo MemAvailable is too low";
+
+constexpr const char *const kObjectCacheParam = "--object_cache";
+constexpr const char *const kObjectCacheDesc =
+    "Directory of the local object cache (relative to current directory), "
+    "disabled when empty";
+
+constexpr const char *const kObjectCacheSizeParam = "--object_cache_size";
+constexpr const char *const kObjectCacheSizeDesc =
+    "Maximum size of the object cache in MiB (0 for no limit)";
+
+constexpr const char *const kObjectCacheLinkParam = "--object_cache_link";
+constexpr const char *const kObjectCacheLinkDesc =
+    "How cached objects are placed in the build directory";
+
+constexpr const char *const kObjectCacheBaseDirParam =
+    "--object_cache_base_dir";
+constexpr const char *const kObjectCacheBaseDirDesc =
+    "Paths below this directory (relative to current directory) are cached "
+    "relative to it, objects are shared between checkouts in different "
+    "directories";
+
+constexpr const char *const kRemoteCacheParam = "--remote_cache";
+constexpr const char *const kRemoteCacheDesc =
+    "Url of a remote HTTP object cache, disabled when empty. Uses the "
+    "/ac and /cas paths of bazel-remote, which must run with "
+    "--disable_http_ac_validation";
+
+constexpr const char *const kRemoteCacheReadOnlyParam =
+    "--remote_cache_read_only";
+constexpr const char *const kRemoteCacheReadOnlyDesc =
+    "Fetch objects from the remote cache without uploading them";
+
+constexpr const char *const kDistWorkersParam = "--dist_workers";
+constexpr const char *const kDistWorkersDesc =
+    "Compile on buildcc-worker daemons, `host[:port][/slots]` per worker. "
+    "Sources are preprocessed locally";
+
 constexpr const char *const kRootDirParam = "--root_dir";
 constexpr const char *const kRootDirDesc =
     "Project root directory (relative to current directory)";
@@ -79,6 +160,19 @@ const std::unordered_map<const char *, buildcc::env::LogLevel> kLogLevelMap{
     {"critical", buildcc::env::LogLevel::Critical},
 };
 
+const std::unordered_map<const char *, buildcc::PathHashStrategy>
+    kHashStrategyMap{
+        {"timestamp", buildcc::PathHashStrategy::Timestamp},
+        {"content", buildcc::PathHashStrategy::Content},
+    };
+
+const std::unordered_map<const char *, buildcc::ObjectCacheLink>
+    kObjectCacheLinkMap{
+        {"copy", buildcc::ObjectCacheLink::Copy},
+        {"reflink", buildcc::ObjectCacheLink::Reflink},
+        {"hardlink", buildcc::ObjectCacheLink::Hardlink},
+    };
+
 const std::unordered_map<const char *, buildcc::ToolchainId> kToolchainIdMap{
     {"gcc", buildcc::ToolchainId::Gcc},
     {"msvc", buildcc::ToolchainId::Msvc},
@@ -91,6 +185,25 @@ const std::unordered_map<const char *, buildcc::ToolchainId> kToolchainIdMap{
 // Static variables
 bool clean_{false};
 buildcc::env::LogLevel loglevel_{buildcc::env::LogLevel::Info};
+buildcc::PathHashStrategy hash_strategy_{
+    buildcc::PathHashStrategy::Timestamp};
+bool export_json_{false};
+unsigned int jobs_{0};
+bool disable_jobserver_{false};
+unsigned int max_processes_{0};
+bool disable_output_grouping_{false};
+std::uint64_t output_limit_{0};
+bool fail_fast_{false};
+bool keep_going_{false};
+std::uint64_t memory_budget_{0};
+bool check_meminfo_{false};
+fs::path object_cache_dir_{""};
+std::uint64_t object_cache_size_{5120};
+buildcc::ObjectCacheLink object_cache_link_{buildcc::ObjectCacheLink::Reflink};
+fs::path object_cache_base_dir_{""};
+std::string remote_cache_url_{""};
+bool remote_cache_read_only_{false};
+std::vector<std::string> dist_workers_;
 fs::path project_root_dir_{""};
 fs::path project_build_dir_{"_internal"};
 
@@ -123,6 +236,28 @@ bool Args::IsParsed() {
 }
 bool Args::Clean() { return clean_; }
 env::LogLevel Args::GetLogLevel() { return loglevel_; }
+PathHashStrategy Args::GetHashStrategy() { return hash_strategy_; }
+bool Args::ExportJson() { return export_json_; }
+unsigned int Args::GetJobs() { return jobs_; }
+bool Args::DisableJobServer() { return disable_jobserver_; }
+unsigned int Args::GetMaxProcesses() { return max_processes_; }
+bool Args::DisableOutputGrouping() { return disable_output_grouping_; }
+std::uint64_t Args::GetOutputLimit() { return output_limit_; }
+bool Args::FailFast() { return fail_fast_; }
+bool Args::KeepGoing() { return keep_going_; }
+std::uint64_t Args::GetMemoryBudget() { return memory_budget_; }
+bool Args::CheckMeminfo() { return check_meminfo_; }
+const fs::path &Args::GetObjectCacheDir() { return object_cache_dir_; }
+std::uint64_t Args::GetObjectCacheSize() { return object_cache_size_; }
+ObjectCacheLink Args::GetObjectCacheLink() { return object_cache_link_; }
+const fs::path &Args::GetObjectCacheBaseDir() {
+  return object_cache_base_dir_;
+}
+const std::string &Args::GetRemoteCacheUrl() { return remote_cache_url_; }
+bool Args::RemoteCacheReadOnly() { return remote_cache_read_only_; }
+const std::vector<std::string> &Args::GetDistWorkers() {
+  return dist_workers_;
+}
 
 const fs::path &Args::GetProjectRootDir() { return project_root_dir_; }
 const fs::path &Args::GetProjectBuildDir() { return project_build_dir_; }
@@ -141,6 +276,40 @@ void Args::RootArgs() {
   root_group->add_flag(kCleanParam, clean_, kCleanDesc);
   root_group->add_option(kLoglevelParam, loglevel_, kLoglevelDesc)
       ->transform(CLI::CheckedTransformer(kLogLevelMap, CLI::ignore_case));
+  root_group->add_option(kHashStrategyParam, hash_strategy_, kHashStrategyDesc)
+      ->transform(
+          CLI::CheckedTransformer(kHashStrategyMap, CLI::ignore_case));
+  root_group->add_flag(kExportJsonParam, export_json_, kExportJsonDesc);
+  root_group->add_option(kJobsParam, jobs_, kJobsDesc);
+  root_group->add_flag(kDisableJobServerParam, disable_jobserver_,
+                       kDisableJobServerDesc);
+  root_group->add_option(kMaxProcessesParam, max_processes_,
+                         kMaxProcessesDesc);
+  root_group->add_flag(kDisableOutputGroupingParam, disable_output_grouping_,
+                       kDisableOutputGroupingDesc);
+  root_group->add_option(kOutputLimitParam, output_limit_, kOutputLimitDesc);
+  auto *fail_fast =
+      root_group->add_flag(kFailFastParam, fail_fast_, kFailFastDesc);
+  root_group->add_flag(kKeepGoingParam, keep_going_, kKeepGoingDesc)
+      ->excludes(fail_fast);
+  root_group->add_option(kMemoryBudgetParam, memory_budget_,
+                         kMemoryBudgetDesc);
+  root_group->add_flag(kCheckMeminfoParam, check_meminfo_, kCheckMeminfoDesc);
+  root_group->add_option(kObjectCacheParam, object_cache_dir_,
+                         kObjectCacheDesc);
+  root_group->add_option(kObjectCacheSizeParam, object_cache_size_,
+                         kObjectCacheSizeDesc);
+  root_group->add_option(kObjectCacheLinkParam, object_cache_link_,
+                         kObjectCacheLinkDesc)
+      ->transform(
+          CLI::CheckedTransformer(kObjectCacheLinkMap, CLI::ignore_case));
+  root_group->add_option(kObjectCacheBaseDirParam, object_cache_base_dir_,
+                         kObjectCacheBaseDirDesc);
+  root_group->add_option(kRemoteCacheParam, remote_cache_url_,
+                         kRemoteCacheDesc);
+  root_group->add_flag(kRemoteCacheReadOnlyParam, remote_cache_read_only_,
+                       kRemoteCacheReadOnlyDesc);
+  root_group->add_option(kDistWorkersParam, dist_workers_, kDistWorkersDesc);
 
   // Dir flags
   root_group->add_option(kRootDirParam, project_root_dir_, kRootDirDesc)
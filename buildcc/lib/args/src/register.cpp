@@ -16,14 +16,25 @@
 
 #include "args/register.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <queue>
 
 #include "fmt/format.h"
 
 #include "env/assert_fatal.h"
+#include "env/concurrency.h"
 #include "env/env.h"
+#include "env/job_output.h"
+#include "env/jobserver.h"
+#include "env/memory_budget.h"
+#include "env/process_reaper.h"
 #include "env/storage.h"
+#include "env/task_state.h"
+
+#include "schema/build_log.h"
+#include "schema/dist_compile.h"
+#include "schema/remote_cache.h"
 
 namespace fs = std::filesystem;
 
@@ -62,6 +73,20 @@ void DepDetectCyclicDependency(const tf::Task &target_task,
   }
 }
 
+unsigned int GetParallelJobs() {
+  return buildcc::Args::GetJobs() != 0
+             ? buildcc::Args::GetJobs()
+             : buildcc::env::get_available_concurrency();
+}
+
+// Child processes do not occupy a worker thread when they are reaped by the
+// ProcessReaper
+unsigned int GetProcessSlots() {
+  return buildcc::Args::GetMaxProcesses() != 0
+             ? buildcc::Args::GetMaxProcesses()
+             : GetParallelJobs();
+}
+
 } // namespace
 
 namespace buildcc {
@@ -72,6 +97,53 @@ void SystemInit() {
   Project::Init(fs::current_path() / Args::GetProjectRootDir(),
                 fs::current_path() / Args::GetProjectBuildDir());
   env::set_log_level(Args::GetLogLevel());
+  internal::PathInfoList::SetHashStrategy(Args::GetHashStrategy());
+  internal::TargetSerialization::EnableJsonExport(Args::ExportJson());
+
+  // Share the job slots of a parent jobserver (for example `make -j`)
+  // Otherwise provide one to child processes
+  if (!Args::DisableJobServer()) {
+    const char *makeflags = std::getenv("MAKEFLAGS");
+    if (makeflags == nullptr || !env::JobServer::InitClient(makeflags)) {
+      env::JobServer::InitServer(GetProcessSlots());
+    }
+  }
+  (void)env::ProcessReaper::Init(GetProcessSlots());
+  // Output of parallel jobs is printed once per job
+  if (!Args::DisableOutputGrouping()) {
+    env::JobOutput::Init(Args::GetOutputLimit() * 1024);
+  }
+  if (Args::KeepGoing()) {
+    env::set_failure_mode(env::FailureMode::KeepGoing);
+  } else if (Args::FailFast()) {
+    env::set_failure_mode(env::FailureMode::FailFast);
+  } else {
+    env::set_failure_mode(env::FailureMode::Stop);
+  }
+  env::MemoryBudget::Init(Args::GetMemoryBudget() * 1024 * 1024,
+                          Args::CheckMeminfo());
+  if (!Args::GetObjectCacheDir().empty()) {
+    internal::ObjectCache::Init(fs::current_path() / Args::GetObjectCacheDir(),
+                                Args::GetObjectCacheSize() * 1024 * 1024,
+                                Args::GetObjectCacheLink());
+  }
+  if (!Args::GetRemoteCacheUrl().empty()) {
+    env::assert_fatal(
+        internal::RemoteCache::Init(Args::GetRemoteCacheUrl(),
+                                    !Args::RemoteCacheReadOnly()),
+        fmt::format("Invalid remote cache url '{}'",
+                    Args::GetRemoteCacheUrl()));
+  }
+  if (!Args::GetDistWorkers().empty()) {
+    env::assert_fatal(
+        internal::DistCompile::Init(Args::GetDistWorkers()),
+        fmt::format("Invalid dist workers '{}'",
+                    fmt::join(Args::GetDistWorkers(), " ")));
+  }
+  if (!Args::GetObjectCacheBaseDir().empty()) {
+    internal::ObjectCache::SetBaseDir(fs::current_path() /
+                                      Args::GetObjectCacheBaseDir());
+  }
 
   // Top down (what is init first gets deinit last)
   std::atexit([]() {
@@ -96,6 +168,16 @@ void Reg::Init() {
 void Reg::Deinit() {
   instance_.reset(nullptr);
   Project::Deinit();
+  // Local fallbacks are executed by the ProcessReaper
+  internal::DistCompile::Deinit();
+  env::ProcessReaper::Deinit();
+  env::JobOutput::Deinit();
+  env::JobServer::Deinit();
+  env::MemoryBudget::Deinit();
+  internal::ObjectCache::Deinit();
+  internal::ObjectCache::SetBaseDir("");
+  // Waits for queued uploads
+  internal::RemoteCache::Deinit();
 }
 
 void Reg::Run(const std::function<void(void)> &post_build_cb) {
@@ -108,6 +190,7 @@ void Reg::Run(const std::function<void(void)> &post_build_cb) {
 }
 
 const tf::Taskflow &Reg::GetTaskflow() { return Ref().GetTaskflow(); }
+tf::Executor &Reg::GetExecutor() { return Ref().GetExecutor(); }
 
 Reg::Instance &Reg::Ref() {
   env::assert_fatal(instance_ != nullptr, kRegkNotInit);
@@ -156,12 +239,35 @@ void Reg::Instance::Dep(const internal::BuilderInterface &target,
                     "Call Instance::Build API on target and "
                     "dependency before Instance::Dep API");
 
+  BuildTasks &target_tasks = target_iter->second;
+  BuildTasks &dep_tasks = dep_iter->second;
   const std::string &dep_unique_id = dependency.GetUniqueId();
-  DepDetectDuplicate(target_iter->second, dep_unique_id);
-  DepDetectCyclicDependency(target_iter->second, dep_unique_id);
+  const auto generator_iter = target_tasks.generators.find(dep_unique_id);
+  env::assert_fatal(
+      generator_iter == target_tasks.generators.end() ||
+          !generator_iter->second,
+      fmt::format("Dependency '{}' already added", dep_unique_id));
+  DepDetectDuplicate(target_tasks.link, dep_unique_id);
+  // Every task reachable from the target is downstream of the compile task
+  DepDetectCyclicDependency(target_tasks.compile, dep_unique_id);
+
+  target_tasks.builder->AddFailureDependency(dependency);
 
   // Finally do this
-  target_iter->second.succeed(dep_iter->second);
+  // Only generated files are consumed while compiling, generated files of the
+  // dependencies (such as headers in their include dirs) included
+  if (dep_tasks.generator) {
+    DepGenerators(target_tasks, {dep_unique_id});
+    target_tasks.generators[dep_unique_id] = true;
+  } else {
+    target_tasks.link.succeed(dep_tasks.link);
+    dep_tasks.dependents.push_back(target.GetUniqueId());
+    std::vector<std::string> generators;
+    for (const auto &generator : dep_tasks.generators) {
+      generators.push_back(generator.first);
+    }
+    DepGenerators(target_tasks, generators);
+  }
 }
 
 void Reg::Instance::Test(const std::string &command, const BaseTarget &target,
@@ -178,16 +284,77 @@ void Reg::Instance::Test(const std::string &command, const BaseTarget &target,
       added, fmt::format("Could not register test {}", target.GetName()));
 }
 
+tf::Executor &Reg::Instance::GetExecutor() {
+  if (!executor_) {
+    executor_ = std::make_unique<tf::Executor>(GetParallelJobs());
+  }
+  return *executor_;
+}
+
 // Private
 
 void Reg::Instance::BuildStoreTask(const std::string &unique_id,
-                                   const tf::Task &task) {
-  const bool stored = build_.emplace(unique_id, task).second;
+                                   const BuildTasks &tasks) {
+  const bool stored = build_.emplace(unique_id, tasks).second;
   env::assert_fatal(
       stored, fmt::format("Duplicate `Instance::Build` call detected for '{}'",
                           unique_id));
 }
 
+// The compile task succeeds `generators`, builders that link against `tasks`
+// inherit them
+void Reg::Instance::DepGenerators(BuildTasks &tasks,
+                                  const std::vector<std::string> &generators) {
+  std::vector<std::string> added;
+  for (const auto &unique_id : generators) {
+    if (tasks.generators.emplace(unique_id, false).second) {
+      tasks.compile.succeed(build_.at(unique_id).link);
+      added.push_back(unique_id);
+    }
+  }
+  if (added.empty()) {
+    return;
+  }
+  for (const auto &dependent : tasks.dependents) {
+    DepGenerators(build_.at(dependent), added);
+  }
+}
+
+// Targets link after the links of their dependencies, the longest chain of
+// links that waits for a target is estimated using the BuildLog
+void Reg::Instance::SetDownstreamDurations() {
+  std::unordered_map<std::string, std::uint64_t> durations;
+  for (auto &[unique_id, tasks] : build_) {
+    const std::uint64_t duration = DownstreamDuration(unique_id, durations);
+    if (tasks.target != nullptr) {
+      tasks.target->SetDownstreamDuration(duration);
+    }
+  }
+}
+
+std::uint64_t Reg::Instance::DownstreamDuration(
+    const std::string &unique_id,
+    std::unordered_map<std::string, std::uint64_t> &durations) {
+  const auto iter = durations.find(unique_id);
+  if (iter != durations.end()) {
+    return iter->second;
+  }
+  std::uint64_t longest = 0;
+  for (const auto &dependent : build_.at(unique_id).dependents) {
+    const BuildTasks &tasks = build_.at(dependent);
+    std::uint64_t link = 0;
+    if (tasks.target != nullptr) {
+      link = internal::BuildLog::GetDuration(
+                 context_, path_as_string(tasks.target->GetTargetPath()))
+                 .value_or(0);
+    }
+    longest =
+        std::max(longest, link + DownstreamDuration(dependent, durations));
+  }
+  durations.emplace(unique_id, longest);
+  return longest;
+}
+
 //
 
 void TestInfo::TestRunner() const {
@@ -19,24 +19,104 @@
 #include "env/logging.h"
 #include "env/util.h"
 
+#include "schema/build_log.h"
+#include "schema/dist_compile.h"
+#include "schema/object_cache.h"
+#include "schema/remote_cache.h"
+
+namespace {
+
+constexpr const char *const kBuildLogFile = "buildcc_log.bin";
+
+}
+
 namespace buildcc {
 
-tf::Task Reg::Instance::BuildTask(BaseTarget &target) {
-  return build_tf_.composed_of(target.GetTaskflow()).name(target.GetUniqueId());
+Reg::Instance::BuildTasks Reg::Instance::BuildTask(BaseTarget &target) {
+  BuildTasks tasks;
+  tasks.compile = build_tf_.composed_of(target.GetCompileTaskflow())
+                      .name(fmt::format("{} Compile", target.GetUniqueId()));
+  tasks.link = build_tf_.composed_of(target.GetLinkTaskflow())
+                   .name(target.GetUniqueId());
+  tasks.compile.precede(tasks.link);
+  return tasks;
 }
 
-tf::Task Reg::Instance::BuildTask(CustomGenerator &generator) {
-  return build_tf_.composed_of(generator.GetTaskflow())
-      .name(generator.GetUniqueId());
+Reg::Instance::BuildTasks
+Reg::Instance::BuildTask(CustomGenerator &generator) {
+  BuildTasks tasks;
+  tasks.compile = build_tf_.composed_of(generator.GetTaskflow())
+                      .name(generator.GetUniqueId());
+  tasks.link = tasks.compile;
+  tasks.generator = true;
+  return tasks;
 }
 
 void Reg::Instance::RunBuild() {
-  tf::Executor executor;
+  // Every path is fingerprinted at most once per build
+  // NOTE, The caches are shared with the builds of other Instances that
+  // overlap this build
+  internal::PathHashCache::BeginBuild();
+  // Toolchain executables are resolved and fingerprinted once per build
+  Toolchain::BeginFingerprintCache();
+
+  // Job durations of previous builds schedule the jobs on the longest paths
+  // first
+  const fs::path build_log = context_.GetBuildDir() / kBuildLogFile;
+  (void)internal::BuildLog::LoadFromFile(context_, build_log);
+  internal::BuildLog::Enable(context_, true);
+  SetDownstreamDurations();
+
+  tf::Executor &executor = GetExecutor();
   env::log_info(__FUNCTION__,
                 fmt::format("Running with {} workers", executor.num_workers()));
-  executor.run(build_tf_);
-  executor.wait_for_all();
-  env::assert_fatal(env::get_task_state() == env::TaskState::SUCCESS,
+  // NOTE, The executor is shared so only wait for this taskflow
+  executor.run(build_tf_).wait();
+
+  internal::PathHashCache::EndBuild();
+  Toolchain::EndFingerprintCache();
+  internal::BuildLog::Enable(context_, false);
+  if (!internal::BuildLog::StoreToFile(context_, build_log)) {
+    env::log_warning(__FUNCTION__, "Could not store the build log");
+  }
+  internal::BuildLog::Clear(context_);
+  env::log_debug(__FUNCTION__,
+                 fmt::format("Path hash cache: {} hits, {} misses",
+                             internal::PathHashCache::GetHits(),
+                             internal::PathHashCache::GetMisses()));
+  if (internal::ObjectCache::IsEnabled()) {
+    const auto stats = internal::ObjectCache::GetStats();
+    env::log_info(__FUNCTION__,
+                  fmt::format("Object cache: {} hits, {} misses, {} stored, "
+                              "{} evicted, {} MiB",
+                              stats.hits, stats.misses, stats.stores,
+                              stats.evictions,
+                              stats.size_bytes / (1024 * 1024)));
+  }
+  if (internal::RemoteCache::IsEnabled()) {
+    // Uploads still queued are completed by Reg::Deinit
+    const auto stats = internal::RemoteCache::GetStats();
+    env::log_info(__FUNCTION__,
+                  fmt::format("Remote cache: {} hits, {} misses, {} uploaded, "
+                              "{} failed uploads, {} KiB downloaded",
+                              stats.hits, stats.misses, stats.uploads,
+                              stats.upload_failures,
+                              stats.bytes_downloaded / 1024));
+  }
+  if (internal::DistCompile::IsEnabled()) {
+    const auto stats = internal::DistCompile::GetStats();
+    env::log_info(__FUNCTION__,
+                  fmt::format("Distributed compile: {} remote, {} local "
+                              "fallbacks, {} errors",
+                              stats.remote, stats.local_fallbacks,
+                              stats.errors));
+  }
+  for (const auto &[unique_id, tasks] : build_) {
+    if (tasks.builder->GetFailureScope().IsFailed()) {
+      env::log_critical(__FUNCTION__, fmt::format("Failed: {}", unique_id));
+    }
+  }
+  env::assert_fatal(context_.GetTaskState() == env::TaskState::SUCCESS,
                     "Task state is not successful!");
 }
 
@@ -46,9 +126,8 @@ void Reg::Instance::RunTest() {
       tests_.begin(), tests_.end(),
       [](const std::pair<std::string, TestInfo> &p) { p.second.TestRunner(); });
 
-  tf::Executor executor;
-  executor.run(test_tf);
-  executor.wait_for_all();
+  tf::Executor &executor = GetExecutor();
+  executor.run(test_tf).wait();
 }
 
 } // namespace buildcc
@@ -35,6 +35,157 @@ TEST(ArgsTestGroup, Args_BasicParse) {
   CHECK_TRUE(buildcc::Args::IsParsed());
 }
 
+TEST(ArgsTestGroup, Args_HashStrategy) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--hash_strategy", "content"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK(buildcc::Args::GetHashStrategy() == buildcc::PathHashStrategy::Content);
+}
+
+TEST(ArgsTestGroup, Args_ExportJson) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--export_json"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_TRUE(buildcc::Args::ExportJson());
+}
+
+TEST(ArgsTestGroup, Args_Jobs) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "-j", "3"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_EQUAL(buildcc::Args::GetJobs(), 3);
+}
+
+TEST(ArgsTestGroup, Args_DisableJobServer) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--disable_jobserver"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_TRUE(buildcc::Args::DisableJobServer());
+}
+
+TEST(ArgsTestGroup, Args_MaxProcesses) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "-j", "4", "--max_processes", "64"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_EQUAL(buildcc::Args::GetJobs(), 4);
+  CHECK_EQUAL(buildcc::Args::GetMaxProcesses(), 64);
+}
+
+TEST(ArgsTestGroup, Args_OutputGrouping) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--disable_output_grouping", "--output_limit",
+                               "256"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_TRUE(buildcc::Args::DisableOutputGrouping());
+  CHECK_EQUAL(buildcc::Args::GetOutputLimit(), 256);
+}
+
+TEST(ArgsTestGroup, Args_FailureMode) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "-k"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_TRUE(buildcc::Args::KeepGoing());
+  CHECK_FALSE(buildcc::Args::FailFast());
+}
+
+TEST(ArgsTestGroup, Args_FailureMode_Exclusive) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--keep_going", "--fail_fast"};
+  int argc = av.size();
+
+  auto &instance = buildcc::Args::Init();
+  CHECK_THROWS(std::exception, instance.Parse(argc, av.data()));
+}
+
+TEST(ArgsTestGroup, Args_MemoryBudget) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--memory_budget", "4096", "--check_meminfo"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  CHECK_EQUAL(buildcc::Args::GetMemoryBudget(), 4096);
+  CHECK_TRUE(buildcc::Args::CheckMeminfo());
+}
+
+TEST(ArgsTestGroup, Args_ObjectCache) {
+  std::vector<const char *> av{"",
+                               "--config",
+                               "configs/basic_parse.toml",
+                               "--object_cache",
+                               "cache",
+                               "--object_cache_size",
+                               "64",
+                               "--object_cache_link",
+                               "hardlink"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  STRCMP_EQUAL(buildcc::Args::GetObjectCacheDir().string().c_str(), "cache");
+  CHECK_EQUAL(buildcc::Args::GetObjectCacheSize(), 64);
+  CHECK_TRUE(buildcc::Args::GetObjectCacheLink() ==
+             buildcc::ObjectCacheLink::Hardlink);
+}
+
+TEST(ArgsTestGroup, Args_RemoteCache) {
+  std::vector<const char *> av{"",
+                               "--config",
+                               "configs/basic_parse.toml",
+                               "--object_cache_base_dir",
+                               "project",
+                               "--remote_cache",
+                               "http://localhost:8080",
+                               "--remote_cache_read_only"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  STRCMP_EQUAL(buildcc::Args::GetObjectCacheBaseDir().string().c_str(),
+               "project");
+  STRCMP_EQUAL(buildcc::Args::GetRemoteCacheUrl().c_str(),
+               "http://localhost:8080");
+  CHECK_TRUE(buildcc::Args::RemoteCacheReadOnly());
+}
+
+TEST(ArgsTestGroup, Args_DistWorkers) {
+  std::vector<const char *> av{"",
+                               "--config",
+                               "configs/basic_parse.toml",
+                               "--dist_workers",
+                               "localhost",
+                               "127.0.0.1:3633/4"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  const auto &workers = buildcc::Args::GetDistWorkers();
+  CHECK_EQUAL(workers.size(), 2);
+  STRCMP_EQUAL(workers[0].c_str(), "localhost");
+  STRCMP_EQUAL(workers[1].c_str(), "127.0.0.1:3633/4");
+}
+
 TEST(ArgsTestGroup, Args_BasicExit) {
   UT_PRINT("Args_BasicExit\r\n");
   std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
@@ -1,5 +1,18 @@
 #include "args/register.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "env/jobserver.h"
+#include "env/memory_budget.h"
+
+#include "schema/dist_compile.h"
+#include "schema/object_cache.h"
+#include "schema/remote_cache.h"
+
 #include "expect_command.h"
 
 #include "mock_command_copier.h"
@@ -37,6 +50,121 @@ TEST(RegisterTestGroup, Register_Initialize) {
   buildcc::Reg::Init(); // Second init does nothing
 }
 
+TEST(RegisterTestGroup, Register_Executor) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--jobs", "2"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+  buildcc::Reg::Init();
+
+  // Created once and shared
+  tf::Executor &executor = buildcc::Reg::GetExecutor();
+  CHECK_EQUAL(executor.num_workers(), 2);
+  CHECK_TRUE(&executor == &buildcc::Reg::GetExecutor());
+}
+
+TEST(RegisterTestGroup, Register_JobServer) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--jobs", "2"};
+  int argc = av.size();
+
+  // Not invoked from a parallel make, provide a jobserver
+  unsetenv("MAKEFLAGS");
+  buildcc::Args::Init().Parse(argc, av.data());
+  buildcc::Reg::Init();
+  CHECK_TRUE(buildcc::env::JobServer::IsEnabled());
+  CHECK_TRUE(buildcc::env::JobServer::IsServer());
+  CHECK_TRUE(getenv("MAKEFLAGS") != nullptr);
+
+  buildcc::Reg::Deinit();
+  CHECK_FALSE(buildcc::env::JobServer::IsEnabled());
+  CHECK_TRUE(getenv("MAKEFLAGS") == nullptr);
+}
+
+TEST(RegisterTestGroup, Register_FailureMode) {
+  {
+    std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                                 "--fail_fast"};
+    int argc = av.size();
+    buildcc::Args::Init().Parse(argc, av.data());
+    buildcc::Reg::Init();
+    CHECK_TRUE(buildcc::env::get_failure_mode() ==
+               buildcc::env::FailureMode::FailFast);
+    buildcc::Reg::Deinit();
+    buildcc::Args::Deinit();
+  }
+
+  {
+    std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                                 "-k"};
+    int argc = av.size();
+    buildcc::Args::Init().Parse(argc, av.data());
+    buildcc::Reg::Init();
+    CHECK_TRUE(buildcc::env::get_failure_mode() ==
+               buildcc::env::FailureMode::KeepGoing);
+  }
+}
+
+TEST(RegisterTestGroup, Register_MemoryBudget) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--memory_budget", "512"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+  buildcc::Reg::Init();
+  CHECK_TRUE(buildcc::env::MemoryBudget::IsEnabled());
+
+  buildcc::Reg::Deinit();
+  CHECK_FALSE(buildcc::env::MemoryBudget::IsEnabled());
+}
+
+TEST(RegisterTestGroup, Register_ObjectCache) {
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--object_cache", "build/object_cache"};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+  buildcc::Reg::Init();
+  CHECK_TRUE(buildcc::internal::ObjectCache::IsEnabled());
+
+  buildcc::Reg::Deinit();
+  CHECK_FALSE(buildcc::internal::ObjectCache::IsEnabled());
+}
+
+TEST(RegisterTestGroup, Register_RemoteCache) {
+  buildcc::internal::RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  const std::string url = server.GetUrl();
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--remote_cache", url.c_str()};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+  buildcc::Reg::Init();
+  CHECK_TRUE(buildcc::internal::RemoteCache::IsEnabled());
+
+  buildcc::Reg::Deinit();
+  CHECK_FALSE(buildcc::internal::RemoteCache::IsEnabled());
+}
+
+TEST(RegisterTestGroup, Register_DistCompile) {
+  buildcc::internal::DistCompileWorker worker(2, {"gcc"}, "dist_compile");
+  CHECK_TRUE(worker.Start(0));
+  const std::string address = fmt::format("127.0.0.1:{}", worker.GetPort());
+  std::vector<const char *> av{"", "--config", "configs/basic_parse.toml",
+                               "--dist_workers", address.c_str()};
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+  buildcc::Reg::Init();
+  CHECK_TRUE(buildcc::internal::DistCompile::IsEnabled());
+  CHECK_EQUAL(buildcc::internal::DistCompile::GetSlots(), 2);
+
+  buildcc::Reg::Deinit();
+  CHECK_FALSE(buildcc::internal::DistCompile::IsEnabled());
+}
+
 TEST(RegisterTestGroup, Register_Clean) {
   {
     std::vector<const char *> av{"", "--config", "configs/basic_parse.toml"};
@@ -139,6 +267,32 @@ TEST(RegisterTestGroup, Register_Build) {
   mock().checkExpectations();
 }
 
+TEST(RegisterTestGroup, Register_BuildContext) {
+  buildcc::BuildContext context(fs::current_path(), fs::current_path());
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "",
+      buildcc::ToolchainExecutables("", "", "", "", ""));
+  buildcc::BaseTarget target("contextT", buildcc::TargetType::Executable,
+                             toolchain, buildcc::TargetEnv(context, ""));
+  CHECK_TRUE(&target.GetContext() == &context);
+
+  // Independent of the Reg singleton and the Global BuildContext
+  buildcc::Reg::Instance instance(context);
+  CHECK_TRUE(&instance.GetContext() == &context);
+  mock().expectNCalls(1, "BuildTask_contextT");
+  instance.Build([](buildcc::BaseTarget &target) { (void)target; }, target);
+  mock().checkExpectations();
+
+  // Builders of another BuildContext are rejected
+  buildcc::Project::Init(fs::current_path(), fs::current_path());
+  buildcc::BaseTarget global_target("globalT",
+                                    buildcc::TargetType::Executable, toolchain,
+                                    "");
+  CHECK_THROWS(std::exception,
+               instance.Build([](buildcc::BaseTarget &target) { (void)target; },
+                              global_target));
+}
+
 TEST(RegisterTestGroup, Register_Run_PostCb) {
   std::vector<const char *> av{
       "",
@@ -525,6 +679,142 @@ TEST(RegisterTestGroup, Register_DepCyclic) {
   mock().checkExpectations();
 }
 
+TEST(RegisterTestGroup, Register_DepGatesLink) {
+  std::vector<const char *> av{
+      "",
+      "--config",
+      "configs/basic_parse.toml",
+  };
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  // Make dummy toolchain, targets and generator
+  buildcc::Project::Init(fs::current_path(), fs::current_path());
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "",
+      buildcc::ToolchainExecutables("", "", "", "", ""));
+  buildcc::BaseTarget target("dummyT", buildcc::TargetType::Executable,
+                             toolchain, "");
+  buildcc::BaseTarget dependency("depT", buildcc::TargetType::Executable,
+                                 toolchain, "");
+  buildcc::CustomGenerator generator("depG", "");
+
+  buildcc::ArgToolchainState trueState{true, true};
+
+  buildcc::Reg::Init();
+  mock().expectNCalls(1, "BuildTask_dummyT");
+  mock().expectNCalls(1, "BuildTask_depT");
+  mock().expectNCalls(1, "BuildTask_depG");
+  buildcc::Reg::Toolchain(trueState)
+      .Build([](buildcc::BaseTarget &target) { (void)target; }, target)
+      .Build([](buildcc::BaseTarget &target) { (void)target; }, dependency)
+      .Build([](buildcc::CustomGenerator &generator) { (void)generator; },
+             generator)
+      .Dep(target, dependency)
+      .Dep(target, generator);
+
+  std::unordered_map<std::string, tf::Task> tasks;
+  buildcc::Reg::GetTaskflow().for_each_task(
+      [&](tf::Task task) { tasks.emplace(task.name(), task); });
+  const std::string compile_name =
+      fmt::format("{} Compile", target.GetUniqueId());
+  CHECK_EQUAL(tasks.size(), 5);
+
+  // Target objects compile after the generator and alongside the dependency
+  std::vector<std::string> compile_dependents;
+  tasks.at(compile_name).for_each_dependent([&](tf::Task task) {
+    compile_dependents.push_back(task.name());
+  });
+  CHECK_EQUAL(compile_dependents.size(), 1);
+  STRCMP_EQUAL(compile_dependents[0].c_str(), generator.GetUniqueId().c_str());
+
+  // Target links after the dependency is built
+  std::vector<std::string> link_dependents;
+  tasks.at(target.GetUniqueId()).for_each_dependent([&](tf::Task task) {
+    link_dependents.push_back(task.name());
+  });
+  CHECK_EQUAL(link_dependents.size(), 2);
+  CHECK_TRUE(std::find(link_dependents.begin(), link_dependents.end(),
+                       compile_name) != link_dependents.end());
+  CHECK_TRUE(std::find(link_dependents.begin(), link_dependents.end(),
+                       dependency.GetUniqueId()) != link_dependents.end());
+  buildcc::Reg::Deinit();
+
+  buildcc::Project::Deinit();
+  mock().checkExpectations();
+}
+
+TEST(RegisterTestGroup, Register_DepGeneratorTransitive) {
+  std::vector<const char *> av{
+      "",
+      "--config",
+      "configs/basic_parse.toml",
+  };
+  int argc = av.size();
+
+  buildcc::Args::Init().Parse(argc, av.data());
+
+  // A -> B -> G, C -> A
+  buildcc::Project::Init(fs::current_path(), fs::current_path());
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "",
+      buildcc::ToolchainExecutables("", "", "", "", ""));
+  buildcc::BaseTarget target_a("targetA", buildcc::TargetType::Executable,
+                               toolchain, "");
+  buildcc::BaseTarget target_b("targetB", buildcc::TargetType::StaticLibrary,
+                               toolchain, "");
+  buildcc::BaseTarget target_c("targetC", buildcc::TargetType::Executable,
+                               toolchain, "");
+  buildcc::CustomGenerator generator("generatorG", "");
+
+  buildcc::ArgToolchainState trueState{true, true};
+
+  buildcc::Reg::Init();
+  mock().expectNCalls(1, "BuildTask_targetA");
+  mock().expectNCalls(1, "BuildTask_targetB");
+  mock().expectNCalls(1, "BuildTask_targetC");
+  mock().expectNCalls(1, "BuildTask_generatorG");
+  // The generator dependency is added after the dependents
+  buildcc::Reg::Toolchain(trueState)
+      .Build([](buildcc::BaseTarget &target) { (void)target; }, target_a)
+      .Build([](buildcc::BaseTarget &target) { (void)target; }, target_b)
+      .Build([](buildcc::BaseTarget &target) { (void)target; }, target_c)
+      .Build([](buildcc::CustomGenerator &generator) { (void)generator; },
+             generator)
+      .Dep(target_c, target_a)
+      .Dep(target_a, target_b)
+      .Dep(target_b, generator);
+
+  std::unordered_map<std::string, tf::Task> tasks;
+  buildcc::Reg::GetTaskflow().for_each_task(
+      [&](tf::Task task) { tasks.emplace(task.name(), task); });
+  auto compile_dependents = [&](const buildcc::BaseTarget &target) {
+    std::vector<std::string> dependents;
+    tasks.at(fmt::format("{} Compile", target.GetUniqueId()))
+        .for_each_dependent(
+            [&](tf::Task task) { dependents.push_back(task.name()); });
+    return dependents;
+  };
+
+  // Generated headers of B may be included by A and C
+  for (const auto *target : {&target_a, &target_b, &target_c}) {
+    const std::vector<std::string> dependents = compile_dependents(*target);
+    CHECK_EQUAL(dependents.size(), 1);
+    STRCMP_EQUAL(dependents[0].c_str(), generator.GetUniqueId().c_str());
+  }
+
+  // Direct dependencies on a transitive generator do not add another edge
+  buildcc::Reg::Toolchain(trueState).Dep(target_a, generator);
+  CHECK_EQUAL(compile_dependents(target_a).size(), 1);
+  CHECK_THROWS(std::exception,
+               buildcc::Reg::Toolchain(trueState).Dep(target_a, generator));
+  buildcc::Reg::Deinit();
+
+  buildcc::Project::Deinit();
+  mock().checkExpectations();
+}
+
 TEST(RegisterTestGroup, Register_Test) {
   // Arguments
   std::vector<const char *> av{
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_BUILD_CONTEXT_H_
+#define ENV_BUILD_CONTEXT_H_
+
+#include <atomic>
+#include <filesystem>
+
+#include "env/task_state.h"
+
+namespace fs = std::filesystem;
+
+namespace buildcc {
+
+/**
+ * @brief State of a single build
+ * Project directories, the TaskState and the FailureMode of the build
+ *
+ * Targets and Generators use the context of their TargetEnv, independent
+ * builds in the same process use separate contexts
+ * The static `Project` and `env::*_task_state` APIs use the Global context
+ */
+class BuildContext {
+public:
+  BuildContext() = default;
+  explicit BuildContext(const fs::path &project_root_dir,
+                        const fs::path &project_build_dir) {
+    Init(project_root_dir, project_build_dir);
+  }
+  BuildContext(const BuildContext &) = delete;
+  BuildContext &operator=(const BuildContext &) = delete;
+
+  static BuildContext &Global();
+
+  void Init(const fs::path &project_root_dir,
+            const fs::path &project_build_dir);
+  void Deinit();
+
+  bool IsInit() const { return init_; }
+  const fs::path &GetRootDir() const { return root_dir_; }
+  const fs::path &GetBuildDir() const { return build_dir_; }
+
+  // NOTE, Lock free, updated concurrently by the tasks of the build
+  void SetTaskState(env::TaskState state) { task_state_.store(state); }
+  env::TaskState GetTaskState() const { return task_state_.load(); }
+
+  void SetFailureMode(env::FailureMode mode) { failure_mode_.store(mode); }
+  env::FailureMode GetFailureMode() const { return failure_mode_.load(); }
+
+private:
+  bool init_{false};
+  fs::path root_dir_;
+  fs::path build_dir_;
+  std::atomic<env::TaskState> task_state_{env::TaskState::SUCCESS};
+  std::atomic<env::FailureMode> failure_mode_{env::FailureMode::Stop};
+};
+
+} // namespace buildcc
+
+#endif
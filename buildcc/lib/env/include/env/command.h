@@ -17,18 +17,45 @@
 #ifndef ENV_COMMAND_H_
 #define ENV_COMMAND_H_
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "env/command_line.h"
+#include "env/command_template.h"
 #include "env/optional.h"
 
 namespace fs = std::filesystem;
 
+namespace buildcc {
+
+class BuildContext;
+
+} // namespace buildcc
+
 namespace buildcc::env {
 
+/**
+ * @brief Resource usage of an executed command
+ */
+struct CommandStats {
+  // Peak resident set size of the command and the subprocesses it waited
+  // for, 0 when not supported on the host
+  std::uint64_t peak_rss_bytes{0};
+  // Time between the start and the exit of the command, only measured by
+  // ExecuteAsync
+  std::chrono::milliseconds duration{0};
+};
+
 class Command {
+public:
+  using ExitCallback =
+      std::function<void(bool success, const CommandStats &stats)>;
+
 public:
   explicit Command() = default;
 
@@ -61,6 +88,13 @@ public:
                         const std::unordered_map<const char *, std::string>
                             &arguments = {}) const;
 
+  /**
+   * @brief Parses `pattern` once and binds the default arguments
+   * Use this over `Construct` when the same pattern is constructed repeatedly
+   * with a few changing arguments
+   */
+  CommandTemplate CreateTemplate(const std::string &pattern) const;
+
   /**
    * @brief Execute a particular command over a subprocess and optionally
    * redirect stdout and stderr to user supplied dynamic string lists
@@ -69,6 +103,9 @@ public:
    * @param working_directory Current working directory
    * @param stdout_data Redirect stdout to user OR default print to console
    * @param stderr_data Redirect stderr to user OR default print to console
+   * @param stats Resource usage of the command once it exits
+   * @param context Build that the command belongs to, the Global BuildContext
+   * when not supplied
    * @return true when exit code = 0
    * @return false when exit code != 0
    */
@@ -77,7 +114,71 @@ public:
   static bool Execute(const std::string &command,
                       const optional<fs::path> &working_directory = {},
                       std::vector<std::string> *stdout_data = nullptr,
-                      std::vector<std::string> *stderr_data = nullptr);
+                      std::vector<std::string> *stderr_data = nullptr,
+                      CommandStats *stats = nullptr,
+                      BuildContext *context = nullptr);
+
+  /**
+   * @brief Execute `command_line` without a shell, `arguments[0]` is searched
+   * in PATH
+   * See Execute for the remaining parameters
+   *
+   * NOTE, The arguments are quoted and run on the shell when the
+   * ProcessReaper is not enabled
+   */
+  static bool Execute(const CommandLine &command_line,
+                      std::vector<std::string> *stdout_data = nullptr,
+                      std::vector<std::string> *stderr_data = nullptr,
+                      CommandStats *stats = nullptr,
+                      BuildContext *context = nullptr);
+
+  /**
+   * @brief Execute a command without waiting for it to exit
+   * The output of the command is not redirected
+   *
+   * When the ProcessReaper is enabled `on_exit` is invoked in exit order on a
+   * completion thread shared by every command and should not block, otherwise
+   * the command is executed synchronously and `on_exit` is invoked before
+   * ExecuteAsync returns
+   *
+   * Commands that have to wait for a job slot, for their
+   * `predicted_memory_bytes` in the MemoryBudget or for a ProcessReaper slot
+   * are queued and started by a dispatch thread, `on_exit` may also be
+   * invoked there
+   * Queued commands are started highest `priority` first (such as the
+   * estimated duration of the longest chain of jobs that waits for the
+   * command), commands with the same priority in order
+   */
+  static void ExecuteAsync(const std::string &command,
+                           const optional<fs::path> &working_directory,
+                           const ExitCallback &on_exit,
+                           BuildContext *context = nullptr,
+                           std::uint64_t predicted_memory_bytes = 0,
+                           std::uint64_t priority = 0);
+  static void ExecuteAsync(const CommandLine &command_line,
+                           const ExitCallback &on_exit,
+                           BuildContext *context = nullptr,
+                           std::uint64_t predicted_memory_bytes = 0,
+                           std::uint64_t priority = 0);
+
+  /**
+   * @brief Terminates every command in flight that belongs to `context`
+   * In FailureMode::FailFast commands are not started once the TaskState of
+   * their BuildContext is FAILURE
+   */
+  static void CancelAll(const BuildContext &context);
+
+  /**
+   * @brief Split `command` into arguments, see CommandLine::Split
+   * Commands that are run this way without a shell behave the same as on the
+   * shell
+   *
+   * @return Empty when `command` uses shell syntax other than quoting
+   * (expansions, redirections, pipelines, variable assignments etc) or has no
+   * arguments
+   */
+  static optional<std::vector<std::string>>
+  SplitArguments(const std::string &command);
 
   /**
    * @brief Get the Default Value By Key object
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_COMMAND_LINE_H_
+#define ENV_COMMAND_LINE_H_
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "env/optional.h"
+
+namespace fs = std::filesystem;
+
+namespace buildcc::env {
+
+/**
+ * @brief Arguments of a command and the directory it runs in
+ *
+ * `arguments[0]` is the executable, every argument is passed to the process
+ * as is. Commands are only joined into a string (see ToString) for display
+ * and for hosts that run them on the shell
+ */
+class CommandLine {
+public:
+  CommandLine() = default;
+  explicit CommandLine(std::vector<std::string> arguments,
+                       optional<fs::path> working_directory = {})
+      : arguments_(std::move(arguments)),
+        working_directory_(std::move(working_directory)) {}
+
+  void AddArgument(std::string argument) {
+    arguments_.push_back(std::move(argument));
+  }
+  void SetWorkingDirectory(const fs::path &working_directory) {
+    working_directory_ = working_directory;
+  }
+
+  bool IsEmpty() const { return arguments_.empty(); }
+  const std::vector<std::string> &GetArguments() const { return arguments_; }
+  const optional<fs::path> &GetWorkingDirectory() const {
+    return working_directory_;
+  }
+
+  /**
+   * @brief Joins the arguments, quoted for the host shell
+   * The shell splits the string back into the same arguments
+   */
+  std::string ToString() const;
+
+  /**
+   * @brief Splits a command (or a part of one) into arguments the same way
+   * the host shell does
+   * POSIX: Words separated by whitespace, quoted with '' or "" and escaped
+   * with a backslash
+   * Windows: Words separated by whitespace and quoted with "", backslashes
+   * only escape double quotes
+   *
+   * @return Empty when `command` uses any other shell syntax (expansions,
+   * redirections, pipelines etc) or has an unterminated quote
+   */
+  static optional<std::vector<std::string>> Split(const std::string &command);
+
+  bool operator==(const CommandLine &other) const {
+    return arguments_ == other.arguments_ &&
+           working_directory_ == other.working_directory_;
+  }
+
+private:
+  std::vector<std::string> arguments_;
+  optional<fs::path> working_directory_;
+};
+
+} // namespace buildcc::env
+
+#endif
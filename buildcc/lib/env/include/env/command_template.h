@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_COMMAND_TEMPLATE_H_
+#define ENV_COMMAND_TEMPLATE_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "env/command_line.h"
+#include "env/optional.h"
+
+namespace buildcc::env {
+
+/**
+ * @brief Command pattern that is parsed once and rendered many times
+ *
+ * `{name}` replacement fields are split from the literal text when the
+ * template is created. Fields can be bound to values up front (see Bind), so
+ * that rendering only concatenates the literal text with the values of the
+ * remaining fields
+ *
+ * Renders the same string as `Command::Construct` for the same pattern and
+ * arguments. Values bound first take precedence over values bound later
+ *
+ * The template also renders the arguments of the command (see
+ * RenderCommandLine), the text of the pattern and the bound values is split
+ * into arguments once
+ *
+ * NOTE, Patterns with automatic or positional fields or format specs
+ * (`{}`, `{0}`, `{name:>8}`) are formatted through fmt on every Render
+ */
+class CommandTemplate {
+public:
+  using Arguments = std::unordered_map<const char *, std::string>;
+
+public:
+  CommandTemplate() = default;
+  explicit CommandTemplate(const std::string &pattern);
+
+  /**
+   * @brief Replaces the fields named in `values` with their value
+   * Other fields are left for Bind or Render
+   */
+  CommandTemplate &
+  Bind(const std::unordered_map<std::string, std::string> &values);
+
+  /**
+   * @brief Constructs the command using `arguments` for the unbound fields
+   * Assert Fatal if an unbound field has no argument
+   */
+  std::string Render(const Arguments &arguments = {}) const;
+
+  /**
+   * @brief Constructs the arguments of the command
+   * The pattern and the bound values are split the same way as the host
+   * shell splits them (see CommandLine::Split). `arguments` are inserted
+   * as is, pass unquoted paths for example
+   * Fields that are an argument on their own and render to an empty value do
+   * not add an argument, same as an unquoted empty value on the shell
+   *
+   * @return Empty when the pattern or a bound value uses shell syntax that
+   * cannot be represented as arguments
+   */
+  optional<CommandLine>
+  RenderCommandLine(const Arguments &arguments = {}) const;
+
+private:
+  struct Segment {
+    std::string text;
+    // Replacement field named `text`
+    bool field{false};
+  };
+
+  // Argument made of literal text and unbound fields
+  struct Word {
+    std::vector<Segment> parts;
+    // Contains literal text, kept even when empty
+    bool literal{false};
+  };
+
+  template <typename Lookup> void BindSegments(const Lookup &lookup);
+  void SplitWords();
+
+private:
+  std::vector<Segment> segments_;
+  std::vector<Word> words_;
+  bool splittable_{false};
+
+  // Patterns that are formatted through fmt
+  bool dynamic_{false};
+  std::string pattern_;
+  std::vector<std::pair<std::string, std::string>> bound_;
+};
+
+} // namespace buildcc::env
+
+#endif
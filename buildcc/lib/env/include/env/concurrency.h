@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_CONCURRENCY_H_
+#define ENV_CONCURRENCY_H_
+
+#include <string_view>
+
+#include "env/optional.h"
+
+namespace buildcc::env {
+
+/**
+ * @brief Parse the contents of a cgroup v2 `cpu.max` file
+ * Format: `$MAX $PERIOD` where `$MAX` is `max` when the quota is unlimited
+ *
+ * @return Number of CPUs allowed by the quota (rounded up, atleast 1). Empty
+ * when the quota is unlimited or the data is malformed
+ */
+optional<unsigned int> parse_cgroup_cpu_max(std::string_view data);
+
+/**
+ * @brief Number of CPUs allowed by the cgroup v2 `cpu.max` quota of the
+ * current process and its parent cgroups
+ *
+ * @return Empty when unlimited or when cgroup v2 is not available
+ */
+optional<unsigned int> get_cgroup_cpu_quota();
+
+/**
+ * @brief Number of CPUs the current process is allowed to run on
+ * Uses the process CPU affinity when supported, otherwise
+ * `std::thread::hardware_concurrency`
+ */
+unsigned int get_affinity_cpu_count();
+
+/**
+ * @brief Default number of parallel jobs for the host
+ * Minimum of `get_affinity_cpu_count` and `get_cgroup_cpu_quota`, atleast 1
+ */
+unsigned int get_available_concurrency();
+
+} // namespace buildcc::env
+
+#endif
@@ -25,6 +25,9 @@ namespace fs = std::filesystem;
 
 namespace buildcc {
 
+/**
+ * @brief Project directories of the Global BuildContext
+ */
 class Project {
 public:
   Project() = delete;
@@ -37,11 +40,6 @@ public:
   static bool IsInit();
   static const fs::path &GetRootDir();
   static const fs::path &GetBuildDir();
-
-private:
-  static bool &GetStaticInit();
-  static fs::path &GetStaticRootDir();
-  static fs::path &GetStaticBuildDir();
 };
 
 } // namespace buildcc
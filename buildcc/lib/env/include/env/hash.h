@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_HASH_H_
+#define ENV_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace buildcc::env {
+
+/**
+ * @brief Fast non-cryptographic 64-bit hash of a memory buffer
+ * Bit-compatible with XXH3_64bits (seed 0, default secret)
+ * Uses SSE2 when available for inputs larger than 240 bytes
+ *
+ * @param data Pointer to the buffer, may be nullptr when len is 0
+ * @param len Length of the buffer in bytes
+ * @return std::uint64_t Hash value
+ */
+std::uint64_t hash_bytes(const void *data, std::size_t len);
+
+inline std::uint64_t hash_bytes(const std::string &data) {
+  return hash_bytes(data.data(), data.size());
+}
+
+/**
+ * @brief Hashes the complete contents of a file using `hash_bytes`
+ * Files are memory mapped on POSIX hosts and read otherwise
+ *
+ * @param name File to hash
+ * @param hash Output hash value
+ * @return true when the file was read successfully
+ */
+bool hash_file(const char *name, std::uint64_t *hash);
+
+/**
+ * @brief SHA-256 digest of a memory buffer
+ * Used where digests are shared with other tools (for example content
+ * addressed remote caches), prefer `hash_bytes` otherwise
+ *
+ * @return std::string Lowercase hex digest (64 characters)
+ */
+std::string sha256_hex(const void *data, std::size_t len);
+
+inline std::string sha256_hex(const std::string &data) {
+  return sha256_hex(data.data(), data.size());
+}
+
+} // namespace buildcc::env
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_HTTP_H_
+#define ENV_HTTP_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "env/optional.h"
+
+namespace buildcc::env {
+
+struct HttpRequest {
+  std::string method;
+  // Request target, for example `/cas/<digest>`
+  std::string path;
+  std::string body;
+};
+
+struct HttpResponse {
+  int status{0};
+  std::string body;
+};
+
+/**
+ * @brief Minimal blocking HTTP/1.1 client for `http://host[:port][/base]`
+ * urls
+ *
+ * Requests may be made from multiple threads, idle keep-alive connections
+ * are reused by later requests
+ * Bodies are sent with `Content-Length`, responses are read with
+ * `Content-Length`, chunked transfer encoding or until the server closes the
+ * connection
+ *
+ * NOTE, TLS is not supported
+ * NOTE, Only supported on POSIX hosts, requests always fail otherwise
+ */
+class HttpClient {
+public:
+  /**
+   * @param timeout Applies to every read and write
+   * @param connect_timeout Applies to connecting
+   */
+  HttpClient(const std::string &url, std::chrono::milliseconds timeout,
+             std::chrono::milliseconds connect_timeout);
+
+  /**
+   * @param timeout Applies to connecting and to every read and write
+   */
+  HttpClient(const std::string &url, std::chrono::milliseconds timeout)
+      : HttpClient(url, timeout, timeout) {}
+  ~HttpClient();
+
+  HttpClient(const HttpClient &) = delete;
+  HttpClient &operator=(const HttpClient &) = delete;
+
+  // false when the url could not be parsed
+  bool IsValid() const { return valid_; }
+
+  /**
+   * @brief Sends `method` for `path` (appended to the base path of the url)
+   *
+   * @return Response of the server, empty when the server could not be
+   * reached or the response could not be read
+   */
+  env::optional<HttpResponse> Request(const std::string &method,
+                                      const std::string &path,
+                                      const std::string &body = {});
+
+private:
+  int Connect();
+  void ReleaseConnection(int fd);
+
+private:
+  bool valid_{false};
+  std::string host_;
+  std::string port_;
+  std::string base_path_;
+  std::chrono::milliseconds timeout_;
+  std::chrono::milliseconds connect_timeout_;
+
+  std::mutex mutex_;
+  std::vector<int> idle_;
+};
+
+/**
+ * @brief Minimal HTTP/1.1 server listening on an IPv4 address
+ * Every connection is served on its own thread, connections are kept alive
+ * until the client closes them
+ * Intended for tests, local tools and trusted networks
+ *
+ * NOTE, Only supported on POSIX hosts, Start fails otherwise
+ */
+class HttpServer {
+public:
+  // Invoked concurrently for requests of different connections
+  using Handler = std::function<HttpResponse(const HttpRequest &request)>;
+
+public:
+  explicit HttpServer(const Handler &handler) : handler_(handler) {}
+  ~HttpServer() { Stop(); }
+
+  HttpServer(const HttpServer &) = delete;
+  HttpServer &operator=(const HttpServer &) = delete;
+
+  /**
+   * @brief Listens on `address:port`
+   *
+   * @param port 0 picks a free port, see GetPort
+   * @param address IPv4 address of the interface, `0.0.0.0` for every
+   * interface
+   */
+  bool Start(std::uint16_t port = 0,
+             const std::string &address = "127.0.0.1");
+
+  /**
+   * @brief Closes every connection and waits for their threads
+   */
+  void Stop();
+
+  std::uint16_t GetPort() const { return port_; }
+
+private:
+  struct Connection {
+    int fd{-1};
+    std::thread thread;
+    std::atomic<bool> done{false};
+  };
+
+  void AcceptLoop();
+  void Serve(Connection &connection);
+  void JoinDone();
+
+private:
+  Handler handler_;
+  int listen_fd_{-1};
+  std::uint16_t port_{0};
+  std::atomic<bool> running_{false};
+  std::thread accept_thread_;
+
+  std::mutex mutex_;
+  std::list<std::unique_ptr<Connection>> connections_;
+};
+
+} // namespace buildcc::env
+
+#endif
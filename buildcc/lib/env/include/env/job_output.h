@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_JOB_OUTPUT_H_
+#define ENV_JOB_OUTPUT_H_
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace buildcc::env {
+
+/**
+ * @brief Append only byte buffer for the output of a command
+ *
+ * Bytes are copied into fixed size blocks that are recycled through a
+ * process wide pool, capturing output does not allocate once the pool is
+ * warm
+ *
+ * Bytes appended beyond `max_bytes` are dropped and counted
+ */
+class OutputBuffer {
+public:
+  static constexpr std::size_t kBlockSize = 16 * 1024;
+
+public:
+  /**
+   * @param max_bytes Maximum number of buffered bytes, 0 for no limit
+   */
+  explicit OutputBuffer(std::size_t max_bytes = 0) : max_bytes_(max_bytes) {}
+  ~OutputBuffer() { Clear(); }
+
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+  OutputBuffer(OutputBuffer &&other) noexcept { *this = std::move(other); }
+  OutputBuffer &operator=(OutputBuffer &&other) noexcept;
+
+  void Append(const char *bytes, std::size_t n);
+
+  /**
+   * @brief Returns the blocks to the pool
+   */
+  void Clear();
+
+  bool IsEmpty() const { return size_ == 0; }
+  std::size_t GetSize() const { return size_; }
+  // Bytes that were not buffered because of `max_bytes`
+  std::size_t GetDropped() const { return dropped_; }
+  std::string ToString() const;
+
+  /**
+   * @brief Writes the buffered bytes to `stream`
+   */
+  void WriteTo(std::FILE *stream) const;
+
+private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::size_t size_{0};
+  std::size_t dropped_{0};
+  std::size_t max_bytes_{0};
+};
+
+/**
+ * @brief Process wide grouping of command output
+ *
+ * When enabled the stdout and stderr of every command that is not
+ * redirected to the caller are buffered, and printed together once the
+ * command exits. The output of parallel jobs does not interleave on the
+ * console
+ */
+class JobOutput {
+public:
+  JobOutput() = delete;
+  JobOutput(const JobOutput &) = delete;
+  JobOutput(JobOutput &&) = delete;
+
+  /**
+   * @param max_bytes Maximum number of buffered bytes per stream of a job,
+   * 0 for no limit
+   */
+  static void Init(std::size_t max_bytes);
+  static void Deinit();
+
+  static bool IsEnabled();
+  static std::size_t GetMaxBytes();
+
+  /**
+   * @brief Writes the output of a job to stdout and stderr without
+   * interleaving with other jobs
+   * Truncated streams are followed by a note with the number of dropped bytes
+   */
+  static void Print(const OutputBuffer &stdout_buffer,
+                    const OutputBuffer &stderr_buffer);
+};
+
+} // namespace buildcc::env
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_JOBSERVER_H_
+#define ENV_JOBSERVER_H_
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "env/optional.h"
+
+namespace buildcc::env {
+
+/**
+ * @brief Connection details advertised through `MAKEFLAGS`
+ * `--jobserver-auth=fifo:PATH` (GNU make 4.4+) or `--jobserver-auth=R,W`
+ * (`--jobserver-fds=R,W` on older versions)
+ */
+struct JobServerAuth {
+  enum class Type {
+    Fifo,
+    Pipe,
+  };
+
+  Type type{Type::Fifo};
+  std::string fifo_path;
+  int read_fd{-1};
+  int write_fd{-1};
+};
+
+/**
+ * @brief Process wide GNU make jobserver
+ *
+ * Client: When buildcc is invoked from a parallel make (or any other
+ * jobserver) it shares the parent's job slots
+ * Server: Otherwise buildcc provides a fifo jobserver with `jobs` slots and
+ * advertises it to its children through `MAKEFLAGS`
+ *
+ * Every process owns one implicit job slot, additional slots are tokens read
+ * from the jobserver and written back once the job completes
+ *
+ * NOTE, Only supported on POSIX hosts, Acquire always succeeds otherwise
+ */
+class JobServer {
+public:
+  /**
+   * @brief RAII job slot, released on destruction
+   */
+  class Token {
+  public:
+    Token() = default;
+    ~Token() { Release(); }
+
+    Token(const Token &) = delete;
+    Token &operator=(const Token &) = delete;
+    Token(Token &&other) noexcept { *this = std::move(other); }
+    Token &operator=(Token &&other) noexcept;
+
+    void Release();
+
+    // NOTE, Tokens acquired while the JobServer is disabled are not valid
+    bool IsValid() const { return valid_; }
+
+  private:
+    friend class JobServer;
+    Token(char byte, bool implicit)
+        : byte_(byte), implicit_(implicit), valid_(true) {}
+
+  private:
+    char byte_{0};
+    bool implicit_{false};
+    bool valid_{false};
+  };
+
+public:
+  JobServer() = delete;
+  JobServer(const JobServer &) = delete;
+  JobServer(JobServer &&) = delete;
+
+  /**
+   * @brief Parse the jobserver advertised in a `MAKEFLAGS` value
+   * The last jobserver option wins, as done by GNU make
+   */
+  static optional<JobServerAuth> ParseMakeflags(std::string_view makeflags);
+
+  /**
+   * @brief Connect to the jobserver advertised in `makeflags`
+   *
+   * @return false when no jobserver is advertised or it cannot be used, for
+   * example when the pipe file descriptors were not inherited
+   */
+  static bool InitClient(std::string_view makeflags);
+
+  /**
+   * @brief Create a fifo jobserver with `jobs` slots and advertise it to child
+   * processes through the `MAKEFLAGS` environment variable
+   */
+  static bool InitServer(unsigned int jobs);
+
+  /**
+   * @brief Disconnect from the jobserver
+   * Servers remove their fifo and restore `MAKEFLAGS`
+   */
+  static void Deinit();
+
+  static bool IsEnabled();
+  static bool IsServer();
+
+  /**
+   * @brief Blocks until a job slot is available
+   * Returns an invalid token immediately when the JobServer is disabled
+   */
+  static Token Acquire();
+
+  /**
+   * @brief Non blocking Acquire
+   *
+   * @return false when the JobServer is enabled and no slot is available
+   */
+  static bool TryAcquire(Token &token);
+};
+
+} // namespace buildcc::env
+
+#endif
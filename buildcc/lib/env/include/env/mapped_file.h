@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_MAPPED_FILE_H_
+#define ENV_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace buildcc::env {
+
+/**
+ * @brief Read only view of the complete contents of a file
+ * Files are memory mapped on POSIX hosts and read into an owned buffer
+ * otherwise
+ * The view is valid until the MappedFile is closed or destroyed
+ */
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * @brief Maps the regular file `name`
+   * Closes any previously opened file
+   *
+   * @return true when the file could be opened and mapped
+   */
+  bool Open(const char *name);
+  void Close();
+
+  const char *GetData() const { return data_; }
+  std::size_t GetSize() const { return size_; }
+  std::string_view GetView() const { return std::string_view(data_, size_); }
+
+private:
+  const char *data_{nullptr};
+  std::size_t size_{0};
+  bool mapped_{false};
+
+  // Used when memory mapping is not supported
+  std::string buffer_;
+};
+
+} // namespace buildcc::env
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_MEMORY_BUDGET_H_
+#define ENV_MEMORY_BUDGET_H_
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "env/optional.h"
+
+namespace buildcc::env {
+
+/**
+ * @brief Parse the `MemAvailable` value (in bytes) of a `/proc/meminfo`
+ * formatted string
+ */
+optional<std::uint64_t> parse_meminfo_available(std::string_view meminfo);
+
+/**
+ * @brief Memory available for new processes without swapping
+ * Empty when `/proc/meminfo` is not supported on the host
+ */
+optional<std::uint64_t> get_meminfo_available();
+
+/**
+ * @brief Process wide memory admission control for jobs
+ *
+ * Every job reserves its predicted peak memory before it is started, new jobs
+ * are admitted only while the reserved total stays under the budget
+ * Optionally jobs are also held back while `/proc/meminfo` MemAvailable is
+ * lower than their predicted peak memory
+ *
+ * A job is always admitted when no other job is in flight so that jobs
+ * larger than the budget still make progress
+ * Jobs without a prediction reserve 0 bytes and are only limited by the
+ * MemAvailable check
+ */
+class MemoryBudget {
+public:
+  /**
+   * @brief RAII memory reservation, released on destruction
+   */
+  class Reservation {
+  public:
+    Reservation() = default;
+    ~Reservation() { Release(); }
+
+    Reservation(const Reservation &) = delete;
+    Reservation &operator=(const Reservation &) = delete;
+    Reservation(Reservation &&other) noexcept { *this = std::move(other); }
+    Reservation &operator=(Reservation &&other) noexcept;
+
+    void Release();
+
+    // NOTE, Reservations acquired while the MemoryBudget is disabled are not
+    // valid
+    bool IsValid() const { return valid_; }
+    std::uint64_t GetBytes() const { return bytes_; }
+
+  private:
+    friend class MemoryBudget;
+    explicit Reservation(std::uint64_t bytes) : bytes_(bytes), valid_(true) {}
+
+  private:
+    std::uint64_t bytes_{0};
+    bool valid_{false};
+  };
+
+public:
+  MemoryBudget() = delete;
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget(MemoryBudget &&) = delete;
+
+  /**
+   * @brief Enable admission control
+   *
+   * @param budget_bytes Limit for the predicted memory of all jobs in flight,
+   * 0 for no limit
+   * @param check_meminfo Also check `/proc/meminfo` MemAvailable
+   */
+  static void Init(std::uint64_t budget_bytes, bool check_meminfo);
+
+  /**
+   * @brief Disable admission control and wake up all waiting jobs
+   */
+  static void Deinit();
+
+  static bool IsEnabled();
+
+  /**
+   * @brief Predicted memory of all jobs in flight
+   */
+  static std::uint64_t GetReserved();
+
+  /**
+   * @brief Blocks until the job can be admitted
+   * Returns an invalid reservation immediately when the MemoryBudget is
+   * disabled
+   */
+  static Reservation Acquire(std::uint64_t predicted_bytes);
+
+  /**
+   * @brief Non blocking Acquire
+   *
+   * @return false when the MemoryBudget is enabled and the job cannot be
+   * admitted
+   */
+  static bool TryAcquire(std::uint64_t predicted_bytes,
+                         Reservation &reservation);
+};
+
+} // namespace buildcc::env
+
+#endif
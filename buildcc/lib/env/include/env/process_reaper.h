@@ -0,0 +1,162 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENV_PROCESS_REAPER_H_
+#define ENV_PROCESS_REAPER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace buildcc::env {
+
+/**
+ * @brief Exit information of a process spawned by the ProcessReaper
+ */
+struct ProcessExit {
+  // Exit code, -1 when the process was terminated by a signal
+  int exit_status{-1};
+  // Peak resident set size of the process and the subprocesses it waited for
+  std::uint64_t peak_rss_bytes{0};
+};
+
+/**
+ * @brief Process wide Linux process backend
+ *
+ * Commands are spawned with `posix_spawn` which uses vfork semantics, the
+ * address space of the (possibly large) build process is never copied
+ *
+ * A single reaper thread waits on the pidfd and the output pipes of every
+ * child through epoll. Callers are notified once a child has been reaped and
+ * its output drained, so the number of processes in flight does not depend
+ * on the number of threads waiting for them
+ *
+ * NOTE, Requires Linux 5.3+ (`pidfd_open`) and glibc 2.29+
+ * (`posix_spawn_file_actions_addchdir_np`), Init fails otherwise
+ */
+class ProcessReaper {
+public:
+  /**
+   * @brief RAII process slot reserved for one Spawn, released on destruction
+   * when it was not spawned
+   */
+  class Slot {
+  public:
+    Slot() : valid_(false) {}
+    ~Slot() { Release(); }
+
+    Slot(const Slot &) = delete;
+    Slot &operator=(const Slot &) = delete;
+    Slot(Slot &&other) noexcept : valid_(false) {
+      *this = std::move(other);
+    }
+    Slot &operator=(Slot &&other) noexcept;
+
+    void Release();
+
+    // NOTE, Slots acquired without a `max_processes` limit are not valid
+    bool IsValid() const { return valid_; }
+
+  private:
+    friend class ProcessReaper;
+    explicit Slot(bool valid) : valid_(valid) {}
+
+  private:
+    // NOTE, Not a default member initializer, Slot is a default argument of
+    // Spawn
+    bool valid_;
+  };
+
+  using OutputCallback = std::function<void(const char *bytes, std::size_t n)>;
+  using ExitCallback = std::function<void(const ProcessExit &exit)>;
+
+public:
+  ProcessReaper() = delete;
+  ProcessReaper(const ProcessReaper &) = delete;
+  ProcessReaper(ProcessReaper &&) = delete;
+
+  /**
+   * @brief Starts the reaper thread
+   *
+   * @param max_processes Spawn blocks while this many children are in
+   * flight, 0 for no limit
+   * @return false when the host does not support the backend
+   */
+  static bool Init(unsigned int max_processes);
+
+  /**
+   * @brief Waits for the children in flight and stops the reaper thread
+   */
+  static void Deinit();
+
+  static bool IsEnabled();
+
+  /**
+   * @brief Non blocking reservation of a process slot
+   *
+   * @return false when `max_processes` children are in flight or reserved
+   */
+  static bool TryAcquireSlot(Slot &slot);
+
+  /**
+   * @brief Runs `command` on the shell in a new process group
+   * Blocks while `max_processes` children are in flight, unless `slot` was
+   * reserved with TryAcquireSlot
+   *
+   * @param working_directory Current directory of the child, inherited when
+   * empty
+   * @param on_stdout Receives the stdout of the child, inherited when nullptr
+   * @param on_stderr Receives the stderr of the child, inherited when nullptr
+   * @param on_exit Invoked once the child exits
+   * @return Process id of the child, -1 when the command could not be spawned
+   * (`on_exit` is not invoked)
+   *
+   * NOTE, Callbacks are invoked on the reaper thread and must not block
+   */
+  static int Spawn(const std::string &command,
+                   const std::string &working_directory,
+                   const OutputCallback &on_stdout,
+                   const OutputCallback &on_stderr,
+                   const ExitCallback &on_exit, Slot slot = Slot());
+
+  /**
+   * @brief Runs `arguments[0]` (searched in PATH) with `arguments` as its argv
+   * in a new process group, without a shell
+   * See Spawn for the remaining parameters
+   */
+  static int Spawn(const std::vector<std::string> &arguments,
+                   const std::string &working_directory,
+                   const OutputCallback &on_stdout,
+                   const OutputCallback &on_stderr,
+                   const ExitCallback &on_exit, Slot slot = Slot());
+
+  /**
+   * @brief Terminates the process group of a child
+   * Children that were already reaped are ignored, their process id may
+   * belong to an unrelated process
+   */
+  static void Kill(int pid);
+
+  // Number of children spawned and not yet reaped
+  static std::size_t GetInFlight();
+};
+
+} // namespace buildcc::env
+
+#endif
@@ -17,6 +17,15 @@
 #ifndef ENV_TASK_STATE_H_
 #define ENV_TASK_STATE_H_
 
+#include <atomic>
+#include <vector>
+
+namespace buildcc {
+
+class BuildContext;
+
+} // namespace buildcc
+
 namespace buildcc::env {
 
 enum class TaskState {
@@ -25,9 +34,74 @@ enum class TaskState {
   // TODO, Add more states here
 };
 
+/**
+ * @brief Result of the build using the Global BuildContext
+ * Set to FAILURE when any FailureScope of the context fails
+ */
 void set_task_state(TaskState state);
 TaskState get_task_state();
 
+enum class FailureMode {
+  // Tasks that have not started are skipped, commands in flight complete
+  Stop,
+  // Tasks that have not started are skipped, commands in flight are
+  // terminated
+  FailFast,
+  // Only the tasks of the failed scope and its downstream scopes are skipped
+  KeepGoing,
+};
+
+/**
+ * @brief FailureMode of the Global BuildContext
+ */
+void set_failure_mode(FailureMode mode);
+FailureMode get_failure_mode();
+
+/**
+ * @brief Failure state of a single build unit (Target or Generator)
+ *
+ * Scopes that consume the outputs of other scopes add them as upstream
+ * scopes, a failure is visible to every downstream scope
+ * NOTE, Upstream scopes must be added before the build starts and must
+ * outlive this scope
+ */
+class FailureScope {
+public:
+  FailureScope();
+  explicit FailureScope(BuildContext &context) : context_(&context) {}
+  FailureScope(const FailureScope &) = delete;
+  FailureScope &operator=(const FailureScope &) = delete;
+
+  /**
+   * @brief Marks this scope as failed and sets the TaskState of its
+   * BuildContext to FAILURE
+   * Terminates the commands in flight of the BuildContext in
+   * FailureMode::FailFast
+   */
+  void Fail();
+
+  /**
+   * @brief true when this scope or any upstream scope has failed
+   */
+  bool IsFailed() const;
+
+  /**
+   * @brief true when the tasks of this scope should run
+   * Any failure stops every scope of the BuildContext unless the FailureMode
+   * is KeepGoing
+   */
+  bool CanRun() const;
+
+  void AddUpstream(const FailureScope &upstream);
+
+  BuildContext &GetContext() const { return *context_; }
+
+private:
+  BuildContext *context_;
+  std::atomic<bool> failed_{false};
+  std::vector<const FailureScope *> upstream_;
+};
+
 } // namespace buildcc::env
 
 #endif
@@ -14,9 +14,12 @@ static constexpr const char *const STDERR_DATA_STRING = "stderr_data";
 bool Command::Execute(const std::string &command,
                       const optional<fs::path> &working_directory,
                       std::vector<std::string> *stdout_data,
-                      std::vector<std::string> *stderr_data) {
+                      std::vector<std::string> *stderr_data,
+                      CommandStats *stats, BuildContext *context) {
   (void)command;
   (void)working_directory;
+  (void)stats;
+  (void)context;
   auto &actualcall = mock().actualCall(EXECUTE_FUNCTION);
   if (stdout_data != nullptr) {
     actualcall.withOutputParameterOfType(
@@ -29,6 +32,48 @@ bool Command::Execute(const std::string &command,
   return actualcall.returnBoolValue();
 }
 
+bool Command::Execute(const CommandLine &command_line,
+                      std::vector<std::string> *stdout_data,
+                      std::vector<std::string> *stderr_data,
+                      CommandStats *stats, BuildContext *context) {
+  return Execute(command_line.ToString(), command_line.GetWorkingDirectory(),
+                 stdout_data, stderr_data, stats, context);
+}
+
+void Command::ExecuteAsync(const std::string &command,
+                           const optional<fs::path> &working_directory,
+                           const ExitCallback &on_exit, BuildContext *context,
+                           std::uint64_t predicted_memory_bytes,
+                           std::uint64_t priority) {
+  (void)predicted_memory_bytes;
+  (void)priority;
+  CommandStats stats;
+  const auto start = std::chrono::steady_clock::now();
+  const bool success = Execute(command, working_directory, nullptr, nullptr,
+                               &stats, context);
+  stats.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  on_exit(success, stats);
+}
+
+void Command::ExecuteAsync(const CommandLine &command_line,
+                           const ExitCallback &on_exit, BuildContext *context,
+                           std::uint64_t predicted_memory_bytes,
+                           std::uint64_t priority) {
+  (void)predicted_memory_bytes;
+  (void)priority;
+  CommandStats stats;
+  const auto start = std::chrono::steady_clock::now();
+  const bool success = Execute(command_line, nullptr, nullptr, &stats, context);
+  stats.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  on_exit(success, stats);
+}
+
+void Command::CancelAll(const BuildContext &context) {
+  (void)context;
+}
+
 namespace m {
 
 void CommandExpect_Execute(unsigned int calls, bool expectation,
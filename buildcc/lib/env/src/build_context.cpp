@@ -0,0 +1,41 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/build_context.h"
+
+namespace buildcc {
+
+BuildContext &BuildContext::Global() {
+  static BuildContext context;
+  return context;
+}
+
+void BuildContext::Init(const fs::path &project_root_dir,
+                        const fs::path &project_build_dir) {
+  root_dir_ = project_root_dir;
+  build_dir_ = project_build_dir;
+  root_dir_.make_preferred();
+  build_dir_.make_preferred();
+  init_ = true;
+}
+
+void BuildContext::Deinit() {
+  root_dir_.clear();
+  build_dir_.clear();
+  init_ = false;
+}
+
+} // namespace buildcc
@@ -43,6 +43,23 @@ const std::string &Command::GetDefaultValueByKey(const std::string &key) const {
   return default_values_.at(key);
 }
 
+CommandTemplate Command::CreateTemplate(const std::string &pattern) const {
+  CommandTemplate command(pattern);
+  command.Bind(default_values_);
+  return command;
+}
+
+optional<std::vector<std::string>>
+Command::SplitArguments(const std::string &command) {
+  auto arguments = CommandLine::Split(command);
+  // Leading `NAME=value` words are variable assignments
+  if (!arguments.has_value() || arguments->empty() ||
+      arguments->front().find('=') != std::string::npos) {
+    return {};
+  }
+  return arguments;
+}
+
 std::string Command::Construct(
     const std::string &pattern,
     const std::unordered_map<const char *, std::string> &arguments) const {
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/command_line.h"
+
+#include <string_view>
+
+#include "env/host_os.h"
+
+namespace {
+
+// Arguments made of these characters are never quoted
+constexpr std::string_view kPlainCharacters =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "0123456789_-+=%@,.:/";
+
+// Characters with a special meaning for the POSIX shell other than quoting,
+// `#` and `~` are only special at the start of a word but are rare enough in
+// commands to always use the shell
+constexpr std::string_view kShellSyntax = "|&;<>()$`*?[]#~{}!\r\n";
+
+// Characters a backslash escapes within double quotes
+constexpr std::string_view kDoubleQuoteEscapes = "\"\\$`";
+
+bool is_blank(char c) { return c == ' ' || c == '\t'; }
+
+void quote_posix(const std::string &argument, std::string &command) {
+  command += '\'';
+  for (const char c : argument) {
+    if (c == '\'') {
+      command += "'\\''";
+    } else {
+      command += c;
+    }
+  }
+  command += '\'';
+}
+
+// Backslashes are only escaped when they precede a double quote
+void quote_win(const std::string &argument, std::string &command) {
+  command += '"';
+  std::size_t backslashes = 0;
+  for (const char c : argument) {
+    if (c == '\\') {
+      backslashes++;
+      continue;
+    }
+    command.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+    command += c;
+    backslashes = 0;
+  }
+  command.append(backslashes * 2, '\\');
+  command += '"';
+}
+
+buildcc::env::optional<std::vector<std::string>>
+split_posix(const std::string &command) {
+  enum class Quote { None, Single, Double };
+  std::vector<std::string> arguments;
+  std::string argument;
+  bool in_argument = false;
+  Quote quote = Quote::None;
+
+  for (std::size_t i = 0; i < command.size(); i++) {
+    const char c = command[i];
+    const bool has_next = i + 1 < command.size();
+    switch (quote) {
+    case Quote::Single:
+      if (c == '\'') {
+        quote = Quote::None;
+      } else {
+        argument += c;
+      }
+      continue;
+    case Quote::Double:
+      if (c == '"') {
+        quote = Quote::None;
+      } else if (c == '\\' && has_next &&
+                 kDoubleQuoteEscapes.find(command[i + 1]) !=
+                     std::string_view::npos) {
+        argument += command[++i];
+      } else if (c == '$' || c == '`') {
+        return {};
+      } else {
+        argument += c;
+      }
+      continue;
+    case Quote::None:
+    default:
+      break;
+    }
+
+    if (is_blank(c)) {
+      if (in_argument) {
+        arguments.push_back(std::move(argument));
+        argument.clear();
+        in_argument = false;
+      }
+      continue;
+    }
+
+    in_argument = true;
+    if (c == '\'') {
+      quote = Quote::Single;
+    } else if (c == '"') {
+      quote = Quote::Double;
+    } else if (c == '\\') {
+      // Line continuations are not supported
+      if (!has_next || command[i + 1] == '\n' || command[i + 1] == '\r') {
+        return {};
+      }
+      argument += command[++i];
+    } else if (kShellSyntax.find(c) != std::string_view::npos) {
+      return {};
+    } else {
+      argument += c;
+    }
+  }
+
+  if (quote != Quote::None) {
+    return {};
+  }
+  if (in_argument) {
+    arguments.push_back(std::move(argument));
+  }
+  return arguments;
+}
+
+// Same rules as CommandLineToArgvW
+buildcc::env::optional<std::vector<std::string>>
+split_win(const std::string &command) {
+  std::vector<std::string> arguments;
+  std::string argument;
+  bool in_argument = false;
+  bool quoted = false;
+
+  for (std::size_t i = 0; i < command.size(); i++) {
+    const char c = command[i];
+    if (!quoted && is_blank(c)) {
+      if (in_argument) {
+        arguments.push_back(std::move(argument));
+        argument.clear();
+        in_argument = false;
+      }
+      continue;
+    }
+
+    in_argument = true;
+    if (c == '\\') {
+      std::size_t backslashes = 0;
+      while (i < command.size() && command[i] == '\\') {
+        backslashes++;
+        i++;
+      }
+      if (i < command.size() && command[i] == '"') {
+        argument.append(backslashes / 2, '\\');
+        if (backslashes % 2 == 1) {
+          argument += '"';
+        } else {
+          quoted = !quoted;
+        }
+      } else {
+        argument.append(backslashes, '\\');
+        i--;
+      }
+    } else if (c == '"') {
+      quoted = !quoted;
+    } else {
+      argument += c;
+    }
+  }
+
+  if (quoted) {
+    return {};
+  }
+  if (in_argument) {
+    arguments.push_back(std::move(argument));
+  }
+  return arguments;
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+std::string CommandLine::ToString() const {
+  std::string command;
+  for (const auto &argument : arguments_) {
+    if (!command.empty()) {
+      command += ' ';
+    }
+    if (!argument.empty() &&
+        argument.find_first_not_of(kPlainCharacters) == std::string::npos) {
+      command += argument;
+    } else if constexpr (is_win()) {
+      quote_win(argument, command);
+    } else {
+      quote_posix(argument, command);
+    }
+  }
+  return command;
+}
+
+optional<std::vector<std::string>>
+CommandLine::Split(const std::string &command) {
+  if constexpr (is_win()) {
+    return split_win(command);
+  } else {
+    return split_posix(command);
+  }
+}
+
+} // namespace buildcc::env
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/command_template.h"
+
+#include <cctype>
+
+#include "fmt/args.h"
+#include "fmt/format.h"
+
+#include "env/assert_fatal.h"
+
+namespace {
+
+// Same as the argument ids accepted by fmt
+bool is_identifier(const std::string &name) {
+  if (name.empty() ||
+      !(std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_')) {
+    return false;
+  }
+  for (const char c : name) {
+    if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::string &
+find_argument(const buildcc::env::CommandTemplate::Arguments &arguments,
+              const std::string &field) {
+  for (const auto &[name, value] : arguments) {
+    if (field == name) {
+      return value;
+    }
+  }
+  buildcc::env::assert_fatal<false>(fmt::format(
+      "Construct command failed: argument not found {{{}}}", field));
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+CommandTemplate::CommandTemplate(const std::string &pattern) {
+  std::string literal;
+  std::size_t i = 0;
+  while (i < pattern.size()) {
+    const char c = pattern[i];
+    const bool escaped = i + 1 < pattern.size() && pattern[i + 1] == c;
+    if ((c == '{' || c == '}') && escaped) {
+      literal += c;
+      i += 2;
+      continue;
+    }
+    if (c == '}') {
+      dynamic_ = true;
+      break;
+    }
+    if (c != '{') {
+      literal += c;
+      i++;
+      continue;
+    }
+
+    const std::size_t end = pattern.find('}', i + 1);
+    if (end == std::string::npos) {
+      dynamic_ = true;
+      break;
+    }
+    std::string name = pattern.substr(i + 1, end - i - 1);
+    if (!is_identifier(name)) {
+      dynamic_ = true;
+      break;
+    }
+    if (!literal.empty()) {
+      segments_.push_back({std::move(literal), false});
+      literal.clear();
+    }
+    segments_.push_back({std::move(name), true});
+    i = end + 1;
+  }
+
+  if (dynamic_) {
+    // Invalid patterns are reported by fmt when rendered, same as
+    // Command::Construct
+    segments_.clear();
+    pattern_ = pattern;
+    return;
+  }
+  if (!literal.empty()) {
+    segments_.push_back({std::move(literal), false});
+  }
+  SplitWords();
+}
+
+CommandTemplate &CommandTemplate::Bind(
+    const std::unordered_map<std::string, std::string> &values) {
+  if (dynamic_) {
+    bound_.insert(bound_.end(), values.cbegin(), values.cend());
+    return *this;
+  }
+  BindSegments([&values](const std::string &name) -> const std::string * {
+    const auto iter = values.find(name);
+    return iter == values.end() ? nullptr : &iter->second;
+  });
+  SplitWords();
+  return *this;
+}
+
+std::string CommandTemplate::Render(const Arguments &arguments) const {
+  for (const auto &[name, _] : arguments) {
+    env::assert_fatal(name != nullptr, "Argument must not be NULL");
+  }
+
+  if (dynamic_) {
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    for (const auto &[name, value] : bound_) {
+      store.push_back(fmt::arg(name.c_str(), value));
+    }
+    for (const auto &[name, value] : arguments) {
+      store.push_back(fmt::arg(name, value));
+    }
+    std::string command;
+    try {
+      command = fmt::vformat(pattern_, store);
+    } catch (const std::exception &e) {
+      env::assert_fatal<false>(
+          fmt::format("Construct command failed: {}", e.what()));
+    }
+    return command;
+  }
+
+  std::size_t size = 0;
+  for (const auto &segment : segments_) {
+    size += segment.text.size();
+  }
+  for (const auto &[_, argument] : arguments) {
+    size += argument.size();
+  }
+
+  std::string command;
+  command.reserve(size);
+  for (const auto &segment : segments_) {
+    if (!segment.field) {
+      command += segment.text;
+      continue;
+    }
+    command += find_argument(arguments, segment.text);
+  }
+  return command;
+}
+
+optional<CommandLine>
+CommandTemplate::RenderCommandLine(const Arguments &arguments) const {
+  if (!splittable_) {
+    return {};
+  }
+  for (const auto &[name, _] : arguments) {
+    env::assert_fatal(name != nullptr, "Argument must not be NULL");
+  }
+
+  CommandLine command_line;
+  for (const auto &word : words_) {
+    std::string argument;
+    for (const auto &part : word.parts) {
+      argument += part.field ? find_argument(arguments, part.text) : part.text;
+    }
+    if (word.literal || !argument.empty()) {
+      command_line.AddArgument(std::move(argument));
+    }
+  }
+  return command_line;
+}
+
+// PRIVATE
+
+template <typename Lookup>
+void CommandTemplate::BindSegments(const Lookup &lookup) {
+  std::vector<Segment> segments;
+  segments.reserve(segments_.size());
+  auto append_literal = [&segments](const std::string &text) {
+    if (segments.empty() || segments.back().field) {
+      segments.push_back({text, false});
+    } else {
+      segments.back().text += text;
+    }
+  };
+
+  for (auto &segment : segments_) {
+    if (!segment.field) {
+      append_literal(segment.text);
+      continue;
+    }
+    const std::string *value = lookup(segment.text);
+    if (value == nullptr) {
+      segments.push_back(std::move(segment));
+    } else {
+      append_literal(*value);
+    }
+  }
+  segments_ = std::move(segments);
+}
+
+// Fields inserted between literal text join the word the text starts or ends
+// with, unless the text starts or ends with whitespace
+void CommandTemplate::SplitWords() {
+  words_.clear();
+  splittable_ = false;
+  if (dynamic_) {
+    return;
+  }
+
+  bool open = false;
+  for (const auto &segment : segments_) {
+    if (segment.field) {
+      if (!open) {
+        words_.emplace_back();
+      }
+      words_.back().parts.push_back(segment);
+      open = true;
+      continue;
+    }
+
+    const auto split = CommandLine::Split(segment.text);
+    if (!split.has_value()) {
+      words_.clear();
+      return;
+    }
+    // A sentinel character joins the first / last word when no whitespace
+    // separates them
+    const auto sentinel_front = CommandLine::Split("_" + segment.text);
+    const auto sentinel_back = CommandLine::Split(segment.text + "_");
+    const bool joins_front = sentinel_front.has_value() &&
+                             sentinel_front->size() == split->size();
+    const bool joins_back = sentinel_back.has_value() &&
+                            sentinel_back->size() == split->size();
+
+    for (std::size_t i = 0; i < split->size(); i++) {
+      if (i != 0 || !open || !joins_front) {
+        words_.emplace_back();
+      }
+      words_.back().parts.push_back({(*split)[i], false});
+      words_.back().literal = true;
+    }
+    open = !split->empty() && joins_back;
+  }
+  splittable_ = true;
+}
+
+} // namespace buildcc::env
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/concurrency.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "env/util.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#define BUILDCC_CONCURRENCY_LINUX 1
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+#if defined(BUILDCC_CONCURRENCY_LINUX)
+constexpr const char *const kProcSelfCgroup = "/proc/self/cgroup";
+constexpr const char *const kCgroupRoot = "/sys/fs/cgroup";
+constexpr const char *const kCgroupCpuMax = "cpu.max";
+// cgroup v2 entries are listed as `0::<path>`
+constexpr std::string_view kCgroupV2Prefix = "0::";
+#endif
+
+bool ParseUnsigned(std::string_view data, unsigned long long &value) {
+  const char *end = data.data() + data.size();
+  auto [ptr, ec] = std::from_chars(data.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+std::string_view Trim(std::string_view data) {
+  const auto begin = data.find_first_not_of(" \t\r\n");
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  const auto end = data.find_last_not_of(" \t\r\n");
+  return data.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+optional<unsigned int> parse_cgroup_cpu_max(std::string_view data) {
+  data = Trim(data);
+  const auto separator = data.find(' ');
+  if (separator == std::string_view::npos) {
+    return {};
+  }
+
+  const std::string_view max = data.substr(0, separator);
+  const std::string_view period = Trim(data.substr(separator + 1));
+  unsigned long long max_value = 0;
+  unsigned long long period_value = 0;
+  if (max == "max" || !ParseUnsigned(max, max_value) ||
+      !ParseUnsigned(period, period_value) || max_value == 0 ||
+      period_value == 0) {
+    return {};
+  }
+
+  const unsigned long long cpus =
+      (max_value + period_value - 1) / period_value;
+  return static_cast<unsigned int>(std::max(cpus, 1ULL));
+}
+
+optional<unsigned int> get_cgroup_cpu_quota() {
+#if defined(BUILDCC_CONCURRENCY_LINUX)
+  std::string cgroups;
+  if (!load_file(kProcSelfCgroup, false, &cgroups)) {
+    return {};
+  }
+
+  std::string cgroup_path;
+  for (const auto &line : split(cgroups, '\n')) {
+    if (line.rfind(kCgroupV2Prefix.data(), 0) == 0) {
+      cgroup_path = line.substr(kCgroupV2Prefix.size());
+      break;
+    }
+  }
+  if (cgroup_path.empty()) {
+    return {};
+  }
+
+  // Quotas of parent cgroups also apply to the current cgroup
+  optional<unsigned int> quota;
+  const fs::path root(kCgroupRoot);
+  const fs::path relative = fs::path(cgroup_path).relative_path();
+  fs::path current = relative.empty() ? root : root / relative;
+  while (true) {
+    std::string cpu_max;
+    if (load_file((current / kCgroupCpuMax).string().c_str(), false,
+                  &cpu_max)) {
+      const auto cpus = parse_cgroup_cpu_max(cpu_max);
+      if (cpus.has_value()) {
+        quota = std::min(quota.value_or(cpus.value()), cpus.value());
+      }
+    }
+    if (current == root || current.parent_path() == current) {
+      break;
+    }
+    current = current.parent_path();
+  }
+  return quota;
+#else
+  return {};
+#endif
+}
+
+unsigned int get_affinity_cpu_count() {
+#if defined(BUILDCC_CONCURRENCY_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    const int count = CPU_COUNT(&set);
+    if (count > 0) {
+      return static_cast<unsigned int>(count);
+    }
+  }
+#endif
+  return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+unsigned int get_available_concurrency() {
+  const unsigned int affinity = get_affinity_cpu_count();
+  const auto quota = get_cgroup_cpu_quota();
+  return std::max(std::min(affinity, quota.value_or(affinity)), 1U);
+}
+
+} // namespace buildcc::env
@@ -15,6 +15,8 @@
  */
 
 #include "env/env.h"
+
+#include "env/build_context.h"
 #include "env/logging.h"
 
 namespace buildcc {
@@ -22,40 +24,20 @@ namespace buildcc {
 void Project::Init(const fs::path &project_root_dir,
                    const fs::path &project_build_dir) {
   // State
-  fs::path root_dir = project_root_dir;
-  fs::path build_dir = project_build_dir;
-  root_dir.make_preferred();
-  build_dir.make_preferred();
-
-  GetStaticRootDir() = root_dir;
-  GetStaticBuildDir() = build_dir;
-  GetStaticInit() = true;
+  BuildContext::Global().Init(project_root_dir, project_build_dir);
 
   // Logging
   env::set_log_pattern("%^[%l]%$ %v");
   env::set_log_level(env::LogLevel::Info);
 }
-void Project::Deinit() {
-  GetStaticRootDir() = "";
-  GetStaticBuildDir() = "";
-  GetStaticInit() = false;
-}
+void Project::Deinit() { BuildContext::Global().Deinit(); }
 
-bool Project::IsInit() { return GetStaticInit(); }
-const fs::path &Project::GetRootDir() { return GetStaticRootDir(); }
-const fs::path &Project::GetBuildDir() { return GetStaticBuildDir(); }
-
-bool &Project::GetStaticInit() {
-  static bool is_init = false;
-  return is_init;
-}
-fs::path &Project::GetStaticRootDir() {
-  static fs::path root_dir = "";
-  return root_dir;
+bool Project::IsInit() { return BuildContext::Global().IsInit(); }
+const fs::path &Project::GetRootDir() {
+  return BuildContext::Global().GetRootDir();
 }
-fs::path &Project::GetStaticBuildDir() {
-  static fs::path build_dir = "";
-  return build_dir;
+const fs::path &Project::GetBuildDir() {
+  return BuildContext::Global().GetBuildDir();
 }
 
 } // namespace buildcc
@@ -16,18 +16,85 @@
 
 #include "env/command.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 #include "fmt/format.h"
 
 #include "env/assert_fatal.h"
+#include "env/build_context.h"
+#include "env/command_line.h"
 #include "env/host_os.h"
+#include "env/job_output.h"
+#include "env/jobserver.h"
 #include "env/logging.h"
+#include "env/memory_budget.h"
+#include "env/process_reaper.h"
+#include "env/task_state.h"
 
 #include "process.hpp"
 
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BUILDCC_EXECUTE_RUSAGE 1
+#endif
+
 namespace tpl = TinyProcessLib;
 
 namespace {
 
+struct InFlightState {
+  std::mutex mutex;
+  // Process id -> spawned by the ProcessReaper
+  std::unordered_map<const buildcc::BuildContext *,
+                     std::unordered_map<tpl::Process::id_type, bool>>
+      ids;
+};
+
+InFlightState &GetInFlightState() {
+  static InFlightState state;
+  return state;
+}
+
+void untrack(const buildcc::BuildContext &context,
+             tpl::Process::id_type id) {
+  auto &in_flight = GetInFlightState();
+  std::lock_guard<std::mutex> lock(in_flight.mutex);
+  auto iter = in_flight.ids.find(&context);
+  if (iter == in_flight.ids.end()) {
+    return;
+  }
+  iter->second.erase(id);
+  if (iter->second.empty()) {
+    in_flight.ids.erase(iter);
+  }
+}
+
+bool is_cancelled(const buildcc::BuildContext &context) {
+  return context.GetFailureMode() == buildcc::env::FailureMode::FailFast &&
+         context.GetTaskState() != buildcc::env::TaskState::SUCCESS;
+}
+
+void kill_process(tpl::Process::id_type id, bool reaper) {
+  if (reaper) {
+    buildcc::env::ProcessReaper::Kill(static_cast<int>(id));
+  } else {
+    tpl::Process::kill(id);
+  }
+}
+
 tpl::Process::string_type get_working_directory(
     const buildcc::env::optional<fs::path> &working_directory) {
 #ifdef UNICODE
@@ -37,31 +104,518 @@ tpl::Process::string_type get_working_directory(
 #endif
 }
 
+#if defined(BUILDCC_EXECUTE_RUSAGE)
+// Waits for the child to exit without reaping it so that TinyProcessLib can
+// still collect the exit status
+// NOTE, The glibc `waitid` wrapper does not expose the rusage argument
+std::uint64_t wait_peak_rss(pid_t pid) {
+  siginfo_t info{};
+  struct rusage usage {};
+  long ret = 0;
+  do {
+    ret = syscall(SYS_waitid, P_PID, pid, &info, WEXITED | WNOWAIT, &usage);
+  } while (ret < 0 && errno == EINTR);
+  if (ret != 0 || usage.ru_maxrss <= 0) {
+    return 0;
+  }
+  // ru_maxrss is reported in kilobytes
+  return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+}
+#endif
+
+// Captures the output of a command
+// Streams redirected to the caller are returned once the command exits. When
+// JobOutput is enabled the other streams are printed together at that point
+class OutputCapture {
+public:
+  OutputCapture(std::vector<std::string> *stdout_data,
+                std::vector<std::string> *stderr_data)
+      : stdout_data_(stdout_data), stderr_data_(stderr_data),
+        group_(buildcc::env::JobOutput::IsEnabled()),
+        stdout_(stdout_data == nullptr
+                    ? buildcc::env::JobOutput::GetMaxBytes()
+                    : 0),
+        stderr_(stderr_data == nullptr
+                    ? buildcc::env::JobOutput::GetMaxBytes()
+                    : 0) {}
+
+  // nullptr when the stream is inherited by the command
+  std::function<void(const char *bytes, size_t n)> Stdout() {
+    if (stdout_data_ == nullptr && !group_) {
+      return nullptr;
+    }
+    return [this](const char *bytes, size_t n) { stdout_.Append(bytes, n); };
+  }
+
+  std::function<void(const char *bytes, size_t n)> Stderr() {
+    if (stderr_data_ == nullptr && !group_) {
+      return nullptr;
+    }
+    return [this](const char *bytes, size_t n) { stderr_.Append(bytes, n); };
+  }
+
+  void Finish() {
+    Redirect(stdout_, stdout_data_);
+    Redirect(stderr_, stderr_data_);
+    if (group_) {
+      buildcc::env::JobOutput::Print(stdout_, stderr_);
+    }
+  }
+
+private:
+  static void Redirect(buildcc::env::OutputBuffer &buffer,
+                       std::vector<std::string> *data) {
+    if (data == nullptr) {
+      return;
+    }
+    if (!buffer.IsEmpty()) {
+      data->emplace_back(buffer.ToString());
+    }
+    buffer.Clear();
+  }
+
+private:
+  std::vector<std::string> *stdout_data_;
+  std::vector<std::string> *stderr_data_;
+  bool group_;
+  buildcc::env::OutputBuffer stdout_;
+  buildcc::env::OutputBuffer stderr_;
+};
+
+// Shared between the caller and the ProcessReaper thread
+struct ReaperCommand {
+  buildcc::env::JobServer::Token token;
+  // Guarded by InFlightState::mutex
+  bool exited{false};
+  bool tracked{false};
+  tpl::Process::id_type id{};
+};
+
+// Spawns the command on the ProcessReaper and tracks it until `on_exit` is
+// invoked
+// NOTE, The command may exit before ProcessReaper::Spawn returns
+// Arguments are spawned without a shell when present
+bool spawn_tracked(
+    const std::string &command,
+    const buildcc::env::optional<std::vector<std::string>> &arguments,
+    const buildcc::env::optional<fs::path> &working_directory,
+    const buildcc::env::ProcessReaper::OutputCallback &on_stdout,
+    const buildcc::env::ProcessReaper::OutputCallback &on_stderr,
+    const buildcc::BuildContext &context, buildcc::env::JobServer::Token token,
+    const buildcc::env::ProcessReaper::ExitCallback &on_exit,
+    buildcc::env::ProcessReaper::Slot slot =
+        buildcc::env::ProcessReaper::Slot()) {
+  auto reaper_command = std::make_shared<ReaperCommand>();
+  reaper_command->token = std::move(token);
+  const buildcc::BuildContext *context_ptr = &context;
+  auto on_reaped = [reaper_command, context_ptr,
+                    on_exit](const buildcc::env::ProcessExit &exit) {
+    reaper_command->token.Release();
+    bool tracked = false;
+    {
+      std::lock_guard<std::mutex> lock(GetInFlightState().mutex);
+      reaper_command->exited = true;
+      tracked = reaper_command->tracked;
+    }
+    if (tracked) {
+      untrack(*context_ptr, reaper_command->id);
+    }
+    on_exit(exit);
+  };
+  const std::string cwd = working_directory.value_or(fs::path()).string();
+  const int pid =
+      arguments.has_value()
+          ? buildcc::env::ProcessReaper::Spawn(arguments.value(), cwd,
+                                               on_stdout, on_stderr, on_reaped,
+                                               std::move(slot))
+          : buildcc::env::ProcessReaper::Spawn(command, cwd, on_stdout,
+                                               on_stderr, on_reaped,
+                                               std::move(slot));
+  if (pid < 0) {
+    return false;
+  }
+
+  auto &in_flight = GetInFlightState();
+  std::lock_guard<std::mutex> lock(in_flight.mutex);
+  if (!reaper_command->exited) {
+    reaper_command->id = static_cast<tpl::Process::id_type>(pid);
+    reaper_command->tracked = true;
+    in_flight.ids[&context][reaper_command->id] = true;
+    if (is_cancelled(context)) {
+      buildcc::env::ProcessReaper::Kill(pid);
+    }
+  }
+  return true;
+}
+
 } // namespace
 
 namespace buildcc::env {
 
+namespace {
+
+bool execute(const std::string &command,
+             const optional<std::vector<std::string>> &arguments,
+             const optional<fs::path> &working_directory,
+             std::vector<std::string> *stdout_data,
+             std::vector<std::string> *stderr_data, CommandStats *stats,
+             BuildContext *context) {
+  const BuildContext &build_context =
+      context != nullptr ? *context : BuildContext::Global();
+  buildcc::env::log_debug("system", command);
+
+  // Hold a job slot for the lifetime of the child process
+  JobServer::Token token = JobServer::Acquire();
+  if (is_cancelled(build_context)) {
+    env::log_debug("system", "Cancelled");
+    return false;
+  }
+
+  OutputCapture output(stdout_data, stderr_data);
+  if (ProcessReaper::IsEnabled()) {
+    auto exited = std::make_shared<std::promise<ProcessExit>>();
+    std::future<ProcessExit> exit_future = exited->get_future();
+    if (!spawn_tracked(
+            command, arguments, working_directory, output.Stdout(),
+            output.Stderr(), build_context, std::move(token),
+            [exited](const ProcessExit &exit) { exited->set_value(exit); })) {
+      return false;
+    }
+    const ProcessExit exit = exit_future.get();
+    output.Finish();
+    if (stats != nullptr) {
+      stats->peak_rss_bytes = exit.peak_rss_bytes;
+    }
+    return exit.exit_status == 0;
+  }
+
+  tpl::Process process(command, get_working_directory(working_directory),
+                       output.Stdout(), output.Stderr());
+
+  // Track the process so that CancelAll can terminate it
+  // NOTE, The TaskState is checked again since CancelAll may have run before
+  // the process was tracked
+  auto &in_flight = GetInFlightState();
+  const tpl::Process::id_type id = process.get_id();
+  {
+    std::lock_guard<std::mutex> lock(in_flight.mutex);
+    in_flight.ids[&build_context][id] = false;
+    if (is_cancelled(build_context)) {
+      tpl::Process::kill(id);
+    }
+  }
+
+  std::uint64_t peak_rss_bytes = 0;
+#if defined(BUILDCC_EXECUTE_RUSAGE)
+  // Untrack before the process is reaped and its id can be reused
+  peak_rss_bytes = wait_peak_rss(id);
+  untrack(build_context, id);
+  const int exit_status = process.get_exit_status();
+#else
+  const int exit_status = process.get_exit_status();
+  untrack(build_context, id);
+#endif
+  output.Finish();
+  if (stats != nullptr) {
+    stats->peak_rss_bytes = peak_rss_bytes;
+  }
+  return exit_status == 0;
+}
+
+struct AsyncLaunch {
+  std::string command;
+  optional<std::vector<std::string>> arguments;
+  optional<fs::path> working_directory;
+  Command::ExitCallback on_exit;
+  const BuildContext *context{nullptr};
+  std::uint64_t predicted_memory_bytes{0};
+  std::uint64_t priority{0};
+};
+
+// Launches that wait for a job slot, for memory or for a process slot are
+// started by a dispatch thread, so callers of ExecuteAsync are never blocked
+struct LaunchState {
+  ~LaunchState() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Highest priority first, in order within a priority
+  std::deque<AsyncLaunch> pending;
+  // Set while the dispatch thread waits for the front launch
+  bool dispatching{false};
+  bool stop{false};
+  std::thread thread;
+};
+
+LaunchState &GetLaunchState() {
+  static LaunchState state;
+  return state;
+}
+
+struct AsyncExit {
+  std::shared_ptr<OutputCapture> output;
+  Command::ExitCallback on_exit;
+  bool success{false};
+  CommandStats stats;
+};
+
+// Exits are completed in order by a completion thread, the ProcessReaper
+// thread only drains the output and reaps the children
+struct ExitState {
+  ~ExitState() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<AsyncExit> exited;
+  bool stop{false};
+  std::thread thread;
+};
+
+ExitState &GetExitState() {
+  static ExitState state;
+  return state;
+}
+
+void complete(ExitState &state) {
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.cv.wait(lock, [&]() { return state.stop || !state.exited.empty(); });
+    if (state.exited.empty()) {
+      return;
+    }
+    AsyncExit exited = std::move(state.exited.front());
+    state.exited.pop_front();
+    lock.unlock();
+
+    exited.output->Finish();
+    exited.on_exit(exited.success, exited.stats);
+
+    lock.lock();
+  }
+}
+
+void post_exit(AsyncExit exited) {
+  auto &state = GetExitState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.exited.push_back(std::move(exited));
+  if (!state.thread.joinable()) {
+    state.thread = std::thread(complete, std::ref(state));
+  }
+  state.cv.notify_one();
+}
+
+// NOTE, Requires the ProcessReaper
+// Spawn waits for a process slot when `slot` was not reserved
+void launch(const AsyncLaunch &launch, MemoryBudget::Reservation reservation,
+            JobServer::Token token,
+            ProcessReaper::Slot slot = ProcessReaper::Slot()) {
+  if (is_cancelled(*launch.context)) {
+    env::log_debug("system", "Cancelled");
+    launch.on_exit(false, CommandStats());
+    return;
+  }
+  // Output is captured on the reaper thread and printed on the completion
+  // thread
+  auto output = std::make_shared<OutputCapture>(nullptr, nullptr);
+  auto memory =
+      std::make_shared<MemoryBudget::Reservation>(std::move(reservation));
+  const Command::ExitCallback &on_exit = launch.on_exit;
+  const auto start = std::chrono::steady_clock::now();
+  if (!spawn_tracked(launch.command, launch.arguments,
+                     launch.working_directory, output->Stdout(),
+                     output->Stderr(), *launch.context, std::move(token),
+                     [output, memory, on_exit,
+                      start](const ProcessExit &exit) {
+                       memory->Release();
+                       AsyncExit exited{output, on_exit,
+                                        exit.exit_status == 0, {}};
+                       exited.stats.peak_rss_bytes = exit.peak_rss_bytes;
+                       exited.stats.duration = std::chrono::duration_cast<
+                           std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start);
+                       post_exit(std::move(exited));
+                     },
+                     std::move(slot))) {
+    memory->Release();
+    on_exit(false, CommandStats());
+  }
+}
+
+void dispatch(LaunchState &state) {
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.cv.wait(lock,
+                  [&]() { return state.stop || !state.pending.empty(); });
+    if (state.stop) {
+      return;
+    }
+    AsyncLaunch pending = std::move(state.pending.front());
+    state.pending.pop_front();
+    state.dispatching = true;
+    lock.unlock();
+
+    MemoryBudget::Reservation reservation;
+    JobServer::Token token;
+    // Cancelled launches do not wait
+    if (!is_cancelled(*pending.context)) {
+      reservation = MemoryBudget::Acquire(pending.predicted_memory_bytes);
+      token = JobServer::Acquire();
+    }
+    launch(pending, std::move(reservation), std::move(token));
+
+    lock.lock();
+    state.dispatching = false;
+  }
+}
+
+void execute_async(const std::string &command,
+                   const optional<std::vector<std::string>> &arguments,
+                   const optional<fs::path> &working_directory,
+                   const Command::ExitCallback &on_exit,
+                   BuildContext *context, std::uint64_t predicted_memory_bytes,
+                   std::uint64_t priority) {
+  buildcc::env::log_debug("system", command);
+  AsyncLaunch pending{command,
+                      arguments,
+                      working_directory,
+                      on_exit,
+                      context != nullptr ? context : &BuildContext::Global(),
+                      predicted_memory_bytes,
+                      priority};
+
+  // Started directly when nothing is queued and the job is admitted
+  auto &state = GetLaunchState();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  if (state.pending.empty() && !state.dispatching) {
+    MemoryBudget::Reservation reservation;
+    JobServer::Token token;
+    ProcessReaper::Slot slot;
+    if (MemoryBudget::TryAcquire(predicted_memory_bytes, reservation) &&
+        JobServer::TryAcquire(token) && ProcessReaper::TryAcquireSlot(slot)) {
+      lock.unlock();
+      launch(pending, std::move(reservation), std::move(token),
+             std::move(slot));
+      return;
+    }
+  }
+  const auto position = std::upper_bound(
+      state.pending.begin(), state.pending.end(), priority,
+      [](std::uint64_t value, const AsyncLaunch &queued) {
+        return value > queued.priority;
+      });
+  state.pending.insert(position, std::move(pending));
+  if (!state.thread.joinable()) {
+    state.thread = std::thread(dispatch, std::ref(state));
+  }
+  state.cv.notify_one();
+}
+
+} // namespace
+
 bool Command::Execute(const std::string &command,
                       const optional<fs::path> &working_directory,
                       std::vector<std::string> *stdout_data,
-                      std::vector<std::string> *stderr_data) {
+                      std::vector<std::string> *stderr_data,
+                      CommandStats *stats, BuildContext *context) {
   env::assert_fatal(!command.empty(), "Empty command");
-  buildcc::env::log_debug("system", command);
+  // Commands without shell syntax do not need the shell
+  optional<std::vector<std::string>> arguments;
+  if (ProcessReaper::IsEnabled()) {
+    arguments = SplitArguments(command);
+  }
+  return execute(command, arguments, working_directory, stdout_data,
+                 stderr_data, stats, context);
+}
 
-  std::function<void(const char *bytes, size_t n)> stdout_func =
-      [&](const char *bytes, size_t n) {
-        stdout_data->emplace_back(std::string(bytes, n));
-      };
+bool Command::Execute(const CommandLine &command_line,
+                      std::vector<std::string> *stdout_data,
+                      std::vector<std::string> *stderr_data,
+                      CommandStats *stats, BuildContext *context) {
+  env::assert_fatal(!command_line.IsEmpty(), "Empty command");
+  // The quoted command is logged, and run when the shell is needed
+  optional<std::vector<std::string>> arguments;
+  if (ProcessReaper::IsEnabled()) {
+    arguments = command_line.GetArguments();
+  }
+  return execute(command_line.ToString(), arguments,
+                 command_line.GetWorkingDirectory(), stdout_data, stderr_data,
+                 stats, context);
+}
 
-  std::function<void(const char *bytes, size_t n)> stderr_func =
-      [&](const char *bytes, size_t n) {
-        stderr_data->emplace_back(std::string(bytes, n));
-      };
+void Command::ExecuteAsync(const std::string &command,
+                           const optional<fs::path> &working_directory,
+                           const ExitCallback &on_exit, BuildContext *context,
+                           std::uint64_t predicted_memory_bytes,
+                           std::uint64_t priority) {
+  if (!ProcessReaper::IsEnabled()) {
+    (void)priority;
+    MemoryBudget::Reservation reservation =
+        MemoryBudget::Acquire(predicted_memory_bytes);
+    CommandStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    const bool success = Execute(command, working_directory, nullptr, nullptr,
+                                 &stats, context);
+    stats.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    on_exit(success, stats);
+    return;
+  }
+  env::assert_fatal(!command.empty(), "Empty command");
+  execute_async(command, SplitArguments(command), working_directory, on_exit,
+                context, predicted_memory_bytes, priority);
+}
 
-  tpl::Process process(command, get_working_directory(working_directory),
-                       stdout_data == nullptr ? nullptr : stdout_func,
-                       stderr_data == nullptr ? nullptr : stderr_func);
-  return process.get_exit_status() == 0;
+void Command::ExecuteAsync(const CommandLine &command_line,
+                           const ExitCallback &on_exit, BuildContext *context,
+                           std::uint64_t predicted_memory_bytes,
+                           std::uint64_t priority) {
+  if (!ProcessReaper::IsEnabled()) {
+    (void)priority;
+    MemoryBudget::Reservation reservation =
+        MemoryBudget::Acquire(predicted_memory_bytes);
+    CommandStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    const bool success =
+        Execute(command_line, nullptr, nullptr, &stats, context);
+    stats.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    on_exit(success, stats);
+    return;
+  }
+  env::assert_fatal(!command_line.IsEmpty(), "Empty command");
+  execute_async(command_line.ToString(), command_line.GetArguments(),
+                command_line.GetWorkingDirectory(), on_exit, context,
+                predicted_memory_bytes, priority);
+}
+
+void Command::CancelAll(const BuildContext &context) {
+  auto &in_flight = GetInFlightState();
+  std::lock_guard<std::mutex> lock(in_flight.mutex);
+  auto iter = in_flight.ids.find(&context);
+  if (iter == in_flight.ids.end()) {
+    return;
+  }
+  for (const auto &[id, reaper] : iter->second) {
+    kill_process(id, reaper);
+  }
 }
 
 } // namespace buildcc::env
@@ -0,0 +1,470 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * XXH3 algorithm by Yann Collet, xxHash Library (BSD 2-Clause License)
+ * https://github.com/Cyan4973/xxHash
+ *
+ * Only the 64-bit, seed 0, default secret variant is implemented here
+ *
+ * SHA-256 as specified in FIPS 180-4
+ */
+
+#include "env/hash.h"
+
+#include <cstring>
+
+#include "env/mapped_file.h"
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BUILDCC_HASH_SSE2 1
+#endif
+
+namespace {
+
+using u8 = std::uint8_t;
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+
+constexpr u32 kPrime32_1 = 0x9E3779B1U;
+constexpr u32 kPrime32_2 = 0x85EBCA77U;
+constexpr u32 kPrime32_3 = 0xC2B2AE3DU;
+constexpr u64 kPrime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr u64 kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr u64 kPrime64_3 = 0x165667B19E3779F9ULL;
+constexpr u64 kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr u64 kPrime64_5 = 0x27D4EB2F165667C5ULL;
+constexpr u64 kPrimeMx1 = 0x165667919E3779F9ULL;
+constexpr u64 kPrimeMx2 = 0x9FB21C651E98DF25ULL;
+
+constexpr std::size_t kSecretSize = 192;
+constexpr std::size_t kSecretSizeMin = 136;
+constexpr std::size_t kStripeLen = 64;
+constexpr std::size_t kSecretConsumeRate = 8;
+constexpr std::size_t kAccNb = kStripeLen / sizeof(u64);
+constexpr std::size_t kMidSizeMax = 240;
+
+alignas(64) constexpr u8 kSecret[kSecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// NOTE, Little endian hosts are assumed (x86, x86_64, arm, aarch64)
+inline u32 ReadLE32(const u8 *p) {
+  u32 v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline u64 ReadLE64(const u8 *p) {
+  u64 v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline u32 Swap32(u32 x) {
+  return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) |
+         ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+inline u64 Swap64(u64 x) {
+  return (static_cast<u64>(Swap32(static_cast<u32>(x))) << 32) |
+         Swap32(static_cast<u32>(x >> 32));
+}
+
+inline u64 Rotl64(u64 x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline u64 Mul128Fold64(u64 lhs, u64 rhs) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t const product = static_cast<__uint128_t>(lhs) * rhs;
+  return static_cast<u64>(product) ^ static_cast<u64>(product >> 64);
+#else
+  u64 const lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  u64 const hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  u64 const lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  u64 const hi_hi = (lhs >> 32) * (rhs >> 32);
+  u64 const cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  u64 const upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  u64 const lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  return lower ^ upper;
+#endif
+}
+
+inline u64 Xxh64Avalanche(u64 h) {
+  h ^= h >> 33;
+  h *= kPrime64_2;
+  h ^= h >> 29;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline u64 Xxh3Avalanche(u64 h) {
+  h ^= h >> 37;
+  h *= kPrimeMx1;
+  h ^= h >> 32;
+  return h;
+}
+
+inline u64 Rrmxmx(u64 h, u64 len) {
+  h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+  h *= kPrimeMx2;
+  h ^= (h >> 35) + len;
+  h *= kPrimeMx2;
+  h ^= h >> 28;
+  return h;
+}
+
+inline u64 Mix16B(const u8 *input, const u8 *secret) {
+  return Mul128Fold64(ReadLE64(input) ^ ReadLE64(secret),
+                      ReadLE64(input + 8) ^ ReadLE64(secret + 8));
+}
+
+u64 Hash0To16(const u8 *input, std::size_t len) {
+  if (len > 8) {
+    u64 const bitflip1 = ReadLE64(kSecret + 24) ^ ReadLE64(kSecret + 32);
+    u64 const bitflip2 = ReadLE64(kSecret + 40) ^ ReadLE64(kSecret + 48);
+    u64 const input_lo = ReadLE64(input) ^ bitflip1;
+    u64 const input_hi = ReadLE64(input + len - 8) ^ bitflip2;
+    u64 const acc = len + Swap64(input_lo) + input_hi +
+                    Mul128Fold64(input_lo, input_hi);
+    return Xxh3Avalanche(acc);
+  }
+  if (len >= 4) {
+    u32 const input1 = ReadLE32(input);
+    u32 const input2 = ReadLE32(input + len - 4);
+    u64 const bitflip = ReadLE64(kSecret + 8) ^ ReadLE64(kSecret + 16);
+    u64 const input64 = input2 + (static_cast<u64>(input1) << 32);
+    return Rrmxmx(input64 ^ bitflip, len);
+  }
+  if (len > 0) {
+    u8 const c1 = input[0];
+    u8 const c2 = input[len >> 1];
+    u8 const c3 = input[len - 1];
+    u32 const combined = (static_cast<u32>(c1) << 16) |
+                         (static_cast<u32>(c2) << 24) |
+                         (static_cast<u32>(c3) << 0) |
+                         (static_cast<u32>(len) << 8);
+    u64 const bitflip = ReadLE32(kSecret) ^ ReadLE32(kSecret + 4);
+    return Xxh64Avalanche(static_cast<u64>(combined) ^ bitflip);
+  }
+  return Xxh64Avalanche(ReadLE64(kSecret + 56) ^ ReadLE64(kSecret + 64));
+}
+
+u64 Hash17To128(const u8 *input, std::size_t len) {
+  u64 acc = len * kPrime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += Mix16B(input + 48, kSecret + 96);
+        acc += Mix16B(input + len - 64, kSecret + 112);
+      }
+      acc += Mix16B(input + 32, kSecret + 64);
+      acc += Mix16B(input + len - 48, kSecret + 80);
+    }
+    acc += Mix16B(input + 16, kSecret + 32);
+    acc += Mix16B(input + len - 32, kSecret + 48);
+  }
+  acc += Mix16B(input + 0, kSecret + 0);
+  acc += Mix16B(input + len - 16, kSecret + 16);
+  return Xxh3Avalanche(acc);
+}
+
+u64 Hash129To240(const u8 *input, std::size_t len) {
+  constexpr std::size_t kMidSizeStartOffset = 3;
+  constexpr std::size_t kMidSizeLastOffset = 17;
+
+  u64 acc = len * kPrime64_1;
+  std::size_t const nb_rounds = len / 16;
+  for (std::size_t i = 0; i < 8; i++) {
+    acc += Mix16B(input + (16 * i), kSecret + (16 * i));
+  }
+  acc = Xxh3Avalanche(acc);
+  for (std::size_t i = 8; i < nb_rounds; i++) {
+    acc += Mix16B(input + (16 * i),
+                  kSecret + (16 * (i - 8)) + kMidSizeStartOffset);
+  }
+  acc += Mix16B(input + len - 16,
+                kSecret + kSecretSizeMin - kMidSizeLastOffset);
+  return Xxh3Avalanche(acc);
+}
+
+// Long input: 64 byte stripes accumulated into 8 lanes
+#if defined(BUILDCC_HASH_SSE2)
+
+inline void Accumulate512(u64 *acc, const u8 *input, const u8 *secret) {
+  auto *const xacc = reinterpret_cast<__m128i *>(acc);
+  const auto *const xinput = reinterpret_cast<const __m128i *>(input);
+  const auto *const xsecret = reinterpret_cast<const __m128i *>(secret);
+  for (std::size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i const data_vec = _mm_loadu_si128(xinput + i);
+    __m128i const key_vec = _mm_loadu_si128(xsecret + i);
+    __m128i const data_key = _mm_xor_si128(data_vec, key_vec);
+    __m128i const data_key_lo =
+        _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i const product = _mm_mul_epu32(data_key, data_key_lo);
+    __m128i const data_swap =
+        _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i const sum = _mm_add_epi64(xacc[i], data_swap);
+    xacc[i] = _mm_add_epi64(product, sum);
+  }
+}
+
+inline void ScrambleAcc(u64 *acc, const u8 *secret) {
+  auto *const xacc = reinterpret_cast<__m128i *>(acc);
+  const auto *const xsecret = reinterpret_cast<const __m128i *>(secret);
+  __m128i const prime32 = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  for (std::size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i const acc_vec = xacc[i];
+    __m128i const shifted = _mm_srli_epi64(acc_vec, 47);
+    __m128i const data_vec = _mm_xor_si128(acc_vec, shifted);
+    __m128i const key_vec = _mm_loadu_si128(xsecret + i);
+    __m128i const data_key = _mm_xor_si128(data_vec, key_vec);
+    __m128i const data_key_hi =
+        _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i const prod_lo = _mm_mul_epu32(data_key, prime32);
+    __m128i const prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+    xacc[i] = _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32));
+  }
+}
+
+#else
+
+inline void Accumulate512(u64 *acc, const u8 *input, const u8 *secret) {
+  for (std::size_t i = 0; i < kAccNb; i++) {
+    u64 const data_val = ReadLE64(input + i * 8);
+    u64 const data_key = data_val ^ ReadLE64(secret + i * 8);
+    acc[i ^ 1] += data_val;
+    acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+  }
+}
+
+inline void ScrambleAcc(u64 *acc, const u8 *secret) {
+  for (std::size_t i = 0; i < kAccNb; i++) {
+    u64 acc64 = acc[i];
+    acc64 ^= acc64 >> 47;
+    acc64 ^= ReadLE64(secret + i * 8);
+    acc64 *= kPrime32_1;
+    acc[i] = acc64;
+  }
+}
+
+#endif
+
+inline void Accumulate(u64 *acc, const u8 *input, const u8 *secret,
+                       std::size_t nb_stripes) {
+  for (std::size_t n = 0; n < nb_stripes; n++) {
+    Accumulate512(acc, input + n * kStripeLen,
+                  secret + n * kSecretConsumeRate);
+  }
+}
+
+u64 HashLong(const u8 *input, std::size_t len) {
+  constexpr std::size_t kSecretLastAccStart = 7;
+  constexpr std::size_t kSecretMergeAccsStart = 11;
+  constexpr std::size_t kStripesPerBlock =
+      (kSecretSize - kStripeLen) / kSecretConsumeRate;
+  constexpr std::size_t kBlockLen = kStripeLen * kStripesPerBlock;
+
+  alignas(16) u64 acc[kAccNb] = {kPrime32_3, kPrime64_1, kPrime64_2,
+                                 kPrime64_3, kPrime64_4, kPrime32_2,
+                                 kPrime64_5, kPrime32_1};
+
+  std::size_t const nb_blocks = (len - 1) / kBlockLen;
+  for (std::size_t n = 0; n < nb_blocks; n++) {
+    Accumulate(acc, input + n * kBlockLen, kSecret, kStripesPerBlock);
+    ScrambleAcc(acc, kSecret + kSecretSize - kStripeLen);
+  }
+
+  // Last partial block
+  std::size_t const nb_stripes =
+      ((len - 1) - (kBlockLen * nb_blocks)) / kStripeLen;
+  Accumulate(acc, input + nb_blocks * kBlockLen, kSecret, nb_stripes);
+
+  // Last stripe
+  Accumulate512(acc, input + len - kStripeLen,
+                kSecret + kSecretSize - kStripeLen - kSecretLastAccStart);
+
+  // Merge
+  u64 result = len * kPrime64_1;
+  const u8 *const secret = kSecret + kSecretMergeAccsStart;
+  for (std::size_t i = 0; i < 4; i++) {
+    result += Mul128Fold64(acc[2 * i] ^ ReadLE64(secret + 16 * i),
+                           acc[2 * i + 1] ^ ReadLE64(secret + 16 * i + 8));
+  }
+  return Xxh3Avalanche(result);
+}
+
+// SHA-256
+
+constexpr u32 kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr std::size_t kSha256BlockLen = 64;
+
+inline u32 Rotr32(u32 x, int r) { return (x >> r) | (x << (32 - r)); }
+
+inline u32 ReadBE32(const u8 *p) {
+  return (static_cast<u32>(p[0]) << 24) | (static_cast<u32>(p[1]) << 16) |
+         (static_cast<u32>(p[2]) << 8) | static_cast<u32>(p[3]);
+}
+
+void Sha256Block(u32 state[8], const u8 *block) {
+  u32 w[64];
+  for (std::size_t i = 0; i < 16; i++) {
+    w[i] = ReadBE32(block + 4 * i);
+  }
+  for (std::size_t i = 16; i < 64; i++) {
+    const u32 s0 =
+        Rotr32(w[i - 15], 7) ^ Rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const u32 s1 =
+        Rotr32(w[i - 2], 17) ^ Rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  u32 a = state[0];
+  u32 b = state[1];
+  u32 c = state[2];
+  u32 d = state[3];
+  u32 e = state[4];
+  u32 f = state[5];
+  u32 g = state[6];
+  u32 h = state[7];
+  for (std::size_t i = 0; i < 64; i++) {
+    const u32 s1 = Rotr32(e, 6) ^ Rotr32(e, 11) ^ Rotr32(e, 25);
+    const u32 ch = (e & f) ^ (~e & g);
+    const u32 t1 = h + s1 + ch + kSha256K[i] + w[i];
+    const u32 s0 = Rotr32(a, 2) ^ Rotr32(a, 13) ^ Rotr32(a, 22);
+    const u32 maj = (a & b) ^ (a & c) ^ (b & c);
+    const u32 t2 = s0 + maj;
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+std::uint64_t hash_bytes(const void *data, std::size_t len) {
+  const auto *input = static_cast<const u8 *>(data);
+  if (len <= 16) {
+    return Hash0To16(input, len);
+  }
+  if (len <= 128) {
+    return Hash17To128(input, len);
+  }
+  if (len <= kMidSizeMax) {
+    return Hash129To240(input, len);
+  }
+  return HashLong(input, len);
+}
+
+bool hash_file(const char *name, std::uint64_t *hash) {
+  if (name == nullptr || hash == nullptr) {
+    return false;
+  }
+
+  MappedFile file;
+  if (!file.Open(name)) {
+    return false;
+  }
+  *hash = hash_bytes(file.GetData(), file.GetSize());
+  return true;
+}
+
+std::string sha256_hex(const void *data, std::size_t len) {
+  u32 state[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+  const auto *input = static_cast<const u8 *>(data);
+  std::size_t remaining = len;
+  while (remaining >= kSha256BlockLen) {
+    Sha256Block(state, input);
+    input += kSha256BlockLen;
+    remaining -= kSha256BlockLen;
+  }
+
+  // Padding: 0x80, zeros and the message length in bits (big endian)
+  u8 tail[2 * kSha256BlockLen] = {};
+  if (remaining != 0) {
+    std::memcpy(tail, input, remaining);
+  }
+  tail[remaining] = 0x80;
+  const std::size_t tail_len =
+      remaining < kSha256BlockLen - 8 ? kSha256BlockLen : 2 * kSha256BlockLen;
+  const u64 bits = static_cast<u64>(len) * 8;
+  for (std::size_t i = 0; i < 8; i++) {
+    tail[tail_len - 1 - i] = static_cast<u8>(bits >> (8 * i));
+  }
+  for (std::size_t i = 0; i < tail_len; i += kSha256BlockLen) {
+    Sha256Block(state, tail + i);
+  }
+
+  constexpr const char *const kHex = "0123456789abcdef";
+  std::string digest;
+  digest.reserve(64);
+  for (u32 word : state) {
+    for (int shift = 28; shift >= 0; shift -= 4) {
+      digest.push_back(kHex[(word >> shift) & 0xf]);
+    }
+  }
+  return digest;
+}
+
+} // namespace buildcc::env
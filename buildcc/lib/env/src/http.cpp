@@ -0,0 +1,671 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/http.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <string_view>
+
+#include "fmt/format.h"
+
+#include "env/logging.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define BUILDCC_HTTP_POSIX 1
+#endif
+
+namespace {
+
+constexpr std::string_view kHttpScheme = "http://";
+constexpr const char *const kDefaultPort = "80";
+constexpr std::size_t kMaxHeadSize = 64 * 1024;
+constexpr std::size_t kMaxBodySize = std::size_t(1) << 30;
+constexpr std::size_t kReadSize = 64 * 1024;
+constexpr int kListenBacklog = 64;
+// Stop is noticed by the accept loop within this interval
+constexpr int kAcceptPollMs = 50;
+
+std::string to_lower(std::string_view data) {
+  std::string lower(data);
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return lower;
+}
+
+std::string_view trim(std::string_view data) {
+  while (!data.empty() && (data.front() == ' ' || data.front() == '\t')) {
+    data.remove_prefix(1);
+  }
+  while (!data.empty() && (data.back() == ' ' || data.back() == '\t')) {
+    data.remove_suffix(1);
+  }
+  return data;
+}
+
+bool parse_size(std::string_view data, std::size_t &size, int base = 10) {
+  const char *end = data.data() + data.size();
+  auto [ptr, ec] = std::from_chars(data.data(), end, size, base);
+  return ec == std::errc() && ptr == end && !data.empty();
+}
+
+// `http://host[:port][/base]`, IPv6 hosts in brackets
+bool parse_url(const std::string &url, std::string &host, std::string &port,
+               std::string &base_path) {
+  std::string_view data(url);
+  if (data.substr(0, kHttpScheme.size()) != kHttpScheme) {
+    return false;
+  }
+  data.remove_prefix(kHttpScheme.size());
+  const std::size_t path_start = data.find('/');
+  std::string_view authority = data.substr(0, path_start);
+  base_path = path_start == std::string_view::npos
+                  ? std::string()
+                  : std::string(data.substr(path_start));
+  while (!base_path.empty() && base_path.back() == '/') {
+    base_path.pop_back();
+  }
+
+  std::string_view port_view;
+  if (!authority.empty() && authority.front() == '[') {
+    const std::size_t close = authority.find(']');
+    if (close == std::string_view::npos) {
+      return false;
+    }
+    host = std::string(authority.substr(1, close - 1));
+    authority.remove_prefix(close + 1);
+    if (!authority.empty() && authority.front() != ':') {
+      return false;
+    }
+    port_view = authority.empty() ? authority : authority.substr(1);
+  } else {
+    const std::size_t colon = authority.find(':');
+    host = std::string(authority.substr(0, colon));
+    port_view = colon == std::string_view::npos ? std::string_view()
+                                                : authority.substr(colon + 1);
+  }
+  std::size_t port_number{0};
+  if (!port_view.empty() &&
+      (!parse_size(port_view, port_number) || port_number > 65535)) {
+    return false;
+  }
+  port = port_view.empty() ? kDefaultPort : std::string(port_view);
+  return !host.empty();
+}
+
+// Start line and the headers used for framing
+struct MessageHead {
+  std::string start_line;
+  bool has_content_length{false};
+  std::size_t content_length{0};
+  bool chunked{false};
+  bool close{false};
+};
+
+bool parse_head(std::string_view data, MessageHead &head) {
+  std::size_t end = data.find("\r\n");
+  head.start_line = std::string(data.substr(0, end));
+  head.close = head.start_line.find("HTTP/1.0") != std::string::npos;
+  while (end != std::string_view::npos) {
+    data.remove_prefix(end + 2);
+    end = data.find("\r\n");
+    const std::string_view line = data.substr(0, end);
+    if (line.empty()) {
+      continue;
+    }
+    const std::size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      return false;
+    }
+    const std::string name = to_lower(trim(line.substr(0, colon)));
+    const std::string value = to_lower(trim(line.substr(colon + 1)));
+    if (name == "content-length") {
+      if (!parse_size(value, head.content_length) ||
+          head.content_length > kMaxBodySize) {
+        return false;
+      }
+      head.has_content_length = true;
+    } else if (name == "transfer-encoding") {
+      head.chunked = value.find("chunked") != std::string::npos;
+    } else if (name == "connection") {
+      head.close = value == "close";
+    }
+  }
+  return true;
+}
+
+const char *reason_phrase(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 204:
+    return "No Content";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 413:
+    return "Payload Too Large";
+  case 500:
+    return "Internal Server Error";
+  default:
+    return "Unknown";
+  }
+}
+
+#if defined(BUILDCC_HTTP_POSIX)
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+void configure_socket(int fd) {
+  (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+  const int one = 1;
+  (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#if defined(SO_NOSIGPIPE)
+  (void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+
+bool send_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+    const ssize_t sent = send(fd, data.data(), data.size(), kSendFlags);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    data.remove_prefix(static_cast<std::size_t>(sent));
+  }
+  return true;
+}
+
+// Buffered reads of a message from a socket
+class SocketReader {
+public:
+  explicit SocketReader(int fd) : fd_(fd) {}
+
+  bool ReadHead(std::string &head) {
+    std::size_t end = buffer_.find("\r\n\r\n");
+    while (end == std::string::npos) {
+      if (buffer_.size() > kMaxHeadSize || !Fill()) {
+        return false;
+      }
+      end = buffer_.find("\r\n\r\n");
+    }
+    head = buffer_.substr(0, end + 2);
+    buffer_.erase(0, end + 4);
+    return true;
+  }
+
+  bool ReadExact(std::size_t size, std::string &out) {
+    out.reserve(out.size() + size);
+    while (buffer_.size() < size) {
+      out.append(buffer_);
+      size -= buffer_.size();
+      buffer_.clear();
+      if (!Fill()) {
+        return false;
+      }
+    }
+    out.append(buffer_, 0, size);
+    buffer_.erase(0, size);
+    return true;
+  }
+
+  bool ReadChunked(std::string &out) {
+    while (true) {
+      std::string line;
+      if (!ReadLine(line)) {
+        return false;
+      }
+      std::size_t size{0};
+      if (!parse_size(trim(std::string_view(line).substr(0, line.find(';'))),
+                      size, 16) ||
+          out.size() + size > kMaxBodySize) {
+        return false;
+      }
+      if (size == 0) {
+        break;
+      }
+      if (!ReadExact(size, out) || !ReadLine(line) || !line.empty()) {
+        return false;
+      }
+    }
+    // Trailers
+    std::string line;
+    do {
+      if (!ReadLine(line)) {
+        return false;
+      }
+    } while (!line.empty());
+    return true;
+  }
+
+  bool ReadUntilClose(std::string &out) {
+    while (Fill()) {
+      if (buffer_.size() > kMaxBodySize) {
+        return false;
+      }
+    }
+    out.append(buffer_);
+    buffer_.clear();
+    return closed_;
+  }
+
+  bool ReceivedAny() const { return received_any_; }
+
+private:
+  bool ReadLine(std::string &line) {
+    std::size_t end = buffer_.find("\r\n");
+    while (end == std::string::npos) {
+      if (buffer_.size() > kMaxHeadSize || !Fill()) {
+        return false;
+      }
+      end = buffer_.find("\r\n");
+    }
+    line = buffer_.substr(0, end);
+    buffer_.erase(0, end + 2);
+    return true;
+  }
+
+  bool Fill() {
+    char data[kReadSize];
+    while (true) {
+      const ssize_t received = recv(fd_, data, sizeof(data), 0);
+      if (received < 0 && errno == EINTR) {
+        continue;
+      }
+      if (received <= 0) {
+        closed_ = received == 0;
+        return false;
+      }
+      received_any_ = true;
+      buffer_.append(data, static_cast<std::size_t>(received));
+      return true;
+    }
+  }
+
+private:
+  int fd_;
+  std::string buffer_;
+  bool received_any_{false};
+  bool closed_{false};
+};
+
+bool read_body(SocketReader &reader, const MessageHead &head,
+               std::string &body) {
+  if (head.chunked) {
+    return reader.ReadChunked(body);
+  }
+  if (head.has_content_length) {
+    return reader.ReadExact(head.content_length, body);
+  }
+  return true;
+}
+
+#endif
+
+} // namespace
+
+namespace buildcc::env {
+
+// HttpClient
+
+HttpClient::HttpClient(const std::string &url,
+                       std::chrono::milliseconds timeout,
+                       std::chrono::milliseconds connect_timeout)
+    : timeout_(timeout), connect_timeout_(connect_timeout) {
+  valid_ = parse_url(url, host_, port_, base_path_);
+}
+
+HttpClient::~HttpClient() {
+#if defined(BUILDCC_HTTP_POSIX)
+  for (int fd : idle_) {
+    close(fd);
+  }
+#endif
+}
+
+env::optional<HttpResponse> HttpClient::Request(const std::string &method,
+                                                const std::string &path,
+                                                const std::string &body) {
+#if defined(BUILDCC_HTTP_POSIX)
+  if (!valid_) {
+    return {};
+  }
+  const bool has_body = !body.empty() || method == "PUT" || method == "POST";
+  std::string message = fmt::format(
+      "{} {}{} HTTP/1.1\r\nHost: {}:{}\r\n", method, base_path_, path,
+      host_.find(':') == std::string::npos ? host_ : "[" + host_ + "]",
+      port_);
+  if (has_body) {
+    message += fmt::format("Content-Length: {}\r\n", body.size());
+  }
+  message += "\r\n";
+  message += body;
+
+  // A reused connection may have been closed by the server while it was
+  // idle, the request is sent again on a new connection
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    int fd = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!idle_.empty()) {
+        fd = idle_.back();
+        idle_.pop_back();
+        reused = true;
+      }
+    }
+    if (fd < 0) {
+      fd = Connect();
+      if (fd < 0) {
+        return {};
+      }
+    }
+
+    SocketReader reader(fd);
+    std::string head_data;
+    MessageHead head;
+    HttpResponse response;
+    bool ok = send_all(fd, message) && reader.ReadHead(head_data) &&
+              parse_head(head_data, head) &&
+              head.start_line.size() >= 12 &&
+              head.start_line.compare(0, 5, "HTTP/") == 0;
+    if (ok) {
+      std::size_t status{0};
+      ok = parse_size(std::string_view(head.start_line).substr(9, 3), status);
+      response.status = static_cast<int>(status);
+    }
+    const bool no_body = method == "HEAD" || response.status == 204 ||
+                         response.status == 304 || response.status < 200;
+    if (ok && !no_body) {
+      if (head.chunked || head.has_content_length) {
+        ok = read_body(reader, head, response.body);
+      } else {
+        ok = reader.ReadUntilClose(response.body);
+        head.close = true;
+      }
+    }
+
+    if (ok) {
+      if (head.close) {
+        close(fd);
+      } else {
+        ReleaseConnection(fd);
+      }
+      return response;
+    }
+    close(fd);
+    if (!reused || reader.ReceivedAny()) {
+      break;
+    }
+  }
+  return {};
+#else
+  (void)method;
+  (void)path;
+  (void)body;
+  return {};
+#endif
+}
+
+int HttpClient::Connect() {
+#if defined(BUILDCC_HTTP_POSIX)
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses = nullptr;
+  if (getaddrinfo(host_.c_str(), port_.c_str(), &hints, &addresses) != 0) {
+    env::log_debug(__FUNCTION__,
+                   fmt::format("Could not resolve '{}'", host_));
+    return -1;
+  }
+
+  const auto connect_timeout_ms = static_cast<int>(connect_timeout_.count());
+  int fd = -1;
+  for (addrinfo *address = addresses; address != nullptr;
+       address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype,
+                address->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    // Connected without blocking to honour the timeout
+    const int flags = fcntl(fd, F_GETFL, 0);
+    (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    bool connected = connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+    if (!connected && errno == EINPROGRESS) {
+      pollfd pfd{fd, POLLOUT, 0};
+      int error = 0;
+      socklen_t length = sizeof(error);
+      connected = poll(&pfd, 1, connect_timeout_ms) == 1 &&
+                  getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 &&
+                  error == 0;
+    }
+    if (connected) {
+      (void)fcntl(fd, F_SETFL, flags);
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) {
+    env::log_debug(__FUNCTION__, fmt::format("Could not connect to '{}:{}'",
+                                             host_, port_));
+    return -1;
+  }
+
+  configure_socket(fd);
+  const auto timeout_ms = static_cast<int>(timeout_.count());
+  timeval tv{};
+  tv.tv_sec = static_cast<decltype(tv.tv_sec)>(timeout_ms / 1000);
+  tv.tv_usec = static_cast<decltype(tv.tv_usec)>((timeout_ms % 1000) * 1000);
+  (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  (void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  return fd;
+#else
+  return -1;
+#endif
+}
+
+void HttpClient::ReleaseConnection(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_.push_back(fd);
+}
+
+// HttpServer
+
+bool HttpServer::Start(std::uint16_t port, const std::string &address) {
+#if defined(BUILDCC_HTTP_POSIX)
+  if (running_.load()) {
+    return false;
+  }
+  sockaddr_in listen_address{};
+  listen_address.sin_family = AF_INET;
+  listen_address.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &listen_address.sin_addr) != 1) {
+    return false;
+  }
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  (void)fcntl(listen_fd_, F_SETFD, FD_CLOEXEC);
+  const int one = 1;
+  (void)setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  socklen_t length = sizeof(listen_address);
+  const bool listening =
+      bind(listen_fd_, reinterpret_cast<sockaddr *>(&listen_address),
+           sizeof(listen_address)) == 0 &&
+      listen(listen_fd_, kListenBacklog) == 0 &&
+      getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&listen_address),
+                  &length) == 0;
+  if (!listening) {
+    env::log_warning(__FUNCTION__, fmt::format("Could not listen on {}:{}",
+                                               address, port));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  port_ = ntohs(listen_address.sin_port);
+  running_.store(true);
+  accept_thread_ = std::thread([this]() { AcceptLoop(); });
+  return true;
+#else
+  (void)port;
+  (void)address;
+  return false;
+#endif
+}
+
+void HttpServer::Stop() {
+#if defined(BUILDCC_HTTP_POSIX)
+  if (!running_.exchange(false)) {
+    return;
+  }
+  accept_thread_.join();
+  close(listen_fd_);
+  listen_fd_ = -1;
+
+  std::list<std::unique_ptr<Connection>> connections;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections.swap(connections_);
+  }
+  // Wakes up connections blocked on a read
+  for (auto &connection : connections) {
+    shutdown(connection->fd, SHUT_RDWR);
+  }
+  for (auto &connection : connections) {
+    connection->thread.join();
+    close(connection->fd);
+  }
+#endif
+}
+
+void HttpServer::AcceptLoop() {
+#if defined(BUILDCC_HTTP_POSIX)
+  while (running_.load()) {
+    pollfd pfd{listen_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, kAcceptPollMs) != 1) {
+      continue;
+    }
+    const int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    configure_socket(fd);
+
+    JoinDone();
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    Connection &ref = *connection;
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.push_back(std::move(connection));
+    ref.thread = std::thread([this, &ref]() { Serve(ref); });
+  }
+#endif
+}
+
+void HttpServer::Serve(Connection &connection) {
+#if defined(BUILDCC_HTTP_POSIX)
+  SocketReader reader(connection.fd);
+  bool keep_alive = true;
+  while (keep_alive) {
+    std::string head_data;
+    if (!reader.ReadHead(head_data)) {
+      break;
+    }
+
+    MessageHead head;
+    HttpRequest request;
+    HttpResponse response;
+    const bool parsed = parse_head(head_data, head);
+    const std::size_t method_end = head.start_line.find(' ');
+    const std::size_t path_end = head.start_line.find(' ', method_end + 1);
+    if (parsed && path_end != std::string::npos &&
+        read_body(reader, head, request.body)) {
+      request.method = head.start_line.substr(0, method_end);
+      request.path =
+          head.start_line.substr(method_end + 1, path_end - method_end - 1);
+      response = handler_(request);
+      keep_alive = !head.close;
+    } else {
+      response.status = 400;
+      keep_alive = false;
+    }
+
+    std::string message = fmt::format(
+        "HTTP/1.1 {} {}\r\nContent-Length: {}\r\n{}\r\n", response.status,
+        reason_phrase(response.status), response.body.size(),
+        keep_alive ? "" : "Connection: close\r\n");
+    if (request.method != "HEAD") {
+      message += response.body;
+    }
+    if (!send_all(connection.fd, message)) {
+      break;
+    }
+  }
+  connection.done.store(true);
+#else
+  (void)connection;
+#endif
+}
+
+void HttpServer::JoinDone() {
+#if defined(BUILDCC_HTTP_POSIX)
+  std::list<std::unique_ptr<Connection>> done;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto iter = connections_.begin(); iter != connections_.end();) {
+      if ((*iter)->done.load()) {
+        done.push_back(std::move(*iter));
+        iter = connections_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+  for (auto &connection : done) {
+    connection->thread.join();
+    close(connection->fd);
+  }
+#endif
+}
+
+} // namespace buildcc::env
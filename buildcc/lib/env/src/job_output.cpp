@@ -0,0 +1,193 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/job_output.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "fmt/format.h"
+
+namespace {
+
+// Blocks kept for reuse, 4MiB
+constexpr std::size_t kMaxPooledBlocks = 256;
+
+struct BlockPool {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<char[]>> blocks;
+};
+
+BlockPool &GetBlockPool() {
+  static BlockPool pool;
+  return pool;
+}
+
+std::unique_ptr<char[]> AcquireBlock() {
+  auto &pool = GetBlockPool();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (!pool.blocks.empty()) {
+      std::unique_ptr<char[]> block = std::move(pool.blocks.back());
+      pool.blocks.pop_back();
+      return block;
+    }
+  }
+  return std::make_unique<char[]>(buildcc::env::OutputBuffer::kBlockSize);
+}
+
+void ReleaseBlocks(std::vector<std::unique_ptr<char[]>> &blocks) {
+  auto &pool = GetBlockPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (auto &block : blocks) {
+    if (pool.blocks.size() >= kMaxPooledBlocks) {
+      break;
+    }
+    pool.blocks.push_back(std::move(block));
+  }
+  blocks.clear();
+}
+
+struct JobOutputState {
+  std::mutex mutex;
+  bool enabled{false};
+  std::size_t max_bytes{0};
+  // Serializes console writes of different jobs
+  std::mutex print_mutex;
+};
+
+JobOutputState &GetState() {
+  static JobOutputState state;
+  return state;
+}
+
+void PrintStream(const buildcc::env::OutputBuffer &buffer,
+                 std::FILE *stream) {
+  buffer.WriteTo(stream);
+  // Output is usually truncated in the middle of a line
+  if (buffer.GetDropped() != 0) {
+    fmt::print(stream, "\n[{} bytes of output truncated]\n",
+               buffer.GetDropped());
+  }
+  std::fflush(stream);
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+OutputBuffer &OutputBuffer::operator=(OutputBuffer &&other) noexcept {
+  if (this != &other) {
+    Clear();
+    blocks_ = std::move(other.blocks_);
+    size_ = other.size_;
+    dropped_ = other.dropped_;
+    max_bytes_ = other.max_bytes_;
+    other.blocks_.clear();
+    other.size_ = 0;
+    other.dropped_ = 0;
+  }
+  return *this;
+}
+
+void OutputBuffer::Append(const char *bytes, std::size_t n) {
+  std::size_t accepted = n;
+  if (max_bytes_ != 0) {
+    accepted = std::min(n, max_bytes_ - std::min(size_, max_bytes_));
+  }
+  dropped_ += n - accepted;
+
+  while (accepted != 0) {
+    const std::size_t offset = size_ % kBlockSize;
+    if (offset == 0) {
+      blocks_.push_back(AcquireBlock());
+    }
+    const std::size_t count = std::min(accepted, kBlockSize - offset);
+    std::memcpy(blocks_.back().get() + offset, bytes, count);
+    bytes += count;
+    accepted -= count;
+    size_ += count;
+  }
+}
+
+void OutputBuffer::Clear() {
+  ReleaseBlocks(blocks_);
+  size_ = 0;
+  dropped_ = 0;
+}
+
+std::string OutputBuffer::ToString() const {
+  std::string data;
+  data.reserve(size_);
+  std::size_t remaining = size_;
+  for (const auto &block : blocks_) {
+    const std::size_t count = std::min(remaining, kBlockSize);
+    data.append(block.get(), count);
+    remaining -= count;
+  }
+  return data;
+}
+
+void OutputBuffer::WriteTo(std::FILE *stream) const {
+  std::size_t remaining = size_;
+  for (const auto &block : blocks_) {
+    const std::size_t count = std::min(remaining, kBlockSize);
+    (void)std::fwrite(block.get(), 1, count, stream);
+    remaining -= count;
+  }
+}
+
+void JobOutput::Init(std::size_t max_bytes) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.enabled = true;
+  state.max_bytes = max_bytes;
+}
+
+void JobOutput::Deinit() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.enabled = false;
+  state.max_bytes = 0;
+}
+
+bool JobOutput::IsEnabled() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.enabled;
+}
+
+std::size_t JobOutput::GetMaxBytes() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.max_bytes;
+}
+
+void JobOutput::Print(const OutputBuffer &stdout_buffer,
+                      const OutputBuffer &stderr_buffer) {
+  if (stdout_buffer.IsEmpty() && stdout_buffer.GetDropped() == 0 &&
+      stderr_buffer.IsEmpty() && stderr_buffer.GetDropped() == 0) {
+    return;
+  }
+
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.print_mutex);
+  PrintStream(stdout_buffer, stdout);
+  PrintStream(stderr_buffer, stderr);
+}
+
+} // namespace buildcc::env
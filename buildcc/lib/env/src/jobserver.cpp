@@ -0,0 +1,385 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/jobserver.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+
+#include "fmt/format.h"
+
+#include "env/logging.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BUILDCC_JOBSERVER_POSIX 1
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::string_view kJobServerAuth = "--jobserver-auth=";
+constexpr std::string_view kJobServerFds = "--jobserver-fds=";
+constexpr std::string_view kFifoPrefix = "fifo:";
+// Variable assignments follow this separator
+constexpr std::string_view kMakeflagsSeparator = " -- ";
+constexpr const char *const kMakeflags = "MAKEFLAGS";
+constexpr char kTokenByte = '+';
+// Releasing the implicit slot does not wake up `poll`
+constexpr int kPollTimeoutMs = 10;
+
+bool ParseFd(std::string_view data, int &fd) {
+  const char *end = data.data() + data.size();
+  auto [ptr, ec] = std::from_chars(data.data(), end, fd);
+  return ec == std::errc() && ptr == end && fd >= 0;
+}
+
+struct JobServerState {
+  std::mutex mutex;
+  bool enabled{false};
+  bool server{false};
+  bool implicit_in_use{false};
+  // Only owned descriptors are closed on Deinit, inherited pipes belong to
+  // the parent jobserver
+  bool owns_fds{false};
+  int read_fd{-1};
+  int write_fd{-1};
+  fs::path fifo_path;
+  buildcc::env::optional<std::string> makeflags;
+};
+
+JobServerState &GetState() {
+  static JobServerState state;
+  return state;
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+JobServer::Token &JobServer::Token::operator=(Token &&other) noexcept {
+  if (this != &other) {
+    Release();
+    byte_ = other.byte_;
+    implicit_ = other.implicit_;
+    valid_ = other.valid_;
+    other.valid_ = false;
+  }
+  return *this;
+}
+
+void JobServer::Token::Release() {
+  if (!valid_) {
+    return;
+  }
+  valid_ = false;
+
+  auto &state = GetState();
+  if (implicit_) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.implicit_in_use = false;
+    return;
+  }
+
+#if defined(BUILDCC_JOBSERVER_POSIX)
+  // Deinit and Init replace the fds, a token is only ever written to an open
+  // jobserver
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.write_fd < 0) {
+    return;
+  }
+  ssize_t written = 0;
+  do {
+    written = write(state.write_fd, &byte_, 1);
+  } while (written < 0 && errno == EINTR);
+  if (written != 1) {
+    env::log_warning(__FUNCTION__, "Could not return jobserver token");
+  }
+#endif
+}
+
+optional<JobServerAuth> JobServer::ParseMakeflags(std::string_view makeflags) {
+  optional<JobServerAuth> auth;
+  std::size_t pos = 0;
+  while (pos < makeflags.size()) {
+    const auto begin = makeflags.find_first_not_of(' ', pos);
+    if (begin == std::string_view::npos) {
+      break;
+    }
+    auto end = makeflags.find(' ', begin);
+    if (end == std::string_view::npos) {
+      end = makeflags.size();
+    }
+    pos = end;
+
+    std::string_view word = makeflags.substr(begin, end - begin);
+    if (word == "--") {
+      break;
+    }
+
+    std::string_view value;
+    if (word.substr(0, kJobServerAuth.size()) == kJobServerAuth) {
+      value = word.substr(kJobServerAuth.size());
+    } else if (word.substr(0, kJobServerFds.size()) == kJobServerFds) {
+      value = word.substr(kJobServerFds.size());
+    } else {
+      continue;
+    }
+
+    JobServerAuth parsed;
+    if (value.substr(0, kFifoPrefix.size()) == kFifoPrefix) {
+      parsed.type = JobServerAuth::Type::Fifo;
+      parsed.fifo_path = std::string(value.substr(kFifoPrefix.size()));
+      if (parsed.fifo_path.empty()) {
+        auth.reset();
+        continue;
+      }
+    } else {
+      const auto comma = value.find(',');
+      parsed.type = JobServerAuth::Type::Pipe;
+      if (comma == std::string_view::npos ||
+          !ParseFd(value.substr(0, comma), parsed.read_fd) ||
+          !ParseFd(value.substr(comma + 1), parsed.write_fd)) {
+        // Unsupported variants (such as windows semaphores)
+        auth.reset();
+        continue;
+      }
+    }
+    auth = parsed;
+  }
+  return auth;
+}
+
+bool JobServer::InitClient(std::string_view makeflags) {
+  Deinit();
+  auto auth = ParseMakeflags(makeflags);
+  if (!auth.has_value()) {
+    return false;
+  }
+
+#if defined(BUILDCC_JOBSERVER_POSIX)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (auth->type == JobServerAuth::Type::Fifo) {
+    // O_RDWR so that opening does not block and reads never see EOF
+    int fd = open(auth->fifo_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+      env::log_warning(__FUNCTION__,
+                       fmt::format("Could not open jobserver fifo '{}'",
+                                   auth->fifo_path));
+      return false;
+    }
+    state.read_fd = fd;
+    state.write_fd = fd;
+    state.owns_fds = true;
+  } else {
+    // File descriptors are not inherited when the parent make did not
+    // consider this a recursive invocation
+    if (fcntl(auth->read_fd, F_GETFD) < 0 ||
+        fcntl(auth->write_fd, F_GETFD) < 0) {
+      env::log_warning(__FUNCTION__,
+                       "Jobserver file descriptors are not available");
+      return false;
+    }
+    state.read_fd = auth->read_fd;
+    state.write_fd = auth->write_fd;
+    state.owns_fds = false;
+  }
+  state.enabled = true;
+  state.server = false;
+  state.implicit_in_use = false;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool JobServer::InitServer(unsigned int jobs) {
+  Deinit();
+  if (jobs == 0) {
+    return false;
+  }
+
+#if defined(BUILDCC_JOBSERVER_POSIX)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  std::error_code errorcode;
+  fs::path fifo_path = fs::temp_directory_path(errorcode) /
+                       fmt::format("buildcc_jobserver_{}", getpid());
+  if (errorcode) {
+    return false;
+  }
+  fs::remove(fifo_path, errorcode);
+  if (mkfifo(fifo_path.c_str(), 0600) != 0) {
+    env::log_warning(__FUNCTION__, fmt::format("Could not create '{}'",
+                                               fifo_path.string()));
+    return false;
+  }
+  int fd = open(fifo_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    fs::remove(fifo_path, errorcode);
+    return false;
+  }
+
+  // The server holds the implicit slot, the fifo holds the rest
+  const std::string tokens(jobs - 1, kTokenByte);
+  if (!tokens.empty() &&
+      write(fd, tokens.data(), tokens.size()) !=
+          static_cast<ssize_t>(tokens.size())) {
+    close(fd);
+    fs::remove(fifo_path, errorcode);
+    return false;
+  }
+
+  // Advertise to child processes
+  const char *makeflags_env = getenv(kMakeflags);
+  std::string makeflags;
+  if (makeflags_env != nullptr) {
+    state.makeflags = makeflags_env;
+    makeflags = makeflags_env;
+  }
+  const std::string jobserver = fmt::format(" -j{} {}{}{}", jobs,
+                                            kJobServerAuth, kFifoPrefix,
+                                            fifo_path.string());
+  const auto separator = makeflags.find(kMakeflagsSeparator);
+  makeflags.insert(separator == std::string::npos ? makeflags.size()
+                                                  : separator,
+                   jobserver);
+  setenv(kMakeflags, makeflags.c_str(), 1);
+
+  state.read_fd = fd;
+  state.write_fd = fd;
+  state.owns_fds = true;
+  state.fifo_path = fifo_path;
+  state.enabled = true;
+  state.server = true;
+  state.implicit_in_use = false;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void JobServer::Deinit() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.enabled) {
+    return;
+  }
+
+#if defined(BUILDCC_JOBSERVER_POSIX)
+  if (state.owns_fds) {
+    close(state.read_fd);
+  }
+  if (state.server) {
+    std::error_code errorcode;
+    fs::remove(state.fifo_path, errorcode);
+    if (state.makeflags.has_value()) {
+      setenv(kMakeflags, state.makeflags->c_str(), 1);
+    } else {
+      unsetenv(kMakeflags);
+    }
+  }
+#endif
+
+  state.enabled = false;
+  state.server = false;
+  state.implicit_in_use = false;
+  state.owns_fds = false;
+  state.read_fd = -1;
+  state.write_fd = -1;
+  state.fifo_path.clear();
+  state.makeflags.reset();
+}
+
+bool JobServer::IsEnabled() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.enabled;
+}
+
+bool JobServer::IsServer() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.server;
+}
+
+bool JobServer::TryAcquire(Token &token) {
+  token.Release();
+  auto &state = GetState();
+  int read_fd = -1;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.enabled) {
+      return true;
+    }
+    if (!state.implicit_in_use) {
+      state.implicit_in_use = true;
+      token = Token(kTokenByte, true);
+      return true;
+    }
+    read_fd = state.read_fd;
+  }
+
+#if defined(BUILDCC_JOBSERVER_POSIX)
+  // NOTE, Inherited pipes may be blocking, only read once data is available
+  pollfd pfd{read_fd, POLLIN, 0};
+  if (poll(&pfd, 1, 0) <= 0) {
+    return false;
+  }
+  char byte = 0;
+  ssize_t bytes_read = read(read_fd, &byte, 1);
+  if (bytes_read == 1) {
+    token = Token(byte, false);
+    return true;
+  }
+  if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR)) {
+    // Another process took the token first
+    return false;
+  }
+  // Broken jobserver, do not block the build
+  env::log_warning(__FUNCTION__, "Could not read jobserver token");
+  return true;
+#else
+  return true;
+#endif
+}
+
+JobServer::Token JobServer::Acquire() {
+  Token token;
+  while (!TryAcquire(token)) {
+#if defined(BUILDCC_JOBSERVER_POSIX)
+    auto &state = GetState();
+    int read_fd = -1;
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      read_fd = state.read_fd;
+    }
+    pollfd pfd{read_fd, POLLIN, 0};
+    poll(&pfd, 1, kPollTimeoutMs);
+#endif
+  }
+  return token;
+}
+
+} // namespace buildcc::env
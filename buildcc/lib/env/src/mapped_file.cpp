@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/mapped_file.h"
+
+#include "env/util.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BUILDCC_MAPPED_FILE_MMAP 1
+#endif
+
+namespace buildcc::env {
+
+bool MappedFile::Open(const char *name) {
+  Close();
+  if (name == nullptr) {
+    return false;
+  }
+
+#if defined(BUILDCC_MAPPED_FILE_MMAP)
+  int fd = open(name, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return false;
+  }
+
+  // mmap does not support empty mappings
+  auto size = static_cast<std::size_t>(st.st_size);
+  if (size == 0) {
+    close(fd);
+    return true;
+  }
+
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<const char *>(data);
+  size_ = size;
+  mapped_ = true;
+  return true;
+#else
+  if (!load_file(name, true, &buffer_)) {
+    buffer_.clear();
+    return false;
+  }
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  return true;
+#endif
+}
+
+void MappedFile::Close() {
+#if defined(BUILDCC_MAPPED_FILE_MMAP)
+  if (mapped_) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+  buffer_.clear();
+}
+
+} // namespace buildcc::env
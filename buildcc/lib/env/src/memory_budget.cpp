@@ -0,0 +1,209 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/memory_budget.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+constexpr std::string_view kMemAvailable = "MemAvailable:";
+constexpr const char *const kMeminfoFile = "/proc/meminfo";
+// MemAvailable changes without notifying waiting jobs
+constexpr std::chrono::milliseconds kRecheckInterval{50};
+
+struct MemoryBudgetState {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool enabled{false};
+  bool check_meminfo{false};
+  std::uint64_t budget_bytes{0};
+  std::uint64_t reserved_bytes{0};
+  std::size_t in_flight{0};
+};
+
+MemoryBudgetState &GetState() {
+  static MemoryBudgetState state;
+  return state;
+}
+
+// NOTE, Must be called with the state mutex held
+bool CanAdmit(const MemoryBudgetState &state, std::uint64_t predicted_bytes) {
+  if (state.in_flight == 0) {
+    return true;
+  }
+  if (state.budget_bytes != 0 &&
+      state.reserved_bytes + predicted_bytes > state.budget_bytes) {
+    return false;
+  }
+  if (state.check_meminfo) {
+    auto available = buildcc::env::get_meminfo_available();
+    if (available.has_value() && predicted_bytes > available.value()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+namespace buildcc::env {
+
+optional<std::uint64_t> parse_meminfo_available(std::string_view meminfo) {
+  std::size_t pos = 0;
+  while (pos < meminfo.size()) {
+    auto end = meminfo.find('\n', pos);
+    if (end == std::string_view::npos) {
+      end = meminfo.size();
+    }
+    std::string_view line = meminfo.substr(pos, end - pos);
+    pos = end + 1;
+    if (line.substr(0, kMemAvailable.size()) != kMemAvailable) {
+      continue;
+    }
+
+    // MemAvailable:    12345678 kB
+    line.remove_prefix(kMemAvailable.size());
+    const auto begin = line.find_first_not_of(' ');
+    if (begin == std::string_view::npos) {
+      return {};
+    }
+    line.remove_prefix(begin);
+    std::uint64_t kilobytes = 0;
+    auto [ptr, ec] =
+        std::from_chars(line.data(), line.data() + line.size(), kilobytes);
+    if (ec != std::errc() || std::string_view(ptr, line.data() + line.size() -
+                                                       ptr) != " kB") {
+      return {};
+    }
+    return kilobytes * 1024;
+  }
+  return {};
+}
+
+optional<std::uint64_t> get_meminfo_available() {
+  std::ifstream meminfo(kMeminfoFile);
+  if (!meminfo.is_open()) {
+    return {};
+  }
+  std::stringstream buffer;
+  buffer << meminfo.rdbuf();
+  return parse_meminfo_available(buffer.str());
+}
+
+MemoryBudget::Reservation &
+MemoryBudget::Reservation::operator=(Reservation &&other) noexcept {
+  if (this != &other) {
+    Release();
+    bytes_ = other.bytes_;
+    valid_ = other.valid_;
+    other.valid_ = false;
+  }
+  return *this;
+}
+
+void MemoryBudget::Reservation::Release() {
+  if (!valid_) {
+    return;
+  }
+  valid_ = false;
+
+  auto &state = GetState();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    // Reservations may outlive a Deinit
+    if (state.in_flight != 0) {
+      state.in_flight--;
+      state.reserved_bytes -= std::min(state.reserved_bytes, bytes_);
+    }
+  }
+  state.cv.notify_all();
+}
+
+void MemoryBudget::Init(std::uint64_t budget_bytes, bool check_meminfo) {
+  Deinit();
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.budget_bytes = budget_bytes;
+  state.check_meminfo = check_meminfo;
+  state.enabled = budget_bytes != 0 || check_meminfo;
+}
+
+void MemoryBudget::Deinit() {
+  auto &state = GetState();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.enabled = false;
+    state.check_meminfo = false;
+    state.budget_bytes = 0;
+    state.reserved_bytes = 0;
+    state.in_flight = 0;
+  }
+  state.cv.notify_all();
+}
+
+bool MemoryBudget::IsEnabled() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.enabled;
+}
+
+std::uint64_t MemoryBudget::GetReserved() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.reserved_bytes;
+}
+
+bool MemoryBudget::TryAcquire(std::uint64_t predicted_bytes,
+                              Reservation &reservation) {
+  reservation.Release();
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.enabled) {
+    return true;
+  }
+  if (!CanAdmit(state, predicted_bytes)) {
+    return false;
+  }
+  state.in_flight++;
+  state.reserved_bytes += predicted_bytes;
+  reservation = Reservation(predicted_bytes);
+  return true;
+}
+
+MemoryBudget::Reservation MemoryBudget::Acquire(std::uint64_t predicted_bytes) {
+  Reservation reservation;
+  auto &state = GetState();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (state.enabled) {
+    if (CanAdmit(state, predicted_bytes)) {
+      state.in_flight++;
+      state.reserved_bytes += predicted_bytes;
+      reservation = Reservation(predicted_bytes);
+      break;
+    }
+    state.cv.wait_for(lock, kRecheckInterval);
+  }
+  return reservation;
+}
+
+} // namespace buildcc::env
@@ -0,0 +1,584 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "env/process_reaper.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "env/logging.h"
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(SYS_pidfd_open) &&                                                \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define BUILDCC_PROCESS_REAPER 1
+extern char **environ;
+#endif
+#endif
+
+namespace {
+
+#if defined(BUILDCC_PROCESS_REAPER)
+
+// Stored in the low bits of the epoll user data, the child key in the
+// remaining bits
+enum class FdKind : std::uint64_t {
+  Wake = 0,
+  Pid = 1,
+  Stdout = 2,
+  Stderr = 3,
+};
+constexpr std::uint64_t kFdKindBits = 2;
+constexpr std::uint64_t kFdKindMask = (1 << kFdKindBits) - 1;
+constexpr int kMaxEvents = 64;
+constexpr std::size_t kReadSize = 64 * 1024;
+constexpr const char *const kShell = "/bin/sh";
+
+struct Child {
+  pid_t pid{-1};
+  int pidfd{-1};
+  int stdout_fd{-1};
+  int stderr_fd{-1};
+  bool reaped{false};
+  buildcc::env::ProcessExit exit;
+
+  buildcc::env::ProcessReaper::OutputCallback on_stdout;
+  buildcc::env::ProcessReaper::OutputCallback on_stderr;
+  buildcc::env::ProcessReaper::ExitCallback on_exit;
+};
+
+struct ReaperState {
+  ~ReaperState() {
+    // Deinit was not invoked before exit
+    if (thread.joinable()) {
+      thread.detach();
+    }
+  }
+
+  std::mutex mutex;
+  // Notified when a slot is released
+  std::condition_variable cv;
+  bool enabled{false};
+  unsigned int max_processes{0};
+  // Slots reserved by Spawn before the child is registered
+  std::size_t spawning{0};
+  // Slots reserved by TryAcquireSlot and not spawned yet
+  std::size_t reserved{0};
+  int epoll_fd{-1};
+  int wake_fd{-1};
+  std::thread thread;
+  // Keyed by spawn order, the process id of a reaped child can be reused
+  // while grandchildren still hold its output pipes open
+  std::uint64_t next_key{1};
+  std::unordered_map<std::uint64_t, std::unique_ptr<Child>> children;
+  // Children that have not been reaped yet
+  std::unordered_map<pid_t, std::uint64_t> running;
+};
+
+ReaperState &GetState() {
+  static ReaperState state;
+  return state;
+}
+
+std::uint64_t ToEventData(std::uint64_t key, FdKind kind) {
+  return (key << kFdKindBits) | static_cast<std::uint64_t>(kind);
+}
+
+bool AddFd(int epoll_fd, int fd, std::uint64_t data) {
+  struct epoll_event event {};
+  event.events = EPOLLIN;
+  event.data.u64 = data;
+  return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void RemoveFd(int epoll_fd, int &fd) {
+  (void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  fd = -1;
+}
+
+void ClosePipe(int (&fds)[2]) {
+  for (int &fd : fds) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+}
+
+// NOTE, The glibc `waitid` wrapper does not expose the rusage argument
+void Reap(ReaperState &state, Child &child) {
+  std::lock_guard<std::mutex> lock(state.mutex);
+  siginfo_t info{};
+  struct rusage usage {};
+  long ret = 0;
+  do {
+    ret = syscall(SYS_waitid, P_PID, child.pid, &info, WEXITED, &usage);
+  } while (ret < 0 && errno == EINTR);
+  child.reaped = true;
+  state.running.erase(child.pid);
+  RemoveFd(state.epoll_fd, child.pidfd);
+  if (ret != 0) {
+    return;
+  }
+
+  child.exit.exit_status = info.si_code == CLD_EXITED ? info.si_status : -1;
+  // ru_maxrss is reported in kilobytes
+  if (usage.ru_maxrss > 0) {
+    child.exit.peak_rss_bytes =
+        static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+  }
+}
+
+void Drain(ReaperState &state, int &fd,
+           const buildcc::env::ProcessReaper::OutputCallback &on_output,
+           std::vector<char> &buffer) {
+  ssize_t nread = 0;
+  do {
+    nread = read(fd, buffer.data(), buffer.size());
+  } while (nread < 0 && errno == EINTR);
+  if (nread > 0) {
+    on_output(buffer.data(), static_cast<std::size_t>(nread));
+    return;
+  }
+
+  // End of file once every writer, including grandchildren, has exited
+  std::lock_guard<std::mutex> lock(state.mutex);
+  RemoveFd(state.epoll_fd, fd);
+}
+
+// Completed children release their slot before the caller is notified
+void TryComplete(ReaperState &state, std::uint64_t key) {
+  std::unique_ptr<Child> child;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto iter = state.children.find(key);
+    if (iter == state.children.end() || !iter->second->reaped ||
+        iter->second->stdout_fd >= 0 || iter->second->stderr_fd >= 0) {
+      return;
+    }
+    child = std::move(iter->second);
+    state.children.erase(iter);
+  }
+  state.cv.notify_all();
+
+  try {
+    child->on_exit(child->exit);
+  } catch (...) {
+    buildcc::env::log_critical(
+        __FUNCTION__,
+        fmt::format("Exit callback of process {} failed", child->pid));
+  }
+}
+
+void ReaperLoop(ReaperState &state) {
+  std::vector<char> buffer(kReadSize);
+  std::vector<struct epoll_event> events(kMaxEvents);
+  while (true) {
+    const int nevents =
+        epoll_wait(state.epoll_fd, events.data(), kMaxEvents, -1);
+    if (nevents < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      buildcc::env::log_critical(__FUNCTION__, "epoll_wait failed");
+      return;
+    }
+
+    for (int i = 0; i < nevents; i++) {
+      const std::uint64_t data = events[i].data.u64;
+      const auto kind = static_cast<FdKind>(data & kFdKindMask);
+      // Only written by Deinit once every child has completed
+      if (kind == FdKind::Wake) {
+        return;
+      }
+
+      const std::uint64_t key = data >> kFdKindBits;
+      Child *child = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto iter = state.children.find(key);
+        if (iter != state.children.end()) {
+          child = iter->second.get();
+        }
+      }
+      // Descriptors of completed children are closed
+      if (child == nullptr) {
+        continue;
+      }
+
+      switch (kind) {
+      case FdKind::Pid:
+        if (child->pidfd >= 0) {
+          Reap(state, *child);
+        }
+        break;
+      case FdKind::Stdout:
+        if (child->stdout_fd >= 0) {
+          Drain(state, child->stdout_fd, child->on_stdout, buffer);
+        }
+        break;
+      case FdKind::Stderr:
+        if (child->stderr_fd >= 0) {
+          Drain(state, child->stderr_fd, child->on_stderr, buffer);
+        }
+        break;
+      default:
+        break;
+      }
+      TryComplete(state, key);
+    }
+  }
+}
+
+// Output that is redirected to the caller is written to a close-on-exec pipe
+// so that concurrently spawned children do not inherit the write end
+bool OpenPipe(const buildcc::env::ProcessReaper::OutputCallback &on_output,
+              int (&fds)[2]) {
+  return !on_output || pipe2(fds, O_CLOEXEC) == 0;
+}
+
+pid_t SpawnProcess(const std::vector<std::string> &arguments,
+                   const std::string &working_directory, int (&out_fds)[2],
+                   int (&err_fds)[2]) {
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawnattr_init(&attr);
+
+  // Own process group, terminated together by Kill
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+  if (out_fds[1] >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, out_fds[1], STDOUT_FILENO);
+  }
+  if (err_fds[1] >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, err_fds[1], STDERR_FILENO);
+  }
+  if (!working_directory.empty()) {
+    posix_spawn_file_actions_addchdir_np(&actions, working_directory.c_str());
+  }
+
+  std::vector<const char *> argv;
+  argv.reserve(arguments.size() + 1);
+  for (const auto &argument : arguments) {
+    argv.push_back(argument.c_str());
+  }
+  argv.push_back(nullptr);
+
+  // Executables without a path are searched in PATH
+  pid_t pid = -1;
+  const int err =
+      posix_spawnp(&pid, argv[0], &actions, &attr,
+                   const_cast<char *const *>(argv.data()), environ);
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  return err == 0 ? pid : -1;
+}
+
+#endif
+
+} // namespace
+
+namespace buildcc::env {
+
+ProcessReaper::Slot &ProcessReaper::Slot::operator=(Slot &&other) noexcept {
+  if (this != &other) {
+    Release();
+    valid_ = other.valid_;
+    other.valid_ = false;
+  }
+  return *this;
+}
+
+void ProcessReaper::Slot::Release() {
+  if (!valid_) {
+    return;
+  }
+  valid_ = false;
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.reserved--;
+  }
+  state.cv.notify_all();
+#endif
+}
+
+bool ProcessReaper::Init(unsigned int max_processes) {
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.enabled) {
+    state.max_processes = max_processes;
+    return true;
+  }
+
+  // pidfd_open is not available before Linux 5.3
+  const int probe_fd =
+      static_cast<int>(syscall(SYS_pidfd_open, getpid(), 0U));
+  if (probe_fd < 0) {
+    env::log_debug(__FUNCTION__, "pidfd_open is not supported");
+    return false;
+  }
+  close(probe_fd);
+
+  state.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  state.wake_fd = eventfd(0, EFD_CLOEXEC);
+  if (state.epoll_fd < 0 || state.wake_fd < 0 ||
+      !AddFd(state.epoll_fd, state.wake_fd, ToEventData(0, FdKind::Wake))) {
+    env::log_warning(__FUNCTION__, "Could not create the process reaper");
+    if (state.epoll_fd >= 0) {
+      close(state.epoll_fd);
+      state.epoll_fd = -1;
+    }
+    if (state.wake_fd >= 0) {
+      close(state.wake_fd);
+      state.wake_fd = -1;
+    }
+    return false;
+  }
+
+  state.max_processes = max_processes;
+  state.enabled = true;
+  state.thread = std::thread(ReaperLoop, std::ref(state));
+  return true;
+#else
+  (void)max_processes;
+  return false;
+#endif
+}
+
+void ProcessReaper::Deinit() {
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    if (!state.enabled) {
+      return;
+    }
+    state.enabled = false;
+    state.cv.notify_all();
+    state.cv.wait(lock, [&]() {
+      return state.children.empty() && state.spawning == 0;
+    });
+  }
+
+  const std::uint64_t wake = 1;
+  (void)write(state.wake_fd, &wake, sizeof(wake));
+  state.thread.join();
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  close(state.epoll_fd);
+  close(state.wake_fd);
+  state.epoll_fd = -1;
+  state.wake_fd = -1;
+#endif
+}
+
+bool ProcessReaper::IsEnabled() {
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.enabled;
+#else
+  return false;
+#endif
+}
+
+bool ProcessReaper::TryAcquireSlot(Slot &slot) {
+  slot.Release();
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.enabled || state.max_processes == 0) {
+    return true;
+  }
+  if (state.children.size() + state.spawning + state.reserved >=
+      state.max_processes) {
+    return false;
+  }
+  state.reserved++;
+  slot = Slot(true);
+#endif
+  return true;
+}
+
+int ProcessReaper::Spawn(const std::string &command,
+                         const std::string &working_directory,
+                         const OutputCallback &on_stdout,
+                         const OutputCallback &on_stderr,
+                         const ExitCallback &on_exit, Slot slot) {
+#if defined(BUILDCC_PROCESS_REAPER)
+  return Spawn(std::vector<std::string>{kShell, "-c", command},
+               working_directory, on_stdout, on_stderr, on_exit,
+               std::move(slot));
+#else
+  (void)command;
+  (void)working_directory;
+  (void)on_stdout;
+  (void)on_stderr;
+  (void)on_exit;
+  (void)slot;
+  return -1;
+#endif
+}
+
+int ProcessReaper::Spawn(const std::vector<std::string> &arguments,
+                         const std::string &working_directory,
+                         const OutputCallback &on_stdout,
+                         const OutputCallback &on_stderr,
+                         const ExitCallback &on_exit, Slot slot) {
+#if defined(BUILDCC_PROCESS_REAPER)
+  if (arguments.empty()) {
+    return -1;
+  }
+  auto &state = GetState();
+  {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    if (slot.IsValid()) {
+      // The reserved slot is handed over to this child
+      slot.valid_ = false;
+      state.reserved--;
+    } else {
+      state.cv.wait(lock, [&]() {
+        return !state.enabled || state.max_processes == 0 ||
+               state.children.size() + state.spawning + state.reserved <
+                   state.max_processes;
+      });
+    }
+    if (!state.enabled) {
+      state.cv.notify_all();
+      return -1;
+    }
+    state.spawning++;
+  }
+
+  auto child = std::make_unique<Child>();
+  child->on_stdout = on_stdout;
+  child->on_stderr = on_stderr;
+  child->on_exit = on_exit;
+
+  int out_fds[2] = {-1, -1};
+  int err_fds[2] = {-1, -1};
+  pid_t pid = -1;
+  int pidfd = -1;
+  if (OpenPipe(on_stdout, out_fds) && OpenPipe(on_stderr, err_fds)) {
+    pid = SpawnProcess(arguments, working_directory, out_fds, err_fds);
+  }
+  if (pid > 0) {
+    pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0U));
+    if (pidfd < 0) {
+      kill(-pid, SIGKILL);
+      (void)waitpid(pid, nullptr, 0);
+      pid = -1;
+    }
+  }
+  // The write ends now belong to the child
+  if (out_fds[1] >= 0) {
+    close(out_fds[1]);
+    out_fds[1] = -1;
+  }
+  if (err_fds[1] >= 0) {
+    close(err_fds[1]);
+    err_fds[1] = -1;
+  }
+
+  std::unique_lock<std::mutex> lock(state.mutex);
+  state.spawning--;
+  if (pid < 0) {
+    lock.unlock();
+    state.cv.notify_all();
+    ClosePipe(out_fds);
+    ClosePipe(err_fds);
+    env::log_warning(__FUNCTION__,
+                     fmt::format("Could not spawn \"{}\"", arguments[0]));
+    return -1;
+  }
+
+  // Registered before the descriptors are watched by the reaper thread
+  child->pid = pid;
+  child->pidfd = pidfd;
+  child->stdout_fd = out_fds[0];
+  child->stderr_fd = err_fds[0];
+  Child &registered = *child;
+  const std::uint64_t key = state.next_key++;
+  state.children.emplace(key, std::move(child));
+  state.running.emplace(pid, key);
+  (void)AddFd(state.epoll_fd, registered.pidfd,
+              ToEventData(key, FdKind::Pid));
+  if (registered.stdout_fd >= 0) {
+    (void)AddFd(state.epoll_fd, registered.stdout_fd,
+                ToEventData(key, FdKind::Stdout));
+  }
+  if (registered.stderr_fd >= 0) {
+    (void)AddFd(state.epoll_fd, registered.stderr_fd,
+                ToEventData(key, FdKind::Stderr));
+  }
+  return pid;
+#else
+  (void)arguments;
+  (void)working_directory;
+  (void)on_stdout;
+  (void)on_stderr;
+  (void)on_exit;
+  (void)slot;
+  return -1;
+#endif
+}
+
+void ProcessReaper::Kill(int pid) {
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.running.count(pid) == 0) {
+    return;
+  }
+  kill(-pid, SIGTERM);
+#else
+  (void)pid;
+#endif
+}
+
+std::size_t ProcessReaper::GetInFlight() {
+#if defined(BUILDCC_PROCESS_REAPER)
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.children.size() + state.spawning;
+#else
+  return 0;
+#endif
+}
+
+} // namespace buildcc::env
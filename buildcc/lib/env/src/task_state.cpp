@@ -16,26 +16,55 @@
 
 #include "env/task_state.h"
 
-#include <mutex>
+#include <algorithm>
 
-namespace {
-
-std::mutex current_state_mutex;
-buildcc::env::TaskState current_state{buildcc::env::TaskState::SUCCESS};
-
-} // namespace
+#include "env/build_context.h"
+#include "env/command.h"
 
 namespace buildcc::env {
 
 void set_task_state(TaskState state) {
-  // NOTE, `Avoid resetting` if same state is provided
-  if (state == get_task_state()) {
-    return;
+  BuildContext::Global().SetTaskState(state);
+}
+TaskState get_task_state() { return BuildContext::Global().GetTaskState(); }
+
+void set_failure_mode(FailureMode mode) {
+  BuildContext::Global().SetFailureMode(mode);
+}
+FailureMode get_failure_mode() {
+  return BuildContext::Global().GetFailureMode();
+}
+
+// FailureScope
+
+FailureScope::FailureScope() : context_(&BuildContext::Global()) {}
+
+void FailureScope::Fail() {
+  failed_.store(true);
+  context_->SetTaskState(TaskState::FAILURE);
+  if (context_->GetFailureMode() == FailureMode::FailFast) {
+    Command::CancelAll(*context_);
+  }
+}
+
+bool FailureScope::IsFailed() const {
+  if (failed_.load()) {
+    return true;
   }
-  std::lock_guard<std::mutex> guard(current_state_mutex);
-  current_state = state;
+  return std::any_of(upstream_.begin(), upstream_.end(),
+                     [](const FailureScope *u) { return u->IsFailed(); });
 }
 
-TaskState get_task_state() { return current_state; }
+bool FailureScope::CanRun() const {
+  if (context_->GetFailureMode() != FailureMode::KeepGoing &&
+      context_->GetTaskState() != TaskState::SUCCESS) {
+    return false;
+  }
+  return !IsFailed();
+}
+
+void FailureScope::AddUpstream(const FailureScope &upstream) {
+  upstream_.push_back(&upstream);
+}
 
 } // namespace buildcc::env
@@ -0,0 +1,68 @@
+#include "env/build_context.h"
+#include "env/env.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+// clang-format off
+TEST_GROUP(BuildContextTestGroup)
+{
+  void teardown() {
+    buildcc::Project::Deinit();
+    buildcc::env::set_task_state(buildcc::env::TaskState::SUCCESS);
+    buildcc::env::set_failure_mode(buildcc::env::FailureMode::Stop);
+  }
+};
+// clang-format on
+
+TEST(BuildContextTestGroup, Project_UsesGlobal) {
+  auto &global = buildcc::BuildContext::Global();
+  CHECK_FALSE(global.IsInit());
+
+  buildcc::Project::Init("root", "build");
+  CHECK_TRUE(global.IsInit());
+  CHECK_TRUE(buildcc::Project::IsInit());
+  CHECK_TRUE(&buildcc::Project::GetRootDir() == &global.GetRootDir());
+  STRCMP_EQUAL(global.GetBuildDir().string().c_str(), "build");
+
+  buildcc::env::set_task_state(buildcc::env::TaskState::FAILURE);
+  CHECK_TRUE(global.GetTaskState() == buildcc::env::TaskState::FAILURE);
+
+  buildcc::Project::Deinit();
+  CHECK_FALSE(global.IsInit());
+  CHECK_TRUE(global.GetRootDir().empty());
+}
+
+TEST(BuildContextTestGroup, IndependentContexts) {
+  buildcc::BuildContext first("first_root", "first_build");
+  buildcc::BuildContext second("second_root", "second_build");
+  CHECK_TRUE(first.IsInit());
+  STRCMP_EQUAL(second.GetRootDir().string().c_str(), "second_root");
+  CHECK_FALSE(buildcc::Project::IsInit());
+
+  buildcc::env::FailureScope first_scope(first);
+  buildcc::env::FailureScope second_scope(second);
+  CHECK_TRUE(&first_scope.GetContext() == &first);
+
+  // Failures do not leak into other builds
+  first_scope.Fail();
+  CHECK_TRUE(first.GetTaskState() == buildcc::env::TaskState::FAILURE);
+  CHECK_TRUE(second.GetTaskState() == buildcc::env::TaskState::SUCCESS);
+  CHECK_TRUE(buildcc::env::get_task_state() ==
+             buildcc::env::TaskState::SUCCESS);
+  CHECK_FALSE(first_scope.CanRun());
+  CHECK_TRUE(second_scope.CanRun());
+
+  // Failure modes are per build
+  second.SetFailureMode(buildcc::env::FailureMode::KeepGoing);
+  CHECK_TRUE(first.GetFailureMode() == buildcc::env::FailureMode::Stop);
+  CHECK_TRUE(buildcc::env::get_failure_mode() ==
+             buildcc::env::FailureMode::Stop);
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
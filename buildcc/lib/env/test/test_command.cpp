@@ -55,6 +55,41 @@ TEST(CommandTestGroup, GetDefaultValueByKey_BadKey) {
   CHECK_THROWS(std::exception, command.GetDefaultValueByKey("bad_key"));
 }
 
+TEST(CommandTestGroup, SplitArguments) {
+  auto arguments = buildcc::env::Command::SplitArguments(
+      "  gcc -std=c++17\t-o out.o  -c main.cpp ");
+  CHECK_TRUE(arguments.has_value());
+  CHECK_EQUAL(arguments->size(), 6);
+  STRCMP_EQUAL((*arguments)[0].c_str(), "gcc");
+  STRCMP_EQUAL((*arguments)[1].c_str(), "-std=c++17");
+  STRCMP_EQUAL((*arguments)[2].c_str(), "-o");
+  STRCMP_EQUAL((*arguments)[5].c_str(), "main.cpp");
+}
+
+TEST(CommandTestGroup, SplitArguments_Quoted) {
+  auto arguments = buildcc::env::Command::SplitArguments(
+      "gcc \"a b.cpp\" 'c d.cpp' e\\ f.cpp");
+  CHECK_TRUE(arguments.has_value());
+  CHECK_EQUAL(arguments->size(), 4);
+  STRCMP_EQUAL((*arguments)[1].c_str(), "a b.cpp");
+  STRCMP_EQUAL((*arguments)[2].c_str(), "c d.cpp");
+  STRCMP_EQUAL((*arguments)[3].c_str(), "e f.cpp");
+}
+
+TEST(CommandTestGroup, SplitArguments_ShellSyntax) {
+  using buildcc::env::Command;
+  CHECK_FALSE(Command::SplitArguments("").has_value());
+  CHECK_FALSE(Command::SplitArguments(" \t ").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc $CFLAGS main.cpp").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc *.cpp").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc main.cpp > out").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc main.cpp | cat").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc main.cpp && true").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc \"$HOME\"").has_value());
+  CHECK_FALSE(Command::SplitArguments("gcc \"main.cpp").has_value());
+  CHECK_FALSE(Command::SplitArguments("CC=gcc make").has_value());
+}
+
 int main(int ac, char **av) {
   return CommandLineTestRunner::RunAllTests(ac, av);
 }
@@ -0,0 +1,85 @@
+#include "env/command_line.h"
+#include "env/host_os.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+using buildcc::env::CommandLine;
+
+// clang-format off
+TEST_GROUP(CommandLineTestGroup)
+{
+};
+// clang-format on
+
+TEST(CommandLineTestGroup, ToString_Plain) {
+  CommandLine command_line({"gcc", "-std=c++17", "-o", "/tmp/out.o"});
+  STRCMP_EQUAL(command_line.ToString().c_str(), "gcc -std=c++17 -o /tmp/out.o");
+}
+
+TEST(CommandLineTestGroup, ToString_Split_RoundTrip) {
+  const std::vector<std::string> arguments = {
+      "gcc",   "a b.cpp",  "it's",      "$HOME",          "",
+      "x\"y",  "C:\\dir\\", "tab\there", "-DNAME=\"value\"", "\\\\server",
+      "{}*?;", "100%",
+  };
+  CommandLine command_line(arguments);
+  const auto split = CommandLine::Split(command_line.ToString());
+  CHECK_TRUE(split.has_value());
+  CHECK_EQUAL(split->size(), arguments.size());
+  for (std::size_t i = 0; i < arguments.size(); i++) {
+    STRCMP_EQUAL((*split)[i].c_str(), arguments[i].c_str());
+  }
+}
+
+TEST(CommandLineTestGroup, Split) {
+  if constexpr (buildcc::env::is_win()) {
+    return;
+  }
+  const auto split =
+      CommandLine::Split("  g++ -I\"inc dir\" '-DA=\"b\"' c\\ d \"\" x\\\\y ");
+  CHECK_TRUE(split.has_value());
+  CHECK_EQUAL(split->size(), 6);
+  STRCMP_EQUAL((*split)[0].c_str(), "g++");
+  STRCMP_EQUAL((*split)[1].c_str(), "-Iinc dir");
+  STRCMP_EQUAL((*split)[2].c_str(), "-DA=\"b\"");
+  STRCMP_EQUAL((*split)[3].c_str(), "c d");
+  STRCMP_EQUAL((*split)[4].c_str(), "");
+  STRCMP_EQUAL((*split)[5].c_str(), "x\\y");
+
+  CHECK_TRUE(CommandLine::Split("")->empty());
+}
+
+TEST(CommandLineTestGroup, Split_ShellSyntax) {
+  if constexpr (buildcc::env::is_win()) {
+    return;
+  }
+  CHECK_FALSE(CommandLine::Split("gcc $CFLAGS").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc \"$CFLAGS\"").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc `pkg-config --cflags x`").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc *.c").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc a.c > out").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc a.c; true").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc 'a.c").has_value());
+  CHECK_FALSE(CommandLine::Split("gcc \\").has_value());
+}
+
+TEST(CommandLineTestGroup, WorkingDirectory) {
+  CommandLine command_line;
+  CHECK_TRUE(command_line.IsEmpty());
+  CHECK_FALSE(command_line.GetWorkingDirectory().has_value());
+
+  command_line.AddArgument("make");
+  command_line.SetWorkingDirectory("build");
+  CHECK_FALSE(command_line.IsEmpty());
+  CHECK_TRUE(command_line.GetWorkingDirectory().value() == "build");
+  CHECK_TRUE(command_line == CommandLine({"make"}, fs::path("build")));
+  CHECK_FALSE(command_line == CommandLine({"make"}));
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
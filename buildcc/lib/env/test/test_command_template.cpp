@@ -0,0 +1,140 @@
+#include "env/command.h"
+#include "env/command_template.h"
+#include "env/host_os.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+using buildcc::env::Command;
+using buildcc::env::CommandTemplate;
+
+// clang-format off
+TEST_GROUP(CommandTemplateTestGroup)
+{
+};
+// clang-format on
+
+TEST(CommandTemplateTestGroup, Render) {
+  CommandTemplate command("{compiler} -o {output} -c {input}");
+  const std::string rendered = command.Render({
+      {"compiler", "gcc"},
+      {"output", "main.o"},
+      {"input", "main.c"},
+  });
+  STRCMP_EQUAL(rendered.c_str(), "gcc -o main.o -c main.c");
+}
+
+TEST(CommandTemplateTestGroup, Render_Escaped) {
+  CommandTemplate command("{{literal}} {value} }}");
+  STRCMP_EQUAL(command.Render({{"value", "v"}}).c_str(), "{literal} v }");
+}
+
+TEST(CommandTemplateTestGroup, Bind) {
+  CommandTemplate command("{compiler} {flags} -o {output} -c {input}");
+  command.Bind({{"compiler", "gcc"}, {"flags", "-O2 -g"}});
+  STRCMP_EQUAL(command.Render({{"output", "a.o"}, {"input", "a.c"}}).c_str(),
+               "gcc -O2 -g -o a.o -c a.c");
+  STRCMP_EQUAL(command.Render({{"output", "b.o"}, {"input", "b.c"}}).c_str(),
+               "gcc -O2 -g -o b.o -c b.c");
+
+  // Values bound first take precedence
+  command.Bind({{"compiler", "clang"}, {"input", "c.c"}});
+  STRCMP_EQUAL(command.Render({{"output", "c.o"}}).c_str(),
+               "gcc -O2 -g -o c.o -c c.c");
+}
+
+TEST(CommandTemplateTestGroup, Render_MissingArgument) {
+  CommandTemplate command("{compiler} {input}");
+  command.Bind({{"compiler", "gcc"}});
+  CHECK_THROWS(std::exception, command.Render());
+  CHECK_THROWS(std::exception, command.Render({{nullptr, "main.c"}}));
+}
+
+TEST(CommandTemplateTestGroup, CreateTemplate_SameAsConstruct) {
+  Command command;
+  command.AddDefaultArguments({
+      {"include_dirs", "-Iinclude -Isrc"},
+      {"compile_flags", "-Wall"},
+  });
+
+  const std::string patterns[] = {
+      "{compiler} {include_dirs} {compile_flags} -o {output} -c {input}",
+      "{{{compiler}}} {{}} {input}",
+      "prefix{input}suffix",
+      "{input}{input}",
+      "{input:>12}",
+      "{}",
+      "",
+  };
+  for (const auto &pattern : patterns) {
+    const CommandTemplate::Arguments arguments = {
+        {"compiler", "g++"},
+        {"output", "main.o"},
+        {"input", "main.cpp"},
+    };
+    STRCMP_EQUAL(command.CreateTemplate(pattern).Render(arguments).c_str(),
+                 command.Construct(pattern, arguments).c_str());
+  }
+}
+
+TEST(CommandTemplateTestGroup, InvalidPattern) {
+  Command command;
+  const std::string patterns[] = {"{input", "input}", "{in put}"};
+  for (const auto &pattern : patterns) {
+    CHECK_THROWS(std::exception, command.Construct(pattern, {{"input", "a"}}));
+    CHECK_THROWS(std::exception,
+                 command.CreateTemplate(pattern).Render({{"input", "a"}}));
+  }
+}
+
+TEST(CommandTemplateTestGroup, RenderCommandLine) {
+  if constexpr (buildcc::env::is_win()) {
+    return;
+  }
+  CommandTemplate command_template(
+      "{compiler} {flags} -o {output} -I{include}.d -c {input} {empty}");
+  command_template.Bind({
+      {"compiler", "g++"},
+      {"flags", "-O2  -DNAME='\"a b\"'"},
+  });
+  const auto command_line = command_template.RenderCommandLine({
+      {"output", "out dir/main.o"},
+      {"include", "inc"},
+      {"input", "$main.cpp"},
+      {"empty", ""},
+  });
+  CHECK_TRUE(command_line.has_value());
+  const std::vector<std::string> expected = {
+      "g++",           "-O2",    "-DNAME=\"a b\"", "-o",
+      "out dir/main.o", "-Iinc.d", "-c",             "$main.cpp",
+  };
+  CHECK_TRUE(command_line->GetArguments() == expected);
+}
+
+TEST(CommandTemplateTestGroup, RenderCommandLine_ShellSyntax) {
+  if constexpr (buildcc::env::is_win()) {
+    return;
+  }
+  CommandTemplate command_template("{compiler} {flags} {input} > {output}");
+  CHECK_FALSE(command_template.RenderCommandLine({
+                                  {"compiler", "gcc"},
+                                  {"flags", ""},
+                                  {"input", "a"},
+                                  {"output", "b"},
+                              })
+                  .has_value());
+
+  CommandTemplate bound("{compiler} {flags} {input}");
+  bound.Bind({{"flags", "$(pkg-config --cflags x)"}});
+  CHECK_FALSE(
+      bound.RenderCommandLine({{"compiler", "gcc"}, {"input", "a"}})
+          .has_value());
+  CHECK_FALSE(CommandTemplate("{} {}").RenderCommandLine().has_value());
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -0,0 +1,58 @@
+#include "env/concurrency.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+// clang-format off
+TEST_GROUP(ConcurrencyTestGroup)
+{
+};
+// clang-format on
+
+TEST(ConcurrencyTestGroup, ParseCgroupCpuMax) {
+  auto cpus = buildcc::env::parse_cgroup_cpu_max("400000 100000\n");
+  CHECK_TRUE(cpus.has_value());
+  CHECK_EQUAL(cpus.value(), 4);
+
+  // Fractional quotas are rounded up
+  cpus = buildcc::env::parse_cgroup_cpu_max("150000 100000");
+  CHECK_TRUE(cpus.has_value());
+  CHECK_EQUAL(cpus.value(), 2);
+
+  cpus = buildcc::env::parse_cgroup_cpu_max("1000 100000");
+  CHECK_TRUE(cpus.has_value());
+  CHECK_EQUAL(cpus.value(), 1);
+}
+
+TEST(ConcurrencyTestGroup, ParseCgroupCpuMax_Unlimited) {
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("max 100000\n").has_value());
+}
+
+TEST(ConcurrencyTestGroup, ParseCgroupCpuMax_Malformed) {
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("").has_value());
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("400000").has_value());
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("400000 0").has_value());
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("0 100000").has_value());
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("4x 100000").has_value());
+  CHECK_FALSE(buildcc::env::parse_cgroup_cpu_max("-1 100000").has_value());
+}
+
+TEST(ConcurrencyTestGroup, AvailableConcurrency) {
+  const unsigned int affinity = buildcc::env::get_affinity_cpu_count();
+  const unsigned int available = buildcc::env::get_available_concurrency();
+  CHECK_TRUE(affinity >= 1);
+  CHECK_TRUE(available >= 1);
+  CHECK_TRUE(available <= affinity);
+
+  const auto quota = buildcc::env::get_cgroup_cpu_quota();
+  if (quota.has_value()) {
+    CHECK_TRUE(available <= quota.value());
+  }
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
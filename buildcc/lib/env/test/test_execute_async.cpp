@@ -0,0 +1,171 @@
+#include "env/command.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "env/jobserver.h"
+#include "env/process_reaper.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+using buildcc::env::Command;
+using buildcc::env::CommandStats;
+using buildcc::env::JobServer;
+using buildcc::env::ProcessReaper;
+
+namespace {
+
+// Records the order in which commands exit
+// NOTE, Callbacks run on the completion or dispatch thread, results are
+// checked on the main thread
+class ExitOrder {
+public:
+  Command::ExitCallback Exit(int id) {
+    return [this, id](bool success, const CommandStats &stats) {
+      (void)stats;
+      std::lock_guard<std::mutex> lock(mutex_);
+      ids_.push_back(success ? id : -1);
+      cv_.notify_all();
+    };
+  }
+
+  bool WaitFor(std::size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(10),
+                        [&]() { return ids_.size() >= count; });
+  }
+
+  std::vector<int> GetIds() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ids_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<int> ids_;
+};
+
+} // namespace
+
+// clang-format off
+TEST_GROUP(ExecuteAsyncTestGroup)
+{
+  void teardown() {
+    JobServer::Deinit();
+    ProcessReaper::Deinit();
+  }
+};
+// clang-format on
+
+TEST(ExecuteAsyncTestGroup, Direct) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+
+  ExitOrder order;
+  Command::ExecuteAsync("true", {}, order.Exit(0));
+  Command::ExecuteAsync("false", {}, order.Exit(1));
+  CHECK_TRUE(order.WaitFor(2));
+  const std::vector<int> ids = order.GetIds();
+  CHECK_TRUE(ids[0] == -1 || ids[1] == -1);
+  CHECK_TRUE(ids[0] == 0 || ids[1] == 0);
+}
+
+TEST(ExecuteAsyncTestGroup, JobServerSaturated) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+  CHECK_TRUE(JobServer::InitServer(1));
+  JobServer::Token token;
+  CHECK_TRUE(JobServer::TryAcquire(token));
+  JobServer::Token other;
+  CHECK_FALSE(JobServer::TryAcquire(other));
+
+  // Queued while every job slot is held
+  ExitOrder order;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 4; i++) {
+    Command::ExecuteAsync("sleep 0.02", {}, order.Exit(i));
+  }
+  CHECK_TRUE(std::chrono::steady_clock::now() - start <
+             std::chrono::milliseconds(500));
+  CHECK_EQUAL(order.GetIds().size(), 0);
+  CHECK_EQUAL(ProcessReaper::GetInFlight(), 0);
+
+  // A single job slot runs the queued commands one after the other
+  token.Release();
+  CHECK_TRUE(order.WaitFor(4));
+  const std::vector<int> ids = order.GetIds();
+  CHECK_EQUAL(ids.size(), 4);
+  for (int i = 0; i < 4; i++) {
+    CHECK_EQUAL(ids[i], i);
+  }
+}
+
+TEST(ExecuteAsyncTestGroup, Priority) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+  CHECK_TRUE(JobServer::InitServer(1));
+  JobServer::Token token;
+  CHECK_TRUE(JobServer::TryAcquire(token));
+
+  // The dispatch thread waits for the job slot with the first launch
+  ExitOrder order;
+  Command::ExecuteAsync("true", {}, order.Exit(99), nullptr, 0, 100);
+
+  // Highest priority first, in order within a priority
+  const std::vector<std::uint64_t> priorities{10, 0, 30, 10, 20};
+  for (std::size_t i = 0; i < priorities.size(); i++) {
+    Command::ExecuteAsync("true", {}, order.Exit(static_cast<int>(i)),
+                          nullptr, 0, priorities[i]);
+  }
+
+  token.Release();
+  CHECK_TRUE(order.WaitFor(priorities.size() + 1));
+  const std::vector<int> ids = order.GetIds();
+  const std::vector<int> expected{99, 2, 4, 0, 3, 1};
+  CHECK_TRUE(ids == expected);
+}
+
+TEST(ExecuteAsyncTestGroup, ProcessReaperSaturated) {
+  if (!ProcessReaper::Init(1)) {
+    return;
+  }
+  ProcessReaper::Slot slot;
+  CHECK_TRUE(ProcessReaper::TryAcquireSlot(slot));
+  CHECK_TRUE(slot.IsValid());
+
+  // ExecuteAsync does not wait for a process slot
+  ExitOrder order;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 3; i++) {
+    Command::ExecuteAsync("true", {}, order.Exit(i));
+  }
+  CHECK_TRUE(std::chrono::steady_clock::now() - start <
+             std::chrono::milliseconds(500));
+  CHECK_EQUAL(order.GetIds().size(), 0);
+
+  slot.Release();
+  CHECK_TRUE(order.WaitFor(3));
+  const std::vector<int> ids = order.GetIds();
+  for (int i = 0; i < 3; i++) {
+    CHECK_EQUAL(ids[i], i);
+  }
+}
+
+int main(int ac, char **av) {
+  // The reaper and the dispatch thread keep their bookkeeping allocated
+  // across tests
+  MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
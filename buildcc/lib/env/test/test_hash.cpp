@@ -0,0 +1,100 @@
+#include "env/hash.h"
+
+#include <filesystem>
+#include <string>
+
+#include "env/util.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+namespace fs = std::filesystem;
+
+// clang-format off
+TEST_GROUP(HashTestGroup)
+{
+};
+// clang-format on
+
+static std::string PatternData(std::size_t len) {
+  std::string data;
+  for (std::size_t i = 0; i < len; i++) {
+    data.push_back(static_cast<char>(i * 31 + 7));
+  }
+  return data;
+}
+
+// Reference values computed with XXH3_64bits from xxHash 0.8
+TEST(HashTestGroup, HashBytes_Reference) {
+  const std::string data = PatternData(1000);
+
+  CHECK_TRUE(buildcc::env::hash_bytes(nullptr, 0) == 0x2d06800538d394c2ULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(data.data(), 3) ==
+             0x15f7093b173d005cULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(data.data(), 8) ==
+             0xdec6a9a43575982eULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(data.data(), 16) ==
+             0x7e484c18d74895d0ULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(data.data(), 100) ==
+             0x8c97158042fbf926ULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(data.data(), 200) ==
+             0x12fdb864685f344dULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(data.data(), 1000) ==
+             0x989765d0ea7a5ecdULL);
+  CHECK_TRUE(buildcc::env::hash_bytes(std::string("hello world")) ==
+             0xd447b1ea40e6988bULL);
+}
+
+TEST(HashTestGroup, HashFile) {
+  constexpr const char *const FILENAME = "HashFile.txt";
+  const std::string data = PatternData(1000);
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, data, true));
+
+  std::uint64_t hash{0};
+  CHECK_TRUE(buildcc::env::hash_file(FILENAME, &hash));
+  CHECK_TRUE(hash == 0x989765d0ea7a5ecdULL);
+}
+
+TEST(HashTestGroup, HashFile_Empty) {
+  constexpr const char *const FILENAME = "HashFile_Empty.txt";
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, std::string(), true));
+
+  std::uint64_t hash{0};
+  CHECK_TRUE(buildcc::env::hash_file(FILENAME, &hash));
+  CHECK_TRUE(hash == 0x2d06800538d394c2ULL);
+}
+
+TEST(HashTestGroup, HashFile_Failure) {
+  std::uint64_t hash{0};
+  CHECK_FALSE(buildcc::env::hash_file(nullptr, &hash));
+  CHECK_FALSE(buildcc::env::hash_file("HashFile.txt", nullptr));
+
+  fs::remove("HashFile_NotFound.txt");
+  CHECK_FALSE(buildcc::env::hash_file("HashFile_NotFound.txt", &hash));
+}
+
+// Reference values from FIPS 180-4 examples and sha256sum
+TEST(HashTestGroup, Sha256_Reference) {
+  STRCMP_EQUAL(
+      buildcc::env::sha256_hex(nullptr, 0).c_str(),
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  STRCMP_EQUAL(
+      buildcc::env::sha256_hex(std::string("abc")).c_str(),
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  STRCMP_EQUAL(
+      buildcc::env::sha256_hex(
+          std::string(
+              "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))
+          .c_str(),
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  STRCMP_EQUAL(
+      buildcc::env::sha256_hex(std::string(1000000, 'a')).c_str(),
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
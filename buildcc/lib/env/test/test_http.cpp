@@ -0,0 +1,213 @@
+#include "env/http.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+using buildcc::env::HttpClient;
+using buildcc::env::HttpRequest;
+using buildcc::env::HttpResponse;
+using buildcc::env::HttpServer;
+
+// clang-format off
+TEST_GROUP(HttpTestGroup)
+{
+};
+// clang-format on
+
+constexpr std::chrono::milliseconds kTimeout(5000);
+
+static HttpResponse Echo(const HttpRequest &request) {
+  if (request.path == "/missing") {
+    return {404, "missing"};
+  }
+  return {200, fmt::format("{} {} {}", request.method, request.path,
+                           request.body)};
+}
+
+static std::string Url(const HttpServer &server, const char *base = "") {
+  return fmt::format("http://127.0.0.1:{}{}", server.GetPort(), base);
+}
+
+TEST(HttpTestGroup, Client_InvalidUrl) {
+  CHECK_FALSE(HttpClient("https://localhost", kTimeout).IsValid());
+  CHECK_FALSE(HttpClient("http://", kTimeout).IsValid());
+  CHECK_FALSE(HttpClient("http://localhost:99999", kTimeout).IsValid());
+  CHECK_FALSE(HttpClient("http://localhost:port", kTimeout).IsValid());
+  CHECK_FALSE(HttpClient("http://[::1", kTimeout).IsValid());
+  CHECK_TRUE(HttpClient("http://localhost", kTimeout).IsValid());
+  CHECK_TRUE(HttpClient("http://[::1]:8080/cache/", kTimeout).IsValid());
+
+  HttpClient client("localhost:8080", kTimeout);
+  CHECK_FALSE(client.Request("GET", "/").has_value());
+}
+
+TEST(HttpTestGroup, Client_ConnectTimeout) {
+  // Connections beyond the backlog of a listener that never accepts are not
+  // established
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_TRUE(listener >= 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  CHECK_EQUAL(bind(listener, reinterpret_cast<sockaddr *>(&address), length),
+              0);
+  CHECK_EQUAL(listen(listener, 0), 0);
+  CHECK_EQUAL(
+      getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length),
+      0);
+  std::vector<int> backlog;
+  for (int i = 0; i < 4; i++) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    (void)connect(fd, reinterpret_cast<sockaddr *>(&address), length);
+    backlog.push_back(fd);
+  }
+
+  const std::string url =
+      fmt::format("http://127.0.0.1:{}", ntohs(address.sin_port));
+  HttpClient client(url, kTimeout, std::chrono::milliseconds(100));
+  const auto start = std::chrono::steady_clock::now();
+  CHECK_FALSE(client.Request("GET", "/").has_value());
+  CHECK_TRUE(std::chrono::steady_clock::now() - start < kTimeout);
+
+  for (int fd : backlog) {
+    close(fd);
+  }
+  close(listener);
+}
+
+TEST(HttpTestGroup, Request) {
+  HttpServer server(Echo);
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(server.GetPort() != 0);
+
+  HttpClient client(Url(server, "/base/"), kTimeout);
+  auto response = client.Request("GET", "/ac/key");
+  CHECK_TRUE(response.has_value());
+  CHECK_EQUAL(response->status, 200);
+  STRCMP_EQUAL(response->body.c_str(), "GET /base/ac/key ");
+
+  response = client.Request("PUT", "/cas/key", "data");
+  CHECK_TRUE(response.has_value());
+  STRCMP_EQUAL(response->body.c_str(), "PUT /base/cas/key data");
+
+  // Empty bodies
+  response = client.Request("PUT", "/cas/key");
+  CHECK_TRUE(response.has_value());
+  STRCMP_EQUAL(response->body.c_str(), "PUT /base/cas/key ");
+
+  response = client.Request("HEAD", "/cas/key");
+  CHECK_TRUE(response.has_value());
+  CHECK_EQUAL(response->status, 200);
+  CHECK_TRUE(response->body.empty());
+
+  HttpClient root_client(Url(server), kTimeout);
+  response = root_client.Request("GET", "/missing");
+  CHECK_TRUE(response.has_value());
+  CHECK_EQUAL(response->status, 404);
+  STRCMP_EQUAL(response->body.c_str(), "missing");
+}
+
+TEST(HttpTestGroup, Request_LargeBody) {
+  HttpServer server([](const HttpRequest &request) {
+    return HttpResponse{200, request.body + request.body};
+  });
+  CHECK_TRUE(server.Start());
+
+  std::string body;
+  for (std::size_t i = 0; i < 3 * 1024 * 1024; i++) {
+    body.push_back(static_cast<char>(i * 31));
+  }
+  HttpClient client(Url(server), kTimeout);
+  auto response = client.Request("PUT", "/large", body);
+  CHECK_TRUE(response.has_value());
+  CHECK_TRUE(response->body == body + body);
+}
+
+TEST(HttpTestGroup, Request_Concurrent) {
+  HttpServer server(Echo);
+  CHECK_TRUE(server.Start());
+  HttpClient client(Url(server), kTimeout);
+
+  std::vector<std::thread> threads;
+  std::vector<int> ok(8, 0);
+  for (std::size_t t = 0; t < ok.size(); t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 50; i++) {
+        const std::string path = fmt::format("/{}/{}", t, i);
+        auto response = client.Request("GET", path);
+        if (response.has_value() && response->body == "GET " + path + " ") {
+          ok[t]++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (int count : ok) {
+    CHECK_EQUAL(count, 50);
+  }
+}
+
+TEST(HttpTestGroup, Request_ServerRestarted) {
+  auto server = std::make_unique<HttpServer>(Echo);
+  CHECK_TRUE(server->Start());
+  const std::uint16_t port = server->GetPort();
+  HttpClient client(Url(*server), kTimeout);
+  CHECK_TRUE(client.Request("GET", "/first").has_value());
+
+  // Idle connection closed by the server
+  server->Stop();
+  CHECK_FALSE(client.Request("GET", "/stopped").has_value());
+
+  server = std::make_unique<HttpServer>(Echo);
+  CHECK_TRUE(server->Start(port));
+  CHECK_TRUE(client.Request("GET", "/first").has_value());
+  server->Stop();
+
+  // Connection of a stopped server reused
+  server = std::make_unique<HttpServer>(Echo);
+  CHECK_TRUE(server->Start(port));
+  auto response = client.Request("GET", "/second");
+  CHECK_TRUE(response.has_value());
+  STRCMP_EQUAL(response->body.c_str(), "GET /second ");
+}
+
+TEST(HttpTestGroup, Server_StartTwice) {
+  HttpServer server(Echo);
+  CHECK_TRUE(server.Start());
+  CHECK_FALSE(server.Start());
+
+  HttpServer other(Echo);
+  CHECK_FALSE(other.Start(server.GetPort()));
+  CHECK_FALSE(other.Start(0, "localhost"));
+  server.Stop();
+  server.Stop();
+
+  // Every interface
+  CHECK_TRUE(other.Start(0, "0.0.0.0"));
+  HttpClient client(Url(other), kTimeout);
+  CHECK_TRUE(client.Request("GET", "/").has_value());
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -0,0 +1,96 @@
+#include "env/job_output.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+using buildcc::env::JobOutput;
+using buildcc::env::OutputBuffer;
+
+// clang-format off
+TEST_GROUP(JobOutputTestGroup)
+{
+  void teardown() {
+    JobOutput::Deinit();
+  }
+};
+// clang-format on
+
+TEST(JobOutputTestGroup, OutputBuffer_Append) {
+  OutputBuffer buffer;
+  CHECK_TRUE(buffer.IsEmpty());
+
+  buffer.Append("hello ", 6);
+  buffer.Append("world", 5);
+  CHECK_EQUAL(buffer.GetSize(), 11);
+  CHECK_EQUAL(buffer.GetDropped(), 0);
+  STRCMP_EQUAL(buffer.ToString().c_str(), "hello world");
+
+  buffer.Clear();
+  CHECK_TRUE(buffer.IsEmpty());
+  STRCMP_EQUAL(buffer.ToString().c_str(), "");
+}
+
+TEST(JobOutputTestGroup, OutputBuffer_MultipleBlocks) {
+  std::string data;
+  for (std::size_t i = 0; i < OutputBuffer::kBlockSize * 2 + 100; i++) {
+    data.push_back(static_cast<char>('a' + i % 26));
+  }
+
+  OutputBuffer buffer;
+  // Chunks that straddle block boundaries
+  const std::size_t chunk = OutputBuffer::kBlockSize / 3;
+  for (std::size_t offset = 0; offset < data.size(); offset += chunk) {
+    buffer.Append(data.data() + offset,
+                  std::min(chunk, data.size() - offset));
+  }
+  CHECK_EQUAL(buffer.GetSize(), data.size());
+  CHECK_TRUE(buffer.ToString() == data);
+}
+
+TEST(JobOutputTestGroup, OutputBuffer_MaxBytes) {
+  OutputBuffer buffer(8);
+  buffer.Append("0123", 4);
+  buffer.Append("456789", 6);
+  buffer.Append("abc", 3);
+  STRCMP_EQUAL(buffer.ToString().c_str(), "01234567");
+  CHECK_EQUAL(buffer.GetDropped(), 5);
+
+  buffer.Clear();
+  CHECK_EQUAL(buffer.GetDropped(), 0);
+  buffer.Append("x", 1);
+  STRCMP_EQUAL(buffer.ToString().c_str(), "x");
+}
+
+TEST(JobOutputTestGroup, OutputBuffer_Move) {
+  OutputBuffer buffer;
+  buffer.Append("data", 4);
+
+  OutputBuffer moved(std::move(buffer));
+  STRCMP_EQUAL(moved.ToString().c_str(), "data");
+  CHECK_TRUE(buffer.IsEmpty());
+}
+
+TEST(JobOutputTestGroup, JobOutput_Init) {
+  CHECK_FALSE(JobOutput::IsEnabled());
+
+  JobOutput::Init(1024);
+  CHECK_TRUE(JobOutput::IsEnabled());
+  CHECK_EQUAL(JobOutput::GetMaxBytes(), 1024);
+
+  JobOutput::Deinit();
+  CHECK_FALSE(JobOutput::IsEnabled());
+  CHECK_EQUAL(JobOutput::GetMaxBytes(), 0);
+}
+
+int main(int ac, char **av) {
+  // Blocks are kept in a process wide pool for reuse
+  MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -0,0 +1,240 @@
+#include "env/jobserver.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+namespace fs = std::filesystem;
+
+using buildcc::env::JobServer;
+using buildcc::env::JobServerAuth;
+
+// clang-format off
+TEST_GROUP(JobServerTestGroup)
+{
+  void teardown() {
+    JobServer::Deinit();
+  }
+};
+// clang-format on
+
+TEST(JobServerTestGroup, ParseMakeflags_Fifo) {
+  auto auth = JobServer::ParseMakeflags(
+      " -j4 --jobserver-auth=fifo:/tmp/GMfifo1234");
+  CHECK_TRUE(auth.has_value());
+  CHECK_TRUE(auth->type == JobServerAuth::Type::Fifo);
+  STRCMP_EQUAL(auth->fifo_path.c_str(), "/tmp/GMfifo1234");
+}
+
+TEST(JobServerTestGroup, ParseMakeflags_Pipe) {
+  auto auth = JobServer::ParseMakeflags("-j4 --jobserver-auth=3,4");
+  CHECK_TRUE(auth.has_value());
+  CHECK_TRUE(auth->type == JobServerAuth::Type::Pipe);
+  CHECK_EQUAL(auth->read_fd, 3);
+  CHECK_EQUAL(auth->write_fd, 4);
+
+  // Older GNU make versions
+  auth = JobServer::ParseMakeflags("--jobserver-fds=5,6 -j");
+  CHECK_TRUE(auth.has_value());
+  CHECK_EQUAL(auth->read_fd, 5);
+  CHECK_EQUAL(auth->write_fd, 6);
+}
+
+TEST(JobServerTestGroup, ParseMakeflags_LastWins) {
+  auto auth = JobServer::ParseMakeflags(
+      "-j4 --jobserver-auth=3,4 -j2 --jobserver-auth=fifo:/tmp/f");
+  CHECK_TRUE(auth.has_value());
+  CHECK_TRUE(auth->type == JobServerAuth::Type::Fifo);
+
+  // Invalid options disable the previous jobserver
+  auth = JobServer::ParseMakeflags("--jobserver-auth=3,4 --jobserver-auth=x");
+  CHECK_FALSE(auth.has_value());
+}
+
+TEST(JobServerTestGroup, ParseMakeflags_Invalid) {
+  CHECK_FALSE(JobServer::ParseMakeflags("").has_value());
+  CHECK_FALSE(JobServer::ParseMakeflags("-j4 -k").has_value());
+  CHECK_FALSE(JobServer::ParseMakeflags("--jobserver-auth=").has_value());
+  CHECK_FALSE(JobServer::ParseMakeflags("--jobserver-auth=fifo:").has_value());
+  CHECK_FALSE(JobServer::ParseMakeflags("--jobserver-auth=-1,4").has_value());
+  CHECK_FALSE(JobServer::ParseMakeflags("--jobserver-auth=3").has_value());
+  CHECK_FALSE(
+      JobServer::ParseMakeflags("--jobserver-auth=gmake_semaphore_1234")
+          .has_value());
+
+  // Variable assignments are not options
+  CHECK_FALSE(
+      JobServer::ParseMakeflags("-j4 -- VAR=--jobserver-auth=3,4").has_value());
+}
+
+TEST(JobServerTestGroup, Disabled) {
+  CHECK_FALSE(JobServer::IsEnabled());
+  JobServer::Token token = JobServer::Acquire();
+  CHECK_FALSE(token.IsValid());
+  CHECK_TRUE(JobServer::TryAcquire(token));
+
+  CHECK_FALSE(JobServer::InitClient("-j4"));
+  CHECK_FALSE(JobServer::InitServer(0));
+  CHECK_FALSE(JobServer::IsEnabled());
+}
+
+TEST(JobServerTestGroup, Client_Pipe) {
+  int fds[2];
+  CHECK_EQUAL(pipe(fds), 0);
+  CHECK_EQUAL(write(fds[1], "++", 2), 2);
+
+  CHECK_TRUE(JobServer::InitClient(
+      fmt::format("-j3 --jobserver-auth={},{}", fds[0], fds[1])));
+  CHECK_TRUE(JobServer::IsEnabled());
+  CHECK_FALSE(JobServer::IsServer());
+
+  // Implicit slot and 2 tokens
+  JobServer::Token t1 = JobServer::Acquire();
+  JobServer::Token t2;
+  JobServer::Token t3;
+  JobServer::Token t4;
+  CHECK_TRUE(JobServer::TryAcquire(t2));
+  CHECK_TRUE(JobServer::TryAcquire(t3));
+  CHECK_FALSE(JobServer::TryAcquire(t4));
+  CHECK_TRUE(t1.IsValid());
+  CHECK_TRUE(t2.IsValid());
+  CHECK_TRUE(t3.IsValid());
+  CHECK_FALSE(t4.IsValid());
+
+  // Tokens are written back to the pipe
+  t3.Release();
+  CHECK_TRUE(JobServer::TryAcquire(t4));
+  t1 = std::move(t4);
+  CHECK_TRUE(JobServer::TryAcquire(t3));
+  t2.Release();
+  t3.Release();
+  t1.Release();
+
+  // Inherited file descriptors are not closed
+  JobServer::Deinit();
+  char buf[3];
+  CHECK_EQUAL(read(fds[0], buf, 3), 2);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(JobServerTestGroup, Client_Pipe_NotInherited) {
+  int fds[2];
+  CHECK_EQUAL(pipe(fds), 0);
+  close(fds[0]);
+  close(fds[1]);
+  CHECK_FALSE(JobServer::InitClient(
+      fmt::format("--jobserver-auth={},{}", fds[0], fds[1])));
+  CHECK_FALSE(JobServer::IsEnabled());
+}
+
+TEST(JobServerTestGroup, Client_Fifo) {
+  const fs::path fifo = fs::temp_directory_path() / "buildcc_test_jobserver";
+  fs::remove(fifo);
+  CHECK_EQUAL(mkfifo(fifo.c_str(), 0600), 0);
+  int fd = open(fifo.c_str(), O_RDWR | O_NONBLOCK);
+  CHECK_TRUE(fd >= 0);
+  CHECK_EQUAL(write(fd, "+", 1), 1);
+
+  CHECK_TRUE(JobServer::InitClient(
+      fmt::format("-j2 --jobserver-auth=fifo:{}", fifo.string())));
+  {
+    JobServer::Token t1 = JobServer::Acquire();
+    JobServer::Token t2 = JobServer::Acquire();
+    JobServer::Token t3;
+    CHECK_FALSE(JobServer::TryAcquire(t3));
+  }
+  JobServer::Deinit();
+
+  // Fifo remains owned by the parent jobserver
+  CHECK_TRUE(fs::exists(fifo));
+  char buf[2];
+  CHECK_EQUAL(read(fd, buf, 2), 1);
+  close(fd);
+  fs::remove(fifo);
+
+  CHECK_FALSE(JobServer::InitClient(
+      fmt::format("--jobserver-auth=fifo:{}", fifo.string())));
+}
+
+TEST(JobServerTestGroup, Server) {
+  unsetenv("MAKEFLAGS");
+  CHECK_TRUE(JobServer::InitServer(2));
+  CHECK_TRUE(JobServer::IsEnabled());
+  CHECK_TRUE(JobServer::IsServer());
+
+  // Advertised to child processes
+  const char *makeflags = getenv("MAKEFLAGS");
+  CHECK_TRUE(makeflags != nullptr);
+  auto auth = JobServer::ParseMakeflags(makeflags);
+  CHECK_TRUE(auth.has_value());
+  CHECK_TRUE(auth->type == JobServerAuth::Type::Fifo);
+  CHECK_TRUE(fs::exists(auth->fifo_path));
+
+  {
+    JobServer::Token t1 = JobServer::Acquire();
+    JobServer::Token t2 = JobServer::Acquire();
+    JobServer::Token t3;
+    CHECK_FALSE(JobServer::TryAcquire(t3));
+  }
+  JobServer::Token t1;
+  JobServer::Token t2;
+  CHECK_TRUE(JobServer::TryAcquire(t1));
+  CHECK_TRUE(JobServer::TryAcquire(t2));
+  t1.Release();
+  t2.Release();
+
+  JobServer::Deinit();
+  CHECK_FALSE(fs::exists(auth->fifo_path));
+  CHECK_TRUE(getenv("MAKEFLAGS") == nullptr);
+}
+
+TEST(JobServerTestGroup, Server_ReleaseDuringDeinit) {
+  unsetenv("MAKEFLAGS");
+  CHECK_TRUE(JobServer::InitServer(4));
+  std::vector<JobServer::Token> tokens(4);
+  for (auto &token : tokens) {
+    CHECK_TRUE(JobServer::TryAcquire(token));
+  }
+
+  // Tokens returned after Deinit are dropped
+  std::thread releaser([&]() {
+    for (auto &token : tokens) {
+      token.Release();
+    }
+  });
+  JobServer::Deinit();
+  releaser.join();
+  CHECK_FALSE(JobServer::IsEnabled());
+}
+
+TEST(JobServerTestGroup, Server_PreservesMakeflags) {
+  setenv("MAKEFLAGS", "k -- VAR=1", 1);
+  CHECK_TRUE(JobServer::InitServer(4));
+  const std::string makeflags = getenv("MAKEFLAGS");
+  CHECK_TRUE(makeflags.find("k -j4 --jobserver-auth=fifo:") == 0);
+  CHECK_TRUE(makeflags.find(" -- VAR=1") != std::string::npos);
+  CHECK_TRUE(JobServer::ParseMakeflags(makeflags).has_value());
+
+  JobServer::Deinit();
+  STRCMP_EQUAL(getenv("MAKEFLAGS"), "k -- VAR=1");
+  unsetenv("MAKEFLAGS");
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
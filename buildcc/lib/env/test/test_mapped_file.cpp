@@ -0,0 +1,74 @@
+#include "env/mapped_file.h"
+
+#include <filesystem>
+#include <string>
+
+#include "env/util.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+namespace fs = std::filesystem;
+
+// clang-format off
+TEST_GROUP(MappedFileTestGroup)
+{
+};
+// clang-format on
+
+TEST(MappedFileTestGroup, Open) {
+  constexpr const char *const FILENAME = "MappedFile.txt";
+  const std::string data("hello\0world", 11);
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, data, true));
+
+  buildcc::env::MappedFile file;
+  CHECK_TRUE(file.Open(FILENAME));
+  CHECK_EQUAL(file.GetSize(), data.size());
+  CHECK_TRUE(file.GetView() == data);
+
+  file.Close();
+  CHECK_EQUAL(file.GetSize(), 0);
+  CHECK_TRUE(file.GetData() == nullptr);
+}
+
+TEST(MappedFileTestGroup, Open_Reopen) {
+  constexpr const char *const FIRST = "MappedFile_First.txt";
+  constexpr const char *const SECOND = "MappedFile_Second.txt";
+  CHECK_TRUE(buildcc::env::save_file(FIRST, std::string("first"), true));
+  CHECK_TRUE(buildcc::env::save_file(SECOND, std::string("second"), true));
+
+  buildcc::env::MappedFile file;
+  CHECK_TRUE(file.Open(FIRST));
+  CHECK_TRUE(file.GetView() == "first");
+  CHECK_TRUE(file.Open(SECOND));
+  CHECK_TRUE(file.GetView() == "second");
+}
+
+TEST(MappedFileTestGroup, Open_Empty) {
+  constexpr const char *const FILENAME = "MappedFile_Empty.txt";
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, std::string(), true));
+
+  buildcc::env::MappedFile file;
+  CHECK_TRUE(file.Open(FILENAME));
+  CHECK_EQUAL(file.GetSize(), 0);
+  CHECK_TRUE(file.GetView().empty());
+}
+
+TEST(MappedFileTestGroup, Open_Failure) {
+  buildcc::env::MappedFile file;
+  CHECK_FALSE(file.Open(nullptr));
+
+  fs::remove("MappedFile_NotFound.txt");
+  CHECK_FALSE(file.Open("MappedFile_NotFound.txt"));
+
+  // Directories cannot be mapped
+  CHECK_FALSE(file.Open(fs::current_path().string().c_str()));
+  CHECK_TRUE(file.GetView().empty());
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
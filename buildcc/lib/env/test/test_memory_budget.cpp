@@ -0,0 +1,145 @@
+#include "env/memory_budget.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+using buildcc::env::MemoryBudget;
+
+// clang-format off
+TEST_GROUP(MemoryBudgetTestGroup)
+{
+  void teardown() {
+    MemoryBudget::Deinit();
+  }
+};
+// clang-format on
+
+TEST(MemoryBudgetTestGroup, ParseMeminfo) {
+  constexpr const char *const kMeminfo = "MemTotal:       16303144 kB\n"
+                                         "MemFree:         1018376 kB\n"
+                                         "MemAvailable:    8151572 kB\n"
+                                         "Buffers:          451832 kB\n";
+  auto available = buildcc::env::parse_meminfo_available(kMeminfo);
+  CHECK_TRUE(available.has_value());
+  CHECK_EQUAL(available.value(), 8151572ULL * 1024);
+
+  // Last line without a newline
+  available = buildcc::env::parse_meminfo_available("MemAvailable: 4 kB");
+  CHECK_EQUAL(available.value(), 4096);
+}
+
+TEST(MemoryBudgetTestGroup, ParseMeminfo_Invalid) {
+  CHECK_FALSE(buildcc::env::parse_meminfo_available("").has_value());
+  CHECK_FALSE(buildcc::env::parse_meminfo_available("MemTotal: 16303144 kB\n")
+                  .has_value());
+  CHECK_FALSE(
+      buildcc::env::parse_meminfo_available("MemAvailable:\n").has_value());
+  CHECK_FALSE(
+      buildcc::env::parse_meminfo_available("MemAvailable: x kB").has_value());
+  CHECK_FALSE(
+      buildcc::env::parse_meminfo_available("MemAvailable: 12 MB").has_value());
+}
+
+TEST(MemoryBudgetTestGroup, Disabled) {
+  CHECK_FALSE(MemoryBudget::IsEnabled());
+  MemoryBudget::Reservation reservation = MemoryBudget::Acquire(100);
+  CHECK_FALSE(reservation.IsValid());
+  CHECK_TRUE(MemoryBudget::TryAcquire(100, reservation));
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 0);
+
+  MemoryBudget::Init(0, false);
+  CHECK_FALSE(MemoryBudget::IsEnabled());
+}
+
+TEST(MemoryBudgetTestGroup, Budget) {
+  MemoryBudget::Init(100, false);
+  CHECK_TRUE(MemoryBudget::IsEnabled());
+
+  // Always admitted when no other job is in flight
+  MemoryBudget::Reservation r1 = MemoryBudget::Acquire(150);
+  CHECK_TRUE(r1.IsValid());
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 150);
+
+  MemoryBudget::Reservation r2;
+  CHECK_FALSE(MemoryBudget::TryAcquire(10, r2));
+  r1.Release();
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 0);
+
+  CHECK_TRUE(MemoryBudget::TryAcquire(60, r1));
+  CHECK_TRUE(MemoryBudget::TryAcquire(40, r2));
+  MemoryBudget::Reservation r3;
+  CHECK_FALSE(MemoryBudget::TryAcquire(1, r3));
+
+  // Jobs without a prediction are not limited by the budget
+  CHECK_TRUE(MemoryBudget::TryAcquire(0, r3));
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 100);
+
+  r1 = std::move(r2);
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 40);
+  CHECK_EQUAL(r1.GetBytes(), 40);
+}
+
+TEST(MemoryBudgetTestGroup, Acquire_Blocks) {
+  MemoryBudget::Init(100, false);
+  MemoryBudget::Reservation r1 = MemoryBudget::Acquire(80);
+
+  std::atomic<bool> admitted{false};
+  std::atomic<bool> valid{false};
+  std::thread waiter([&]() {
+    MemoryBudget::Reservation r2 = MemoryBudget::Acquire(50);
+    valid = r2.IsValid();
+    admitted = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  CHECK_FALSE(admitted.load());
+  r1.Release();
+  waiter.join();
+  CHECK_TRUE(admitted.load());
+  CHECK_TRUE(valid.load());
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 0);
+}
+
+TEST(MemoryBudgetTestGroup, Deinit_WakesWaiters) {
+  MemoryBudget::Init(100, false);
+  MemoryBudget::Reservation r1 = MemoryBudget::Acquire(100);
+
+  std::atomic<bool> valid{true};
+  std::thread waiter([&]() {
+    MemoryBudget::Reservation r2 = MemoryBudget::Acquire(100);
+    valid = r2.IsValid();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  MemoryBudget::Deinit();
+  waiter.join();
+  CHECK_FALSE(valid.load());
+
+  // Reservations that outlive Deinit are released safely
+  r1.Release();
+  CHECK_EQUAL(MemoryBudget::GetReserved(), 0);
+}
+
+TEST(MemoryBudgetTestGroup, Meminfo) {
+  auto available = buildcc::env::get_meminfo_available();
+  if (!available.has_value()) {
+    return;
+  }
+
+  MemoryBudget::Init(0, true);
+  CHECK_TRUE(MemoryBudget::IsEnabled());
+  MemoryBudget::Reservation r1 = MemoryBudget::Acquire(1);
+  MemoryBudget::Reservation r2;
+  CHECK_TRUE(MemoryBudget::TryAcquire(1, r2));
+  CHECK_FALSE(MemoryBudget::TryAcquire(available.value() * 4, r2));
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
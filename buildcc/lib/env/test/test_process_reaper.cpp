@@ -0,0 +1,246 @@
+#include "env/process_reaper.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+namespace fs = std::filesystem;
+
+using buildcc::env::ProcessExit;
+using buildcc::env::ProcessReaper;
+
+namespace {
+
+// Collects the output and exit of spawned processes
+// NOTE, Callbacks run on the reaper thread, results are checked on the main
+// thread
+class Collector {
+public:
+  ProcessReaper::OutputCallback Stdout() {
+    return [this](const char *bytes, std::size_t n) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stdout_.append(bytes, n);
+    };
+  }
+
+  ProcessReaper::OutputCallback Stderr() {
+    return [this](const char *bytes, std::size_t n) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stderr_.append(bytes, n);
+    };
+  }
+
+  ProcessReaper::ExitCallback Exit() {
+    return [this](const ProcessExit &exit) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exits_.push_back(exit);
+      cv_.notify_all();
+    };
+  }
+
+  bool WaitFor(std::size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(10),
+                        [&]() { return exits_.size() >= count; });
+  }
+
+  std::string GetStdout() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stdout_;
+  }
+  std::string GetStderr() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stderr_;
+  }
+  std::vector<ProcessExit> GetExits() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return exits_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::string stdout_;
+  std::string stderr_;
+  std::vector<ProcessExit> exits_;
+};
+
+} // namespace
+
+// clang-format off
+TEST_GROUP(ProcessReaperTestGroup)
+{
+  void teardown() {
+    ProcessReaper::Deinit();
+  }
+};
+// clang-format on
+
+TEST(ProcessReaperTestGroup, Disabled) {
+  CHECK_FALSE(ProcessReaper::IsEnabled());
+  Collector collector;
+  CHECK_EQUAL(ProcessReaper::Spawn("true", "", nullptr, nullptr,
+                                   collector.Exit()),
+              -1);
+  CHECK_EQUAL(ProcessReaper::GetInFlight(), 0);
+}
+
+TEST(ProcessReaperTestGroup, Output) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+  CHECK_TRUE(ProcessReaper::IsEnabled());
+
+  Collector collector;
+  CHECK_TRUE(ProcessReaper::Spawn("echo out; echo err 1>&2", "",
+                                  collector.Stdout(), collector.Stderr(),
+                                  collector.Exit()) > 0);
+  CHECK_TRUE(collector.WaitFor(1));
+  STRCMP_EQUAL(collector.GetStdout().c_str(), "out\n");
+  STRCMP_EQUAL(collector.GetStderr().c_str(), "err\n");
+  CHECK_EQUAL(collector.GetExits()[0].exit_status, 0);
+  CHECK_TRUE(collector.GetExits()[0].peak_rss_bytes > 0);
+}
+
+TEST(ProcessReaperTestGroup, Arguments) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+
+  // Arguments are passed verbatim, shell syntax is not interpreted
+  Collector collector;
+  CHECK_TRUE(ProcessReaper::Spawn(std::vector<std::string>{"echo", "a b",
+                                                           "$HOME", "|"},
+                                  "", collector.Stdout(), nullptr,
+                                  collector.Exit()) > 0);
+  CHECK_TRUE(collector.WaitFor(1));
+  STRCMP_EQUAL(collector.GetStdout().c_str(), "a b $HOME |\n");
+  CHECK_EQUAL(collector.GetExits()[0].exit_status, 0);
+
+  // Executables that cannot be found are not spawned
+  CHECK_EQUAL(ProcessReaper::Spawn(std::vector<std::string>{
+                                       "buildcc_executable_not_found"},
+                                   "", nullptr, nullptr, collector.Exit()),
+              -1);
+  CHECK_EQUAL(ProcessReaper::Spawn(std::vector<std::string>{}, "", nullptr,
+                                   nullptr, collector.Exit()),
+              -1);
+}
+
+TEST(ProcessReaperTestGroup, ExitStatus) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+
+  Collector collector;
+  CHECK_TRUE(ProcessReaper::Spawn("exit 3", "", nullptr, nullptr,
+                                  collector.Exit()) > 0);
+  CHECK_TRUE(collector.WaitFor(1));
+  CHECK_EQUAL(collector.GetExits()[0].exit_status, 3);
+}
+
+TEST(ProcessReaperTestGroup, WorkingDirectory) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+
+  const fs::path cwd = fs::canonical(fs::temp_directory_path());
+  Collector collector;
+  CHECK_TRUE(ProcessReaper::Spawn("pwd -P", cwd.string(), collector.Stdout(),
+                                  nullptr, collector.Exit()) > 0);
+  CHECK_TRUE(collector.WaitFor(1));
+  STRCMP_EQUAL(collector.GetStdout().c_str(), (cwd.string() + "\n").c_str());
+}
+
+TEST(ProcessReaperTestGroup, MaxProcesses) {
+  if (!ProcessReaper::Init(2)) {
+    return;
+  }
+
+  Collector collector;
+  for (int i = 0; i < 6; i++) {
+    CHECK_TRUE(ProcessReaper::Spawn("sleep 0.05", "", nullptr, nullptr,
+                                    collector.Exit()) > 0);
+    CHECK_TRUE(ProcessReaper::GetInFlight() <= 2);
+  }
+  CHECK_TRUE(collector.WaitFor(6));
+  CHECK_EQUAL(ProcessReaper::GetInFlight(), 0);
+}
+
+TEST(ProcessReaperTestGroup, TryAcquireSlot) {
+  ProcessReaper::Slot slot;
+  // No limit when disabled
+  CHECK_TRUE(ProcessReaper::TryAcquireSlot(slot));
+  CHECK_FALSE(slot.IsValid());
+
+  if (!ProcessReaper::Init(1)) {
+    return;
+  }
+  CHECK_TRUE(ProcessReaper::TryAcquireSlot(slot));
+  CHECK_TRUE(slot.IsValid());
+  ProcessReaper::Slot other;
+  CHECK_FALSE(ProcessReaper::TryAcquireSlot(other));
+
+  // The reserved slot is handed over to the child
+  Collector collector;
+  CHECK_TRUE(ProcessReaper::Spawn("sleep 0.05", "", nullptr, nullptr,
+                                  collector.Exit(), std::move(slot)) > 0);
+  CHECK_FALSE(slot.IsValid());
+  CHECK_FALSE(ProcessReaper::TryAcquireSlot(other));
+  CHECK_TRUE(collector.WaitFor(1));
+  CHECK_TRUE(ProcessReaper::TryAcquireSlot(other));
+
+  // Released slots can be reserved again
+  other.Release();
+  CHECK_TRUE(ProcessReaper::TryAcquireSlot(slot));
+  CHECK_TRUE(slot.IsValid());
+}
+
+TEST(ProcessReaperTestGroup, Kill) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+
+  Collector collector;
+  const auto start = std::chrono::steady_clock::now();
+  const int pid = ProcessReaper::Spawn("sleep 10", "", collector.Stdout(),
+                                       nullptr, collector.Exit());
+  CHECK_TRUE(pid > 0);
+  ProcessReaper::Kill(pid);
+  CHECK_TRUE(collector.WaitFor(1));
+  CHECK_EQUAL(collector.GetExits()[0].exit_status, -1);
+  CHECK_TRUE(std::chrono::steady_clock::now() - start <
+             std::chrono::seconds(5));
+
+  // Reaped children are ignored
+  ProcessReaper::Kill(pid);
+}
+
+TEST(ProcessReaperTestGroup, Deinit_WaitsForChildren) {
+  if (!ProcessReaper::Init(0)) {
+    return;
+  }
+
+  Collector collector;
+  CHECK_TRUE(ProcessReaper::Spawn("sleep 0.05", "", nullptr, nullptr,
+                                  collector.Exit()) > 0);
+  ProcessReaper::Deinit();
+  CHECK_FALSE(ProcessReaper::IsEnabled());
+  CHECK_EQUAL(collector.GetExits().size(), 1);
+}
+
+int main(int ac, char **av) {
+  // The reaper keeps its bookkeeping allocated across tests
+  MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
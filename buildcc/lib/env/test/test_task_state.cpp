@@ -14,6 +14,10 @@ TEST_GROUP(TaskStateTestGroup)
   void setup() {
     buildcc::env::set_task_state(buildcc::env::TaskState::SUCCESS);
   }
+  void teardown() {
+    buildcc::env::set_task_state(buildcc::env::TaskState::SUCCESS);
+    buildcc::env::set_failure_mode(buildcc::env::FailureMode::Stop);
+  }
 };
 // clang-format on
 
@@ -66,6 +70,64 @@ TEST(TaskStateTestGroup, MultipleTasks) {
   CHECK_TRUE(completed3);
 }
 
+TEST(TaskStateTestGroup, FailureScope_Stop) {
+  using buildcc::env::FailureScope;
+  CHECK(buildcc::env::get_failure_mode() == buildcc::env::FailureMode::Stop);
+
+  FailureScope lib;
+  FailureScope exe;
+  FailureScope other;
+  exe.AddUpstream(lib);
+  CHECK_TRUE(lib.CanRun());
+  CHECK_TRUE(exe.CanRun());
+  CHECK_FALSE(exe.IsFailed());
+
+  lib.Fail();
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::FAILURE);
+  CHECK_TRUE(lib.IsFailed());
+  CHECK_TRUE(exe.IsFailed());
+  CHECK_FALSE(other.IsFailed());
+
+  // Every scope stops
+  CHECK_FALSE(lib.CanRun());
+  CHECK_FALSE(exe.CanRun());
+  CHECK_FALSE(other.CanRun());
+}
+
+TEST(TaskStateTestGroup, FailureScope_KeepGoing) {
+  using buildcc::env::FailureScope;
+  buildcc::env::set_failure_mode(buildcc::env::FailureMode::KeepGoing);
+
+  FailureScope gen;
+  FailureScope lib;
+  FailureScope exe;
+  FailureScope other;
+  lib.AddUpstream(gen);
+  exe.AddUpstream(lib);
+  other.AddUpstream(gen);
+
+  lib.Fail();
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::FAILURE);
+
+  // Only the failed scope and its downstream scopes stop
+  CHECK_TRUE(gen.CanRun());
+  CHECK_FALSE(lib.CanRun());
+  CHECK_FALSE(exe.CanRun());
+  CHECK_TRUE(other.CanRun());
+  CHECK_FALSE(gen.IsFailed());
+  CHECK_TRUE(exe.IsFailed());
+}
+
+TEST(TaskStateTestGroup, FailureScope_FailFast) {
+  buildcc::env::set_failure_mode(buildcc::env::FailureMode::FailFast);
+
+  buildcc::env::FailureScope scope;
+  CHECK_TRUE(scope.CanRun());
+  scope.Fail();
+  CHECK_FALSE(scope.CanRun());
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::FAILURE);
+}
+
 int main(int ac, char **av) {
   return CommandLineTestRunner::RunAllTests(ac, av);
 }
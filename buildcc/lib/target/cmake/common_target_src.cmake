@@ -9,6 +9,8 @@ set(COMMON_TARGET_SRCS
     include/target/common/target_state.h
     include/target/common/target_env.h
     include/target/common/util.h
+    src/common/dep_file.cpp
+    include/target/common/dep_file.h
 
     # API
     src/api/lib_api.cpp
@@ -20,6 +20,8 @@
 #include <filesystem>
 #include <string>
 
+#include "env/command_line.h"
+
 #include "schema/target_type.h"
 
 #include "toolchain/toolchain.h"
@@ -73,6 +75,11 @@ public:
 
   // TODO, Add GetPchCommand if required
   const std::string &GetCompileCommand(const fs::path &source) const;
+  /**
+   * @brief Arguments of the compile command of `source`
+   * Empty when the compile command uses shell syntax, use GetCompileCommand
+   */
+  const env::CommandLine &GetCompileCommandLine(const fs::path &source) const;
   const std::string &GetLinkCommand() const;
 };
 
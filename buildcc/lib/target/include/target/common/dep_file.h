@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TARGET_COMMON_DEP_FILE_H_
+#define TARGET_COMMON_DEP_FILE_H_
+
+#include <string>
+#include <vector>
+
+namespace buildcc::internal {
+
+/**
+ * @brief Parses a Makefile style dependency file as emitted by `-MD -MF`
+ * - Rule targets (tokens ending with `:`) are skipped
+ * - Line continuations (`\` + newline) are treated as whitespace
+ * - Escaped spaces (`\ `), escaped hashes (`\#`) and `$$` are unescaped
+ * - Duplicate dependencies are removed, first occurrence order is preserved
+ *
+ * @param data Contents of the dependency file
+ * @return std::vector<std::string> List of dependencies (prerequisites)
+ */
+std::vector<std::string> ParseDepFile(const std::string &data);
+
+/**
+ * @brief Constructs a dependency file with a single rule that ParseDepFile
+ * parses back into `deps`
+ * Spaces and hashes are escaped with a backslash and `$` with `$$`
+ */
+std::string MakeDepFile(const std::string &target,
+                        const std::vector<std::string> &deps);
+
+} // namespace buildcc::internal
+
+#endif
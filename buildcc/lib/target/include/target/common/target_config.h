@@ -17,6 +17,7 @@
 #ifndef TARGET_COMMON_TARGET_CONFIG_H_
 #define TARGET_COMMON_TARGET_CONFIG_H_
 
+#include <cstddef>
 #include <filesystem>
 #include <string>
 #include <unordered_set>
@@ -25,16 +26,51 @@ namespace fs = std::filesystem;
 
 namespace buildcc {
 
+/**
+ * @brief Scope of recompilation when `headers`, `compile_dependencies`,
+ * language specific compile flags or toolchain executables change
+ *
+ * Target: Every object of the target is recompiled
+ * Object: Only objects that used the changed path are recompiled. Objects
+ * without compiler discovered headers (see `{dep_file}`) are always recompiled.
+ * Changes to `asm_compile_flags`, `c_compile_flags` or `cpp_compile_flags`
+ * only recompile sources of the matching `FileExt`. Similarly a changed
+ * assembler, c_compiler or cpp_compiler (see `Toolchain::Fingerprint`) only
+ * recompiles sources of the matching `FileExt`
+ */
+enum class InvalidationMode {
+  Target,
+  Object,
+};
+
 struct TargetConfig {
   TargetConfig() = default;
 
   std::string target_ext{""};
+  InvalidationMode invalidation_mode{InvalidationMode::Object};
 
   // clang-format off
   std::string pch_command{"{compiler} {preprocessor_flags} {include_dirs} {common_compile_flags} {pch_compile_flags} {compile_flags} -o {output} -c {input}"};
   std::string compile_command{"{compiler} {preprocessor_flags} {include_dirs} {common_compile_flags} {pch_object_flags} {compile_flags} -o {output} -c {input}"};
   std::string link_command{"{cpp_compiler} {link_flags} {compiled_sources} -o {output} {lib_dirs} {lib_deps}"};
   // clang-format on
+
+  /**
+   * @brief TargetType::StaticLibrary only
+   * Replaces the recompiled objects (`{compiled_sources}`) of an existing
+   * archive instead of recreating it from every object
+   * The archive is recreated when this is empty, when objects are removed,
+   * when objects share the same file name or when any other link input changes
+   */
+  std::string archive_update_command{""};
+
+  /**
+   * @brief Link and archive update commands longer than this many characters
+   * pass `{compiled_sources}` through a response file
+   * (`{target_build_dir}/{name}.rsp`) as `@file`, 0 to disable
+   * NOTE, Requires a link driver / archiver that understands `@file`
+   */
+  std::size_t response_file_threshold{8192};
 };
 
 } // namespace buildcc
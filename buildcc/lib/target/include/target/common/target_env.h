@@ -19,6 +19,7 @@
 
 #include <filesystem>
 
+#include "env/build_context.h"
 #include "env/env.h"
 
 namespace fs = std::filesystem;
@@ -56,8 +57,19 @@ public:
    * Project::GetRootDir()
    */
   explicit TargetEnv(const fs::path &target_relative_to_env_root)
-      : target_root_dir_(Project::GetRootDir() / target_relative_to_env_root),
-        target_build_dir_(Project::GetBuildDir()), relative_(true) {}
+      : TargetEnv(BuildContext::Global(), target_relative_to_env_root) {}
+
+  /**
+   * @brief Similar to `TargetEnv(const fs::path &)` with the project root and
+   * build dir of `context`
+   *
+   * Targets and Generators created with this TargetEnv belong to `context`
+   */
+  explicit TargetEnv(BuildContext &context,
+                     const fs::path &target_relative_to_env_root)
+      : target_root_dir_(context.GetRootDir() / target_relative_to_env_root),
+        target_build_dir_(context.GetBuildDir()), relative_(true),
+        context_(&context) {}
 
   /**
    * @brief Change the absolute root and build path for a particular Generator /
@@ -69,17 +81,21 @@ public:
    * changes as per this parameter
    */
   explicit TargetEnv(const fs::path &absolute_target_root,
-                     const fs::path &absolute_target_build)
+                     const fs::path &absolute_target_build,
+                     BuildContext &context = BuildContext::Global())
       : target_root_dir_(absolute_target_root),
-        target_build_dir_(absolute_target_build), relative_(false) {}
+        target_build_dir_(absolute_target_build), relative_(false),
+        context_(&context) {}
 
   const fs::path &GetTargetRootDir() const { return target_root_dir_; }
   const fs::path &GetTargetBuildDir() const { return target_build_dir_; }
+  BuildContext &GetContext() const { return *context_; }
 
 private:
   fs::path target_root_dir_;
   fs::path target_build_dir_;
   bool relative_{false};
+  BuildContext *context_;
 };
 
 namespace internal {
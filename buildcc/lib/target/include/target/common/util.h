@@ -17,13 +17,164 @@
 #ifndef TARGET_COMMON_UTIL_H_
 #define TARGET_COMMON_UTIL_H_
 
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "env/build_context.h"
+#include "env/command.h"
+#include "env/hash.h"
+#include "env/memory_budget.h"
+
+#include "schema/build_log.h"
+#include "schema/dist_compile.h"
 #include "schema/path.h"
 
 namespace buildcc::internal {
 
+/**
+ * @brief Digest of a fully constructed command
+ * Stored in the target schema to detect changes to any part of the command
+ */
+inline std::string command_digest(const std::string &command) {
+  return fmt::format("{:016x}", env::hash_bytes(command));
+}
+
+inline bool execute_command(const std::string &command,
+                            env::CommandStats &stats, BuildContext &context) {
+  return env::Command::Execute(command, {}, nullptr, nullptr, &stats,
+                               &context);
+}
+
+inline bool execute_command(const env::CommandLine &command_line,
+                            env::CommandStats &stats, BuildContext &context) {
+  return env::Command::Execute(command_line, nullptr, nullptr, &stats,
+                               &context);
+}
+
+inline void execute_command_async(const std::string &command,
+                                  const env::Command::ExitCallback &on_exit,
+                                  BuildContext &context,
+                                  std::uint64_t predicted_memory_bytes,
+                                  std::uint64_t priority) {
+  env::Command::ExecuteAsync(command, {}, on_exit, &context,
+                             predicted_memory_bytes, priority);
+}
+
+inline void execute_command_async(const env::CommandLine &command_line,
+                                  const env::Command::ExitCallback &on_exit,
+                                  BuildContext &context,
+                                  std::uint64_t predicted_memory_bytes,
+                                  std::uint64_t priority) {
+  env::Command::ExecuteAsync(command_line, on_exit, &context,
+                             predicted_memory_bytes, priority);
+}
+
+/**
+ * @brief Executes the command that generates `output` and records its
+ * duration and peak memory in the BuildLog
+ * The job is admitted by the MemoryBudget using the peak memory of the
+ * previous build
+ *
+ * @tparam CommandType std::string (run on the shell) or env::CommandLine
+ */
+template <typename CommandType>
+bool execute_and_record(const CommandType &command, const fs::path &output,
+                        BuildContext &context) {
+  const std::string output_str = path_as_string(output);
+  env::MemoryBudget::Reservation reservation = env::MemoryBudget::Acquire(
+      BuildLog::GetPeakMemory(context, output_str).value_or(0));
+
+  env::CommandStats stats;
+  const auto start = std::chrono::steady_clock::now();
+  const bool success = execute_command(command, stats, context);
+  if (success) {
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    BuildLog::Record(context, output_str,
+                     static_cast<std::uint64_t>(duration.count()),
+                     stats.peak_rss_bytes);
+  }
+  return success;
+}
+
+/**
+ * @brief Asynchronous `execute_and_record`, see env::Command::ExecuteAsync
+ * The job slot and the MemoryBudget reservation are acquired by the dispatch
+ * thread of env::Command when they are not available, the caller is not
+ * blocked
+ * `on_exit` is invoked on the completion thread of env::Command and should
+ * not block
+ * Queued commands are prioritized by their recorded duration plus
+ * `downstream_ms`, the estimated duration of the jobs that wait for `output`
+ */
+template <typename CommandType>
+void execute_and_record_async(const CommandType &command,
+                              const fs::path &output, BuildContext &context,
+                              const std::function<void(bool success)> &on_exit,
+                              std::uint64_t downstream_ms = 0) {
+  std::string output_str = path_as_string(output);
+  const std::uint64_t predicted_memory_bytes =
+      BuildLog::GetPeakMemory(context, output_str).value_or(0);
+  const std::uint64_t priority =
+      BuildLog::GetDuration(context, output_str).value_or(0) + downstream_ms;
+
+  execute_command_async(
+      command,
+      [output_str = std::move(output_str), &context,
+       on_exit](bool success, const env::CommandStats &stats) {
+        if (success) {
+          BuildLog::Record(context, output_str,
+                           static_cast<std::uint64_t>(stats.duration.count()),
+                           stats.peak_rss_bytes);
+        }
+        on_exit(success);
+      },
+      context, predicted_memory_bytes, priority);
+}
+
+/**
+ * @brief Compiles `command_line` on a DistCompile worker and records its
+ * duration in the BuildLog, the peak memory of the previous local compile is
+ * kept
+ * `on_exit` may be invoked on a dispatch thread and must not block
+ *
+ * @return false when the command was not distributed, `on_exit` is not
+ * invoked
+ */
+inline bool
+distribute_and_record_async(const env::CommandLine &command_line,
+                            const fs::path &output, BuildContext &context,
+                            const std::function<void(bool success)> &on_exit) {
+  if (!DistCompile::IsEnabled()) {
+    return false;
+  }
+  std::string output_str = path_as_string(output);
+  const auto start = std::chrono::steady_clock::now();
+  return DistCompile::ExecuteAsync(
+      command_line,
+      [output_str = std::move(output_str), start, &context,
+       on_exit](bool success, const env::CommandStats &stats) {
+        if (success) {
+          const auto duration =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start);
+          // Remote compiles are not measured
+          const std::uint64_t peak_rss_bytes =
+              stats.peak_rss_bytes != 0
+                  ? stats.peak_rss_bytes
+                  : BuildLog::GetPeakMemory(context, output_str).value_or(0);
+          BuildLog::Record(context, output_str,
+                           static_cast<std::uint64_t>(duration.count()),
+                           peak_rss_bytes);
+        }
+        on_exit(success);
+      },
+      &context);
+}
+
 // Aggregates
 template <typename T> std::string aggregate(const T &list) {
   return fmt::format("{}", fmt::join(list, " "));
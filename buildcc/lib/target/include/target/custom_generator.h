@@ -39,8 +39,8 @@ namespace buildcc {
 
 struct UserCustomGeneratorSchema : public internal::CustomGeneratorSchema {
   struct UserIdInfo : internal::CustomGeneratorSchema::IdInfo {
-    void ConvertToInternal() {
-      inputs.ComputeHashForAll();
+    void ConvertToInternal(const internal::PathInfoList &previous_inputs) {
+      inputs.ComputeHashForAll(previous_inputs);
       userblob = blob_handler != nullptr ? blob_handler->GetSerializedData()
                                          : std::vector<uint8_t>();
     }
@@ -51,7 +51,8 @@ struct UserCustomGeneratorSchema : public internal::CustomGeneratorSchema {
 
   void ConvertToInternal() {
     for (auto &[id_key, id_info] : ids) {
-      id_info.ConvertToInternal();
+      // Inputs hashed earlier during this build are reused
+      id_info.ConvertToInternal(id_info.inputs);
       auto [_, success] = internal_ids.try_emplace(id_key, id_info);
       env::assert_fatal(success, fmt::format("Could not save {}", id_key));
     }
@@ -63,8 +64,9 @@ struct UserCustomGeneratorSchema : public internal::CustomGeneratorSchema {
 class CustomGenerator : public internal::BuilderInterface {
 public:
   CustomGenerator(const std::string &name, const TargetEnv &env)
-      : name_(name),
-        env_(env.GetTargetRootDir(), env.GetTargetBuildDir() / name),
+      : internal::BuilderInterface(env.GetContext()), name_(name),
+        env_(env.GetTargetRootDir(), env.GetTargetBuildDir() / name,
+             env.GetContext()),
         serialization_(env_.GetTargetBuildDir() /
                        fmt::format("{}.json", name)) {
     Initialize();
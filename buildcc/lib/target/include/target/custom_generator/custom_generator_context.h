@@ -19,6 +19,7 @@
 
 #include "schema/path.h"
 
+#include "env/build_context.h"
 #include "env/command.h"
 
 namespace buildcc {
@@ -28,13 +29,15 @@ public:
   CustomGeneratorContext(const env::Command &c,
                          const std::vector<std::string> &i,
                          const std::vector<std::string> &o,
-                         const std::vector<uint8_t> &ub)
-      : command(c), inputs(i), outputs(o), userblob(ub) {}
+                         const std::vector<uint8_t> &ub,
+                         BuildContext &bc = BuildContext::Global())
+      : command(c), inputs(i), outputs(o), userblob(ub), build_context(bc) {}
 
   const env::Command &command;
   const std::vector<std::string> &inputs;
   const std::vector<std::string> &outputs;
   const std::vector<uint8_t> &userblob;
+  BuildContext &build_context;
 };
 
 // clang-format off
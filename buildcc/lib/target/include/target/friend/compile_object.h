@@ -17,10 +17,21 @@
 #ifndef TARGET_FRIEND_COMPILE_OBJECT_H_
 #define TARGET_FRIEND_COMPILE_OBJECT_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <future>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "env/command_line.h"
 
 #include "schema/path.h"
 
+#include "toolchain/common/file_ext.h"
+
 #include "taskflow/core/task.hpp"
 #include "taskflow/taskflow.hpp"
 
@@ -38,19 +49,27 @@ class CompileObject {
 
 public:
   struct ObjectData {
-    ObjectData(const fs::path &o, const std::string &c)
-        : output(o), command(c) {}
+    ObjectData(const fs::path &o, const fs::path &d, const std::string &c)
+        : output(o), dep_file(d), command(c) {}
 
     fs::path output;
+    fs::path dep_file;
     std::string command;
+    // Empty when the command uses shell syntax
+    env::CommandLine command_line;
+    std::string command_hash;
+    // Empty when the ObjectCache and the RemoteCache are disabled
+    std::string cache_key;
   };
 
 public:
   CompileObject(Target &target) : target_(target) {}
+  ~CompileObject();
 
   void AddObjectData(const fs::path &absolute_source_path);
 
   void CacheCompileCommands();
+  void PreObjectCompile(std::vector<PathHashJob> &jobs);
   void Task();
 
   const ObjectData &GetObjectData(const fs::path &absolute_source) const;
@@ -58,6 +77,19 @@ public:
     return object_files_;
   }
   std::vector<fs::path> GetCompiledSources() const;
+
+  /**
+   * @brief Orders `source_files` by estimated compile duration, longest first
+   * Uses the BuildLog durations of the object files, the source file size
+   * otherwise
+   */
+  void
+  SortByEstimatedDuration(std::vector<internal::PathInfo> &source_files) const;
+
+  // Objects selected for (re)compilation during the current build
+  const std::vector<fs::path> &GetSelectedObjects() const {
+    return selected_objects_;
+  }
   tf::Task &GetTask() { return compile_task_; }
 
 private:
@@ -66,17 +98,64 @@ private:
   void BuildObjectCompile(std::vector<internal::PathInfo> &source_files,
                           std::vector<internal::PathInfo> &dummy_source_files);
 
-  void PreObjectCompile();
-
   void CompileSources(std::vector<internal::PathInfo> &source_files);
+
   void RecompileSources(std::vector<internal::PathInfo> &source_files,
-                        std::vector<internal::PathInfo> &dummy_source_files);
+                        std::vector<internal::PathInfo> &dummy_source_files,
+                        bool path_changed, bool invalidate_all_objects,
+                        const std::unordered_set<FileExt> &changed_exts);
+
+  std::unordered_set<FileExt> GetFlagChangedFileExts() const;
+  std::unordered_set<FileExt> GetToolchainChangedFileExts() const;
+  bool IsUntrackedCompileDependencyChanged() const;
+  bool IsObjectHeaderTracked(const std::string &absolute_source) const;
+  bool IsObjectCommandChanged(const std::string &absolute_source) const;
+
+  bool IsObjectHeaderChanged(
+      const std::string &absolute_source,
+      std::unordered_map<std::string, std::string> &current_header_hashes)
+      const;
+
+  void ClearDepFile(const std::string &absolute_source);
+  bool FetchCachedObject(const std::string &absolute_source);
+  void StoreObjectInfo(const std::string &absolute_source,
+                       bool store_in_cache);
+  void StoreDummyObjectInfo(const std::string &absolute_source);
+
+  // Compile jobs run asynchronously, exited jobs are queued and their objects
+  // are stored on the executor
+  void QueueCompileJobs(tf::Subflow &subflow);
+  void CompileJobsQueued();
+  void CompileJobExited(std::size_t index, bool success);
+  void StoreExitedCompileJobs();
+  void WaitCompileJobs();
+  void StoreCompileJobs(std::unique_lock<std::mutex> &lock);
 
 private:
   Target &target_;
 
   std::unordered_map<std::string, ObjectData> object_files_;
+  std::vector<fs::path> selected_objects_;
+  std::vector<internal::PathInfo> compile_jobs_;
+  std::atomic<std::size_t> next_compile_job_{0};
+  // Set for compile jobs fetched from a cache, indexed like compile_jobs_
+  std::vector<char> cached_compile_jobs_;
+  std::mutex exited_compile_jobs_mutex_;
+  std::condition_variable exited_compile_jobs_cv_;
+  // Index and result of the exited jobs that are not stored yet
+  std::vector<std::pair<std::size_t, bool>> exited_compile_jobs_;
+  // Set while a task of the executor stores the exited jobs
+  bool storing_compile_jobs_{false};
+  // Jobs that are not stored yet, and the compile task while it queues them
+  std::size_t pending_compile_jobs_{0};
   tf::Task compile_task_;
+  tf::Task wait_task_;
+
+  // Held from the compile task until the last job is stored, the wait task
+  // does not hold a worker in the meantime
+  tf::Semaphore compile_jobs_semaphore_{1};
+  tf::Taskflow release_tf_;
+  std::future<void> release_future_;
 };
 
 } // namespace buildcc::internal
@@ -19,6 +19,9 @@
 
 #include <filesystem>
 #include <string>
+#include <vector>
+
+#include "schema/path.h"
 
 #include "taskflow/taskflow.hpp"
 
@@ -41,6 +44,7 @@ public:
 
   // NOTE, These APIs should be called inside `Target::Build`
   void CacheCompileCommand();
+  void PreCompile(std::vector<PathHashJob> &jobs);
   void Task();
 
   const fs::path &GetHeaderPath() const { return header_path_; }
@@ -62,7 +66,6 @@ private:
 
   std::string ConstructCompileCommand() const;
 
-  void PreCompile();
   void BuildCompile();
 
 private:
@@ -19,6 +19,9 @@
 
 #include <filesystem>
 #include <string>
+#include <vector>
+
+#include "schema/path.h"
 
 #include "taskflow/taskflow.hpp"
 
@@ -48,6 +51,17 @@ private:
   void BuildLink();
   void PreLink();
 
+  bool IsArchiveUpdatable() const;
+
+  std::string ConstructCommand(const std::string &pattern,
+                               const std::string &compiled_sources) const;
+  std::string UseResponseFile(const std::string &pattern,
+                              const std::string &command,
+                              const std::vector<fs::path> &objects,
+                              const fs::path &response_file,
+                              std::string &response_file_content) const;
+  fs::path ConstructResponseFilePath(const char *suffix) const;
+
   fs::path ConstructOutputPath() const;
 
 private:
@@ -55,6 +69,9 @@ private:
 
   fs::path output_;
   std::string command_;
+  // Written before the link when `command_` uses a response file
+  std::string response_file_content_;
+  std::vector<PathHashJob> fingerprint_jobs_;
   tf::Task task_;
 };
 
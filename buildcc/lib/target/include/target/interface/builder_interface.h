@@ -24,6 +24,8 @@
 #include "taskflow/taskflow.hpp"
 
 #include "env/assert_fatal.h"
+#include "env/build_context.h"
+#include "env/task_state.h"
 
 #include "target/common/util.h"
 
@@ -32,13 +34,26 @@ namespace buildcc::internal {
 class BuilderInterface {
 
 public:
+  BuilderInterface() = default;
+  explicit BuilderInterface(BuildContext &context) : failure_scope_(context) {}
+
   virtual void Build() = 0;
 
+  /**
+   * @brief Tasks are skipped once `dependency` fails
+   */
+  void AddFailureDependency(const BuilderInterface &dependency) {
+    failure_scope_.AddUpstream(dependency.failure_scope_);
+  }
+
   const std::string &GetUniqueId() const { return unique_id_; }
   tf::Taskflow &GetTaskflow() { return tf_; }
+  const env::FailureScope &GetFailureScope() const { return failure_scope_; }
+  BuildContext &GetContext() const { return failure_scope_.GetContext(); }
 
 protected:
   bool dirty_{false};
+  env::FailureScope failure_scope_;
   std::string unique_id_;
   tf::Taskflow tf_;
 };
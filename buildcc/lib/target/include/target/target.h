@@ -17,6 +17,7 @@
 #ifndef TARGET_TARGET_H_
 #define TARGET_TARGET_H_
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <initializer_list>
@@ -68,9 +69,12 @@ public:
   explicit Target(const std::string &name, TargetType type,
                   const Toolchain &toolchain, const TargetEnv &env,
                   const TargetConfig &config = TargetConfig())
-      : TargetInfo(toolchain, TargetEnv(env.GetTargetRootDir(),
-                                        env.GetTargetBuildDir() /
-                                            toolchain.GetName() / name)),
+      : internal::BuilderInterface(env.GetContext()),
+        TargetInfo(toolchain,
+                   TargetEnv(env.GetTargetRootDir(),
+                             env.GetTargetBuildDir() / toolchain.GetName() /
+                                 name,
+                             env.GetContext())),
         name_(name), type_(type), config_(config),
         serialization_(env_.GetTargetBuildDir() / fmt::format("{}.bin", name)),
         compile_pch_(*this), compile_object_(*this), link_target_(*this) {
@@ -82,6 +86,34 @@ public:
   // Builders
   void Build() override;
 
+  /**
+   * @brief Compile stage (Start, Pch and Objects) and link stage (Link and
+   * End) of the target
+   * `GetTaskflow` runs both stages in order. Registering the stages
+   * separately allows target dependencies to only gate the link stage
+   */
+  tf::Taskflow &GetCompileTaskflow() { return compile_tf_; }
+  tf::Taskflow &GetLinkTaskflow() { return link_tf_; }
+
+  /**
+   * @brief Executor that runs the Taskflow of the target
+   * PreReq: Call before `Build`
+   *
+   * Objects are stored on `executor` as their commands exit and the compile
+   * stage does not hold a worker while the commands run. Otherwise a worker
+   * stores the objects and waits for the commands of the target
+   */
+  void SetExecutor(tf::Executor &executor) { executor_ = &executor; }
+
+  /**
+   * @brief Estimated duration (in milliseconds) of the longest chain of links
+   * that waits for the target to link, such as the links of its dependents
+   * Queued compile commands of targets on longer chains start first
+   */
+  void SetDownstreamDuration(std::uint64_t duration_ms) {
+    downstream_duration_ms_ = duration_ms;
+  }
+
 private:
   friend class internal::CompilePch;
   friend class internal::CompileObject;
@@ -97,6 +129,7 @@ private:
   env::optional<std::string> SelectCompiler(FileExt ext) const;
 
   // Tasks
+  void StartTask();
   void EndTask();
   void TaskDeps();
 
@@ -112,6 +145,8 @@ private:
   void DirChanged();
   void FlagChanged();
   void ExternalLibChanged();
+  void CommandChanged();
+  void ToolchainChanged();
 
 private:
   std::string name_;
@@ -127,6 +162,11 @@ private:
   env::Command command_;
 
   // Task states
+  tf::Executor *executor_{nullptr};
+  std::uint64_t downstream_duration_ms_{0};
+  tf::Taskflow compile_tf_;
+  tf::Taskflow link_tf_;
+  std::vector<internal::PathHashJob> fingerprint_jobs_;
   tf::Task target_start_task_;
   tf::Task target_end_task_;
 };
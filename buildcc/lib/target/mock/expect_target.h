@@ -23,6 +23,8 @@ void TargetExpect_PathChanged(unsigned int calls, Target *target);
 void TargetExpect_DirChanged(unsigned int calls, Target *target);
 void TargetExpect_FlagChanged(unsigned int calls, Target *target);
 void TargetExpect_ExternalLibChanged(unsigned int calls, Target *target);
+void TargetExpect_CommandChanged(unsigned int calls, Target *target);
+void TargetExpect_ToolchainChanged(unsigned int calls, Target *target);
 
 } // namespace buildcc::m
 
@@ -20,6 +20,10 @@ static constexpr const char *const FLAG_CHANGED_FUNCTION =
     "Target::FlagChanged";
 static constexpr const char *const EXTERNAL_LIB_CHANGED_FUNCTION =
     "Target::ExternalLibChanged";
+static constexpr const char *const COMMAND_CHANGED_FUNCTION =
+    "Target::CommandChanged";
+static constexpr const char *const TOOLCHAIN_CHANGED_FUNCTION =
+    "Target::ToolchainChanged";
 
 // Source rechecks
 void Target::SourceRemoved() {
@@ -53,6 +57,14 @@ void Target::ExternalLibChanged() {
   mock().actualCall(EXTERNAL_LIB_CHANGED_FUNCTION).onObject(this);
 }
 
+void Target::CommandChanged() {
+  mock().actualCall(COMMAND_CHANGED_FUNCTION).onObject(this);
+}
+
+void Target::ToolchainChanged() {
+  mock().actualCall(TOOLCHAIN_CHANGED_FUNCTION).onObject(this);
+}
+
 namespace m {
 
 void TargetExpect_SourceRemoved(unsigned int calls, Target *target) {
@@ -91,6 +103,14 @@ void TargetExpect_ExternalLibChanged(unsigned int calls, Target *target) {
   mock().expectNCalls(calls, EXTERNAL_LIB_CHANGED_FUNCTION).onObject(target);
 }
 
+void TargetExpect_CommandChanged(unsigned int calls, Target *target) {
+  mock().expectNCalls(calls, COMMAND_CHANGED_FUNCTION).onObject(target);
+}
+
+void TargetExpect_ToolchainChanged(unsigned int calls, Target *target) {
+  mock().expectNCalls(calls, TOOLCHAIN_CHANGED_FUNCTION).onObject(target);
+}
+
 } // namespace m
 
 } // namespace buildcc
@@ -81,6 +81,13 @@ TargetGetter<T>::GetCompileCommand(const fs::path &source) const {
   return t.compile_object_.GetObjectData(source).command;
 }
 
+template <typename T>
+const env::CommandLine &
+TargetGetter<T>::GetCompileCommandLine(const fs::path &source) const {
+  const auto &t = static_cast<const T &>(*this);
+  return t.compile_object_.GetObjectData(source).command_line;
+}
+
 template <typename T>
 const std::string &TargetGetter<T>::GetLinkCommand() const {
   const auto &t = static_cast<const T &>(*this);
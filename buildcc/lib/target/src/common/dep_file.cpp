@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "target/common/dep_file.h"
+
+#include <unordered_set>
+
+namespace {
+
+void append_escaped(const std::string &path, std::string &data) {
+  for (const char c : path) {
+    if (c == ' ' || c == '#') {
+      data += '\\';
+    } else if (c == '$') {
+      data += '$';
+    }
+    data += c;
+  }
+}
+
+} // namespace
+
+namespace buildcc::internal {
+
+std::vector<std::string> ParseDepFile(const std::string &data) {
+  std::vector<std::string> tokens;
+  std::string token;
+
+  auto flush_token = [&]() {
+    if (!token.empty()) {
+      tokens.emplace_back(std::move(token));
+      token.clear();
+    }
+  };
+
+  const std::size_t size = data.size();
+  for (std::size_t i = 0; i < size; i++) {
+    const char c = data[i];
+    const char next = (i + 1) < size ? data[i + 1] : '\0';
+    switch (c) {
+    case '\\':
+      if (next == '\n') {
+        // Line continuation
+        flush_token();
+        i++;
+      } else if (next == '\r' && (i + 2) < size && data[i + 2] == '\n') {
+        flush_token();
+        i += 2;
+      } else if (next == ' ' || next == '#') {
+        token += next;
+        i++;
+      } else {
+        // Windows path separators are kept as is
+        token += c;
+      }
+      break;
+    case '$':
+      token += c;
+      if (next == '$') {
+        i++;
+      }
+      break;
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+      flush_token();
+      break;
+    default:
+      token += c;
+      break;
+    }
+  }
+  flush_token();
+
+  std::vector<std::string> deps;
+  std::unordered_set<std::string> unique_deps;
+  for (auto &t : tokens) {
+    // Targets i.e `main.cpp.o:` or a standalone `:`
+    if (t.back() == ':') {
+      continue;
+    }
+    if (unique_deps.insert(t).second) {
+      deps.emplace_back(std::move(t));
+    }
+  }
+  return deps;
+}
+
+std::string MakeDepFile(const std::string &target,
+                        const std::vector<std::string> &deps) {
+  std::string data;
+  append_escaped(target, data);
+  data += ':';
+  for (const auto &dep : deps) {
+    data += " \\\n  ";
+    append_escaped(dep, data);
+  }
+  data += '\n';
+  return data;
+}
+
+} // namespace buildcc::internal
@@ -100,6 +100,14 @@ struct Comparator {
     return id_state_info_.at(State::kAdded).count(id) == 1;
   }
 
+  const buildcc::internal::PathInfoList &
+  GetLoadedInputs(const std::string &id) const {
+    static const buildcc::internal::PathInfoList kEmptyInputs;
+    auto iter = loaded_.internal_ids.find(id);
+    return iter == loaded_.internal_ids.end() ? kEmptyInputs
+                                              : iter->second.inputs;
+  }
+
 private:
   const buildcc::internal::CustomGeneratorSchema &loaded_;
   const buildcc::UserCustomGeneratorSchema &current_;
@@ -119,16 +127,16 @@ struct TaskFunctor {
   TaskFunctor(const std::string &id,
               UserCustomGeneratorSchema::UserIdInfo &id_info,
               const Comparator &comparator, const env::Command &command,
-              TaskState &state)
+              TaskState &state, env::FailureScope &failure_scope)
       : id_(id), id_info_(id_info), comparator(comparator), command_(command),
-        state_(state) {}
+        state_(state), failure_scope_(failure_scope) {}
 
   void operator()() {
-    if (env::get_task_state() != env::TaskState::SUCCESS) {
+    if (!failure_scope_.CanRun()) {
       return;
     }
     try {
-      id_info_.ConvertToInternal();
+      id_info_.ConvertToInternal(comparator.GetLoadedInputs(id_));
       // Compute runnable
       state_.should_run =
           comparator.IsIdAdded(id_) ? true : comparator.IsChanged(id_);
@@ -138,7 +146,8 @@ struct TaskFunctor {
         const auto input_paths = id_info_.inputs.GetPaths();
         CustomGeneratorContext ctx(command_, input_paths,
                                    id_info_.outputs.GetPaths(),
-                                   id_info_.userblob);
+                                   id_info_.userblob,
+                                   failure_scope_.GetContext());
 
         bool success = id_info_.generate_cb(ctx);
         env::assert_fatal(success,
@@ -146,7 +155,7 @@ struct TaskFunctor {
       }
       state_.run_success = true;
     } catch (...) {
-      env::set_task_state(env::TaskState::FAILURE);
+      failure_scope_.Fail();
     }
   }
 
@@ -158,6 +167,7 @@ private:
   const env::Command &command_;
 
   TaskState &state_;
+  env::FailureScope &failure_scope_;
 };
 
 bool ComputeBuild(const internal::CustomGeneratorSerialization &serialization,
@@ -241,14 +251,14 @@ void CustomGenerator::Build() {
 void CustomGenerator::Initialize() {
   // Checks
   env::assert_fatal(
-      Project::IsInit(),
+      GetContext().IsInit(),
       "Environment is not initialized. Use the buildcc::Project::Init API");
 
   //
   fs::create_directories(env_.GetTargetBuildDir());
   command_.AddDefaultArguments({
-      {kProjectRootDirName, path_as_string(Project::GetRootDir())},
-      {kProjectBuildDirName, path_as_string(Project::GetBuildDir())},
+      {kProjectRootDirName, path_as_string(GetContext().GetRootDir())},
+      {kProjectBuildDirName, path_as_string(GetContext().GetBuildDir())},
       {kCurrentRootDirName, path_as_string(env_.GetTargetRootDir())},
       {kCurrentBuildDirName, path_as_string(env_.GetTargetBuildDir())},
   });
@@ -260,7 +270,7 @@ void CustomGenerator::Initialize() {
 
 void CustomGenerator::GenerateTask() {
   tf::Task generate_task = tf_.emplace([&](tf::Subflow &subflow) {
-    if (env::get_task_state() != env::TaskState::SUCCESS) {
+    if (!failure_scope_.CanRun()) {
       return;
     }
 
@@ -277,14 +287,16 @@ void CustomGenerator::GenerateTask() {
       for (const auto &id : comparator.GetAddedIds()) {
         states.try_emplace(id, TaskState());
         auto &id_info = user_.ids.at(id);
-        TaskFunctor functor(id, id_info, comparator, command_, states.at(id));
+        TaskFunctor functor(id, id_info, comparator, command_, states.at(id),
+                            failure_scope_);
         subflow.emplace(functor).name(id);
       }
 
       for (const auto &id : comparator.GetCheckLaterIds()) {
         states.try_emplace(id, TaskState());
         auto &id_info = user_.ids.at(id);
-        TaskFunctor functor(id, id_info, comparator, command_, states.at(id));
+        TaskFunctor functor(id, id_info, comparator, command_, states.at(id),
+                            failure_scope_);
         subflow.emplace(functor).name(id);
       }
 
@@ -308,7 +320,7 @@ void CustomGenerator::GenerateTask() {
                           fmt::format("Store failed for {}", name_));
       }
     } catch (...) {
-      env::set_task_state(env::TaskState::FAILURE);
+      failure_scope_.Fail();
     }
   });
   generate_task.name(kGenerateTaskName);
@@ -29,7 +29,8 @@ bool FileGeneratorGenerateCb(const buildcc::CustomGeneratorContext &ctx) {
       buildcc::TypedCustomBlobHandler<std::vector<std::string>>::Deserialize(
           ctx.userblob);
   for (const auto &c : commands) {
-    bool executed = buildcc::env::Command::Execute(c);
+    bool executed = buildcc::env::Command::Execute(c, {}, nullptr, nullptr,
+                                                   nullptr, &ctx.build_context);
     if (!executed) {
       success = false;
       buildcc::env::log_critical(__FUNCTION__,
@@ -64,7 +64,7 @@ std::string TemplateGenerator::Parse(const std::string &pattern) const {
 void TemplateGenerator::Build() {
   for (const auto &info : template_infos_) {
     std::string name = string_as_path(ParsePattern(info.input_pattern))
-                           .lexically_relative(Project::GetRootDir())
+                           .lexically_relative(GetContext().GetRootDir())
                            .string();
     AddIdInfo(name, {info.input_pattern}, {info.output_pattern},
               template_generate_cb);
@@ -112,6 +112,7 @@ void Target::Build() {
   }
 
   // Target State Tasks
+  StartTask();
   EndTask();
 
   // Compile Command
@@ -16,14 +16,24 @@
 
 #include "target/friend/compile_object.h"
 
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
 #include "target/target.h"
 
+#include "target/common/dep_file.h"
+
+#include "schema/object_cache.h"
+#include "schema/remote_cache.h"
+
 namespace {
 
 constexpr const char *const kCompiler = "compiler";
 constexpr const char *const kCompileFlags = "compile_flags";
 constexpr const char *const kOutput = "output";
 constexpr const char *const kInput = "input";
+constexpr const char *const kDepFile = "dep_file";
 
 } // namespace
 
@@ -33,33 +43,61 @@ void CompileObject::AddObjectData(const fs::path &absolute_source_path) {
   const fs::path absolute_object_path =
       ConstructObjectPath(absolute_source_path);
   fs::create_directories(absolute_object_path.parent_path());
+  const fs::path absolute_dep_file_path =
+      fs::path(absolute_object_path).concat(".d");
 
   object_files_.try_emplace(
       internal::PathInfo::ToPathString(absolute_source_path),
-      absolute_object_path, "");
+      absolute_object_path, absolute_dep_file_path, "");
 }
 
 void CompileObject::CacheCompileCommands() {
-  for (auto &[absolute_current_source, object_data] : object_files_) {
-
-    const std::string output =
-        fmt::format("{}", GetObjectData(absolute_current_source).output);
-    const std::string input = fmt::format("{}", absolute_current_source);
+  // The pattern is parsed once and the arguments shared by every source of a
+  // FileExt are bound once, each source only renders its own paths
+  const env::CommandTemplate compile_command =
+      target_.command_.CreateTemplate(target_.GetConfig().compile_command);
+  std::unordered_map<FileExt, env::CommandTemplate> ext_compile_commands;
 
+  for (auto &[absolute_current_source, object_data] : object_files_) {
     const auto type =
         target_.toolchain_.GetConfig().GetFileExt(absolute_current_source);
-    const std::string selected_aggregated_compile_flags =
-        target_.SelectCompileFlags(type).value_or("");
-    const std::string selected_compiler =
-        fmt::format("{}", fs::path(target_.SelectCompiler(type).value_or("")));
-    object_data.command = target_.command_.Construct(
-        target_.GetConfig().compile_command,
-        {
-            {kCompiler, selected_compiler},
-            {kCompileFlags, selected_aggregated_compile_flags},
-            {kOutput, output},
-            {kInput, input},
-        });
+    auto iter = ext_compile_commands.find(type);
+    if (iter == ext_compile_commands.end()) {
+      env::CommandTemplate ext_compile_command = compile_command;
+      ext_compile_command.Bind({
+          {kCompiler, fmt::format("{}", fs::path(target_.SelectCompiler(type)
+                                                     .value_or("")))},
+          {kCompileFlags, target_.SelectCompileFlags(type).value_or("")},
+      });
+      iter = ext_compile_commands.emplace(type, std::move(ext_compile_command))
+                 .first;
+    }
+
+    object_data.command = iter->second.Render({
+        {kOutput, fmt::format("{}", object_data.output)},
+        {kInput, absolute_current_source},
+        {kDepFile, fmt::format("{}", object_data.dep_file)},
+    });
+    // Arguments are passed as is, paths are not quoted
+    object_data.command_line =
+        iter->second
+            .RenderCommandLine({
+                {kOutput, path_as_string(object_data.output)},
+                {kInput, absolute_current_source},
+                {kDepFile, path_as_string(object_data.dep_file)},
+            })
+            .value_or(env::CommandLine());
+    if (ObjectCache::IsEnabled() || RemoteCache::IsEnabled()) {
+      // Paths in the build directory are not part of the key
+      object_data.cache_key = ObjectCache::ComputeKey(
+          target_.SelectCompiler(type).value_or(""),
+          iter->second.Render({
+              {kOutput, kOutput},
+              {kInput, absolute_current_source},
+              {kDepFile, kDepFile},
+          }));
+    }
+    object_data.command_hash = internal::command_digest(object_data.command);
   }
 }
 
@@ -166,12 +204,13 @@ CompileObject::ConstructObjectPath(const fs::path &absolute_source_file) const {
 void CompileObject::BuildObjectCompile(
     std::vector<internal::PathInfo> &source_files,
     std::vector<internal::PathInfo> &dummy_source_files) {
-  PreObjectCompile();
-
   const auto &serialization = target_.serialization_;
   const auto &load_target_schema = serialization.GetLoad();
   const auto &user_target_schema = target_.user_;
 
+  bool path_changed = false;
+  bool invalidate_all_objects = false;
+  std::unordered_set<FileExt> changed_exts;
   if (!serialization.IsLoaded()) {
     target_.dirty_ = true;
   } else {
@@ -181,47 +220,78 @@ void CompileObject::BuildObjectCompile(
                !(load_target_schema.common_compile_flags ==
                  user_target_schema.common_compile_flags) ||
                !(load_target_schema.pch_object_flags ==
-                 user_target_schema.pch_object_flags) ||
-               !(load_target_schema.asm_compile_flags ==
-                 user_target_schema.asm_compile_flags) ||
-               !(load_target_schema.c_compile_flags ==
-                 user_target_schema.c_compile_flags) ||
-               !(load_target_schema.cpp_compile_flags ==
-                 user_target_schema.cpp_compile_flags)) {
+                 user_target_schema.pch_object_flags)) {
       target_.dirty_ = true;
       target_.FlagChanged();
-    } else if (!(load_target_schema.include_dirs ==
-                 user_target_schema.include_dirs)) {
-      target_.dirty_ = true;
-      target_.DirChanged();
-    } else if (!(load_target_schema.headers == user_target_schema.headers)) {
-      target_.dirty_ = true;
-      target_.PathChanged();
-    } else if (!(load_target_schema.compile_dependencies ==
-                 user_target_schema.compile_dependencies)) {
-      target_.dirty_ = true;
-      target_.PathChanged();
+    } else {
+      changed_exts = GetFlagChangedFileExts();
+      if (!changed_exts.empty()) {
+        target_.FlagChanged();
+      }
+      const auto toolchain_changed_exts = GetToolchainChangedFileExts();
+      if (!toolchain_changed_exts.empty()) {
+        target_.ToolchainChanged();
+        changed_exts.insert(toolchain_changed_exts.cbegin(),
+                            toolchain_changed_exts.cend());
+      }
+
+      if (!changed_exts.empty()) {
+        switch (target_.GetConfig().invalidation_mode) {
+        case InvalidationMode::Object:
+          // Only objects compiled with the changed flags / compiler are
+          // recompiled
+          break;
+        case InvalidationMode::Target:
+        default:
+          target_.dirty_ = true;
+          break;
+        }
+      }
+
+      if (target_.dirty_) {
+      } else if (!(load_target_schema.include_dirs ==
+                   user_target_schema.include_dirs)) {
+        target_.dirty_ = true;
+        target_.DirChanged();
+      } else if (!(load_target_schema.headers == user_target_schema.headers) ||
+                 !(load_target_schema.compile_dependencies ==
+                   user_target_schema.compile_dependencies)) {
+        target_.PathChanged();
+        switch (target_.GetConfig().invalidation_mode) {
+        case InvalidationMode::Object:
+          path_changed = true;
+          invalidate_all_objects = IsUntrackedCompileDependencyChanged();
+          break;
+        case InvalidationMode::Target:
+        default:
+          target_.dirty_ = true;
+          break;
+        }
+      }
     }
   }
 
   if (target_.dirty_) {
     CompileSources(source_files);
   } else {
-    RecompileSources(source_files, dummy_source_files);
+    RecompileSources(source_files, dummy_source_files, path_changed,
+                     invalidate_all_objects, changed_exts);
   }
 }
 
-void CompileObject::PreObjectCompile() {
+void CompileObject::PreObjectCompile(std::vector<PathHashJob> &jobs) {
   auto &target_user_schema = target_.user_;
+  const auto &load_target_schema = target_.serialization_.GetLoad();
 
   // Convert user_source_files to current_source_files
-  target_user_schema.sources.ComputeHashForAll();
+  target_user_schema.sources.AddHashJobs(load_target_schema.sources, jobs);
 
   // Convert user_header_files to current_header_files
-  target_user_schema.headers.ComputeHashForAll();
+  target_user_schema.headers.AddHashJobs(load_target_schema.headers, jobs);
 
   // Convert user_compile_dependencies to current_compile_dependencies
-  target_user_schema.compile_dependencies.ComputeHashForAll();
+  target_user_schema.compile_dependencies.AddHashJobs(
+      load_target_schema.compile_dependencies, jobs);
 }
 
 void CompileObject::CompileSources(
@@ -231,13 +301,69 @@ void CompileObject::CompileSources(
   source_files = target_user_schema.sources.GetPathInfos();
 }
 
+// Critical path first
+// The target links once its slowest object is compiled, starting the longest
+// compile jobs first shortens the critical path of the target
+// Durations of previous builds are used when available. Otherwise the source
+// file size is used, scaled to milliseconds using the sources that have a
+// recorded duration
+void CompileObject::SortByEstimatedDuration(
+    std::vector<internal::PathInfo> &source_files) const {
+  std::vector<env::optional<std::uint64_t>> durations;
+  std::vector<std::uintmax_t> sizes;
+  durations.reserve(source_files.size());
+  sizes.reserve(source_files.size());
+
+  double recorded_duration = 0;
+  double recorded_size = 0;
+  for (const auto &path_info : source_files) {
+    durations.push_back(BuildLog::GetDuration(
+        target_.GetContext(),
+        path_as_string(GetObjectData(path_info.path).output)));
+    std::error_code errorcode;
+    std::uintmax_t size = fs::file_size(path_info.path, errorcode);
+    sizes.push_back(errorcode ? 0 : size);
+    if (durations.back().has_value() && sizes.back() != 0) {
+      recorded_duration += static_cast<double>(durations.back().value());
+      recorded_size += static_cast<double>(sizes.back());
+    }
+  }
+
+  const double ms_per_byte =
+      recorded_size != 0 ? recorded_duration / recorded_size : 1.0;
+  std::vector<double> estimates;
+  estimates.reserve(source_files.size());
+  for (std::size_t i = 0; i < source_files.size(); i++) {
+    estimates.push_back(durations[i].has_value()
+                            ? static_cast<double>(durations[i].value())
+                            : static_cast<double>(sizes[i]) * ms_per_byte);
+  }
+
+  std::vector<std::size_t> order(source_files.size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b) {
+                     return estimates[a] > estimates[b];
+                   });
+
+  std::vector<internal::PathInfo> sorted;
+  sorted.reserve(source_files.size());
+  for (std::size_t i : order) {
+    sorted.push_back(std::move(source_files[i]));
+  }
+  source_files = std::move(sorted);
+}
+
 void CompileObject::RecompileSources(
     std::vector<internal::PathInfo> &source_files,
-    std::vector<internal::PathInfo> &dummy_source_files) {
+    std::vector<internal::PathInfo> &dummy_source_files, bool path_changed,
+    bool invalidate_all_objects,
+    const std::unordered_set<FileExt> &changed_exts) {
   const auto &serialization = target_.serialization_;
   const auto &user_target_schema = target_.user_;
   auto previous_source_files =
       serialization.GetLoad().sources.GetUnorderedPathInfos();
+  std::unordered_map<std::string, std::string> current_header_hashes;
 
   for (const auto &current_path_info :
        user_target_schema.sources.GetPathInfos()) {
@@ -253,6 +379,29 @@ void CompileObject::RecompileSources(
         source_files.push_back(current_path_info);
         target_.dirty_ = true;
         target_.SourceUpdated();
+      } else if (!changed_exts.empty() &&
+                 changed_exts.count(
+                     target_.toolchain_.GetConfig().GetFileExt(current_path)) >
+                     0) {
+        // Compile flags or compiler for this source type have changed
+        source_files.push_back(current_path_info);
+        target_.dirty_ = true;
+      } else if (invalidate_all_objects ||
+                 (path_changed && !IsObjectHeaderTracked(current_path))) {
+        // Changed headers / compile dependencies cannot be attributed to this
+        // object
+        source_files.push_back(current_path_info);
+        target_.dirty_ = true;
+      } else if (IsObjectCommandChanged(current_path)) {
+        // Compile command changed (compile_command, compiler path etc)
+        source_files.push_back(current_path_info);
+        target_.dirty_ = true;
+        target_.CommandChanged();
+      } else if (IsObjectHeaderChanged(current_path, current_header_hashes)) {
+        // Header discovered by the compiler has been updated
+        source_files.push_back(current_path_info);
+        target_.dirty_ = true;
+        target_.PathUpdated();
       } else {
         dummy_source_files.push_back(current_path_info);
       }
@@ -266,4 +415,313 @@ void CompileObject::RecompileSources(
   }
 }
 
+bool CompileObject::IsObjectHeaderChanged(
+    const std::string &absolute_source,
+    std::unordered_map<std::string, std::string> &current_header_hashes) const {
+  const auto &objects = target_.serialization_.GetLoad().objects;
+  const auto iter = objects.find(absolute_source);
+  if (iter == objects.end()) {
+    // No compiler discovered headers for this object
+    return false;
+  }
+
+  for (const auto &header : iter->second.headers.GetPathInfos()) {
+    auto hiter = current_header_hashes.find(header.path);
+    if (hiter == current_header_hashes.end()) {
+      // Headers are shared between objects, compute each hash only once
+      // Removed headers are stored with an empty hash
+      internal::PathInfo current;
+      if (!internal::PathInfoList::TryComputePathInfo(header.path, &header,
+                                                      current)) {
+        current.hash.clear();
+      }
+      hiter =
+          current_header_hashes.try_emplace(header.path, current.hash).first;
+    }
+    if (hiter->second.empty() || hiter->second != header.hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::unordered_set<FileExt> CompileObject::GetFlagChangedFileExts() const {
+  const auto &load_target_schema = target_.serialization_.GetLoad();
+  const auto &user_target_schema = target_.user_;
+
+  std::unordered_set<FileExt> flag_changed_exts;
+  if (!(load_target_schema.asm_compile_flags ==
+        user_target_schema.asm_compile_flags)) {
+    flag_changed_exts.insert(FileExt::Asm);
+  }
+  if (!(load_target_schema.c_compile_flags ==
+        user_target_schema.c_compile_flags)) {
+    flag_changed_exts.insert(FileExt::C);
+  }
+  if (!(load_target_schema.cpp_compile_flags ==
+        user_target_schema.cpp_compile_flags)) {
+    flag_changed_exts.insert(FileExt::Cpp);
+  }
+  return flag_changed_exts;
+}
+
+std::unordered_set<FileExt>
+CompileObject::GetToolchainChangedFileExts() const {
+  const auto &load_toolchain = target_.serialization_.GetLoad().toolchain;
+  const auto &user_toolchain = target_.user_.toolchain;
+
+  std::unordered_set<FileExt> toolchain_changed_exts;
+  if (load_toolchain.assembler != user_toolchain.assembler) {
+    toolchain_changed_exts.insert(FileExt::Asm);
+  }
+  if (load_toolchain.c_compiler != user_toolchain.c_compiler) {
+    toolchain_changed_exts.insert(FileExt::C);
+  }
+  if (load_toolchain.cpp_compiler != user_toolchain.cpp_compiler) {
+    toolchain_changed_exts.insert(FileExt::Cpp);
+  }
+  return toolchain_changed_exts;
+}
+
+bool CompileObject::IsObjectHeaderTracked(
+    const std::string &absolute_source) const {
+  const auto &objects = target_.serialization_.GetLoad().objects;
+  const auto iter = objects.find(absolute_source);
+  return iter != objects.end() && iter->second.headers_tracked;
+}
+
+bool CompileObject::IsObjectCommandChanged(
+    const std::string &absolute_source) const {
+  const auto &objects = target_.serialization_.GetLoad().objects;
+  const auto iter = objects.find(absolute_source);
+  if (iter == objects.end()) {
+    return true;
+  }
+  return iter->second.command_hash !=
+         GetObjectData(absolute_source).command_hash;
+}
+
+// Compile dependencies that were never reported by the compiler (for example
+// files consumed through compile flags) could be used by every object
+bool CompileObject::IsUntrackedCompileDependencyChanged() const {
+  const auto &load_target_schema = target_.serialization_.GetLoad();
+  const auto &user_target_schema = target_.user_;
+
+  std::unordered_set<std::string> tracked_paths;
+  for (const auto &[_, info] : load_target_schema.objects) {
+    for (const auto &header : info.headers.GetPathInfos()) {
+      tracked_paths.insert(header.path);
+    }
+  }
+
+  auto previous_deps =
+      load_target_schema.compile_dependencies.GetUnorderedPathInfos();
+  for (const auto &current_dep :
+       user_target_schema.compile_dependencies.GetPathInfos()) {
+    auto iter = previous_deps.find(current_dep.path);
+    const bool changed =
+        (iter == previous_deps.end()) || (iter->second != current_dep.hash);
+    if (changed && tracked_paths.count(current_dep.path) == 0) {
+      return true;
+    }
+    if (iter != previous_deps.end()) {
+      previous_deps.erase(iter);
+    }
+  }
+
+  // Removed compile dependencies
+  for (const auto &[path, _] : previous_deps) {
+    if (tracked_paths.count(path) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void CompileObject::ClearDepFile(const std::string &absolute_source) {
+  // Stale dependency files must not be attributed to the new object
+  std::error_code errcode;
+  fs::remove(GetObjectData(absolute_source).dep_file, errcode);
+}
+
+// On a hit the dependency file is constructed from the inputs of the cached
+// object
+bool CompileObject::FetchCachedObject(const std::string &absolute_source) {
+  const auto &object_data = GetObjectData(absolute_source);
+  if (object_data.cache_key.empty()) {
+    return false;
+  }
+  auto inputs = ObjectCache::Fetch(object_data.cache_key, object_data.output);
+  if (!inputs.has_value()) {
+    inputs = RemoteCache::Fetch(object_data.cache_key, object_data.output);
+    // Later builds on this machine do not download the object again
+    if (inputs.has_value()) {
+      (void)ObjectCache::Store(object_data.cache_key, object_data.output,
+                               inputs.value());
+    }
+  }
+  if (inputs.has_value() &&
+      env::save_file(
+          path_as_string(object_data.dep_file).c_str(),
+          MakeDepFile(path_as_string(object_data.output), inputs.value()),
+          false)) {
+    return true;
+  }
+
+  // Hardlinked objects are shared with the cache, the compiler must create a
+  // new file instead of writing to them
+  std::error_code errcode;
+  fs::remove(object_data.output, errcode);
+  return false;
+}
+
+CompileObject::~CompileObject() {
+  std::unique_lock<std::mutex> lock(exited_compile_jobs_mutex_);
+  std::future<void> release = std::move(release_future_);
+  lock.unlock();
+  if (release.valid()) {
+    release.wait();
+  }
+}
+
+// NOTE, Invoked on the thread that observed the exit, usually the completion
+// thread of env::Command, the objects are stored on the executor
+void CompileObject::CompileJobExited(std::size_t index, bool success) {
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(exited_compile_jobs_mutex_);
+    exited_compile_jobs_.emplace_back(index, success);
+    if (target_.executor_ != nullptr && !storing_compile_jobs_) {
+      storing_compile_jobs_ = true;
+      schedule = true;
+    }
+  }
+  if (schedule) {
+    target_.executor_->silent_async([this]() { StoreExitedCompileJobs(); });
+  } else {
+    exited_compile_jobs_cv_.notify_all();
+  }
+}
+
+void CompileObject::CompileJobsQueued() {
+  std::lock_guard<std::mutex> lock(exited_compile_jobs_mutex_);
+  pending_compile_jobs_--;
+  if (target_.executor_ != nullptr && pending_compile_jobs_ == 0 &&
+      !storing_compile_jobs_) {
+    release_future_ = target_.executor_->run(release_tf_);
+  }
+}
+
+// Only one task stores at a time
+void CompileObject::StoreExitedCompileJobs() {
+  std::unique_lock<std::mutex> lock(exited_compile_jobs_mutex_);
+  StoreCompileJobs(lock);
+  storing_compile_jobs_ = false;
+  if (pending_compile_jobs_ == 0) {
+    release_future_ = target_.executor_->run(release_tf_);
+  }
+}
+
+void CompileObject::WaitCompileJobs() {
+  std::unique_lock<std::mutex> lock(exited_compile_jobs_mutex_);
+  while (true) {
+    exited_compile_jobs_cv_.wait(lock, [this]() {
+      return !exited_compile_jobs_.empty() || pending_compile_jobs_ == 0;
+    });
+    if (exited_compile_jobs_.empty()) {
+      return;
+    }
+    StoreCompileJobs(lock);
+  }
+}
+
+void CompileObject::StoreCompileJobs(std::unique_lock<std::mutex> &lock) {
+  while (!exited_compile_jobs_.empty()) {
+    std::vector<std::pair<std::size_t, bool>> exited;
+    exited.swap(exited_compile_jobs_);
+    lock.unlock();
+    for (const auto &[index, success] : exited) {
+      const internal::PathInfo &path_info = compile_jobs_[index];
+      try {
+        env::assert_fatal(success, "Could not compile source");
+        target_.serialization_.AddSource(path_info.path, path_info.hash);
+        StoreObjectInfo(path_info.path, cached_compile_jobs_[index] == 0);
+      } catch (...) {
+        target_.failure_scope_.Fail();
+      }
+    }
+    lock.lock();
+    pending_compile_jobs_ -= exited.size();
+  }
+}
+
+void CompileObject::StoreObjectInfo(const std::string &absolute_source,
+                                    bool store_in_cache) {
+  const auto &object_data = GetObjectData(absolute_source);
+  TargetSchema::ObjectInfo info;
+  info.command_hash = object_data.command_hash;
+
+  std::error_code errcode;
+  std::string data;
+  if (!fs::exists(object_data.dep_file, errcode) ||
+      !env::load_file(path_as_string(object_data.dep_file).c_str(), false,
+                      &data)) {
+    // Toolchain does not emit dependency files
+    target_.serialization_.AddObjectInfo(absolute_source, info);
+    return;
+  }
+
+  // Headers recorded during the previous build are used to skip rehashing
+  std::unordered_map<std::string, const internal::PathInfo *> previous_headers;
+  const auto &objects = target_.serialization_.GetLoad().objects;
+  const auto iter = objects.find(absolute_source);
+  if (iter != objects.end()) {
+    for (const auto &header : iter->second.headers.GetPathInfos()) {
+      previous_headers.try_emplace(header.path, &header);
+    }
+  }
+
+  info.headers_tracked = true;
+  // Objects are only cached when all of their inputs are known
+  std::vector<std::string> inputs = {absolute_source};
+  for (const auto &dep : ParseDepFile(data)) {
+    const auto dep_path = internal::PathInfo::ToPathString(dep);
+    if (dep_path == absolute_source) {
+      continue;
+    }
+    inputs.push_back(dep_path);
+    auto piter = previous_headers.find(dep_path);
+    internal::PathInfo header;
+    if (internal::PathInfoList::TryComputePathInfo(
+            dep_path,
+            piter == previous_headers.end() ? nullptr : piter->second,
+            header)) {
+      info.headers.Emplace(std::move(header));
+    }
+  }
+  target_.serialization_.AddObjectInfo(absolute_source, info);
+
+  if (!store_in_cache || object_data.cache_key.empty()) {
+    return;
+  }
+  if (ObjectCache::IsEnabled() &&
+      !ObjectCache::Store(object_data.cache_key, object_data.output, inputs)) {
+    env::log_debug(__FUNCTION__,
+                   fmt::format("Could not cache {}", object_data.output));
+  }
+  if (RemoteCache::IsEnabled() &&
+      !RemoteCache::Store(object_data.cache_key, object_data.output, inputs)) {
+    env::log_debug(__FUNCTION__, fmt::format("Could not upload {}",
+                                             object_data.output));
+  }
+}
+
+void CompileObject::StoreDummyObjectInfo(const std::string &absolute_source) {
+  const auto &objects = target_.serialization_.GetLoad().objects;
+  const auto iter = objects.find(absolute_source);
+  if (iter != objects.end()) {
+    target_.serialization_.AddObjectInfo(absolute_source, iter->second);
+  }
+}
+
 } // namespace buildcc::internal
@@ -71,8 +71,6 @@ void CompilePch::CacheCompileCommand() {
 // PRIVATE
 
 void CompilePch::BuildCompile() {
-  PreCompile();
-
   const auto &serialization = target_.serialization_;
   const auto &load_target_schema = serialization.GetLoad();
   const auto &user_target_schema = target_.user_;
@@ -92,6 +90,12 @@ void CompilePch::BuildCompile() {
           user_target_schema.cpp_compile_flags)) {
       target_.dirty_ = true;
       target_.FlagChanged();
+    } else if (load_target_schema.toolchain.c_compiler !=
+                   user_target_schema.toolchain.c_compiler ||
+               load_target_schema.toolchain.cpp_compiler !=
+                   user_target_schema.toolchain.cpp_compiler) {
+      target_.dirty_ = true;
+      target_.ToolchainChanged();
     } else if (!(load_target_schema.include_dirs ==
                  user_target_schema.include_dirs)) {
       target_.dirty_ = true;
@@ -115,7 +119,8 @@ void CompilePch::BuildCompile() {
           env::save_file(p.c_str(), {"//Generated by BuildCC"}, false);
       env::assert_fatal(save, fmt::format("Could not save {}", p));
     }
-    bool success = env::Command::Execute(command_);
+    bool success = internal::execute_and_record(command_, compile_path_,
+                                                target_.GetContext());
     env::assert_fatal(success, "Failed to compile pch");
   }
 }
@@ -164,12 +169,12 @@ std::string CompilePch::ConstructCompileCommand() const {
                                     });
 }
 
-void CompilePch::PreCompile() {
+// NOTE, Headers are shared with CompileObject::PreObjectCompile
+void CompilePch::PreCompile(std::vector<PathHashJob> &jobs) {
   auto &target_user_schema = target_.user_;
+  const auto &load_target_schema = target_.serialization_.GetLoad();
 
-  target_user_schema.headers.ComputeHashForAll();
-
-  target_user_schema.pchs.ComputeHashForAll();
+  target_user_schema.pchs.AddHashJobs(load_target_schema.pchs, jobs);
 }
 
 } // namespace buildcc::internal
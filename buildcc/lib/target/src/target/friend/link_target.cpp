@@ -16,12 +16,30 @@
 
 #include "target/friend/link_target.h"
 
+#include <unordered_set>
+
+#include "env/util.h"
+
 #include "target/target.h"
 
 namespace {
 constexpr const char *const kOutput = "output";
 constexpr const char *const kCompiledSources = "compiled_sources";
+constexpr const char *const kCompiledSourcesPattern = "{compiled_sources}";
 constexpr const char *const kLibDeps = "lib_deps";
+
+void WriteResponseFile(const fs::path &response_file,
+                       const std::string &content) {
+  if (content.empty()) {
+    return;
+  }
+  const bool saved =
+      buildcc::env::save_file(buildcc::path_as_string(response_file).c_str(),
+                              content, false);
+  buildcc::env::assert_fatal(
+      saved, fmt::format("Could not write response file {}", response_file));
+}
+
 } // namespace
 
 namespace buildcc::internal {
@@ -29,22 +47,16 @@ namespace buildcc::internal {
 // PUBLIC
 
 void LinkTarget::CacheLinkCommand() {
-  // Add compiled sources
-  const std::string aggregated_compiled_sources =
-      internal::aggregate(target_.compile_object_.GetCompiledSources());
-
-  const std::string output_target = fmt::format("{}", output_);
-  const auto &target_user_schema = target_.user_;
-  command_ = target_.command_.Construct(
-      target_.GetConfig().link_command,
-      {
-          {kOutput, output_target},
-          {kCompiledSources, aggregated_compiled_sources},
-          {kLibDeps,
-           fmt::format("{} {}",
-                       internal::aggregate(target_user_schema.libs.GetPaths()),
-                       internal::aggregate(target_user_schema.external_libs))},
-      });
+  const std::string &link_command = target_.GetConfig().link_command;
+  const std::vector<fs::path> compiled_sources =
+      target_.compile_object_.GetCompiledSources();
+  command_ = ConstructCommand(link_command,
+                              internal::aggregate(compiled_sources));
+  // The digest covers the objects passed through the response file
+  target_.user_.link_command_hash = internal::command_digest(command_);
+  command_ =
+      UseResponseFile(link_command, command_, compiled_sources,
+                      ConstructResponseFilePath(""), response_file_content_);
 }
 
 // PRIVATE
@@ -59,24 +71,28 @@ fs::path LinkTarget::ConstructOutputPath() const {
 
 void LinkTarget::PreLink() {
   auto &target_user_schema = target_.user_;
+  const auto &load_target_schema = target_.serialization_.GetLoad();
 
-  target_user_schema.libs.ComputeHashForAll();
+  fingerprint_jobs_.clear();
+  target_user_schema.libs.AddHashJobs(load_target_schema.libs,
+                                      fingerprint_jobs_);
 
-  target_user_schema.link_dependencies.ComputeHashForAll();
+  target_user_schema.link_dependencies.AddHashJobs(
+      load_target_schema.link_dependencies, fingerprint_jobs_);
 }
 
 void LinkTarget::BuildLink() {
-  PreLink();
-
   const auto &serialization = target_.serialization_;
   const auto &target_load_schema = serialization.GetLoad();
   const auto &target_user_schema = target_.user_;
 
+  bool archive_update = false;
   if (!serialization.IsLoaded()) {
     target_.dirty_ = true;
   } else {
     if (target_.dirty_) {
       // Skip all the other else if checks
+      archive_update = IsArchiveUpdatable();
     } else if (!(target_load_schema.link_flags ==
                  target_user_schema.link_flags)) {
       target_.dirty_ = true;
@@ -93,6 +109,16 @@ void LinkTarget::BuildLink() {
                !(target_load_schema.libs == target_user_schema.libs)) {
       target_.dirty_ = true;
       target_.PathChanged();
+    } else if (!(target_load_schema.toolchain ==
+                 target_user_schema.toolchain)) {
+      // Any executable can be used as the link driver
+      target_.dirty_ = true;
+      target_.ToolchainChanged();
+    } else if (target_load_schema.link_command_hash !=
+               target_user_schema.link_command_hash) {
+      // Link command changed (link_command, linker path etc)
+      target_.dirty_ = true;
+      target_.CommandChanged();
     } else if (!target_load_schema.target_linked) {
       // TODO, Replace this with fs::exists to check if linked target is present
       // or no
@@ -101,10 +127,133 @@ void LinkTarget::BuildLink() {
   }
 
   if (target_.dirty_) {
-    bool success = env::Command::Execute(command_);
+    bool success = false;
+    if (archive_update) {
+      const std::string &pattern = target_.GetConfig().archive_update_command;
+      const auto &objects = target_.compile_object_.GetSelectedObjects();
+      const fs::path response_file = ConstructResponseFilePath(".update");
+      std::string response_file_content;
+      const std::string command = UseResponseFile(
+          pattern, ConstructCommand(pattern, internal::aggregate(objects)),
+          objects, response_file, response_file_content);
+      WriteResponseFile(response_file, response_file_content);
+      success = internal::execute_and_record(command, output_,
+                                             target_.GetContext());
+    } else {
+      if (target_.type_ == TargetType::StaticLibrary) {
+        // Archivers only add/replace members of an existing archive
+        std::error_code ec;
+        fs::remove(output_, ec);
+      }
+      WriteResponseFile(ConstructResponseFilePath(""), response_file_content_);
+      success = internal::execute_and_record(command_, output_,
+                                             target_.GetContext());
+    }
     env::assert_fatal(success, "Failed to link target");
     target_.serialization_.UpdateTargetCompiled();
   }
 }
 
+// Only the recompiled objects are replaced when every other link input is
+// unchanged and each object maps to a unique archive member
+bool LinkTarget::IsArchiveUpdatable() const {
+  const auto &target_load_schema = target_.serialization_.GetLoad();
+  const auto &target_user_schema = target_.user_;
+  if (target_.type_ != TargetType::StaticLibrary ||
+      target_.GetConfig().archive_update_command.empty() ||
+      target_.compile_object_.GetSelectedObjects().empty() ||
+      !target_load_schema.target_linked || !fs::exists(output_)) {
+    return false;
+  }
+
+  if (!(target_load_schema.link_flags == target_user_schema.link_flags) ||
+      !(target_load_schema.lib_dirs == target_user_schema.lib_dirs) ||
+      !(target_load_schema.external_libs ==
+        target_user_schema.external_libs) ||
+      !(target_load_schema.link_dependencies ==
+        target_user_schema.link_dependencies) ||
+      !(target_load_schema.libs == target_user_schema.libs) ||
+      !(target_load_schema.toolchain == target_user_schema.toolchain) ||
+      target_load_schema.link_command_hash !=
+          target_user_schema.link_command_hash) {
+    return false;
+  }
+
+  // Removed objects would remain in the archive
+  const auto current_sources =
+      target_user_schema.sources.GetUnorderedPathInfos();
+  for (const auto &path_info : target_load_schema.sources.GetPathInfos()) {
+    if (current_sources.count(path_info.path) == 0) {
+      return false;
+    }
+  }
+
+  // Archive members are matched by their file name
+  std::unordered_set<std::string> member_names;
+  for (const auto &object : target_.compile_object_.GetCompiledSources()) {
+    if (!member_names.insert(object.filename().string()).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string
+LinkTarget::ConstructCommand(const std::string &pattern,
+                             const std::string &compiled_sources) const {
+  const auto &target_user_schema = target_.user_;
+  return target_.command_.Construct(
+      pattern,
+      {
+          {kOutput, fmt::format("{}", output_)},
+          {kCompiledSources, compiled_sources},
+          {kLibDeps,
+           fmt::format("{} {}",
+                       internal::aggregate(target_user_schema.libs.GetPaths()),
+                       internal::aggregate(target_user_schema.external_libs))},
+      });
+}
+
+// Long commands pass the objects as `@response_file` to stay well below the
+// command line limit of the host (32K characters on Windows)
+std::string
+LinkTarget::UseResponseFile(const std::string &pattern,
+                            const std::string &command,
+                            const std::vector<fs::path> &objects,
+                            const fs::path &response_file,
+                            std::string &response_file_content) const {
+  response_file_content.clear();
+  const std::size_t threshold = target_.GetConfig().response_file_threshold;
+  if (threshold == 0 || command.size() <= threshold ||
+      pattern.find(kCompiledSourcesPattern) == std::string::npos) {
+    return command;
+  }
+
+  // One object per line, GCC, Clang, MSVC and ar treat `\` as an escape
+  // character so paths use forward slashes
+  for (const auto &object : objects) {
+    std::string object_str = object.lexically_normal().generic_string();
+    if (object_str.find_first_of(" \t\"\\") != std::string::npos) {
+      std::string quoted = "\"";
+      for (const char c : object_str) {
+        if (c == '"' || c == '\\') {
+          quoted += '\\';
+        }
+        quoted += c;
+      }
+      quoted += '"';
+      object_str = std::move(quoted);
+    }
+    response_file_content.append(object_str).append("\n");
+  }
+  return ConstructCommand(pattern, fmt::format("@{}", response_file));
+}
+
+fs::path LinkTarget::ConstructResponseFilePath(const char *suffix) const {
+  fs::path path = target_.GetTargetBuildDir() /
+                  fmt::format("{}{}.rsp", target_.GetName(), suffix);
+  path.make_preferred();
+  return path;
+}
+
 } // namespace buildcc::internal
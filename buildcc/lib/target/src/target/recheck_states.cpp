@@ -34,5 +34,7 @@ void Target::PathChanged() {}
 void Target::DirChanged() {}
 void Target::FlagChanged() {}
 void Target::ExternalLibChanged() {}
+void Target::CommandChanged() {}
+void Target::ToolchainChanged() {}
 
 } // namespace buildcc
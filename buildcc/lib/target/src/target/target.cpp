@@ -49,7 +49,7 @@ namespace buildcc {
 void Target::Initialize() {
   // Checks
   env::assert_fatal(
-      Project::IsInit(),
+      GetContext().IsInit(),
       "Environment is not initialized. Use the buildcc::Project::Init API");
   env::assert_fatal(IsValidTargetType(type_), "Invalid Target Type");
   fs::create_directories(GetTargetBuildDir());
@@ -57,8 +57,10 @@ void Target::Initialize() {
   // String updates
   unique_id_ = fmt::format("[{}] {}", toolchain_.GetName(), name_);
   std::string path = fmt::format(
-      "{}", GetTargetPath().lexically_relative(Project::GetBuildDir()));
+      "{}", GetTargetPath().lexically_relative(GetContext().GetBuildDir()));
   tf_.name(path);
+  compile_tf_.name(fmt::format("{} Compile", path));
+  link_tf_.name(fmt::format("{} Link", path));
 }
 
 env::optional<std::string> Target::SelectCompileFlags(FileExt ext) const {
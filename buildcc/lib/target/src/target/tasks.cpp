@@ -30,10 +30,43 @@ constexpr const char *const kStartTaskName = "Start Target";
 constexpr const char *const kEndTaskName = "End Target";
 constexpr const char *const kCheckTaskName = "Check Target";
 
+constexpr const char *const kCompileStageTaskName = "Compile Stage";
+constexpr const char *const kLinkStageTaskName = "Link Stage";
+
+constexpr const char *const kFingerprintTaskName = "Fingerprint";
 constexpr const char *const kPchTaskName = "Pch";
 constexpr const char *const kCompileTaskName = "Objects";
+constexpr const char *const kWaitObjectsTaskName = "Wait Objects";
 constexpr const char *const kLinkTaskName = "Target";
 
+buildcc::internal::TargetSchema::ToolchainInfo
+ToToolchainInfo(const buildcc::ToolchainExecutables &fingerprint) {
+  buildcc::internal::TargetSchema::ToolchainInfo info;
+  info.assembler = fingerprint.assembler;
+  info.c_compiler = fingerprint.c_compiler;
+  info.cpp_compiler = fingerprint.cpp_compiler;
+  info.archiver = fingerprint.archiver;
+  info.linker = fingerprint.linker;
+  return info;
+}
+
+// Path hashes are independent of each other, spread them across the executor
+tf::Task
+FingerprintTask(tf::Subflow &subflow,
+                const std::vector<buildcc::internal::PathHashJob> &jobs,
+                buildcc::env::FailureScope &failure_scope) {
+  return subflow
+      .for_each_index(std::size_t{0}, jobs.size(), std::size_t{1},
+                      [&jobs, &failure_scope](std::size_t i) {
+                        try {
+                          jobs[i].Run();
+                        } catch (...) {
+                          failure_scope.Fail();
+                        }
+                      })
+      .name(kFingerprintTaskName);
+}
+
 } // namespace
 
 namespace buildcc {} // namespace buildcc
@@ -45,8 +78,8 @@ namespace buildcc::internal {
 // compiles
 // 3. Successfully compiled sources are added to `compiled_pch_files_`
 void CompilePch::Task() {
-  task_ = target_.tf_.emplace([&](tf::Subflow &subflow) {
-    if (env::get_task_state() != env::TaskState::SUCCESS) {
+  task_ = target_.compile_tf_.emplace([&](tf::Subflow &subflow) {
+    if (!target_.failure_scope_.CanRun()) {
       return;
     }
 
@@ -54,13 +87,14 @@ void CompilePch::Task() {
       BuildCompile();
       target_.serialization_.UpdatePchCompiled(target_.user_);
     } catch (...) {
-      env::set_task_state(env::TaskState::FAILURE);
+      target_.failure_scope_.Fail();
     }
 
     // For Graph generation
     for (const auto &p : target_.GetPchFiles()) {
       std::string name = fmt::format(
-          "{}", fs::path(p).lexically_relative(Project::GetRootDir()));
+          "{}",
+          fs::path(p).lexically_relative(target_.GetContext().GetRootDir()));
       subflow.placeholder().name(name);
     }
   });
@@ -78,51 +112,111 @@ void CompilePch::Task() {
 // We would need to store `source_file : object_file : state` in our
 // serialization schema
 void CompileObject::Task() {
-  compile_task_ = target_.tf_.emplace([&](tf::Subflow &subflow) {
-    if (env::get_task_state() != env::TaskState::SUCCESS) {
-      return;
+  compile_task_ = target_.compile_tf_.emplace([&](tf::Subflow &subflow) {
+    {
+      std::lock_guard<std::mutex> lock(exited_compile_jobs_mutex_);
+      pending_compile_jobs_ = 1;
     }
+    if (target_.failure_scope_.CanRun()) {
+      QueueCompileJobs(subflow);
+    }
+    CompileJobsQueued();
+  });
+  compile_task_.name(kCompileTaskName);
+
+  // Without an executor the wait task stores the objects itself
+  if (target_.executor_ == nullptr) {
+    wait_task_ = target_.compile_tf_.emplace([this]() { WaitCompileJobs(); });
+  } else {
+    compile_task_.acquire(compile_jobs_semaphore_);
+    wait_task_ = target_.compile_tf_.emplace([]() {});
+    wait_task_.acquire(compile_jobs_semaphore_)
+        .release(compile_jobs_semaphore_);
+    release_tf_.emplace([]() {}).release(compile_jobs_semaphore_);
+  }
+  wait_task_.name(kWaitObjectsTaskName);
+  compile_task_.precede(wait_task_);
+}
 
-    std::vector<internal::PathInfo> selected_source_files;
-    std::vector<internal::PathInfo> selected_dummy_source_files;
+void CompileObject::QueueCompileJobs(tf::Subflow &subflow) {
+  std::vector<internal::PathInfo> selected_source_files;
+  std::vector<internal::PathInfo> selected_dummy_source_files;
 
-    try {
-      BuildObjectCompile(selected_source_files, selected_dummy_source_files);
-      for (const auto &path_info : selected_dummy_source_files) {
-        target_.serialization_.AddSource(path_info.path, path_info.hash);
-      }
+  try {
+    BuildObjectCompile(selected_source_files, selected_dummy_source_files);
+    selected_objects_.clear();
+    for (const auto &path_info : selected_source_files) {
+      selected_objects_.push_back(GetObjectData(path_info.path).output);
+    }
+    for (const auto &path_info : selected_dummy_source_files) {
+      target_.serialization_.AddSource(path_info.path, path_info.hash);
+      StoreDummyObjectInfo(path_info.path);
+    }
 
-      for (const auto &path_info : selected_source_files) {
-        std::string name = fmt::format(
-            "{}",
-            fs::path(path_info.path).lexically_relative(Project::GetRootDir()));
-        (void)subflow
-            .emplace([this, path_info]() {
-              try {
-                bool success = env::Command::Execute(
-                    GetObjectData(path_info.path).command);
-                env::assert_fatal(success, "Could not compile source");
-                target_.serialization_.AddSource(path_info.path,
-                                                 path_info.hash);
-              } catch (...) {
-                env::set_task_state(env::TaskState::FAILURE);
+    // Every task compiles the next job in scheduling order, independent of
+    // the order in which the executor runs the tasks
+    SortByEstimatedDuration(selected_source_files);
+    compile_jobs_ = selected_source_files;
+    next_compile_job_.store(0);
+    cached_compile_jobs_.assign(compile_jobs_.size(), 0);
+    // Queued compile commands on the longest chain of links start first
+    const std::uint64_t downstream_ms =
+        BuildLog::GetDuration(target_.GetContext(),
+                              path_as_string(target_.GetTargetPath()))
+            .value_or(0) +
+        target_.downstream_duration_ms_;
+    // Tasks only queue their command, job slots and memory are acquired by
+    // the dispatch thread of env::Command and objects are stored when the
+    // commands exit
+    for (const auto &path_info : compile_jobs_) {
+      std::string name = fmt::format(
+          "{}", fs::path(path_info.path)
+                    .lexically_relative(target_.GetContext().GetRootDir()));
+      subflow
+          .emplace([this, downstream_ms]() {
+            const std::size_t index = next_compile_job_.fetch_add(1);
+            const internal::PathInfo &path_info = compile_jobs_[index];
+            try {
+              ClearDepFile(path_info.path);
+              if (FetchCachedObject(path_info.path)) {
+                cached_compile_jobs_[index] = 1;
+                CompileJobExited(index, true);
+                return;
               }
-            })
-            .name(name);
-      }
+              const ObjectData &object = GetObjectData(path_info.path);
+              auto on_exit = [this, index](bool success) {
+                CompileJobExited(index, success);
+              };
+              if (object.command_line.IsEmpty()) {
+                internal::execute_and_record_async(
+                    object.command, object.output, target_.GetContext(),
+                    on_exit, downstream_ms);
+              } else if (!internal::distribute_and_record_async(
+                             object.command_line, object.output,
+                             target_.GetContext(), on_exit)) {
+                internal::execute_and_record_async(
+                    object.command_line, object.output, target_.GetContext(),
+                    on_exit, downstream_ms);
+              }
+            } catch (...) {
+              CompileJobExited(index, false);
+            }
+          })
+          .name(name);
+      std::lock_guard<std::mutex> lock(exited_compile_jobs_mutex_);
+      pending_compile_jobs_++;
+    }
 
-      // For graph generation
-      for (const auto &dummy_path_info : selected_dummy_source_files) {
-        std::string name =
-            fmt::format("{}", fs::path(dummy_path_info.path)
-                                  .lexically_relative(Project::GetRootDir()));
-        (void)subflow.placeholder().name(name);
-      }
-    } catch (...) {
-      env::set_task_state(env::TaskState::FAILURE);
+    // For graph generation
+    for (const auto &dummy_path_info : selected_dummy_source_files) {
+      std::string name = fmt::format(
+          "{}", fs::path(dummy_path_info.path)
+                    .lexically_relative(target_.GetContext().GetRootDir()));
+      (void)subflow.placeholder().name(name);
     }
-  });
-  compile_task_.name(kCompileTaskName);
+  } catch (...) {
+    target_.failure_scope_.Fail();
+  }
 }
 
 // 1. Receives object list from compile stage (not serialized)
@@ -130,15 +224,31 @@ void CompileObject::Task() {
 // the required target
 // 3. Successfully linking the target sets link state
 void LinkTarget::Task() {
-  task_ = target_.tf_.emplace([&]() {
-    if (env::get_task_state() != env::TaskState::SUCCESS) {
+  task_ = target_.link_tf_.emplace([&](tf::Subflow &subflow) {
+    if (!target_.failure_scope_.CanRun()) {
       return;
     }
     try {
-      BuildLink();
+      PreLink();
     } catch (...) {
-      env::set_task_state(env::TaskState::FAILURE);
+      target_.failure_scope_.Fail();
+      return;
     }
+
+    tf::Task fingerprint_task =
+        FingerprintTask(subflow, fingerprint_jobs_, target_.failure_scope_);
+    tf::Task link_task = subflow.emplace([&]() {
+      if (!target_.failure_scope_.CanRun()) {
+        return;
+      }
+      try {
+        BuildLink();
+      } catch (...) {
+        target_.failure_scope_.Fail();
+      }
+    });
+    link_task.name(kLinkTaskName);
+    fingerprint_task.precede(link_task);
   });
   task_.name(kLinkTaskName);
 }
@@ -147,8 +257,31 @@ void LinkTarget::Task() {
 
 namespace buildcc {
 
+// Computes the hashes of all compile stage inputs and the toolchain
+// fingerprint before the Pch and Object tasks run
+void Target::StartTask() {
+  target_start_task_ = compile_tf_.emplace([&](tf::Subflow &subflow) {
+    if (!failure_scope_.CanRun()) {
+      return;
+    }
+    try {
+      user_.toolchain = ToToolchainInfo(toolchain_.Fingerprint());
+      fingerprint_jobs_.clear();
+      if (state_.ContainsPch()) {
+        compile_pch_.PreCompile(fingerprint_jobs_);
+      }
+      compile_object_.PreObjectCompile(fingerprint_jobs_);
+    } catch (...) {
+      failure_scope_.Fail();
+      return;
+    }
+    (void)FingerprintTask(subflow, fingerprint_jobs_, failure_scope_);
+  });
+  target_start_task_.name(kStartTaskName);
+}
+
 void Target::EndTask() {
-  target_end_task_ = tf_.emplace([&]() {
+  target_end_task_ = link_tf_.emplace([&]() {
     if (dirty_) {
       try {
         serialization_.UpdateStore(user_);
@@ -156,7 +289,7 @@ void Target::EndTask() {
                           fmt::format("Store failed for {}", GetName()));
         state_.BuildCompleted();
       } catch (...) {
-        env::set_task_state(env::TaskState::FAILURE);
+        failure_scope_.Fail();
       }
     }
   });
@@ -165,10 +298,17 @@ void Target::EndTask() {
 
 void Target::TaskDeps() {
   if (state_.ContainsPch()) {
+    target_start_task_.precede(compile_pch_.GetTask());
     compile_pch_.GetTask().precede(compile_object_.GetTask());
   }
-  compile_object_.GetTask().precede(link_target_.GetTask());
+  target_start_task_.precede(compile_object_.GetTask());
   link_target_.GetTask().precede(target_end_task_);
+
+  // Link stage consumes the objects of the compile stage
+  tf::Task compile_stage =
+      tf_.composed_of(compile_tf_).name(kCompileStageTaskName);
+  tf::Task link_stage = tf_.composed_of(link_tf_).name(kLinkStageTaskName);
+  compile_stage.precede(link_stage);
 }
 
 } // namespace buildcc
@@ -3,6 +3,10 @@
 
 #include "target/friend/compile_object.h"
 
+#include "env/util.h"
+
+#include "schema/build_log.h"
+
 // NOTE, Make sure all these includes are AFTER the system and header includes
 #include "CppUTest/CommandLineTestRunner.h"
 #include "CppUTest/MemoryLeakDetectorNewMacros.h"
@@ -30,6 +34,70 @@ TEST(TargetCompileObjectTestGroup, CacheCompileCommand_Invalid) {
   CHECK_THROWS(std::exception, object.CacheCompileCommands());
 }
 
+TEST(TargetCompileObjectTestGroup, SortByEstimatedDuration) {
+  buildcc::BaseTarget target("SortByEstimatedDuration",
+                             buildcc::TargetType::Executable, gcc, "data");
+  buildcc::internal::CompileObject object(target);
+
+  const fs::path source_dir = target.GetTargetBuildDir() / "sources";
+  fs::create_directories(source_dir);
+  const fs::path small = source_dir / "small.cpp";
+  const fs::path large = source_dir / "large.cpp";
+  const fs::path missing = source_dir / "missing.cpp";
+  CHECK_TRUE(buildcc::env::save_file(small.string().c_str(),
+                                     std::string(10, ' '), false));
+  CHECK_TRUE(buildcc::env::save_file(large.string().c_str(),
+                                     std::string(1000, ' '), false));
+  object.AddObjectData(small);
+  object.AddObjectData(large);
+  object.AddObjectData(missing);
+
+  auto sources = [&]() {
+    return std::vector<buildcc::internal::PathInfo>{
+        buildcc::internal::PathInfo(small.string(), ""),
+        buildcc::internal::PathInfo(missing.string(), ""),
+        buildcc::internal::PathInfo(large.string(), ""),
+    };
+  };
+
+  // No history, largest source first
+  auto sorted = sources();
+  object.SortByEstimatedDuration(sorted);
+  CHECK_TRUE(sorted[0].path == large.string());
+  CHECK_TRUE(sorted[1].path == small.string());
+  CHECK_TRUE(sorted[2].path == missing.string());
+
+  // Recorded durations take precedence
+  using buildcc::internal::BuildLog;
+  const buildcc::BuildContext &context = target.GetContext();
+  BuildLog::Enable(context, true);
+  BuildLog::Record(context,
+                   buildcc::path_as_string(object.GetObjectData(small).output),
+                   500);
+  BuildLog::Record(context,
+                   buildcc::path_as_string(object.GetObjectData(large).output),
+                   100);
+  sorted = sources();
+  object.SortByEstimatedDuration(sorted);
+  CHECK_TRUE(sorted[0].path == small.string());
+  CHECK_TRUE(sorted[1].path == large.string());
+  CHECK_TRUE(sorted[2].path == missing.string());
+
+  // Sources without history are scaled using the recorded durations
+  // `large` took 2ms for 1000 bytes, `small` is estimated at 0.02ms
+  BuildLog::Clear(context);
+  BuildLog::Enable(context, true);
+  BuildLog::Record(context,
+                   buildcc::path_as_string(object.GetObjectData(large).output),
+                   2);
+  sorted = sources();
+  object.SortByEstimatedDuration(sorted);
+  CHECK_TRUE(sorted[0].path == large.string());
+  CHECK_TRUE(sorted[1].path == small.string());
+
+  BuildLog::Clear(context);
+}
+
 int main(int ac, char **av) {
   buildcc::Project::Init(fs::current_path(), fs::current_path() /
                                                  "intermediate" /
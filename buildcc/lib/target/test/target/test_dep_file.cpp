@@ -0,0 +1,67 @@
+#include "target/common/dep_file.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+
+// clang-format off
+TEST_GROUP(DepFileTestGroup)
+{
+};
+// clang-format on
+
+TEST(DepFileTestGroup, ParseDepFile_Empty) {
+  CHECK_TRUE(buildcc::internal::ParseDepFile("").empty());
+  CHECK_TRUE(buildcc::internal::ParseDepFile("main.o:\n").empty());
+}
+
+TEST(DepFileTestGroup, ParseDepFile_Gcc) {
+  auto deps = buildcc::internal::ParseDepFile(
+      "build/main.cpp.o: src/main.cpp include/hello.h \\\n"
+      " /usr/include/stdio.h \\\n"
+      " include/world.h\n");
+  CHECK_EQUAL(deps.size(), 4);
+  STRCMP_EQUAL(deps[0].c_str(), "src/main.cpp");
+  STRCMP_EQUAL(deps[1].c_str(), "include/hello.h");
+  STRCMP_EQUAL(deps[2].c_str(), "/usr/include/stdio.h");
+  STRCMP_EQUAL(deps[3].c_str(), "include/world.h");
+}
+
+TEST(DepFileTestGroup, ParseDepFile_Escapes) {
+  auto deps = buildcc::internal::ParseDepFile(
+      "main.o: hello\\ world.h dollar$$.h hash\\#.h \\\r\n"
+      " C:\\include\\win.h\n");
+  CHECK_EQUAL(deps.size(), 4);
+  STRCMP_EQUAL(deps[0].c_str(), "hello world.h");
+  STRCMP_EQUAL(deps[1].c_str(), "dollar$.h");
+  STRCMP_EQUAL(deps[2].c_str(), "hash#.h");
+  STRCMP_EQUAL(deps[3].c_str(), "C:\\include\\win.h");
+}
+
+TEST(DepFileTestGroup, ParseDepFile_PhonyTargets) {
+  // -MP generates phony targets for each header
+  auto deps = buildcc::internal::ParseDepFile("main.o: main.cpp a.h b.h\n"
+                                              "\n"
+                                              "a.h:\n"
+                                              "\n"
+                                              "b.h:\n");
+  CHECK_EQUAL(deps.size(), 3);
+  STRCMP_EQUAL(deps[0].c_str(), "main.cpp");
+  STRCMP_EQUAL(deps[1].c_str(), "a.h");
+  STRCMP_EQUAL(deps[2].c_str(), "b.h");
+}
+
+TEST(DepFileTestGroup, MakeDepFile_RoundTrip) {
+  const std::vector<std::string> deps = {
+      "src/main.cpp", "include/hello world.h", "dollar$.h", "hash#.h",
+      "C:\\include\\win.h"};
+  const std::string data =
+      buildcc::internal::MakeDepFile("build dir/main.o", deps);
+  CHECK_TRUE(buildcc::internal::ParseDepFile(data) == deps);
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
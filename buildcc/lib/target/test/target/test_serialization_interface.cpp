@@ -35,12 +35,12 @@ public:
   }
 
 private:
-  bool Verify(const std::string &serialized_data) override {
+  bool Verify(std::string_view serialized_data) override {
     (void)serialized_data;
     return mock().actualCall("verify").onObject(this).returnBoolValue();
   }
 
-  bool Load(const std::string &serialized_data) override {
+  bool Load(std::string_view serialized_data) override {
     (void)serialized_data;
     return mock().actualCall("load").onObject(this).returnBoolValue();
   }
@@ -21,6 +21,7 @@ TEST_GROUP(TargetTestFailureStates)
         mock().checkExpectations();
         mock().clear();
         buildcc::env::set_task_state(buildcc::env::TaskState::SUCCESS);
+        buildcc::env::set_failure_mode(buildcc::env::FailureMode::Stop);
     }
 };
 // clang-format on
@@ -122,6 +123,63 @@ TEST(TargetTestFailureStates, EndTaskStoreFailure) {
   CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::FAILURE);
 }
 
+TEST(TargetTestFailureStates, KeepGoing) {
+  buildcc::env::set_failure_mode(buildcc::env::FailureMode::KeepGoing);
+
+  buildcc::BaseTarget failed("KeepGoing_Failed.a",
+                             buildcc::TargetType::StaticLibrary, gcc, "data");
+  failed.AddSource("dummy_main.cpp");
+  failed.Build();
+
+  buildcc::BaseTarget independent("KeepGoing_Independent.exe",
+                                  buildcc::TargetType::Executable, gcc,
+                                  "data");
+  independent.AddSource("dummy_main.cpp");
+  independent.Build();
+
+  buildcc::BaseTarget downstream(
+      "KeepGoing_Downstream.exe", buildcc::TargetType::Executable, gcc, "data");
+  downstream.AddSource("dummy_main.cpp");
+  downstream.AddFailureDependency(failed);
+  downstream.Build();
+
+  buildcc::env::m::CommandExpect_Execute(1, false); // compile
+  buildcc::m::TargetRunner(failed);
+  CHECK_TRUE(failed.GetFailureScope().IsFailed());
+
+  // Targets that do not depend on the failed target are built
+  buildcc::env::m::CommandExpect_Execute(1, true); // compile
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  buildcc::m::TargetRunner(independent);
+  CHECK_FALSE(independent.GetFailureScope().IsFailed());
+
+  // Downstream targets are skipped
+  buildcc::m::TargetRunner(downstream);
+  CHECK_TRUE(downstream.GetFailureScope().IsFailed());
+
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::FAILURE);
+}
+
+TEST(TargetTestFailureStates, Stop_SkipsOtherTargets) {
+  buildcc::BaseTarget failed("Stop_Failed.exe", buildcc::TargetType::Executable,
+                             gcc, "data");
+  failed.AddSource("dummy_main.cpp");
+  failed.Build();
+
+  buildcc::BaseTarget independent(
+      "Stop_Independent.exe", buildcc::TargetType::Executable, gcc, "data");
+  independent.AddSource("dummy_main.cpp");
+  independent.Build();
+
+  buildcc::env::m::CommandExpect_Execute(1, false); // compile
+  buildcc::m::TargetRunner(failed);
+  buildcc::m::TargetRunner(independent);
+
+  CHECK_TRUE(failed.GetFailureScope().IsFailed());
+  CHECK_FALSE(independent.GetFailureScope().IsFailed());
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::FAILURE);
+}
+
 // TODO, Test failure rebuilds!
 // Every failure state during rebuild should re-run!
 
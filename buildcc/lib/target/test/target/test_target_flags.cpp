@@ -567,7 +567,7 @@ TEST(TargetTestCppCompileFlagsGroup, Target_ChangedCompileFlag) {
     buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
                                "data");
     simple.AddSource(DUMMY_MAIN);
-    simple.AddCCompileFlag("-std=c++17");
+    simple.AddCppCompileFlag("-std=c++17");
 
     buildcc::env::m::CommandExpect_Execute(1, true);
     buildcc::env::m::CommandExpect_Execute(1, true);
@@ -593,7 +593,72 @@ TEST(TargetTestCppCompileFlagsGroup, Target_ChangedCompileFlag) {
     buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
                                "data");
     simple.AddSource(DUMMY_MAIN);
-    simple.AddCCompileFlag("-std=c++17");
+    simple.AddCppCompileFlag("-std=c++17");
+    buildcc::m::TargetExpect_FlagChanged(1, &simple);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  mock().checkExpectations();
+}
+
+// ------------- LANGUAGE SCOPED FLAGS ---------------
+
+// clang-format off
+TEST_GROUP(TargetTestLanguageScopedFlagsGroup)
+{
+    void teardown() {
+      mock().clear();
+    }
+};
+// clang-format on
+
+static const fs::path target_language_scoped_intermediate_path =
+    fs::path(BUILD_TARGET_FLAG_INTERMEDIATE_DIR) / gcc.GetName();
+
+TEST(TargetTestLanguageScopedFlagsGroup, Target_ChangedLanguageFlag) {
+  constexpr const char *const NAME = "ChangedLanguageFlag.exe";
+  constexpr const char *const EMPTY_ASM = "asm/empty_asm.s";
+  constexpr const char *const DUMMY_MAIN_C = "dummy_main.c";
+  constexpr const char *const DUMMY_MAIN_CPP = "dummy_main.cpp";
+
+  auto intermediate_path = target_language_scoped_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  auto setup = [&](buildcc::BaseTarget &simple) {
+    simple.AddSource(EMPTY_ASM);
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+  };
+
+  {
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data");
+    setup(simple);
+    simple.AddAsmCompileFlag("-g");
+    simple.AddCCompileFlag("-std=c11");
+    simple.AddCppCompileFlag("-std=c++17");
+
+    buildcc::env::m::CommandExpect_Execute(3, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  {
+    // * Asm flag changed, only the assembly object is recompiled
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data");
+    setup(simple);
+    simple.AddCCompileFlag("-std=c11");
+    simple.AddCppCompileFlag("-std=c++17");
+
     buildcc::m::TargetExpect_FlagChanged(1, &simple);
     buildcc::env::m::CommandExpect_Execute(1, true);
     buildcc::env::m::CommandExpect_Execute(1, true);
@@ -602,6 +667,40 @@ TEST(TargetTestCppCompileFlagsGroup, Target_ChangedCompileFlag) {
     CHECK_TRUE(simple.IsBuilt());
   }
 
+  {
+    // * C and Cpp flags changed, the assembly object is not recompiled
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data");
+    setup(simple);
+    simple.AddCCompileFlag("-std=c99");
+    simple.AddCppCompileFlag("-std=c++20");
+
+    buildcc::m::TargetExpect_FlagChanged(1, &simple);
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  {
+    // * Cpp flag changed with InvalidationMode::Target
+    buildcc::TargetConfig config;
+    config.invalidation_mode = buildcc::InvalidationMode::Target;
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data", config);
+    setup(simple);
+    simple.AddCCompileFlag("-std=c99");
+    simple.AddCppCompileFlag("-std=c++17");
+
+    buildcc::m::TargetExpect_FlagChanged(1, &simple);
+    buildcc::env::m::CommandExpect_Execute(3, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
   mock().checkExpectations();
 }
 
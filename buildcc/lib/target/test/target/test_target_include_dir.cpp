@@ -334,6 +334,116 @@ TEST(TargetTestIncludeDirGroup, TargetBuildHeaderFile) {
   mock().checkExpectations();
 }
 
+TEST(TargetTestIncludeDirGroup, TargetBuildHeaderFile_InvalidationMode) {
+  constexpr const char *const NAME = "HeaderInvalidation.exe";
+
+  constexpr const char *const DUMMY_MAIN_C = "dummy_main.c";
+  constexpr const char *const RELATIVE_HEADER_FILE = "include/include_header.h";
+  constexpr const char *const RELATIVE_INCLUDE_DIR = "include";
+  constexpr const char *const INCLUDE_HEADER_SOURCE = "include_header.cpp";
+
+  auto source_path = fs::path(BUILD_SCRIPT_SOURCE) / "data";
+  auto intermediate_path = target_include_dir_intermediate_path / NAME;
+  const fs::path absolute_header_path = source_path / RELATIVE_HEADER_FILE;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  auto dummy_c_file = buildcc::internal::PathInfo::ToPathString(
+      fs::path(source_path / DUMMY_MAIN_C).string());
+  auto include_header_file = buildcc::internal::PathInfo::ToPathString(
+      fs::path(source_path / INCLUDE_HEADER_SOURCE).string());
+  auto header_file = buildcc::internal::PathInfo::ToPathString(
+      absolute_header_path.string());
+
+  // Simulates the compiler reporting headers through `{dep_file}`
+  auto store_object_headers = [&]() {
+    buildcc::internal::TargetSerialization serialization(
+        intermediate_path / (std::string(NAME) + ".bin"));
+    CHECK_TRUE(serialization.LoadFromFile());
+    const auto schema = serialization.GetLoad();
+    for (const auto &source : schema.sources.GetPathInfos()) {
+      serialization.AddSource(source.path, source.hash);
+    }
+
+    // Command digests are retained from the build
+    auto include_header_info = schema.objects.at(include_header_file);
+    include_header_info.headers_tracked = true;
+    include_header_info.headers = buildcc::internal::PathInfoList();
+    include_header_info.headers.Emplace(
+        header_file, buildcc::internal::PathInfoList::ComputeHash(header_file));
+    serialization.AddObjectInfo(include_header_file, include_header_info);
+    auto dummy_c_info = schema.objects.at(dummy_c_file);
+    dummy_c_info.headers_tracked = true;
+    serialization.AddObjectInfo(dummy_c_file, dummy_c_info);
+
+    serialization.UpdateTargetCompiled();
+    serialization.UpdateStore(schema);
+    CHECK_TRUE(serialization.StoreToFile());
+  };
+
+  // Initial build
+  {
+    buildcc::BaseTarget target(NAME, buildcc::TargetType::Executable, gcc,
+                               "data");
+    target.AddSource(DUMMY_MAIN_C);
+    target.AddSource(INCLUDE_HEADER_SOURCE);
+    target.AddHeader(RELATIVE_HEADER_FILE);
+    target.AddIncludeDir(RELATIVE_INCLUDE_DIR);
+
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    target.Build();
+    buildcc::m::TargetRunner(target);
+  }
+
+  // Update header, only the object that includes it is recompiled
+  {
+    store_object_headers();
+    buildcc::env::save_file(absolute_header_path.string().c_str(),
+                            std::string{""}, false);
+
+    buildcc::BaseTarget target(NAME, buildcc::TargetType::Executable, gcc,
+                               "data");
+    target.AddSource(DUMMY_MAIN_C);
+    target.AddSource(INCLUDE_HEADER_SOURCE);
+    target.AddHeader(RELATIVE_HEADER_FILE);
+    target.AddIncludeDir(RELATIVE_INCLUDE_DIR);
+
+    // Header list changed + object header updated
+    buildcc::m::TargetExpect_PathChanged(1, &target);
+    buildcc::m::TargetExpect_PathUpdated(1, &target);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    target.Build();
+    buildcc::m::TargetRunner(target);
+  }
+
+  // Update header, InvalidationMode::Target recompiles every object
+  {
+    store_object_headers();
+    buildcc::env::save_file(absolute_header_path.string().c_str(),
+                            std::string{""}, false);
+
+    buildcc::TargetConfig config;
+    config.invalidation_mode = buildcc::InvalidationMode::Target;
+    buildcc::BaseTarget target(NAME, buildcc::TargetType::Executable, gcc,
+                               "data", config);
+    target.AddSource(DUMMY_MAIN_C);
+    target.AddSource(INCLUDE_HEADER_SOURCE);
+    target.AddHeader(RELATIVE_HEADER_FILE);
+    target.AddIncludeDir(RELATIVE_INCLUDE_DIR);
+
+    buildcc::m::TargetExpect_PathUpdated(1, &target);
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    target.Build();
+    buildcc::m::TargetRunner(target);
+  }
+
+  mock().checkExpectations();
+}
+
 int main(int ac, char **av) {
   buildcc::Project::Init(BUILD_SCRIPT_SOURCE,
                          BUILD_TARGET_INCLUDE_DIR_INTERMEDIATE_DIR);
@@ -1,12 +1,23 @@
+#include <algorithm>
+
 #include "constants.h"
 
 #include "expect_command.h"
 #include "expect_target.h"
+#include "mock_command_copier.h"
 #include "test_target_util.h"
 
 #include "target/target.h"
 
+#include "target/friend/compile_object.h"
+
+#include "schema/build_log.h"
+#include "schema/dist_compile.h"
+#include "schema/object_cache.h"
+#include "schema/remote_cache.h"
+
 #include "env/env.h"
+#include "env/process_reaper.h"
 #include "env/util.h"
 
 // Third Party
@@ -119,6 +130,35 @@ TEST(TargetTestSourceGroup, Target_Build_SourceCompile) {
   CHECK_FALSE(loaded_sources.find(dummy_file) == loaded_sources.end());
 }
 
+TEST(TargetTestSourceGroup, Target_Build_Executor) {
+  constexpr const char *const NAME = "Executor.exe";
+
+  auto intermediate_path = target_source_intermediate_path / NAME;
+  fs::remove_all(intermediate_path);
+
+  // Objects are stored on the executor, its only worker is never held while
+  // the compile stage waits for them
+  tf::Executor executor(1);
+  buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                             "data");
+  simple.SetExecutor(executor);
+  simple.AddSource("dummy_main.cpp");
+  simple.AddSource("new_source.cpp");
+  simple.Build();
+
+  buildcc::env::m::CommandExpect_Execute(2, true); // compile
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  executor.run(simple.GetTaskflow()).wait();
+
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::SUCCESS);
+  mock().checkExpectations();
+
+  buildcc::internal::TargetSerialization serialization(simple.GetBinaryPath());
+  CHECK_TRUE(serialization.LoadFromFile());
+  CHECK_EQUAL(serialization.GetLoad().sources.GetPathInfos().size(), 2);
+  CHECK_EQUAL(serialization.GetLoad().objects.size(), 2);
+}
+
 TEST(TargetTestSourceGroup, Target_Build_SourceRecompile) {
   constexpr const char *const NAME = "Recompile.exe";
   constexpr const char *const DUMMY_MAIN_CPP = "dummy_main.cpp";
@@ -231,6 +271,541 @@ TEST(TargetTestSourceGroup, Target_Build_SourceRecompile) {
   mock().checkExpectations();
 }
 
+TEST(TargetTestSourceGroup, Target_Build_CommandChanged) {
+  constexpr const char *const NAME = "CommandChanged.exe";
+  constexpr const char *const DUMMY_MAIN_C = "dummy_main.c";
+  constexpr const char *const DUMMY_MAIN_CPP = "dummy_main.cpp";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  buildcc::TargetConfig config;
+  {
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data", config);
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  {
+    // * Compile command template changed, every object is recompiled
+    config.compile_command += " -DCOMMAND_CHANGED";
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data", config);
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    buildcc::m::TargetExpect_CommandChanged(2, &simple);
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  {
+    // * Compiler changed, only C objects are recompiled
+    buildcc::Toolchain other_gcc(buildcc::ToolchainId::Gcc, "gcc",
+                                 buildcc::ToolchainExecutables(
+                                     "as", "buildcc_gcc", "g++", "ar", "ld"));
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable,
+                               other_gcc, "data", config);
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    // Link is already dirty after the C object is recompiled
+    buildcc::m::TargetExpect_ToolchainChanged(1, &simple);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  {
+    // * Link command template changed, objects are not recompiled
+    buildcc::Toolchain other_gcc(buildcc::ToolchainId::Gcc, "gcc",
+                                 buildcc::ToolchainExecutables(
+                                     "as", "buildcc_gcc", "g++", "ar", "ld"));
+    config.link_command += " -DCOMMAND_CHANGED";
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable,
+                               other_gcc, "data", config);
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    buildcc::m::TargetExpect_CommandChanged(1, &simple);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  mock().checkExpectations();
+}
+
+TEST(TargetTestSourceGroup, Target_Build_ToolchainChanged) {
+  constexpr const char *const NAME = "ToolchainChanged.exe";
+  constexpr const char *const DUMMY_MAIN_C = "dummy_main.c";
+  constexpr const char *const DUMMY_MAIN_CPP = "dummy_main.cpp";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  // Toolchain executables at the same path are updated in place
+  const fs::path toolchain_path = intermediate_path.parent_path() /
+                                  fmt::format("{}.toolchain", NAME);
+  fs::create_directories(toolchain_path);
+  const fs::path c_compiler = toolchain_path / "gcc";
+  CHECK_TRUE(buildcc::env::save_file(c_compiler.string().c_str(),
+                                     std::string("gcc"), false));
+  buildcc::Toolchain local_gcc(
+      buildcc::ToolchainId::Gcc, "gcc",
+      buildcc::ToolchainExecutables("as", c_compiler.string(), "g++", "ar",
+                                    "ld"));
+
+  {
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable,
+                               local_gcc, "data");
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  {
+    // * Toolchain unchanged
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable,
+                               local_gcc, "data");
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_FALSE(simple.IsBuilt());
+  }
+
+  {
+    // * C compiler updated, only C objects are recompiled
+    CHECK_TRUE(buildcc::env::save_file(c_compiler.string().c_str(),
+                                       std::string("gcc-updated"), false));
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable,
+                               local_gcc, "data");
+    simple.AddSource(DUMMY_MAIN_C);
+    simple.AddSource(DUMMY_MAIN_CPP);
+
+    // Link is already dirty after the C object is recompiled
+    buildcc::m::TargetExpect_ToolchainChanged(1, &simple);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    simple.Build();
+    buildcc::m::TargetRunner(simple);
+    CHECK_TRUE(simple.IsBuilt());
+  }
+
+  mock().checkExpectations();
+}
+
+TEST(TargetTestSourceGroup, Target_Build_RecordDurations) {
+  constexpr const char *const NAME = "RecordDurations.exe";
+  constexpr const char *const DUMMY_MAIN = "dummy_main.cpp";
+  constexpr const char *const NEW_SOURCE = "new_source.cpp";
+
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                             "data");
+  using buildcc::internal::BuildLog;
+  BuildLog::Clear(simple.GetContext());
+  BuildLog::Enable(simple.GetContext(), true);
+  simple.AddSource(DUMMY_MAIN);
+  simple.AddSource(NEW_SOURCE);
+  simple.Build();
+
+  buildcc::env::m::CommandExpect_Execute(2, true); // compile
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  buildcc::m::TargetRunner(simple);
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::SUCCESS);
+  mock().checkExpectations();
+
+  // Every object and the target output are recorded
+  buildcc::internal::CompileObject objects(simple);
+  for (const auto *source : {DUMMY_MAIN, NEW_SOURCE}) {
+    const fs::path absolute_source = simple.GetTargetRootDir() / source;
+    objects.AddObjectData(absolute_source);
+    CHECK_TRUE(BuildLog::GetDuration(
+                   simple.GetContext(),
+                   buildcc::path_as_string(
+                       objects.GetObjectData(absolute_source).output))
+                   .has_value());
+  }
+  CHECK_TRUE(BuildLog::GetDuration(simple.GetContext(),
+                                   buildcc::path_as_string(
+                                       simple.GetTargetPath()))
+                 .has_value());
+
+  BuildLog::Clear(simple.GetContext());
+}
+
+TEST(TargetTestSourceGroup, Target_Build_RecordDurations_SeparateContexts) {
+  constexpr const char *const NAME = "RecordContexts.exe";
+  constexpr const char *const DUMMY_MAIN = "dummy_main.cpp";
+
+  const fs::path build_dir = target_source_intermediate_path / NAME;
+  fs::remove_all(build_dir);
+  buildcc::BuildContext first(BUILD_SCRIPT_SOURCE, build_dir / "first");
+  buildcc::BuildContext second(BUILD_SCRIPT_SOURCE, build_dir / "second");
+
+  using buildcc::internal::BuildLog;
+  BuildLog::Enable(first, true);
+  BuildLog::Enable(second, true);
+
+  buildcc::BaseTarget first_target(NAME, buildcc::TargetType::Executable, gcc,
+                                   buildcc::TargetEnv(first, "data"));
+  buildcc::BaseTarget second_target(NAME, buildcc::TargetType::Executable,
+                                    gcc, buildcc::TargetEnv(second, "data"));
+  for (auto *target : {&first_target, &second_target}) {
+    target->AddSource(DUMMY_MAIN);
+    target->Build();
+    buildcc::env::m::CommandExpect_Execute(1, true); // compile
+    buildcc::env::m::CommandExpect_Execute(1, true); // link
+    buildcc::m::TargetRunner(*target);
+    CHECK(target->GetContext().GetTaskState() ==
+          buildcc::env::TaskState::SUCCESS);
+  }
+  mock().checkExpectations();
+
+  // Every build records into the log of its own context
+  const std::string first_output =
+      buildcc::path_as_string(first_target.GetTargetPath());
+  const std::string second_output =
+      buildcc::path_as_string(second_target.GetTargetPath());
+  CHECK_TRUE(BuildLog::GetDuration(first, first_output).has_value());
+  CHECK_FALSE(BuildLog::GetDuration(first, second_output).has_value());
+  CHECK_TRUE(BuildLog::GetDuration(second, second_output).has_value());
+  CHECK_FALSE(BuildLog::GetDuration(second, first_output).has_value());
+
+  // Only the entries of the context are stored in its build dir
+  const fs::path second_log = second.GetBuildDir() / "buildcc_log.bin";
+  CHECK_TRUE(BuildLog::StoreToFile(second, second_log));
+  BuildLog::Clear(second);
+  CHECK_TRUE(BuildLog::LoadFromFile(second, second_log));
+  CHECK_TRUE(BuildLog::GetDuration(second, second_output).has_value());
+  CHECK_FALSE(BuildLog::GetDuration(second, first_output).has_value());
+
+  BuildLog::Clear(first);
+  BuildLog::Clear(second);
+}
+
+TEST(TargetTestSourceGroup, Target_Build_ArchiveUpdate) {
+  constexpr const char *const NAME = "ArchiveUpdate.a";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  const fs::path source_path = intermediate_path.parent_path() /
+                               fmt::format("{}.sources", NAME);
+  fs::remove_all(source_path);
+  fs::create_directories(source_path / "dup");
+  const fs::path first = source_path / "first.cpp";
+  const fs::path second = source_path / "second.cpp";
+  const fs::path duplicate = source_path / "dup" / "first.cpp";
+  CHECK_TRUE(buildcc::env::save_file(first.string().c_str(),
+                                     std::string("int first;"), false));
+  CHECK_TRUE(buildcc::env::save_file(second.string().c_str(),
+                                     std::string("int second;"), false));
+  CHECK_TRUE(buildcc::env::save_file(duplicate.string().c_str(),
+                                     std::string("int dup;"), false));
+
+  buildcc::TargetConfig config;
+  config.archive_update_command = "{archiver} rcs {output} {compiled_sources}";
+  // Simulates the archiver
+  auto create_archive = [](const buildcc::BaseTarget &target) {
+    CHECK_TRUE(buildcc::env::save_file(
+        target.GetTargetPath().string().c_str(), std::string("!<arch>"),
+        false));
+  };
+
+  {
+    buildcc::BaseTarget archive(NAME, buildcc::TargetType::StaticLibrary, gcc,
+                                "data", config);
+    archive.AddSourceAbsolute(first);
+    archive.AddSourceAbsolute(second);
+
+    buildcc::env::m::CommandExpect_Execute(2, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    archive.Build();
+    buildcc::m::TargetRunner(archive);
+    CHECK_TRUE(archive.IsBuilt());
+    create_archive(archive);
+  }
+
+  {
+    // * Updated object is replaced in the existing archive
+    CHECK_TRUE(buildcc::env::save_file(first.string().c_str(),
+                                       std::string("int first = 1;"), false));
+    buildcc::BaseTarget archive(NAME, buildcc::TargetType::StaticLibrary, gcc,
+                                "data", config);
+    archive.AddSourceAbsolute(first);
+    archive.AddSourceAbsolute(second);
+
+    buildcc::m::TargetExpect_SourceUpdated(1, &archive);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    archive.Build();
+    buildcc::m::TargetRunner(archive);
+    CHECK_TRUE(archive.IsBuilt());
+    CHECK_TRUE(fs::exists(archive.GetTargetPath()));
+  }
+
+  {
+    // * Removed object, archive is recreated
+    CHECK_TRUE(buildcc::env::save_file(first.string().c_str(),
+                                       std::string("int first = 2;"), false));
+    buildcc::BaseTarget archive(NAME, buildcc::TargetType::StaticLibrary, gcc,
+                                "data", config);
+    archive.AddSourceAbsolute(first);
+
+    buildcc::m::TargetExpect_SourceUpdated(1, &archive);
+    buildcc::m::TargetExpect_SourceRemoved(1, &archive);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    archive.Build();
+    buildcc::m::TargetRunner(archive);
+    CHECK_TRUE(archive.IsBuilt());
+    CHECK_FALSE(fs::exists(archive.GetTargetPath()));
+    create_archive(archive);
+  }
+
+  {
+    // * Objects with the same file name, archive is recreated
+    buildcc::BaseTarget archive(NAME, buildcc::TargetType::StaticLibrary, gcc,
+                                "data", config);
+    archive.AddSourceAbsolute(first);
+    archive.AddSourceAbsolute(duplicate);
+
+    buildcc::m::TargetExpect_SourceAdded(1, &archive);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    archive.Build();
+    buildcc::m::TargetRunner(archive);
+    CHECK_TRUE(archive.IsBuilt());
+    CHECK_FALSE(fs::exists(archive.GetTargetPath()));
+  }
+
+  mock().checkExpectations();
+}
+
+TEST(TargetTestSourceGroup, Target_Build_ResponseFile) {
+  constexpr const char *const NAME = "ResponseFile.exe";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  buildcc::TargetConfig config;
+  config.response_file_threshold = 1;
+  buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                             "data", config);
+  simple.AddSource("dummy_main.c");
+  simple.AddSource("dummy_main.cpp");
+  simple.Build();
+
+  const fs::path response_file = intermediate_path / "ResponseFile.exe.rsp";
+  CHECK_TRUE(simple.GetLinkCommand().find(
+                 fmt::format("@{}", response_file)) != std::string::npos);
+  CHECK_TRUE(simple.GetLinkCommand().find("dummy_main.cpp.o") ==
+             std::string::npos);
+
+  buildcc::env::m::CommandExpect_Execute(2, true); // compile
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  buildcc::m::TargetRunner(simple);
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::SUCCESS);
+  mock().checkExpectations();
+
+  // Every object on its own line
+  std::string content;
+  CHECK_TRUE(buildcc::env::load_file(response_file.string().c_str(), false,
+                                     &content));
+  CHECK_EQUAL(std::count(content.begin(), content.end(), '\n'), 2);
+  CHECK_TRUE(content.find("dummy_main.c.o\n") != std::string::npos);
+  CHECK_TRUE(content.find("dummy_main.cpp.o\n") != std::string::npos);
+  CHECK_TRUE(content.find('\\') == std::string::npos);
+
+  // Disabled
+  fs::remove_all(intermediate_path);
+  config.response_file_threshold = 0;
+  buildcc::BaseTarget disabled(NAME, buildcc::TargetType::Executable, gcc,
+                               "data", config);
+  disabled.AddSource("dummy_main.cpp");
+  disabled.Build();
+  CHECK_TRUE(disabled.GetLinkCommand().find('@') == std::string::npos);
+}
+
+TEST(TargetTestSourceGroup, Target_Build_ObjectCache) {
+  constexpr const char *const NAME = "ObjectCache.exe";
+  constexpr const char *const DUMMY_MAIN = "dummy_main.cpp";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+  const fs::path cache_dir = intermediate_path / "object_cache";
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  using buildcc::internal::ObjectCache;
+  ObjectCache::Init(cache_dir, 0, buildcc::ObjectCacheLink::Copy);
+
+  buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                             "data");
+  simple.AddSource(DUMMY_MAIN);
+  simple.Build();
+
+  // Object compiled by a previous build
+  const fs::path source = simple.GetTargetRootDir() / DUMMY_MAIN;
+  buildcc::internal::CompileObject compile_object(simple);
+  compile_object.AddObjectData(source);
+  compile_object.CacheCompileCommands();
+  const auto &object_data = compile_object.GetObjectData(source);
+  CHECK_FALSE(object_data.cache_key.empty());
+  const fs::path cached_object = intermediate_path / "cached.o";
+  CHECK_TRUE(buildcc::env::save_file(cached_object.string().c_str(),
+                                     "cached object", true));
+  CHECK_TRUE(ObjectCache::Store(object_data.cache_key, cached_object,
+                                {buildcc::path_as_string(source)}));
+
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  buildcc::m::TargetRunner(simple);
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::SUCCESS);
+  mock().checkExpectations();
+
+  std::string data;
+  CHECK_TRUE(buildcc::env::load_file(
+      object_data.output.string().c_str(), true, &data));
+  STRCMP_EQUAL(data.c_str(), "cached object");
+  CHECK_EQUAL(ObjectCache::GetStats().hits, 1);
+
+  // Dependency file constructed from the inputs of the cached object
+  buildcc::internal::TargetSerialization serialization(simple.GetBinaryPath());
+  CHECK_TRUE(serialization.LoadFromFile());
+  const auto &objects = serialization.GetLoad().objects;
+  const auto iter = objects.find(buildcc::path_as_string(source));
+  CHECK_TRUE(iter != objects.end());
+  CHECK_TRUE(iter->second.headers_tracked);
+
+  ObjectCache::Deinit();
+}
+
+TEST(TargetTestSourceGroup, Target_Build_RemoteCache) {
+  constexpr const char *const NAME = "RemoteCache.exe";
+  constexpr const char *const DUMMY_MAIN = "dummy_main.cpp";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+  const fs::path cache_dir = intermediate_path / "object_cache";
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  using buildcc::internal::ObjectCache;
+  using buildcc::internal::RemoteCache;
+  buildcc::internal::RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(RemoteCache::Init(server.GetUrl()));
+  ObjectCache::Init(cache_dir, 0, buildcc::ObjectCacheLink::Copy);
+
+  buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                             "data");
+  simple.AddSource(DUMMY_MAIN);
+  simple.Build();
+
+  // Object uploaded by another machine
+  const fs::path source = simple.GetTargetRootDir() / DUMMY_MAIN;
+  buildcc::internal::CompileObject compile_object(simple);
+  compile_object.AddObjectData(source);
+  compile_object.CacheCompileCommands();
+  const auto &object_data = compile_object.GetObjectData(source);
+  CHECK_FALSE(object_data.cache_key.empty());
+  const fs::path cached_object = intermediate_path / "cached.o";
+  CHECK_TRUE(buildcc::env::save_file(cached_object.string().c_str(),
+                                     "remote object", true));
+  CHECK_TRUE(RemoteCache::Store(object_data.cache_key, cached_object,
+                                {buildcc::path_as_string(source)}));
+  RemoteCache::Flush();
+
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  buildcc::m::TargetRunner(simple);
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::SUCCESS);
+  mock().checkExpectations();
+
+  std::string data;
+  CHECK_TRUE(buildcc::env::load_file(
+      object_data.output.string().c_str(), true, &data));
+  STRCMP_EQUAL(data.c_str(), "remote object");
+  CHECK_EQUAL(RemoteCache::GetStats().hits, 1);
+  // Stored in the local cache for later builds
+  CHECK_EQUAL(ObjectCache::GetStats().misses, 1);
+  CHECK_EQUAL(ObjectCache::GetStats().stores, 1);
+
+  ObjectCache::Deinit();
+  RemoteCache::Deinit();
+}
+
+TEST(TargetTestSourceGroup, Target_Build_DistCompile) {
+  constexpr const char *const NAME = "DistCompile.exe";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+
+  using buildcc::internal::DistCompile;
+  CHECK_TRUE(buildcc::env::ProcessReaper::Init(1));
+  buildcc::internal::DistCompileWorker worker(1, {"gcc"},
+                                              intermediate_path / "worker");
+  CHECK_TRUE(worker.Start(0));
+  CHECK_TRUE(
+      DistCompile::Init({fmt::format("127.0.0.1:{}", worker.GetPort())}));
+
+  buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                             "data");
+  simple.AddSource("dummy_main.c");
+  simple.Build();
+
+  // Preprocessing is mocked, the worker runs the compiler
+  std::vector<std::string> preprocessed = {"int main() { return 0; }\n"};
+  buildcc::env::m::CommandExpect_Execute(1, true, &preprocessed);
+  buildcc::env::m::CommandExpect_Execute(1, true); // link
+  buildcc::m::TargetRunner(simple);
+  CHECK(buildcc::env::get_task_state() == buildcc::env::TaskState::SUCCESS);
+  mock().checkExpectations();
+
+  CHECK_EQUAL(DistCompile::GetStats().remote, 1);
+  CHECK_EQUAL(worker.GetCompiles(), 1);
+  const fs::path source = simple.GetTargetRootDir() / "dummy_main.c";
+  buildcc::internal::CompileObject compile_object(simple);
+  compile_object.AddObjectData(source);
+  const auto &object_data = compile_object.GetObjectData(source);
+  std::string object;
+  CHECK_TRUE(buildcc::env::load_file(object_data.output.string().c_str(), true,
+                                     &object));
+  CHECK_TRUE(object.substr(0, 4) == "\x7f"
+                                    "ELF");
+
+  DistCompile::Deinit();
+  buildcc::env::ProcessReaper::Deinit();
+}
+
 TEST(TargetTestSourceGroup, Target_CompileCommand_Throws) {
   constexpr const char *const NAME = "CompileCommand_Throws.exe";
   auto intermediate_path = target_source_intermediate_path / NAME;
@@ -252,7 +827,53 @@ TEST(TargetTestSourceGroup, Target_CompileCommand_Throws) {
   }
 }
 
+TEST(TargetTestSourceGroup, Target_CompileCommandLine) {
+  constexpr const char *const NAME = "CompileCommandLine.exe";
+  auto intermediate_path = target_source_intermediate_path / NAME;
+
+  // Delete
+  fs::remove_all(intermediate_path);
+  {
+    buildcc::BaseTarget simple(NAME, buildcc::TargetType::Executable, gcc,
+                               "data");
+    simple.AddSource("dummy_main.c");
+    simple.AddCCompileFlag("-DNAME='\"a b\"'");
+    simple.Build();
+
+    auto p = simple.GetTargetRootDir() / "dummy_main.c";
+    p.make_preferred();
+
+    const auto &arguments = simple.GetCompileCommandLine(p).GetArguments();
+    CHECK_FALSE(arguments.empty());
+    STRCMP_EQUAL(arguments.front().c_str(), "gcc");
+    STRCMP_EQUAL(arguments.back().c_str(),
+                 buildcc::path_as_string(p).c_str());
+    CHECK_TRUE(std::find(arguments.begin(), arguments.end(),
+                         "-DNAME=\"a b\"") != arguments.end());
+    // The shell splits the command into the same arguments
+    CHECK_TRUE(buildcc::env::CommandLine::Split(simple.GetCompileCommand(p)) ==
+               arguments);
+  }
+
+  // Shell syntax, only the command is available
+  {
+    buildcc::BaseTarget simple("CompileCommandLine_Shell.exe",
+                               buildcc::TargetType::Executable, gcc, "data");
+    simple.AddSource("dummy_main.c");
+    simple.AddCCompileFlag("$(pkg-config --cflags zlib)");
+    simple.Build();
+
+    auto p = simple.GetTargetRootDir() / "dummy_main.c";
+    p.make_preferred();
+
+    CHECK_TRUE(simple.GetCompileCommandLine(p).IsEmpty());
+    CHECK_FALSE(simple.GetCompileCommand(p).empty());
+  }
+}
+
 int main(int ac, char **av) {
+  buildcc::env::m::VectorStringCopier copier;
+  mock().installCopier(TEST_VECTOR_STRING_TYPE, copier);
   buildcc::Project::Init(BUILD_SCRIPT_SOURCE,
                          BUILD_TARGET_SOURCE_INTERMEDIATE_DIR);
   return CommandLineTestRunner::RunAllTests(ac, av);
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TOOLCHAIN_TOOLCHAIN_FINGERPRINT_H_
+#define TOOLCHAIN_TOOLCHAIN_FINGERPRINT_H_
+
+#include <filesystem>
+#include <string>
+
+#include "toolchain/common/toolchain_executables.h"
+
+namespace fs = std::filesystem;
+
+namespace buildcc {
+
+template <typename T> class ToolchainFingerprint {
+public:
+  /**
+   * @brief Fingerprint the toolchain executables
+   * Executables without a directory are resolved through ENV{PATH}
+   * Each fingerprint is `resolved_path:size:last_write_time` of the executable
+   * and is suffixed with the compiler version and target architecture when
+   * the toolchain was verified (see `ToolchainVerify::Verify`)
+   * Executables that cannot be resolved are fingerprinted by their name
+   *
+   * @return ToolchainExecutables Fingerprint of every toolchain executable
+   */
+  ToolchainExecutables Fingerprint() const;
+
+  /**
+   * @brief Memoizes the fingerprint of every executable while enabled, the
+   * executables and ENV{PATH} must not change until the cache is cleared
+   * (once per build)
+   * Thread safe, disabled by default
+   */
+  static void EnableFingerprintCache(bool enable);
+
+  /**
+   * @brief Removes all memoized fingerprints
+   */
+  static void ClearFingerprintCache();
+
+  /**
+   * @brief Enables the fingerprint cache until the matching
+   * `EndFingerprintCache`
+   * Builds may overlap, the first build clears the fingerprints of previous
+   * builds and the cache stays enabled until the last build ends
+   */
+  static void BeginFingerprintCache();
+  static void EndFingerprintCache();
+
+  /**
+   * @brief Resolve `executable` to the absolute (canonical) path that would
+   * be run by the host
+   *
+   * @return fs::path Empty when the executable could not be found
+   */
+  static fs::path ResolveExecutable(const std::string &executable);
+};
+
+} // namespace buildcc
+
+#endif
@@ -77,8 +77,16 @@ public:
   void SetToolchainInfoCb(const ToolchainInfoCb &cb);
   const ToolchainInfoCb &GetToolchainInfoCb() const;
 
+  /**
+   * @brief Information of the last successful `Verify` call
+   */
+  const env::optional<ToolchainCompilerInfo> &GetVerifiedInfo() const {
+    return verified_info_;
+  }
+
 private:
   ToolchainInfoCb info_cb_;
+  env::optional<ToolchainCompilerInfo> verified_info_;
 };
 
 } // namespace buildcc
@@ -27,6 +27,7 @@
 
 #include "toolchain/api/flag_api.h"
 #include "toolchain/api/toolchain_find.h"
+#include "toolchain/api/toolchain_fingerprint.h"
 #include "toolchain/api/toolchain_verify.h"
 
 namespace buildcc {
@@ -34,7 +35,8 @@ namespace buildcc {
 // Base toolchain class
 class Toolchain : public internal::FlagApi<Toolchain>,
                   public ToolchainFind<Toolchain>,
-                  public ToolchainVerify<Toolchain> {
+                  public ToolchainVerify<Toolchain>,
+                  public ToolchainFingerprint<Toolchain> {
 public:
   // TODO, Remove ToolchainId from here
   Toolchain(ToolchainId id, std::string_view name,
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "toolchain/api/toolchain_fingerprint.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+#include "fmt/format.h"
+
+#include "env/host_os_util.h"
+#include "env/util.h"
+
+#include "toolchain/toolchain.h"
+
+namespace {
+
+bool IsRegularFile(const fs::path &path) {
+  std::error_code ec;
+  return fs::is_regular_file(path, ec) && !ec;
+}
+
+fs::path FindExecutable(const fs::path &path) {
+  constexpr const char *const executable_ext =
+      buildcc::env::get_os_executable_extension();
+  if (IsRegularFile(path)) {
+    return path;
+  }
+  if (executable_ext != nullptr && executable_ext[0] != '\0') {
+    fs::path path_with_ext(fmt::format("{}{}", path.string(), executable_ext));
+    if (IsRegularFile(path_with_ext)) {
+      return path_with_ext;
+    }
+  }
+  return {};
+}
+
+struct FingerprintCache {
+  std::atomic<bool> enabled{false};
+  std::mutex mutex;
+  // Running builds, see BeginFingerprintCache
+  std::size_t builds{0};
+  // Executable name to fingerprint
+  std::unordered_map<std::string, std::string> fingerprints;
+};
+
+FingerprintCache &GetFingerprintCache() {
+  static FingerprintCache cache;
+  return cache;
+}
+
+std::string FingerprintPath(const std::string &executable) {
+  fs::path resolved =
+      buildcc::ToolchainFingerprint<buildcc::Toolchain>::ResolveExecutable(
+          executable);
+  if (resolved.empty()) {
+    return executable;
+  }
+
+  std::error_code size_ec;
+  std::error_code time_ec;
+  const auto size = fs::file_size(resolved, size_ec);
+  const auto last_write_time = fs::last_write_time(resolved, time_ec);
+  if (size_ec || time_ec) {
+    return executable;
+  }
+
+  return fmt::format("{}:{}:{}", resolved.string(), size,
+                     last_write_time.time_since_epoch().count());
+}
+
+// Memoized FingerprintPath while the cache is enabled
+std::string CachedFingerprintPath(const std::string &executable) {
+  auto &cache = GetFingerprintCache();
+  if (!cache.enabled.load()) {
+    return FingerprintPath(executable);
+  }
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    const auto iter = cache.fingerprints.find(executable);
+    if (iter != cache.fingerprints.end()) {
+      return iter->second;
+    }
+  }
+  // Concurrent misses compute the same fingerprint
+  std::string fingerprint = FingerprintPath(executable);
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.fingerprints.try_emplace(executable, std::move(fingerprint))
+      .first->second;
+}
+
+std::string FingerprintExecutable(
+    const std::string &executable,
+    const buildcc::env::optional<buildcc::ToolchainCompilerInfo> &info) {
+  std::string fingerprint = CachedFingerprintPath(executable);
+  // Unresolved executables are fingerprinted by their name
+  if (fingerprint != executable && info.has_value()) {
+    fingerprint += fmt::format(":{}:{}", info.value().compiler_version,
+                               info.value().target_arch);
+  }
+  return fingerprint;
+}
+
+} // namespace
+
+namespace buildcc {
+
+template <typename T>
+ToolchainExecutables ToolchainFingerprint<T>::Fingerprint() const {
+  const T &t = static_cast<const T &>(*this);
+  const auto &info = t.GetVerifiedInfo();
+  return ToolchainExecutables(FingerprintExecutable(t.GetAssembler(), info),
+                              FingerprintExecutable(t.GetCCompiler(), info),
+                              FingerprintExecutable(t.GetCppCompiler(), info),
+                              FingerprintExecutable(t.GetArchiver(), info),
+                              FingerprintExecutable(t.GetLinker(), info));
+}
+
+template <typename T>
+void ToolchainFingerprint<T>::EnableFingerprintCache(bool enable) {
+  GetFingerprintCache().enabled.store(enable);
+}
+
+template <typename T> void ToolchainFingerprint<T>::ClearFingerprintCache() {
+  auto &cache = GetFingerprintCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.fingerprints.clear();
+}
+
+template <typename T> void ToolchainFingerprint<T>::BeginFingerprintCache() {
+  auto &cache = GetFingerprintCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (cache.builds == 0) {
+    cache.fingerprints.clear();
+  }
+  cache.builds++;
+  cache.enabled.store(true);
+}
+
+template <typename T> void ToolchainFingerprint<T>::EndFingerprintCache() {
+  auto &cache = GetFingerprintCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (cache.builds != 0 && --cache.builds == 0) {
+    cache.enabled.store(false);
+  }
+}
+
+template <typename T>
+fs::path ToolchainFingerprint<T>::ResolveExecutable(
+    const std::string &executable) {
+  if (executable.empty()) {
+    return {};
+  }
+
+  fs::path found;
+  const fs::path executable_path(executable);
+  if (executable_path.has_parent_path()) {
+    found = FindExecutable(executable_path);
+  } else {
+    // NOTE, A missing PATH is not fatal here, the executable is unresolved
+    const char *path_env = getenv("PATH");
+    constexpr const char *const os_env_delim = env::get_os_envvar_delim();
+    if (path_env != nullptr && os_env_delim != nullptr) {
+      for (const auto &dir : env::split(path_env, os_env_delim[0])) {
+        if (dir.empty()) {
+          continue;
+        }
+        found = FindExecutable(fs::path(dir) / executable_path);
+        if (!found.empty()) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (found.empty()) {
+    return {};
+  }
+
+  // Resolve symlinks such as /usr/bin/gcc -> gcc-12
+  std::error_code ec;
+  fs::path canonical = fs::canonical(found, ec);
+  return ec ? found : canonical;
+}
+
+template class ToolchainFingerprint<Toolchain>;
+
+} // namespace buildcc
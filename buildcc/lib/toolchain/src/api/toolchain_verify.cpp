@@ -94,6 +94,7 @@ ToolchainVerify<T>::Verify(const ToolchainFindConfig &config) {
 
   // Update the compilers
   t.executables_ = exes;
+  verified_info_ = toolchain_compiler_info;
   return toolchain_compiler_info;
 }
 
@@ -0,0 +1,175 @@
+#include <cstdlib>
+
+#include "toolchain/toolchain.h"
+
+#include "env/util.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+#include "CppUTestExt/MockSupport.h"
+
+// clang-format off
+TEST_GROUP(ToolchainFingerprintTestGroup)
+{
+  void teardown() {
+    mock().checkExpectations();
+    mock().clear();
+  }
+};
+// clang-format on
+
+static fs::path CreateExecutable(const std::string &name,
+                                 const std::string &data) {
+  fs::path dir = fs::temp_directory_path() / "buildcc_toolchain_fingerprint";
+  fs::create_directories(dir);
+  fs::path executable = dir / name;
+  CHECK_TRUE(
+      buildcc::env::save_file(executable.string().c_str(), data, true));
+  return fs::canonical(executable);
+}
+
+TEST(ToolchainFingerprintTestGroup, ResolveExecutable_Path) {
+  fs::path executable = fs::current_path() / "toolchains" / "gcc" / "gcc";
+  CHECK_TRUE(buildcc::Toolchain::ResolveExecutable(executable.string()) ==
+             fs::canonical(executable));
+
+  CHECK_TRUE(buildcc::Toolchain::ResolveExecutable("").empty());
+  CHECK_TRUE(buildcc::Toolchain::ResolveExecutable(
+                 (fs::current_path() / "does_not_exist").string())
+                 .empty());
+}
+
+TEST(ToolchainFingerprintTestGroup, ResolveExecutable_EnvPath) {
+  // NOTE, putenv keeps a reference to the string
+  const char *path = getenv("PATH");
+  static std::string previous_path =
+      fmt::format("PATH={}", path == nullptr ? "" : path);
+  static std::string toolchain_path;
+
+  fs::path toolchain_dir = fs::current_path() / "toolchains" / "gcc";
+  toolchain_path = fmt::format("PATH={}", toolchain_dir.string());
+  CHECK_TRUE(putenv(toolchain_path.data()) == 0);
+  fs::path resolved = buildcc::Toolchain::ResolveExecutable("gcc");
+  fs::path not_found =
+      buildcc::Toolchain::ResolveExecutable("buildcc_does_not_exist");
+  CHECK_TRUE(putenv(previous_path.data()) == 0);
+
+  CHECK_TRUE(resolved == fs::canonical(toolchain_dir / "gcc"));
+  CHECK_TRUE(not_found.empty());
+}
+
+TEST(ToolchainFingerprintTestGroup, Fingerprint) {
+  fs::path gcc = CreateExecutable("gcc", "gcc");
+  fs::path ld = CreateExecutable("ld", "ld");
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "gcc",
+      buildcc::ToolchainExecutables("buildcc_does_not_exist", gcc.string(),
+                                    gcc.string(), ld.string(), ld.string()));
+
+  auto fingerprint = toolchain.Fingerprint();
+  STRCMP_EQUAL(fingerprint.assembler.c_str(), "buildcc_does_not_exist");
+  CHECK_TRUE(fingerprint.c_compiler.find(fmt::format("{}:3:", gcc)) == 0);
+  CHECK_TRUE(fingerprint.c_compiler == fingerprint.cpp_compiler);
+  CHECK_TRUE(fingerprint.archiver.find(fmt::format("{}:2:", ld)) == 0);
+  CHECK_TRUE(fingerprint.archiver == fingerprint.linker);
+
+  // Unchanged executables have a stable fingerprint
+  auto same_fingerprint = toolchain.Fingerprint();
+  CHECK_TRUE(fingerprint.c_compiler == same_fingerprint.c_compiler);
+  CHECK_TRUE(fingerprint.linker == same_fingerprint.linker);
+
+  // Executable replaced in place
+  CreateExecutable("gcc", "gcc-12");
+  auto changed_fingerprint = toolchain.Fingerprint();
+  CHECK_FALSE(fingerprint.c_compiler == changed_fingerprint.c_compiler);
+  CHECK_TRUE(fingerprint.linker == changed_fingerprint.linker);
+}
+
+TEST(ToolchainFingerprintTestGroup, Fingerprint_Cache) {
+  fs::path gcc = CreateExecutable("cached_gcc", "gcc");
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "gcc",
+      buildcc::ToolchainExecutables("as", gcc.string(), gcc.string(), "ar",
+                                    "ld"));
+  buildcc::Toolchain::ClearFingerprintCache();
+  buildcc::Toolchain::EnableFingerprintCache(true);
+  auto fingerprint = toolchain.Fingerprint();
+
+  // Memoized until the cache is cleared
+  CreateExecutable("cached_gcc", "gcc-12");
+  CHECK_TRUE(toolchain.Fingerprint().c_compiler == fingerprint.c_compiler);
+  buildcc::Toolchain::ClearFingerprintCache();
+  auto changed_fingerprint = toolchain.Fingerprint();
+  CHECK_FALSE(changed_fingerprint.c_compiler == fingerprint.c_compiler);
+
+  // Not memoized while disabled
+  buildcc::Toolchain::EnableFingerprintCache(false);
+  CreateExecutable("cached_gcc", "gcc-13.1");
+  CHECK_FALSE(toolchain.Fingerprint().c_compiler ==
+              changed_fingerprint.c_compiler);
+  buildcc::Toolchain::ClearFingerprintCache();
+}
+
+TEST(ToolchainFingerprintTestGroup, Fingerprint_Cache_OverlappingBuilds) {
+  fs::path gcc = CreateExecutable("overlap_gcc", "gcc");
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "gcc",
+      buildcc::ToolchainExecutables("as", gcc.string(), gcc.string(), "ar",
+                                    "ld"));
+  buildcc::Toolchain::BeginFingerprintCache();
+  auto fingerprint = toolchain.Fingerprint();
+
+  // A second build does not clear the fingerprints of the first build
+  buildcc::Toolchain::BeginFingerprintCache();
+  CreateExecutable("overlap_gcc", "gcc-12");
+  CHECK_TRUE(toolchain.Fingerprint().c_compiler == fingerprint.c_compiler);
+
+  // Nor disables the cache when it ends first
+  buildcc::Toolchain::EndFingerprintCache();
+  CHECK_TRUE(toolchain.Fingerprint().c_compiler == fingerprint.c_compiler);
+
+  buildcc::Toolchain::EndFingerprintCache();
+  CHECK_FALSE(toolchain.Fingerprint().c_compiler == fingerprint.c_compiler);
+  buildcc::Toolchain::ClearFingerprintCache();
+}
+
+TEST(ToolchainFingerprintTestGroup, Fingerprint_Verified) {
+  buildcc::Toolchain toolchain(
+      buildcc::ToolchainId::Gcc, "gcc",
+      buildcc::ToolchainExecutables("as", "gcc", "g++", "ar", "ld"));
+  toolchain.SetToolchainInfoCb(
+      [](const buildcc::ToolchainExecutables &executables)
+          -> buildcc::env::optional<buildcc::ToolchainCompilerInfo> {
+        (void)executables;
+        buildcc::ToolchainCompilerInfo info;
+        info.compiler_version = "version";
+        info.target_arch = "arch";
+        return info;
+      });
+  CHECK_FALSE(toolchain.GetVerifiedInfo().has_value());
+
+  buildcc::ToolchainFindConfig config;
+  config.env_vars.clear();
+  config.absolute_search_paths.push_back(fs::current_path() / "toolchains" /
+                                         "gcc");
+  toolchain.Verify(config);
+  CHECK_TRUE(toolchain.GetVerifiedInfo().has_value());
+
+  auto fingerprint = toolchain.Fingerprint();
+  fs::path gcc = fs::canonical(fs::current_path() / "toolchains" / "gcc" /
+                               "gcc");
+  CHECK_TRUE(fingerprint.c_compiler.find(fmt::format("{}:0:", gcc)) == 0);
+  const std::string suffix = ":version:arch";
+  CHECK_TRUE(fingerprint.c_compiler.size() > suffix.size());
+  CHECK_TRUE(fingerprint.c_compiler.compare(
+                 fingerprint.c_compiler.size() - suffix.size(),
+                 suffix.size(), suffix) == 0);
+}
+
+int main(int ac, char **av) {
+  MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -33,8 +33,8 @@ public:
   void AddTarget(const BaseTarget *target);
 
   /**
-   * @brief Generate clang compile commands file in `Project::GetBuildDir`
-   * folder
+   * @brief Generate clang compile commands file in the project build dir of
+   * the BuildContext of the targets
    */
   void Generate();
 
@@ -22,23 +22,6 @@
 #include "env/assert_fatal.h"
 #include "env/util.h"
 
-// third party
-#include "fmt/format.h"
-#include "fmt/ranges.h"
-
-namespace {
-
-// clang-format off
-constexpr const char *const clang_compile_command_format =
-R"({{
-  "directory": "{directory}",
-  "command": "{command}",
-  "file": "{file}"
-}})";
-// clang-format on
-
-} // namespace
-
 namespace buildcc::plugin {
 
 void ClangCompileCommands::AddTarget(const BaseTarget *target) {
@@ -57,35 +40,37 @@ void ClangCompileCommands::Generate() {
   }
   env::log_trace("ClangCompileCommands", "Generate -> true");
 
-  std::vector<std::string> compile_command_list;
+  // Written with the json library, commands and paths are escaped
+  json compile_commands = json::array();
 
   for (const auto *t : targets_) {
     const auto &source_files = t->GetSourceFiles();
     for (const auto &source : source_files) {
-      // DONE, Get source list name
-      // DONE, Get std::vector<std::string> CompileCommand
-      // DONE, Get intermediate directory from env
-      std::string sf = fmt::format("{}", source);
-      const std::string &command = t->GetCompileCommand(source);
-      std::string directory = fmt::format("{}", Project::GetBuildDir());
-
-      std::string temp = fmt::format(
-          clang_compile_command_format, fmt::arg("directory", directory),
-          fmt::arg("command", command), fmt::arg("file", sf));
-      compile_command_list.push_back(temp);
+      const env::CommandLine &command_line = t->GetCompileCommandLine(source);
+      json entry;
+      entry["directory"] = path_as_string(
+          command_line.GetWorkingDirectory().value_or(
+              t->GetContext().GetBuildDir()));
+      // Arguments are preferred over the command, clients do not have to
+      // split the command again
+      if (command_line.IsEmpty()) {
+        entry["command"] = t->GetCompileCommand(source);
+      } else {
+        entry["arguments"] = command_line.GetArguments();
+      }
+      entry["file"] = source;
+      compile_commands.push_back(std::move(entry));
     }
   }
 
-  std::string compile_commands =
-      fmt::format("[\n{}\n]", fmt::join(compile_command_list, ",\n"));
-
   // DONE, Convert to json
   // DONE, Save file
+  // NOTE, Targets of a single build share the project build dir
   std::filesystem::path file =
-      std::filesystem::path(buildcc::Project::GetBuildDir()) /
+      std::filesystem::path(targets_.front()->GetContext().GetBuildDir()) /
       "compile_commands.json";
-  bool saved =
-      env::save_file(path_as_string(file).c_str(), compile_commands, false);
+  bool saved = env::save_file(path_as_string(file).c_str(),
+                              compile_commands.dump(2), false);
   env::assert_fatal(saved, "Could not save compile_commands.json");
 }
 
@@ -3,6 +3,7 @@ if (${TESTING})
     add_library(mock_schema STATIC
         include/schema/interface/serialization_interface.h
 
+        include/schema/binary_stream.h
         include/schema/path.h
 
         src/custom_generator_serialization.cpp
@@ -12,6 +13,18 @@ if (${TESTING})
         src/target_serialization.cpp
         include/schema/target_schema.h
         include/schema/target_serialization.h
+
+        src/build_log.cpp
+        include/schema/build_log.h
+
+        src/object_cache.cpp
+        include/schema/object_cache.h
+
+        src/remote_cache.cpp
+        include/schema/remote_cache.h
+
+        src/dist_compile.cpp
+        include/schema/dist_compile.h
     )
     target_include_directories(mock_schema PUBLIC 
         ${CMAKE_CURRENT_SOURCE_DIR}/include
@@ -46,6 +59,26 @@ if (${TESTING})
     )
     target_link_libraries(test_target_serialization PRIVATE mock_schema)
 
+    add_executable(test_build_log
+        test/test_build_log.cpp
+    )
+    target_link_libraries(test_build_log PRIVATE mock_schema)
+
+    add_executable(test_object_cache
+        test/test_object_cache.cpp
+    )
+    target_link_libraries(test_object_cache PRIVATE mock_schema)
+
+    add_executable(test_remote_cache
+        test/test_remote_cache.cpp
+    )
+    target_link_libraries(test_remote_cache PRIVATE mock_schema)
+
+    add_executable(test_dist_compile
+        test/test_dist_compile.cpp
+    )
+    target_link_libraries(test_dist_compile PRIVATE mock_schema)
+
     add_test(NAME test_path_schema COMMAND test_path_schema
         WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/test
     )
@@ -55,11 +88,24 @@ if (${TESTING})
     add_test(NAME test_target_serialization COMMAND test_target_serialization
     WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/test
     )
+    add_test(NAME test_build_log COMMAND test_build_log
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/test
+    )
+    add_test(NAME test_object_cache COMMAND test_object_cache
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/test
+    )
+    add_test(NAME test_remote_cache COMMAND test_remote_cache
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/test
+    )
+    add_test(NAME test_dist_compile COMMAND test_dist_compile
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}/test
+    )
 endif()
 
 set(SCHEMA_SRCS
     include/schema/interface/serialization_interface.h
 
+    include/schema/binary_stream.h
     include/schema/path.h
 
     src/custom_generator_serialization.cpp
@@ -69,6 +115,18 @@ set(SCHEMA_SRCS
     src/target_serialization.cpp
     include/schema/target_schema.h
     include/schema/target_serialization.h
+
+    src/build_log.cpp
+    include/schema/build_log.h
+
+    src/object_cache.cpp
+    include/schema/object_cache.h
+
+    src/remote_cache.cpp
+    include/schema/remote_cache.h
+
+    src/dist_compile.cpp
+    include/schema/dist_compile.h
 )
 
 if(${BUILDCC_BUILD_AS_SINGLE_LIB})
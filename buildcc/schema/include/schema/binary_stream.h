@@ -0,0 +1,219 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEMA_BINARY_STREAM_H_
+#define SCHEMA_BINARY_STREAM_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "env/hash.h"
+
+namespace buildcc::internal {
+
+/**
+ * Binary layout
+ *
+ * Header (kHeaderSize bytes)
+ * - magic (4 bytes)
+ * - version (u32)
+ * - hash of the payload (u64, env::hash_bytes)
+ *
+ * Payload
+ * - Integers are stored as fixed width little endian values
+ * - Strings are stored as a u32 length followed by the raw bytes
+ * - Containers are stored as a u32 count followed by the elements
+ */
+class BinaryWriter {
+public:
+  static constexpr std::size_t kHeaderSize = 16;
+  static constexpr std::size_t kMagicSize = 4;
+
+  // NOTE, magic must be kMagicSize characters long
+  BinaryWriter(std::string_view magic, std::uint32_t version) {
+    data_.reserve(4096);
+    data_.append(magic.data(), kMagicSize);
+    WriteU32(version);
+    WriteU64(0);
+  }
+
+  void WriteU8(std::uint8_t value) {
+    data_.push_back(static_cast<char>(value));
+  }
+  void WriteU32(std::uint32_t value) { WriteLittleEndian(value, 4); }
+  void WriteU64(std::uint64_t value) { WriteLittleEndian(value, 8); }
+  void WriteString(std::string_view value) {
+    WriteU32(static_cast<std::uint32_t>(value.size()));
+    data_.append(value.data(), value.size());
+  }
+
+  /**
+   * @brief Updates the payload hash in the header
+   * NOTE, Nothing should be written after Finish
+   */
+  const std::string &Finish() {
+    const std::uint64_t hash = env::hash_bytes(data_.data() + kHeaderSize,
+                                               data_.size() - kHeaderSize);
+    for (std::size_t i = 0; i < 8; i++) {
+      data_[kHeaderSize - 8 + i] = static_cast<char>((hash >> (8 * i)) & 0xFF);
+    }
+    return data_;
+  }
+
+private:
+  void WriteLittleEndian(std::uint64_t value, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; i++) {
+      data_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+  }
+
+private:
+  std::string data_;
+};
+
+/**
+ * @brief Reads data written by BinaryWriter directly from a (memory mapped)
+ * buffer
+ * Reads past the end of the buffer do not throw, they return default values
+ * and mark the reader invalid. Check `IsValid` once decoding is complete
+ */
+class BinaryReader {
+public:
+  explicit BinaryReader(std::string_view data)
+      : data_(data), pos_(BinaryWriter::kHeaderSize) {
+    valid_ = data_.size() >= BinaryWriter::kHeaderSize;
+  }
+
+  /**
+   * @brief Verifies the header and the payload hash
+   */
+  static bool Verify(std::string_view data, std::string_view magic,
+                     std::uint32_t version) {
+    if (data.size() < BinaryWriter::kHeaderSize ||
+        data.substr(0, BinaryWriter::kMagicSize) != magic) {
+      return false;
+    }
+    BinaryReader header(data);
+    header.pos_ = BinaryWriter::kMagicSize;
+    if (header.ReadU32() != version) {
+      return false;
+    }
+    const std::uint64_t hash = header.ReadU64();
+    return hash == env::hash_bytes(data.data() + BinaryWriter::kHeaderSize,
+                                   data.size() - BinaryWriter::kHeaderSize);
+  }
+
+  std::uint8_t ReadU8() {
+    return static_cast<std::uint8_t>(ReadLittleEndian(1));
+  }
+  std::uint32_t ReadU32() {
+    return static_cast<std::uint32_t>(ReadLittleEndian(4));
+  }
+  std::uint64_t ReadU64() { return ReadLittleEndian(8); }
+  void ReadString(std::string &value) {
+    const std::uint32_t size = ReadU32();
+    if (!Require(size)) {
+      value.clear();
+      return;
+    }
+    value.assign(data_.data() + pos_, size);
+    pos_ += size;
+  }
+
+  /**
+   * @brief Reads a container count
+   * Fails when `count * min_element_size` does not fit in the remaining data
+   * so that corrupted counts never cause large allocations
+   */
+  std::uint32_t ReadCount(std::size_t min_element_size) {
+    const std::uint32_t count = ReadU32();
+    if (!Require(static_cast<std::size_t>(count) * min_element_size)) {
+      return 0;
+    }
+    return count;
+  }
+
+  bool IsValid() const { return valid_; }
+  bool IsEnd() const { return pos_ == data_.size(); }
+
+private:
+  bool Require(std::size_t bytes) {
+    if (!valid_ || (data_.size() - pos_) < bytes) {
+      valid_ = false;
+    }
+    return valid_;
+  }
+
+  std::uint64_t ReadLittleEndian(std::size_t bytes) {
+    if (!Require(bytes)) {
+      return 0;
+    }
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; i++) {
+      value |= static_cast<std::uint64_t>(
+                   static_cast<unsigned char>(data_[pos_ + i]))
+               << (8 * i);
+    }
+    pos_ += bytes;
+    return value;
+  }
+
+private:
+  std::string_view data_;
+  std::size_t pos_;
+  bool valid_;
+};
+
+inline void to_binary(BinaryWriter &writer, const std::string &value) {
+  writer.WriteString(value);
+}
+
+inline void from_binary(BinaryReader &reader, std::string &value) {
+  reader.ReadString(value);
+}
+
+inline void to_binary(BinaryWriter &writer, bool value) {
+  writer.WriteU8(value ? 1 : 0);
+}
+
+inline void from_binary(BinaryReader &reader, bool &value) {
+  value = reader.ReadU8() != 0;
+}
+
+template <typename T>
+void to_binary(BinaryWriter &writer, const std::vector<T> &values) {
+  writer.WriteU32(static_cast<std::uint32_t>(values.size()));
+  for (const auto &value : values) {
+    to_binary(writer, value);
+  }
+}
+
+template <typename T>
+void from_binary(BinaryReader &reader, std::vector<T> &values) {
+  // Every element occupies atleast one byte
+  const std::uint32_t count = reader.ReadCount(1);
+  values.clear();
+  values.reserve(count);
+  for (std::uint32_t i = 0; i < count && reader.IsValid(); i++) {
+    from_binary(reader, values.emplace_back());
+  }
+}
+
+} // namespace buildcc::internal
+
+#endif
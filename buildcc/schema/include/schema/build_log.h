@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEMA_BUILD_LOG_H_
+#define SCHEMA_BUILD_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "env/build_context.h"
+#include "env/optional.h"
+
+#include "schema/interface/serialization_interface.h"
+
+namespace buildcc::internal {
+
+struct BuildLogEntry {
+  std::uint64_t duration_ms{0};
+  // 0 when the peak memory could not be measured
+  std::uint64_t peak_rss_bytes{0};
+};
+
+/**
+ * @brief Durations (in milliseconds) and peak memory of the jobs of previous
+ * builds, keyed by the job output path
+ */
+class BuildLogSerialization : public SerializationInterface {
+public:
+  using Entries = std::unordered_map<std::string, BuildLogEntry>;
+
+public:
+  explicit BuildLogSerialization(const fs::path &serialized_file)
+      : SerializationInterface(serialized_file) {}
+
+  void UpdateStore(const Entries &store) { store_ = store; }
+  const Entries &GetLoad() const { return load_; }
+  const Entries &GetStore() const { return store_; }
+
+private:
+  bool Verify(std::string_view serialized_data) override;
+  bool Load(std::string_view serialized_data) override;
+  bool Store(const fs::path &absolute_serialized_file) override;
+
+private:
+  Entries load_;
+  Entries store_;
+};
+
+/**
+ * @brief Log of compile and link job durations and peak memory, one per
+ * BuildContext
+ * Loaded before a build to estimate the cost of every job, jobs that run
+ * during the build update the entries of their context
+ * Recording is disabled by default, lookups return empty when the log of the
+ * context has not been loaded
+ * NOTE, Builds of different contexts never see each others entries
+ */
+class BuildLog {
+public:
+  static void Enable(const BuildContext &context, bool enable);
+  static bool IsEnabled(const BuildContext &context);
+
+  /**
+   * @brief Removes the log of `context`
+   * NOTE, Call once the context is no longer used, logs are keyed by address
+   */
+  static void Clear(const BuildContext &context);
+
+  /**
+   * @brief Replaces the entries of `context` with the contents of
+   * `serialized_file`
+   */
+  static bool LoadFromFile(const BuildContext &context,
+                           const fs::path &serialized_file);
+  static bool StoreToFile(const BuildContext &context,
+                          const fs::path &serialized_file);
+
+  static void Record(const BuildContext &context, const std::string &output,
+                     std::uint64_t duration_ms,
+                     std::uint64_t peak_rss_bytes = 0);
+  static env::optional<std::uint64_t> GetDuration(const BuildContext &context,
+                                                  const std::string &output);
+
+  /**
+   * @brief Peak resident set size (in bytes) of the job that generated
+   * `output`, empty when it was not measured
+   */
+  static env::optional<std::uint64_t>
+  GetPeakMemory(const BuildContext &context, const std::string &output);
+};
+
+} // namespace buildcc::internal
+
+#endif
@@ -38,8 +38,8 @@ public:
   const CustomGeneratorSchema &GetStore() const { return store_; }
 
 private:
-  bool Verify(const std::string &serialized_data) override;
-  bool Load(const std::string &serialized_data) override;
+  bool Verify(std::string_view serialized_data) override;
+  bool Load(std::string_view serialized_data) override;
   bool Store(const fs::path &absolute_serialized_file) override;
 
 private:
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEMA_DIST_COMPILE_H_
+#define SCHEMA_DIST_COMPILE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "env/command.h"
+#include "env/command_line.h"
+#include "env/http.h"
+#include "env/optional.h"
+
+namespace fs = std::filesystem;
+
+namespace buildcc::internal {
+
+/**
+ * @brief gcc / clang style compile command split into a local preprocessing
+ * command and the compile arguments sent to a worker
+ */
+struct DistCompileCommand {
+  // Writes the preprocessed source to stdout, and the dependency file when
+  // the compile command writes one
+  env::CommandLine preprocess;
+  // Compiler name followed by the arguments that do not refer to files, the
+  // worker adds `-c <input> -o <output>`
+  std::vector<std::string> compile;
+  // Extension of the preprocessed source, `.i` or `.ii`
+  std::string extension;
+  fs::path output;
+
+  /**
+   * @brief Splits a command of the form `<compiler> ... -c <source> -o
+   * <object>`
+   *
+   * @return Empty when the command cannot be compiled remotely, for example
+   * when it is not a C / C++ compile command or uses options other than
+   * preprocessor and code generation options (`-save-temps`, `--coverage`,
+   * precompiled headers, plugins, response files, etc)
+   */
+  static env::optional<DistCompileCommand>
+  Split(const env::CommandLine &command_line);
+};
+
+struct DistCompileStats {
+  // Jobs compiled by a worker
+  std::uint64_t remote{0};
+  // Jobs started remotely that were compiled locally
+  std::uint64_t local_fallbacks{0};
+  // Requests that did not receive a response
+  std::uint64_t errors{0};
+};
+
+/**
+ * @brief Process wide client of distributed compile workers (see
+ * DistCompileWorker and the `buildcc-worker` executable)
+ *
+ * Sources are preprocessed locally, only the preprocessed source and the
+ * compile arguments are sent to a worker, the object is sent back
+ * A job is only sent to a worker with a free slot, jobs beyond the capacity
+ * of the workers are compiled locally
+ *
+ * Jobs are compiled locally when the worker cannot be reached or the remote
+ * compile fails, workers are disabled after consecutive failed requests
+ *
+ * NOTE, Workers run the compiler of the same name found in their PATH, it
+ * must be the same version as the local compiler
+ *
+ * Disabled by default
+ */
+class DistCompile {
+public:
+  static constexpr std::uint16_t kDefaultPort = 3632;
+
+public:
+  /**
+   * @brief Connects to the workers and starts one dispatch thread per slot
+   * Workers that cannot be reached are skipped with a warning
+   *
+   * @param workers `host[:port][/slots]`, the slots reported by the worker
+   * are used when not specified
+   * @param timeout Applies to every request, includes the remote compile
+   * @return false when a worker is not valid
+   */
+  static bool Init(const std::vector<std::string> &workers,
+                   std::chrono::milliseconds timeout = std::chrono::minutes(5));
+
+  /**
+   * @brief Waits for the jobs in flight and disables distributed compiles
+   */
+  static void Deinit();
+  static bool IsEnabled();
+
+  /**
+   * @brief Compiles `command_line` on a worker without waiting for it to
+   * complete, see env::Command::ExecuteAsync
+   * `on_exit` is invoked on a dispatch thread (or the completion thread of
+   * env::Command when compiled locally) and must not block
+   *
+   * @return false when the command cannot be distributed or every worker is
+   * busy, `on_exit` is not invoked
+   */
+  static bool ExecuteAsync(const env::CommandLine &command_line,
+                           const env::Command::ExitCallback &on_exit,
+                           BuildContext *context = nullptr);
+
+  static DistCompileStats GetStats();
+
+  // Slots of the workers that are enabled
+  static unsigned int GetSlots();
+};
+
+/**
+ * @brief Compiles preprocessed sources for DistCompile clients
+ *
+ * - `GET /status`: `<slots> <busy>`
+ * - `POST /compile`: Compiles a preprocessed source, responds with `503`
+ * when every slot is busy
+ *
+ * Only compilers in the allowed list are run, arguments other than code
+ * generation options (`-O*`, `-g*`, `-W*`, `-std=`, `-m*` and common `-f*`
+ * flags) or with values that look like paths are rejected. Sources are
+ * compiled in a new directory below the work directory that is removed
+ * afterwards
+ *
+ * NOTE, Requires the ProcessReaper
+ * NOTE, Workers run commands sent by any client that connects, only listen
+ * on trusted networks
+ */
+class DistCompileWorker {
+public:
+  /**
+   * @param slots Maximum number of concurrent compiles
+   * @param compilers Names of the compilers that may be run
+   * @param work_dir Parent directory of the compile directories
+   */
+  DistCompileWorker(unsigned int slots, std::vector<std::string> compilers,
+                    const fs::path &work_dir)
+      : slots_(slots), compilers_(std::move(compilers)), work_dir_(work_dir),
+        server_([this](const env::HttpRequest &request) {
+          return Handle(request);
+        }) {}
+
+  DistCompileWorker(const DistCompileWorker &) = delete;
+  DistCompileWorker &operator=(const DistCompileWorker &) = delete;
+
+  /**
+   * @param port 0 picks a free port, see GetPort
+   * @param address IPv4 address of the interface
+   */
+  bool Start(std::uint16_t port = DistCompile::kDefaultPort,
+             const std::string &address = "127.0.0.1") {
+    return server_.Start(port, address);
+  }
+  void Stop() { server_.Stop(); }
+
+  std::uint16_t GetPort() const { return server_.GetPort(); }
+  // Number of compiles that completed, successful or not
+  std::uint64_t GetCompiles() const { return compiles_.load(); }
+
+private:
+  env::HttpResponse Handle(const env::HttpRequest &request);
+  env::HttpResponse Compile(const std::string &body);
+
+private:
+  unsigned int slots_;
+  std::vector<std::string> compilers_;
+  fs::path work_dir_;
+  std::atomic<unsigned int> busy_{0};
+  std::atomic<std::uint64_t> compiles_{0};
+  std::atomic<std::uint64_t> next_dir_{0};
+
+  // Stopped first on destruction
+  env::HttpServer server_;
+};
+
+} // namespace buildcc::internal
+
+#endif
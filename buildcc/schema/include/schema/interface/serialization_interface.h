@@ -18,8 +18,10 @@
 #define SCHEMA_INTERFACE_SERIALIZATION_INTERFACE_H_
 
 #include <filesystem>
+#include <string_view>
 
 #include "env/assert_fatal.h"
+#include "env/mapped_file.h"
 #include "env/util.h"
 
 #include "schema/path.h"
@@ -35,22 +37,21 @@ public:
   virtual ~SerializationInterface() = default;
 
   bool LoadFromFile() {
-    std::string buffer;
+    env::MappedFile file;
 
-    // Read from serialized file
-    bool is_loaded =
-        env::load_file(path_as_string(serialized_file_).c_str(), true, &buffer);
+    // Map the serialized file, data is decoded directly from the mapping
+    bool is_loaded = file.Open(path_as_string(serialized_file_).c_str());
     if (!is_loaded) {
       return false;
     }
 
     // Verify serialized data as per schema
-    if (!Verify(buffer)) {
+    if (!Verify(file.GetView())) {
       return false;
     }
 
     // Load serialized data as C++ data
-    loaded_ = Load(buffer);
+    loaded_ = Load(file.GetView());
     return loaded_;
   }
 
@@ -62,8 +63,8 @@ public:
   bool IsLoaded() const noexcept { return loaded_; }
 
 private:
-  virtual bool Verify(const std::string &serialized_data) = 0;
-  virtual bool Load(const std::string &serialized_data) = 0;
+  virtual bool Verify(std::string_view serialized_data) = 0;
+  virtual bool Load(std::string_view serialized_data) = 0;
   virtual bool Store(const fs::path &absolute_serialized_file) = 0;
 
 private:
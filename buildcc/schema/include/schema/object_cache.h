@@ -0,0 +1,191 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEMA_OBJECT_CACHE_H_
+#define SCHEMA_OBJECT_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "env/optional.h"
+
+#include "schema/interface/serialization_interface.h"
+
+namespace buildcc {
+
+/**
+ * @brief How a cached object is placed at its output path (and an output is
+ * placed in the cache)
+ * Copy: Copies the file
+ * Reflink: Shares the data of the file until either copy is modified (Linux
+ * filesystems with FICLONE support), copies the file otherwise
+ * Hardlink: Links the file, copies it across filesystems. Objects must not
+ * be modified in place after they are compiled
+ */
+enum class ObjectCacheLink {
+  Copy,
+  Reflink,
+  Hardlink,
+};
+
+} // namespace buildcc
+
+namespace buildcc::internal {
+
+struct ObjectCacheInput {
+  // Relative to the base directory when it is below it (see SetBaseDir)
+  std::string path;
+  // Content hash
+  std::uint64_t hash{0};
+};
+
+struct ObjectCacheEntry {
+  // Source and headers used to compile the object
+  std::vector<ObjectCacheInput> inputs;
+  // Name of the cached object file (digest of the object in the RemoteCache)
+  std::string object;
+};
+
+/**
+ * @brief Cached objects of a single cache key, most recently stored first
+ */
+class ObjectCacheManifest : public SerializationInterface {
+public:
+  using Entries = std::vector<ObjectCacheEntry>;
+
+public:
+  explicit ObjectCacheManifest(const fs::path &serialized_file)
+      : SerializationInterface(serialized_file) {}
+
+  void UpdateStore(const Entries &store) { store_ = store; }
+  const Entries &GetLoad() const { return load_; }
+  const Entries &GetStore() const { return store_; }
+
+  // Binary layout shared with the RemoteCache
+  static std::string Serialize(const Entries &entries);
+  static bool Deserialize(std::string_view serialized_data, Entries &entries);
+
+private:
+  bool Verify(std::string_view serialized_data) override;
+  bool Load(std::string_view serialized_data) override;
+  bool Store(const fs::path &absolute_serialized_file) override;
+
+private:
+  Entries load_;
+  Entries store_;
+};
+
+struct ObjectCacheStats {
+  std::uint64_t hits{0};
+  std::uint64_t misses{0};
+  std::uint64_t stores{0};
+  std::uint64_t evictions{0};
+  // Bytes used by the cache directory
+  std::uint64_t size_bytes{0};
+};
+
+/**
+ * @brief Process wide local cache of compiled objects
+ * A cache key identifies the compile command of a source (see ComputeKey).
+ * The manifest of a key records the content hashes of the inputs (source
+ * and headers from the dependency file) of every object cached for it, an
+ * object is reused when all of its inputs are unchanged
+ *
+ * Layout: `{cache_dir}/{key[0:2]}/{key}/` holds the `manifest` and the
+ * objects of a key. Keys are evicted as a whole, least recently used first,
+ * when the cache grows beyond its maximum size
+ *
+ * Disabled by default
+ */
+class ObjectCache {
+public:
+  /**
+   * @brief Enables the cache in `cache_dir`, the directory is created when
+   * it does not exist
+   *
+   * @param max_size_bytes Size the cache is trimmed to, 0 for no limit
+   */
+  static void Init(const fs::path &cache_dir, std::uint64_t max_size_bytes,
+                   ObjectCacheLink link = ObjectCacheLink::Reflink);
+  static void Deinit();
+  static bool IsEnabled();
+
+  /**
+   * @brief Paths below `base_dir` are recorded relative to it in keys and
+   * manifests so that checkouts in different directories (and machines
+   * sharing a RemoteCache) share objects, empty to record absolute paths
+   * NOTE, Objects still contain the absolute paths they were compiled with
+   * (debug information, `__FILE__`), see `-ffile-prefix-map`
+   */
+  static void SetBaseDir(const fs::path &base_dir);
+
+  /**
+   * @brief Key of a compile command
+   * `command` must not contain the paths of the object and the dependency
+   * file so that the key does not depend on the build directory
+   * The compiler is identified by the name and the contents of its resolved
+   * path, so keys are shared by machines with the same compiler installed
+   * NOTE, Only the compiler driver is hashed, not the programs it runs
+   */
+  static std::string ComputeKey(const std::string &compiler,
+                                const std::string &command);
+
+  /**
+   * @brief Places the object cached for `key` at `object` when all of its
+   * inputs are unchanged
+   *
+   * @return Inputs of the object, empty on a miss
+   */
+  static env::optional<std::vector<std::string>>
+  Fetch(const std::string &key, const fs::path &object);
+
+  /**
+   * @brief Caches `object` compiled from `inputs` for `key`
+   * Trims the cache when it grows beyond its maximum size
+   */
+  static bool Store(const std::string &key, const fs::path &object,
+                    const std::vector<std::string> &inputs);
+
+  /**
+   * @brief Evicts the least recently used keys until the cache fits in its
+   * maximum size
+   */
+  static void Trim();
+
+  /**
+   * @brief Statistics since Init
+   * `size_bytes` is computed by Init and Trim when the size of the cache is
+   * limited and estimated in between
+   */
+  static ObjectCacheStats GetStats();
+
+  // Input fingerprints, shared with the RemoteCache
+
+  /**
+   * @brief Content hashes of `inputs`, empty when an input cannot be read
+   */
+  static env::optional<std::vector<ObjectCacheInput>>
+  HashInputs(const std::vector<std::string> &inputs);
+  static bool InputsUnchanged(const std::vector<ObjectCacheInput> &inputs);
+  // Absolute paths of `inputs`
+  static std::vector<std::string>
+  InputPaths(const std::vector<ObjectCacheInput> &inputs);
+};
+
+} // namespace buildcc::internal
+
+#endif
@@ -17,28 +17,52 @@
 #ifndef SCHEMA_PATH_H_
 #define SCHEMA_PATH_H_
 
+#include <atomic>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 // Env
 #include "env/assert_fatal.h"
+#include "env/hash.h"
 
 // Third party
 #include "fmt/format.h"
 #include "fmt/ranges.h"
 #include "nlohmann/json.hpp"
 
+// Schema
+#include "schema/binary_stream.h"
+
 namespace fs = std::filesystem;
 using json = nlohmann::ordered_json;
 
+namespace buildcc {
+
+/**
+ * @brief Strategy used to compute the hash of a path
+ * Timestamp: Uses the last write time of the file
+ * Content: Uses a fast content hash (XXH3) of the file, the file is only read
+ * when its last write time or size has changed since the previous build
+ */
+enum class PathHashStrategy {
+  Timestamp,
+  Content,
+};
+
+} // namespace buildcc
+
 namespace buildcc::internal {
 
 struct PathInfo {
 private:
   static constexpr const char *const kPath = "path";
   static constexpr const char *const kHash = "hash";
+  static constexpr const char *const kStamp = "stamp";
 
 public:
   PathInfo() = default;
@@ -85,15 +109,32 @@ public:
   friend void to_json(json &j, const PathInfo &info) {
     j[kPath] = info.path;
     j[kHash] = info.hash;
+    j[kStamp] = info.stamp;
   }
 
   friend void from_json(const json &j, PathInfo &info) {
     j.at(kPath).get_to(info.path);
     j.at(kHash).get_to(info.hash);
+    j.at(kStamp).get_to(info.stamp);
+  }
+
+  friend void to_binary(BinaryWriter &writer, const PathInfo &info) {
+    writer.WriteString(info.path);
+    writer.WriteString(info.hash);
+    writer.WriteString(info.stamp);
+  }
+
+  friend void from_binary(BinaryReader &reader, PathInfo &info) {
+    reader.ReadString(info.path);
+    reader.ReadString(info.hash);
+    reader.ReadString(info.stamp);
   }
 
   std::string path;
   std::string hash;
+  // NOTE, stamp (last write time + size) is only used to skip recomputing
+  // the hash and does not take part in equality checks
+  std::string stamp;
 };
 
 /**
@@ -140,10 +181,147 @@ public:
     j.get_to(plist.paths_);
   }
 
+  friend void to_binary(BinaryWriter &writer, const PathList &plist) {
+    to_binary(writer, plist.paths_);
+  }
+
+  friend void from_binary(BinaryReader &reader, PathList &plist) {
+    from_binary(reader, plist.paths_);
+  }
+
 private:
   std::vector<std::string> paths_;
 };
 
+/**
+ * @brief Process wide cache of computed PathInfo keyed by path
+ * When enabled, every path is computed at most once until the cache is
+ * cleared (once per build, see BeginBuild)
+ * Thread safe, concurrent requests for the same path wait for a single
+ * computation
+ * NOTE, Paths that could not be computed (missing files) are not cached
+ */
+class PathHashCache {
+public:
+  static void Enable(bool enable) { Ref().enabled.store(enable); }
+  static bool IsEnabled() { return Ref().enabled.load(); }
+
+  /**
+   * @brief Removes all entries and resets the hit/miss counters
+   */
+  static void Clear() {
+    auto &cache = Ref();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.entries.clear();
+    cache.hits.store(0);
+    cache.misses.store(0);
+  }
+
+  /**
+   * @brief Enables the cache until the matching `EndBuild`
+   * Builds may overlap, the first build clears the entries of previous builds
+   * and the cache stays enabled until the last build ends
+   */
+  static void BeginBuild() {
+    auto &cache = Ref();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.builds == 0) {
+      cache.entries.clear();
+      cache.hits.store(0);
+      cache.misses.store(0);
+    }
+    cache.builds++;
+    cache.enabled.store(true);
+  }
+
+  static void EndBuild() {
+    auto &cache = Ref();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.builds != 0 && --cache.builds == 0) {
+      cache.enabled.store(false);
+    }
+  }
+
+  static std::size_t GetHits() { return Ref().hits.load(); }
+  static std::size_t GetMisses() { return Ref().misses.load(); }
+
+  /**
+   * @brief Returns the cached PathInfo of `path_str` or computes it using
+   * `compute_cb`
+   *
+   * @param path_str Sanitized path string
+   * @param info Output PathInfo
+   * @param compute_cb bool(PathInfo &), returns false on failure
+   */
+  template <typename ComputeCb>
+  static bool GetOrCompute(const std::string &path_str, PathInfo &info,
+                           const ComputeCb &compute_cb) {
+    auto &cache = Ref();
+    if (!cache.enabled.load()) {
+      return compute_cb(info);
+    }
+
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      auto &e = cache.entries[path_str];
+      if (!e) {
+        e = std::make_shared<Entry>();
+      }
+      entry = e;
+    }
+
+    std::lock_guard<std::mutex> entry_lock(entry->mutex);
+    if (entry->valid) {
+      cache.hits++;
+      info = entry->info;
+      return true;
+    }
+    cache.misses++;
+    if (!compute_cb(info)) {
+      return false;
+    }
+    entry->info = info;
+    entry->valid = true;
+    return true;
+  }
+
+private:
+  struct Entry {
+    std::mutex mutex;
+    bool valid{false};
+    PathInfo info;
+  };
+
+  struct Cache {
+    std::atomic<bool> enabled{false};
+    std::atomic<std::size_t> hits{0};
+    std::atomic<std::size_t> misses{0};
+    std::mutex mutex;
+    // Running builds, see BeginBuild
+    std::size_t builds{0};
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+  };
+
+  static Cache &Ref() {
+    static Cache cache;
+    return cache;
+  }
+};
+
+/**
+ * @brief Deferred hash computation of a single PathInfo
+ * Jobs are independent of each other and can be run in parallel
+ */
+struct PathHashJob {
+  PathHashJob(PathInfo *i, const PathInfo *p) : info(i), previous(p) {}
+
+  void Run() const;
+
+  PathInfo *info;
+  const PathInfo *previous;
+};
+
 /**
  * @brief Stores path + path hash in a hashmap
  *
@@ -164,6 +342,11 @@ public:
     infos_.emplace_back(PathInfo(path_str, hash));
   }
 
+  void Emplace(PathInfo info) {
+    info.path = PathInfo::ToPathString(info.path);
+    infos_.emplace_back(std::move(info));
+  }
+
   // TODO, Create a move version of Emplace(std::string &&pstr, std::string
   // &&hash)
 
@@ -175,7 +358,40 @@ public:
 
   void ComputeHashForAll() {
     for (auto &info : infos_) {
-      info.hash = ComputeHash(info.path);
+      info = ComputePathInfo(info.path);
+    }
+  }
+
+  /**
+   * @brief Computes the hash for all paths
+   * Hashes from `previous` are reused for paths whose stamp has not changed
+   *
+   * @param previous PathInfoList stored during the previous build
+   */
+  void ComputeHashForAll(const PathInfoList &previous) {
+    std::vector<PathHashJob> jobs;
+    AddHashJobs(previous, jobs);
+    for (const auto &job : jobs) {
+      job.Run();
+    }
+  }
+
+  /**
+   * @brief Adds a PathHashJob for every path
+   * Running all the jobs is equivalent to `ComputeHashForAll(previous)`
+   * NOTE, Jobs refer to this list and `previous`, both must outlive the jobs
+   * and must not be modified until the jobs have run
+   */
+  void AddHashJobs(const PathInfoList &previous,
+                   std::vector<PathHashJob> &jobs) {
+    std::unordered_map<std::string, const PathInfo *> previous_infos;
+    for (const auto &info : previous.infos_) {
+      previous_infos.try_emplace(info.path, &info);
+    }
+    for (auto &info : infos_) {
+      auto iter = previous_infos.find(info.path);
+      jobs.emplace_back(&info, iter == previous_infos.end() ? nullptr
+                                                             : iter->second);
     }
   }
 
@@ -202,21 +418,47 @@ public:
     return paths;
   }
 
-  // TODO, Add Compute Strategy enum
   static std::string ComputeHash(const std::string &pstr) {
-    auto path_str = PathInfo::ToPathString(pstr);
+    return ComputePathInfo(pstr).hash;
+  }
 
-    // TODO, There might be a file checksum hash compute strategy
-    // This is the timestamp hash compute strategy
-    std::error_code errcode;
-    const std::uint64_t last_write_timestamp =
-        std::filesystem::last_write_time(path_str, errcode)
-            .time_since_epoch()
-            .count();
-    env::assert_fatal(errcode.value() == 0,
-                      fmt::format("{} not found", path_str));
-    return std::to_string(last_write_timestamp);
+  /**
+   * @brief Computes the PathInfo of a path using the current
+   * PathHashStrategy
+   * Asserts when the path cannot be read
+   *
+   * @param pstr Path to compute
+   * @param previous PathInfo stored during the previous build (optional),
+   * its hash is reused when the stamp of the path has not changed
+   */
+  static PathInfo ComputePathInfo(const std::string &pstr,
+                                  const PathInfo *previous = nullptr) {
+    PathInfo info;
+    env::assert_fatal(
+        TryComputePathInfo(pstr, previous, info),
+        fmt::format("{} not found", PathInfo::ToPathString(pstr)));
+    return info;
+  }
+
+  /**
+   * @brief Same as `ComputePathInfo`, returns false instead of asserting when
+   * the path cannot be read
+   * Goes through the PathHashCache when it is enabled
+   */
+  static bool TryComputePathInfo(const std::string &pstr,
+                                 const PathInfo *previous, PathInfo &info) {
+    const auto path_str = PathInfo::ToPathString(pstr);
+    return PathHashCache::GetOrCompute(path_str, info, [&](PathInfo &out) {
+      return ComputePathInfoUncached(path_str, previous, out);
+    });
+  }
+
+  static void SetHashStrategy(PathHashStrategy strategy) {
+    HashStrategy().store(strategy);
+    // Cached hashes were computed with the previous strategy
+    PathHashCache::Clear();
   }
+  static PathHashStrategy GetHashStrategy() { return HashStrategy().load(); }
 
   bool operator==(const PathInfoList &other) const { return IsEqual(other); }
 
@@ -226,10 +468,66 @@ public:
     j.get_to(plist.infos_);
   }
 
+  friend void to_binary(BinaryWriter &writer, const PathInfoList &plist) {
+    to_binary(writer, plist.infos_);
+  }
+
+  friend void from_binary(BinaryReader &reader, PathInfoList &plist) {
+    from_binary(reader, plist.infos_);
+  }
+
+private:
+  static bool ComputePathInfoUncached(const std::string &path_str,
+                                      const PathInfo *previous,
+                                      PathInfo &info) {
+    info = PathInfo(path_str, "");
+
+    std::error_code errcode;
+    const std::uint64_t last_write_timestamp =
+        std::filesystem::last_write_time(info.path, errcode)
+            .time_since_epoch()
+            .count();
+    if (errcode) {
+      return false;
+    }
+
+    if (GetHashStrategy() == PathHashStrategy::Timestamp) {
+      info.hash = std::to_string(last_write_timestamp);
+      return true;
+    }
+
+    const std::uintmax_t size = std::filesystem::file_size(info.path, errcode);
+    if (errcode) {
+      return false;
+    }
+    info.stamp = fmt::format("{}:{}", last_write_timestamp, size);
+    if (previous != nullptr && !previous->stamp.empty() &&
+        previous->stamp == info.stamp) {
+      info.hash = previous->hash;
+      return true;
+    }
+
+    std::uint64_t content_hash{0};
+    if (!env::hash_file(info.path.c_str(), &content_hash)) {
+      return false;
+    }
+    info.hash = fmt::format("{:016x}", content_hash);
+    return true;
+  }
+
+  static std::atomic<PathHashStrategy> &HashStrategy() {
+    static std::atomic<PathHashStrategy> strategy{PathHashStrategy::Timestamp};
+    return strategy;
+  }
+
 private:
   std::vector<PathInfo> infos_;
 };
 
+inline void PathHashJob::Run() const {
+  *info = PathInfoList::ComputePathInfo(info->path, previous);
+}
+
 } // namespace buildcc::internal
 
 namespace buildcc {
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEMA_REMOTE_CACHE_H_
+#define SCHEMA_REMOTE_CACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "env/http.h"
+#include "env/optional.h"
+
+#include "schema/object_cache.h"
+
+namespace buildcc::internal {
+
+struct RemoteCacheStats {
+  std::uint64_t hits{0};
+  std::uint64_t misses{0};
+  std::uint64_t uploads{0};
+  // Uploads that failed or were dropped
+  std::uint64_t upload_failures{0};
+  std::uint64_t bytes_downloaded{0};
+  std::uint64_t bytes_uploaded{0};
+  // Requests that did not receive a response
+  std::uint64_t errors{0};
+};
+
+/**
+ * @brief Process wide client of a remote HTTP cache of compiled objects
+ * Uses the `/ac` and `/cas` path layout of bazel-remote, the `/ac` entries are
+ * buildcc manifests and not Bazel ActionResults
+ * - `GET|PUT /ac/<sha256>`: Manifest of a cache key (see ObjectCacheManifest),
+ * every entry records the input fingerprints of an object and its digest
+ * - `HEAD|GET|PUT /cas/<sha256>`: Object contents, addressed by their SHA-256
+ * digest
+ *
+ * Keys are shared with the ObjectCache (see ObjectCache::ComputeKey), so
+ * machines share objects when their compile commands, compilers and inputs
+ * match. See ObjectCache::SetBaseDir for checkouts in different directories
+ *
+ * Uploads are queued and sent by a background thread, compile jobs never
+ * wait for the network
+ * The cache is disabled for the rest of the process after consecutive
+ * requests fail to reach the server
+ *
+ * NOTE, Not compatible with Bazel remote caching clients. bazel-remote
+ * validates `/ac` entries as protobuf ActionResults by default and requires
+ * `--disable_http_ac_validation`
+ *
+ * Disabled by default
+ */
+class RemoteCache {
+public:
+  /**
+   * @brief Enables the cache
+   *
+   * @param url `http://host[:port][/prefix]`
+   * @param upload false to only fetch objects (for example on developer
+   * machines populated by CI)
+   * @param timeout Applies to every read and write
+   * @param connect_timeout Applies to connecting, fetches block the compile
+   * jobs so an unreachable server must be detected quickly
+   * @return false when the url is not valid
+   */
+  static bool
+  Init(const std::string &url, bool upload = true,
+       std::chrono::milliseconds timeout = std::chrono::seconds(10),
+       std::chrono::milliseconds connect_timeout = std::chrono::seconds(1));
+
+  /**
+   * @brief Waits for queued uploads and disables the cache
+   */
+  static void Deinit();
+  static bool IsEnabled();
+
+  /**
+   * @brief Downloads the object cached for `key` to `object` when all of
+   * its inputs are unchanged
+   *
+   * @return Inputs of the object, empty on a miss
+   */
+  static env::optional<std::vector<std::string>>
+  Fetch(const std::string &key, const fs::path &object);
+
+  /**
+   * @brief Queues an upload of `object` compiled from `inputs` for `key`
+   * The object is read before returning, it may be modified afterwards
+   *
+   * @return false when the upload could not be queued
+   */
+  static bool Store(const std::string &key, const fs::path &object,
+                    const std::vector<std::string> &inputs);
+
+  /**
+   * @brief Waits until every queued upload is complete
+   */
+  static void Flush();
+
+  static RemoteCacheStats GetStats();
+
+  // Request paths of a cache key and of object contents
+  static std::string GetActionPath(const std::string &key);
+  static std::string GetCasPath(const std::string &digest);
+};
+
+/**
+ * @brief In memory reference server of the RemoteCache protocol
+ * Listens on `127.0.0.1`, intended for tests and local experiments
+ * Rejects keys that are not SHA-256 digests and `/cas` contents that do not
+ * match their digest, like bazel-remote
+ */
+class RemoteCacheServer {
+public:
+  RemoteCacheServer()
+      : server_([this](const env::HttpRequest &request) {
+          return Handle(request);
+        }) {}
+
+  RemoteCacheServer(const RemoteCacheServer &) = delete;
+  RemoteCacheServer &operator=(const RemoteCacheServer &) = delete;
+
+  /**
+   * @param port 0 picks a free port, see GetUrl
+   */
+  bool Start(std::uint16_t port = 0) { return server_.Start(port); }
+  void Stop() { server_.Stop(); }
+
+  std::uint16_t GetPort() const { return server_.GetPort(); }
+  std::string GetUrl() const;
+  std::size_t GetActionCount() const;
+  std::size_t GetCasCount() const;
+
+private:
+  env::HttpResponse Handle(const env::HttpRequest &request);
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::string> ac_;
+  std::unordered_map<std::string, std::string> cas_;
+
+  // Stopped first on destruction
+  env::HttpServer server_;
+};
+
+} // namespace buildcc::internal
+
+#endif
@@ -17,17 +17,116 @@
 #ifndef SCHEMA_TARGET_SCHEMA_H_
 #define SCHEMA_TARGET_SCHEMA_H_
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "schema/binary_stream.h"
 #include "schema/path.h"
 #include "schema/target_type.h"
 
 namespace buildcc::internal {
 
 struct TargetSchema {
+  using ObjectKey = std::string;
+  struct ObjectInfo {
+  private:
+    static constexpr const char *const kHeaders = "headers";
+    static constexpr const char *const kHeadersTracked = "headers_tracked";
+    static constexpr const char *const kCommandHash = "command_hash";
+
+  public:
+    // Headers reported by the compiler (depfile) when compiling this object
+    PathInfoList headers;
+    // false when the compiler did not report headers for this object
+    bool headers_tracked{false};
+    // Digest of the complete command used to compile this object
+    std::string command_hash;
+
+    friend void to_json(json &j, const ObjectInfo &info) {
+      j[kHeaders] = info.headers;
+      j[kHeadersTracked] = info.headers_tracked;
+      j[kCommandHash] = info.command_hash;
+    }
+
+    friend void from_json(const json &j, ObjectInfo &info) {
+      j.at(kHeaders).get_to(info.headers);
+      j.at(kHeadersTracked).get_to(info.headers_tracked);
+      j.at(kCommandHash).get_to(info.command_hash);
+    }
+
+    friend void to_binary(BinaryWriter &writer, const ObjectInfo &info) {
+      to_binary(writer, info.headers);
+      to_binary(writer, info.headers_tracked);
+      to_binary(writer, info.command_hash);
+    }
+
+    friend void from_binary(BinaryReader &reader, ObjectInfo &info) {
+      from_binary(reader, info.headers);
+      from_binary(reader, info.headers_tracked);
+      from_binary(reader, info.command_hash);
+    }
+  };
+
+  // Fingerprints of the toolchain executables used to build the target
+  struct ToolchainInfo {
+  private:
+    static constexpr const char *const kAssembler = "assembler";
+    static constexpr const char *const kCCompiler = "c_compiler";
+    static constexpr const char *const kCppCompiler = "cpp_compiler";
+    static constexpr const char *const kArchiver = "archiver";
+    static constexpr const char *const kLinker = "linker";
+
+  public:
+    std::string assembler;
+    std::string c_compiler;
+    std::string cpp_compiler;
+    std::string archiver;
+    std::string linker;
+
+    bool operator==(const ToolchainInfo &other) const {
+      return assembler == other.assembler && c_compiler == other.c_compiler &&
+             cpp_compiler == other.cpp_compiler &&
+             archiver == other.archiver && linker == other.linker;
+    }
+
+    friend void to_json(json &j, const ToolchainInfo &info) {
+      j[kAssembler] = info.assembler;
+      j[kCCompiler] = info.c_compiler;
+      j[kCppCompiler] = info.cpp_compiler;
+      j[kArchiver] = info.archiver;
+      j[kLinker] = info.linker;
+    }
+
+    friend void from_json(const json &j, ToolchainInfo &info) {
+      j.at(kAssembler).get_to(info.assembler);
+      j.at(kCCompiler).get_to(info.c_compiler);
+      j.at(kCppCompiler).get_to(info.cpp_compiler);
+      j.at(kArchiver).get_to(info.archiver);
+      j.at(kLinker).get_to(info.linker);
+    }
+
+    friend void to_binary(BinaryWriter &writer, const ToolchainInfo &info) {
+      to_binary(writer, info.assembler);
+      to_binary(writer, info.c_compiler);
+      to_binary(writer, info.cpp_compiler);
+      to_binary(writer, info.archiver);
+      to_binary(writer, info.linker);
+    }
+
+    friend void from_binary(BinaryReader &reader, ToolchainInfo &info) {
+      from_binary(reader, info.assembler);
+      from_binary(reader, info.c_compiler);
+      from_binary(reader, info.cpp_compiler);
+      from_binary(reader, info.archiver);
+      from_binary(reader, info.linker);
+    }
+  };
+
   std::string name;
   TargetType type{TargetType::Undefined};
+  ToolchainInfo toolchain;
 
   PathInfoList sources;
   PathInfoList headers;
@@ -51,6 +150,12 @@ struct TargetSchema {
   PathInfoList compile_dependencies;
   PathInfoList link_dependencies;
 
+  // Per object information keyed by the source path
+  std::unordered_map<ObjectKey, ObjectInfo> objects;
+
+  // Digest of the complete command used to link the target
+  std::string link_command_hash;
+
   // TODO, Verify this using fs::exists
   bool pch_compiled{false};
   bool target_linked{false};
@@ -58,6 +163,7 @@ struct TargetSchema {
 private:
   static constexpr const char *const kName = "name";
   static constexpr const char *const kType = "type";
+  static constexpr const char *const kToolchain = "toolchain";
 
   static constexpr const char *const kSources = "sources";
   static constexpr const char *const kHeaders = "headers";
@@ -82,6 +188,9 @@ private:
       "compile_dependencies";
   static constexpr const char *const kLinkDependencies = "link_dependencies";
 
+  static constexpr const char *const kObjects = "objects";
+  static constexpr const char *const kLinkCommandHash = "link_command_hash";
+
   static constexpr const char *const kPchCompiled = "pch_compiled";
   static constexpr const char *const kTargetLinked = "target_linked";
 
@@ -89,6 +198,7 @@ public:
   friend void to_json(json &j, const TargetSchema &schema) {
     j[kName] = schema.name;
     j[kType] = schema.type;
+    j[kToolchain] = schema.toolchain;
     j[kSources] = schema.sources;
     j[kHeaders] = schema.headers;
     j[kPchs] = schema.pchs;
@@ -108,6 +218,8 @@ public:
 
     j[kCompileDependencies] = schema.compile_dependencies;
     j[kLinkDependencies] = schema.link_dependencies;
+    j[kObjects] = schema.objects;
+    j[kLinkCommandHash] = schema.link_command_hash;
     j[kPchCompiled] = schema.pch_compiled;
     j[kTargetLinked] = schema.target_linked;
   }
@@ -115,6 +227,7 @@ public:
   friend void from_json(const json &j, TargetSchema &schema) {
     j.at(kName).get_to(schema.name);
     j.at(kType).get_to(schema.type);
+    j.at(kToolchain).get_to(schema.toolchain);
     j.at(kSources).get_to(schema.sources);
     j.at(kHeaders).get_to(schema.headers);
     j.at(kPchs).get_to(schema.pchs);
@@ -134,9 +247,93 @@ public:
 
     j.at(kCompileDependencies).get_to(schema.compile_dependencies);
     j.at(kLinkDependencies).get_to(schema.link_dependencies);
+    j.at(kObjects).get_to(schema.objects);
+    j.at(kLinkCommandHash).get_to(schema.link_command_hash);
     j.at(kPchCompiled).get_to(schema.pch_compiled);
     j.at(kTargetLinked).get_to(schema.target_linked);
   }
+
+  friend void to_binary(BinaryWriter &writer, const TargetSchema &schema) {
+    to_binary(writer, schema.name);
+    writer.WriteU32(static_cast<std::uint32_t>(schema.type));
+    to_binary(writer, schema.toolchain);
+    to_binary(writer, schema.sources);
+    to_binary(writer, schema.headers);
+    to_binary(writer, schema.pchs);
+    to_binary(writer, schema.libs);
+    to_binary(writer, schema.external_libs);
+    to_binary(writer, schema.include_dirs);
+    to_binary(writer, schema.lib_dirs);
+
+    to_binary(writer, schema.preprocessor_flags);
+    to_binary(writer, schema.common_compile_flags);
+    to_binary(writer, schema.pch_compile_flags);
+    to_binary(writer, schema.pch_object_flags);
+    to_binary(writer, schema.asm_compile_flags);
+    to_binary(writer, schema.c_compile_flags);
+    to_binary(writer, schema.cpp_compile_flags);
+    to_binary(writer, schema.link_flags);
+
+    to_binary(writer, schema.compile_dependencies);
+    to_binary(writer, schema.link_dependencies);
+    writer.WriteU32(static_cast<std::uint32_t>(schema.objects.size()));
+    for (const auto &[key, info] : schema.objects) {
+      to_binary(writer, key);
+      to_binary(writer, info);
+    }
+    to_binary(writer, schema.link_command_hash);
+    to_binary(writer, schema.pch_compiled);
+    to_binary(writer, schema.target_linked);
+  }
+
+  friend void from_binary(BinaryReader &reader, TargetSchema &schema) {
+    from_binary(reader, schema.name);
+    schema.type = ToTargetType(reader.ReadU32());
+    from_binary(reader, schema.toolchain);
+    from_binary(reader, schema.sources);
+    from_binary(reader, schema.headers);
+    from_binary(reader, schema.pchs);
+    from_binary(reader, schema.libs);
+    from_binary(reader, schema.external_libs);
+    from_binary(reader, schema.include_dirs);
+    from_binary(reader, schema.lib_dirs);
+
+    from_binary(reader, schema.preprocessor_flags);
+    from_binary(reader, schema.common_compile_flags);
+    from_binary(reader, schema.pch_compile_flags);
+    from_binary(reader, schema.pch_object_flags);
+    from_binary(reader, schema.asm_compile_flags);
+    from_binary(reader, schema.c_compile_flags);
+    from_binary(reader, schema.cpp_compile_flags);
+    from_binary(reader, schema.link_flags);
+
+    from_binary(reader, schema.compile_dependencies);
+    from_binary(reader, schema.link_dependencies);
+    // Every object occupies atleast a key size, a header count, a tracked
+    // flag and a command hash size
+    const std::uint32_t num_objects = reader.ReadCount(13);
+    schema.objects.clear();
+    schema.objects.reserve(num_objects);
+    for (std::uint32_t i = 0; i < num_objects && reader.IsValid(); i++) {
+      ObjectKey key;
+      from_binary(reader, key);
+      from_binary(reader, schema.objects[std::move(key)]);
+    }
+    from_binary(reader, schema.link_command_hash);
+    from_binary(reader, schema.pch_compiled);
+    from_binary(reader, schema.target_linked);
+  }
+
+private:
+  static TargetType ToTargetType(std::uint32_t value) {
+    auto iter = std::find_if(kTargetTypeInfo.cbegin(), kTargetTypeInfo.cend(),
+                             [value](const auto &p) {
+                               return static_cast<std::uint32_t>(p.second) ==
+                                      value;
+                             });
+    return iter != kTargetTypeInfo.cend() ? iter->second
+                                          : TargetType::Undefined;
+  }
 };
 
 } // namespace buildcc::internal
@@ -34,14 +34,24 @@ public:
   void UpdatePchCompiled(const TargetSchema &store);
   void UpdateTargetCompiled();
   void AddSource(const std::string &source, const std::string &hash);
+  void AddObjectInfo(const std::string &source,
+                     const TargetSchema::ObjectInfo &info);
   void UpdateStore(const TargetSchema &store);
 
   const TargetSchema &GetLoad() const { return load_; }
   const TargetSchema &GetStore() const { return store_; }
 
+  /**
+   * @brief Target schemas are stored in a compact binary format
+   * When enabled, a human readable `<serialized_file>.json` copy is also
+   * written on every store. Meant for debugging only, it is never loaded
+   */
+  static void EnableJsonExport(bool enable);
+  static bool IsJsonExportEnabled();
+
 private:
-  bool Verify(const std::string &serialized_data) override;
-  bool Load(const std::string &serialized_data) override;
+  bool Verify(std::string_view serialized_data) override;
+  bool Load(std::string_view serialized_data) override;
   bool Store(const fs::path &absolute_serialized_file) override;
 
 private:
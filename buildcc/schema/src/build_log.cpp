@@ -0,0 +1,188 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "schema/build_log.h"
+
+#include <mutex>
+
+#include "schema/binary_stream.h"
+
+namespace {
+
+// "BuildCC Log"
+constexpr const char *const kMagic = "BCCL";
+// NOTE, Update this when the binary layout changes
+constexpr std::uint32_t kVersion = 2;
+
+// Every entry contains atleast the string length, the duration and the peak
+// memory
+constexpr std::size_t kMinEntrySize = 20;
+
+struct Log {
+  bool enabled{false};
+  buildcc::internal::BuildLogSerialization::Entries entries;
+};
+
+struct BuildLogState {
+  std::mutex mutex;
+  std::unordered_map<const buildcc::BuildContext *, Log> logs;
+};
+
+BuildLogState &GetState() {
+  static BuildLogState state;
+  return state;
+}
+
+} // namespace
+
+namespace buildcc::internal {
+
+// BuildLogSerialization
+
+bool BuildLogSerialization::Verify(std::string_view serialized_data) {
+  return BinaryReader::Verify(serialized_data, kMagic, kVersion);
+}
+
+bool BuildLogSerialization::Load(std::string_view serialized_data) {
+  BinaryReader reader(serialized_data);
+  Entries load;
+  const std::uint32_t count = reader.ReadCount(kMinEntrySize);
+  load.reserve(count);
+  for (std::uint32_t i = 0; i < count && reader.IsValid(); i++) {
+    std::string output;
+    reader.ReadString(output);
+    BuildLogEntry entry;
+    entry.duration_ms = reader.ReadU64();
+    entry.peak_rss_bytes = reader.ReadU64();
+    load.insert_or_assign(std::move(output), entry);
+  }
+
+  bool loaded = reader.IsValid() && reader.IsEnd();
+  if (loaded) {
+    load_ = std::move(load);
+  } else {
+    env::log_critical(__FUNCTION__, "Corrupted build log");
+  }
+  return loaded;
+}
+
+bool BuildLogSerialization::Store(const fs::path &absolute_serialized_file) {
+  BinaryWriter writer(kMagic, kVersion);
+  writer.WriteU32(static_cast<std::uint32_t>(store_.size()));
+  for (const auto &[output, entry] : store_) {
+    writer.WriteString(output);
+    writer.WriteU64(entry.duration_ms);
+    writer.WriteU64(entry.peak_rss_bytes);
+  }
+  return env::save_file(path_as_string(absolute_serialized_file).c_str(),
+                        writer.Finish(), true);
+}
+
+// BuildLog
+
+void BuildLog::Enable(const BuildContext &context, bool enable) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.logs[&context].enabled = enable;
+}
+
+bool BuildLog::IsEnabled(const BuildContext &context) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto iter = state.logs.find(&context);
+  return iter != state.logs.end() && iter->second.enabled;
+}
+
+void BuildLog::Clear(const BuildContext &context) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.logs.erase(&context);
+}
+
+bool BuildLog::LoadFromFile(const BuildContext &context,
+                            const fs::path &serialized_file) {
+  BuildLogSerialization serialization(serialized_file);
+  const bool loaded = serialization.LoadFromFile();
+
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto &entries = state.logs[&context].entries;
+  if (loaded) {
+    entries = serialization.GetLoad();
+  } else {
+    entries.clear();
+  }
+  return loaded;
+}
+
+bool BuildLog::StoreToFile(const BuildContext &context,
+                           const fs::path &serialized_file) {
+  BuildLogSerialization serialization(serialized_file);
+  {
+    auto &state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto iter = state.logs.find(&context);
+    if (iter != state.logs.end()) {
+      serialization.UpdateStore(iter->second.entries);
+    }
+  }
+  return serialization.StoreToFile();
+}
+
+void BuildLog::Record(const BuildContext &context, const std::string &output,
+                      std::uint64_t duration_ms, std::uint64_t peak_rss_bytes) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto iter = state.logs.find(&context);
+  if (iter == state.logs.end() || !iter->second.enabled) {
+    return;
+  }
+  iter->second.entries.insert_or_assign(
+      output, BuildLogEntry{duration_ms, peak_rss_bytes});
+}
+
+env::optional<std::uint64_t> BuildLog::GetDuration(const BuildContext &context,
+                                                   const std::string &output) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto log = state.logs.find(&context);
+  if (log == state.logs.end()) {
+    return {};
+  }
+  auto iter = log->second.entries.find(output);
+  if (iter == log->second.entries.end()) {
+    return {};
+  }
+  return iter->second.duration_ms;
+}
+
+env::optional<std::uint64_t>
+BuildLog::GetPeakMemory(const BuildContext &context,
+                        const std::string &output) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto log = state.logs.find(&context);
+  if (log == state.logs.end()) {
+    return {};
+  }
+  auto iter = log->second.entries.find(output);
+  if (iter == log->second.entries.end() || iter->second.peak_rss_bytes == 0) {
+    return {};
+  }
+  return iter->second.peak_rss_bytes;
+}
+
+} // namespace buildcc::internal
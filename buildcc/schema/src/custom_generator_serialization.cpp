@@ -23,12 +23,12 @@ namespace buildcc::internal {
 
 // PRIVATE
 
-bool CustomGeneratorSerialization::Verify(const std::string &serialized_data) {
+bool CustomGeneratorSerialization::Verify(std::string_view serialized_data) {
   (void)serialized_data;
   return true;
 }
 
-bool CustomGeneratorSerialization::Load(const std::string &serialized_data) {
+bool CustomGeneratorSerialization::Load(std::string_view serialized_data) {
   json j = json::parse(serialized_data, nullptr, false);
   bool loaded = !j.is_discarded();
 
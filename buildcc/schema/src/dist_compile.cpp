@@ -0,0 +1,777 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "schema/dist_compile.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "env/job_output.h"
+#include "env/logging.h"
+#include "env/process_reaper.h"
+#include "env/util.h"
+
+#include "schema/binary_stream.h"
+#include "schema/path.h"
+
+namespace {
+
+// NOTE, Update this when the request or the response changes
+constexpr std::uint32_t kVersion = 1;
+constexpr const char *const kRequestMagic = "BDCQ";
+constexpr const char *const kResponseMagic = "BDCR";
+
+constexpr const char *const kStatusPath = "/status";
+constexpr const char *const kCompilePath = "/compile";
+constexpr const char *const kObjectName = "output.o";
+
+// Workers are disabled after these many consecutive errors
+constexpr std::uint32_t kMaxConsecutiveErrors = 3;
+// Workers that do not answer the status request in time are skipped
+constexpr std::chrono::milliseconds kStatusTimeout(5000);
+
+enum class ArgumentKind {
+  // Sent to the worker and used for preprocessing
+  Compile,
+  // Compile, followed by a value
+  CompileWithValue,
+  // Only used for preprocessing
+  Preprocess,
+  // Preprocess, followed by a value
+  PreprocessWithValue,
+  // The command is compiled locally
+  Unsupported,
+};
+
+constexpr std::array<std::string_view, 17> kPreprocessWithValue = {
+    "-D", "-U", "-I", "-include", "-imacros", "-isystem", "-iquote",
+    "-idirafter", "-iprefix", "-iwithprefix", "-isysroot", "-iwithprefixbefore",
+    "-MF", "-MT", "-MQ", "-Xpreprocessor", "--sysroot"};
+constexpr std::array<std::string_view, 7> kPreprocess = {
+    "-MD", "-MMD", "-MP", "-H", "-nostdinc", "-nostdinc++", "-undef"};
+constexpr std::array<std::string_view, 15> kPreprocessPrefixes = {
+    "-D", "-U", "-I", "-isystem", "-iquote", "-idirafter", "-imacros",
+    "-iprefix", "-iwithprefix", "-isysroot", "-MF", "-MT", "-MQ", "-Wp,",
+    "--sysroot="};
+
+// Only code generation options are sent to workers, everything else is
+// compiled locally
+constexpr std::array<std::string_view, 2> kCompileWithValue = {"-target",
+                                                               "-arch"};
+constexpr std::array<std::string_view, 5> kCompile = {
+    "-pthread", "-pedantic", "-pedantic-errors", "-w", "-ansi"};
+// `-f<flag>` and `-fno-<flag>`
+constexpr std::array<std::string_view, 46> kCompileFlags = {
+    "PIC", "pic", "PIE", "pie", "exceptions", "cxx-exceptions", "rtti",
+    "asynchronous-unwind-tables", "unwind-tables", "common", "builtin",
+    "strict-aliasing", "strict-overflow", "wrapv", "trapv", "signed-char",
+    "unsigned-char", "short-enums", "omit-frame-pointer", "inline",
+    "inline-functions", "unroll-loops", "tree-vectorize", "vectorize",
+    "slp-vectorize", "fast-math", "finite-math-only", "math-errno",
+    "function-sections", "data-sections", "merge-constants",
+    "delete-null-pointer-checks", "semantic-interposition", "plt",
+    "stack-protector", "stack-protector-strong", "stack-protector-all",
+    "stack-clash-protection", "threadsafe-statics", "visibility-inlines-hidden",
+    "permissive", "char8_t", "coroutines", "sized-deallocation",
+    "diagnostics-color", "color-diagnostics"};
+
+template <std::size_t N>
+bool contains(const std::array<std::string_view, N> &list,
+              std::string_view arg) {
+  return std::find(list.begin(), list.end(), arg) != list.end();
+}
+
+template <std::size_t N>
+bool starts_with_any(const std::array<std::string_view, N> &prefixes,
+                     std::string_view arg) {
+  return std::any_of(prefixes.begin(), prefixes.end(),
+                     [&](std::string_view prefix) {
+                       return arg.substr(0, prefix.size()) == prefix;
+                     });
+}
+
+bool starts_with(std::string_view arg, std::string_view prefix) {
+  return arg.substr(0, prefix.size()) == prefix;
+}
+
+// Names, numbers and lists such as `x86-64`, `c++17` or `armv8.2-a+crc`
+bool is_option_text(std::string_view text) {
+  return !text.empty() && text[0] != '.' &&
+         std::all_of(text.begin(), text.end(), [](char c) {
+           return std::isalnum(static_cast<unsigned char>(c)) != 0 ||
+                  std::string_view("_-+=.,").find(c) != std::string_view::npos;
+         });
+}
+
+// Value of a CompileWithValue option, values that look like paths are
+// rejected
+bool is_option_value(std::string_view value) {
+  return is_option_text(value) && value[0] != '-';
+}
+
+bool is_compile_option(std::string_view arg) {
+  if (contains(kCompile, arg)) {
+    return true;
+  }
+  if (starts_with(arg, "-O") || starts_with(arg, "-g")) {
+    // `-gsplit-dwarf` writes a `.dwo` file next to the object
+    return (arg.size() == 2 || is_option_text(arg.substr(2))) &&
+           arg != "-gsplit-dwarf";
+  }
+  if (starts_with(arg, "-W")) {
+    // `-Wa,`, `-Wl,` and `-Wp,` pass options to other tools
+    return (arg.size() == 2 || is_option_text(arg.substr(2))) &&
+           arg.find(',') == std::string_view::npos;
+  }
+  if (starts_with(arg, "-std=") || starts_with(arg, "--target=")) {
+    return is_option_value(arg.substr(arg.find('=') + 1));
+  }
+  if (starts_with(arg, "-m")) {
+    // `-mllvm` passes options to the backend
+    return is_option_text(arg.substr(2)) && !starts_with(arg, "-mllvm");
+  }
+  if (starts_with(arg, "-f")) {
+    std::string_view flag = arg.substr(2);
+    if (starts_with(flag, "no-")) {
+      flag = flag.substr(3);
+    }
+    return contains(kCompileFlags, flag);
+  }
+  return false;
+}
+
+ArgumentKind classify(std::string_view arg) {
+  if (arg.empty() || arg[0] != '-') {
+    return ArgumentKind::Unsupported;
+  }
+  if (contains(kPreprocessWithValue, arg)) {
+    return ArgumentKind::PreprocessWithValue;
+  }
+  if (contains(kPreprocess, arg)) {
+    return ArgumentKind::Preprocess;
+  }
+  if (contains(kCompileWithValue, arg)) {
+    return ArgumentKind::CompileWithValue;
+  }
+  // `-include` is only supported with a separate value
+  if (starts_with(arg, "-include")) {
+    return ArgumentKind::Unsupported;
+  }
+  if (starts_with_any(kPreprocessPrefixes, arg)) {
+    return ArgumentKind::Preprocess;
+  }
+  if (is_compile_option(arg)) {
+    return ArgumentKind::Compile;
+  }
+  return ArgumentKind::Unsupported;
+}
+
+// Extension of the preprocessed source, empty for unsupported sources
+std::string preprocessed_extension(const std::string &source) {
+  const std::string extension = fs::path(source).extension().string();
+  if (extension == ".c") {
+    return ".i";
+  }
+  if (extension == ".cpp" || extension == ".cc" || extension == ".cxx" ||
+      extension == ".c++" || extension == ".cp" || extension == ".C" ||
+      extension == ".CPP") {
+    return ".ii";
+  }
+  return "";
+}
+
+bool is_compiler_name(const std::string &name) {
+  return !name.empty() && name.find('/') == std::string::npos &&
+         name.find('\\') == std::string::npos;
+}
+
+struct CompileRequest {
+  std::vector<std::string> compile;
+  std::string extension;
+  std::string source;
+};
+
+struct CompileResponse {
+  int exit_status{-1};
+  std::string stdout_data;
+  std::string stderr_data;
+  std::string object;
+};
+
+std::string encode(const CompileRequest &request) {
+  buildcc::internal::BinaryWriter writer(kRequestMagic, kVersion);
+  to_binary(writer, request.compile);
+  writer.WriteString(request.extension);
+  writer.WriteString(request.source);
+  return writer.Finish();
+}
+
+bool decode(std::string_view data, CompileRequest &request) {
+  if (!buildcc::internal::BinaryReader::Verify(data, kRequestMagic,
+                                               kVersion)) {
+    return false;
+  }
+  buildcc::internal::BinaryReader reader(data);
+  from_binary(reader, request.compile);
+  reader.ReadString(request.extension);
+  reader.ReadString(request.source);
+  return reader.IsValid() && reader.IsEnd();
+}
+
+std::string encode(const CompileResponse &response) {
+  buildcc::internal::BinaryWriter writer(kResponseMagic, kVersion);
+  writer.WriteU32(static_cast<std::uint32_t>(response.exit_status));
+  writer.WriteString(response.stdout_data);
+  writer.WriteString(response.stderr_data);
+  writer.WriteString(response.object);
+  return writer.Finish();
+}
+
+bool decode(std::string_view data, CompileResponse &response) {
+  if (!buildcc::internal::BinaryReader::Verify(data, kResponseMagic,
+                                               kVersion)) {
+    return false;
+  }
+  buildcc::internal::BinaryReader reader(data);
+  response.exit_status = static_cast<int>(reader.ReadU32());
+  reader.ReadString(response.stdout_data);
+  reader.ReadString(response.stderr_data);
+  reader.ReadString(response.object);
+  return reader.IsValid() && reader.IsEnd();
+}
+
+// Leading unsigned integer of `data`
+buildcc::env::optional<unsigned int> parse_uint(std::string_view data) {
+  unsigned int value = 0;
+  const auto [end, error] =
+      std::from_chars(data.data(), data.data() + data.size(), value);
+  if (error != std::errc() || end == data.data()) {
+    return {};
+  }
+  return value;
+}
+
+struct WorkerSpec {
+  std::string url;
+  // Reported by the worker when empty
+  buildcc::env::optional<unsigned int> slots;
+};
+
+buildcc::env::optional<WorkerSpec> parse_worker(const std::string &worker) {
+  WorkerSpec spec;
+  std::string host_port = worker;
+  const std::size_t slash = worker.rfind('/');
+  if (slash != std::string::npos) {
+    const std::string_view slots = std::string_view(worker).substr(slash + 1);
+    spec.slots = parse_uint(slots);
+    if (!spec.slots.has_value() || spec.slots.value() == 0 ||
+        std::to_string(spec.slots.value()) != slots) {
+      return {};
+    }
+    host_port = worker.substr(0, slash);
+  }
+  if (host_port.empty()) {
+    return {};
+  }
+  // `host` and `[ipv6]` use the default port
+  if (host_port.find(':') == std::string::npos || host_port.back() == ']') {
+    host_port +=
+        fmt::format(":{}", buildcc::internal::DistCompile::kDefaultPort);
+  }
+  spec.url = "http://" + host_port;
+  return spec;
+}
+
+bool save_object(const fs::path &object, const std::string &data) {
+  // Never leaves a partial object behind
+  const fs::path temp = object.string() + ".dist.tmp";
+  std::error_code errcode;
+  if (!buildcc::env::save_file(buildcc::path_as_string(temp).c_str(), data,
+                               true)) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  fs::rename(temp, object, errcode);
+  if (errcode) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  return true;
+}
+
+struct Worker {
+  std::string name;
+  std::unique_ptr<buildcc::env::HttpClient> client;
+  unsigned int slots{0};
+  // Guarded by DistCompileState::mutex
+  unsigned int busy{0};
+  std::uint32_t consecutive_errors{0};
+  bool enabled{true};
+};
+
+struct Job {
+  buildcc::internal::DistCompileCommand command;
+  buildcc::env::CommandLine command_line;
+  buildcc::env::Command::ExitCallback on_exit;
+  buildcc::BuildContext *context{nullptr};
+  std::size_t worker{0};
+};
+
+struct DistCompileState {
+  std::atomic<bool> enabled{false};
+  // Only modified by Init and Deinit
+  std::vector<Worker> workers;
+  std::vector<std::thread> dispatchers;
+
+  // Guards everything below and the slots of the workers
+  std::mutex mutex;
+  buildcc::internal::DistCompileStats stats;
+  std::deque<Job> jobs;
+  bool stop{false};
+  std::condition_variable queued_cv;
+};
+
+DistCompileState &GetState() {
+  static DistCompileState state;
+  return state;
+}
+
+void release_worker(std::size_t index, bool error) {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  Worker &worker = state.workers[index];
+  worker.busy--;
+  if (!error) {
+    worker.consecutive_errors = 0;
+    return;
+  }
+  state.stats.errors++;
+  worker.consecutive_errors++;
+  if (worker.enabled && worker.consecutive_errors >= kMaxConsecutiveErrors) {
+    worker.enabled = false;
+    buildcc::env::log_warning(
+        __FUNCTION__,
+        fmt::format("Worker {} is unreachable, disabled", worker.name));
+  }
+}
+
+// Returns false when the job should be compiled locally
+bool compile_remote(const Job &job) {
+  auto &state = GetState();
+  const Worker &worker = state.workers[job.worker];
+
+  CompileRequest request;
+  request.compile = job.command.compile;
+  request.extension = job.command.extension;
+  std::vector<std::string> preprocessed;
+  if (!buildcc::env::Command::Execute(job.command.preprocess, &preprocessed,
+                                      nullptr, nullptr, job.context)) {
+    // Errors in the source are reported by the local compile
+    release_worker(job.worker, false);
+    return false;
+  }
+  for (const auto &data : preprocessed) {
+    request.source += data;
+  }
+
+  const auto response =
+      worker.client->Request("POST", kCompilePath, encode(request));
+  // Busy workers and rejected commands are not errors
+  release_worker(job.worker, !response.has_value() ||
+                                 (response->status >= 500 &&
+                                  response->status != 503));
+  CompileResponse result;
+  if (!response.has_value() || response->status != 200 ||
+      !decode(response->body, result)) {
+    buildcc::env::log_debug(
+        __FUNCTION__,
+        fmt::format("Worker {} did not compile {}", worker.name,
+                    job.command.output));
+    return false;
+  }
+  // Remote failures are retried locally, the local compiler reports the
+  // errors of the source
+  if (result.exit_status != 0 ||
+      !save_object(job.command.output, result.object)) {
+    return false;
+  }
+
+  buildcc::env::OutputBuffer stdout_buffer;
+  buildcc::env::OutputBuffer stderr_buffer;
+  stdout_buffer.Append(result.stdout_data.data(), result.stdout_data.size());
+  stderr_buffer.Append(result.stderr_data.data(), result.stderr_data.size());
+  buildcc::env::JobOutput::Print(stdout_buffer, stderr_buffer);
+  return true;
+}
+
+void dispatch(const Job &job) {
+  auto &state = GetState();
+  try {
+    if (compile_remote(job)) {
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stats.remote++;
+      }
+      job.on_exit(true, buildcc::env::CommandStats());
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.stats.local_fallbacks++;
+    }
+    buildcc::env::Command::ExecuteAsync(job.command_line, job.on_exit,
+                                        job.context);
+  } catch (...) {
+    job.on_exit(false, buildcc::env::CommandStats());
+  }
+}
+
+void dispatch_loop() {
+  auto &state = GetState();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.queued_cv.wait(lock,
+                         [&]() { return state.stop || !state.jobs.empty(); });
+    if (state.jobs.empty()) {
+      break;
+    }
+    Job job = std::move(state.jobs.front());
+    state.jobs.pop_front();
+
+    lock.unlock();
+    dispatch(job);
+    lock.lock();
+  }
+}
+
+} // namespace
+
+namespace buildcc::internal {
+
+// DistCompileCommand
+
+env::optional<DistCompileCommand>
+DistCompileCommand::Split(const env::CommandLine &command_line) {
+  const auto &arguments = command_line.GetArguments();
+  if (arguments.size() < 2) {
+    return {};
+  }
+  const std::string compiler = fs::path(arguments[0]).filename().string();
+  if (!is_compiler_name(compiler)) {
+    return {};
+  }
+
+  DistCompileCommand command;
+  std::vector<std::string> preprocess = {arguments[0]};
+  command.compile = {compiler};
+  bool compile_only = false;
+  env::optional<std::string> output;
+  env::optional<std::string> input;
+  for (std::size_t i = 1; i < arguments.size(); i++) {
+    const std::string &arg = arguments[i];
+    if (arg == "-c") {
+      compile_only = true;
+      continue;
+    }
+    if (arg == "-o") {
+      if (i + 1 == arguments.size() || output.has_value()) {
+        return {};
+      }
+      output = arguments[++i];
+      continue;
+    }
+    if (!arg.empty() && arg[0] != '-') {
+      if (input.has_value()) {
+        return {};
+      }
+      input = arg;
+      continue;
+    }
+
+    const ArgumentKind kind = classify(arg);
+    switch (kind) {
+    case ArgumentKind::Compile:
+      preprocess.push_back(arg);
+      command.compile.push_back(arg);
+      break;
+    case ArgumentKind::Preprocess:
+      preprocess.push_back(arg);
+      break;
+    case ArgumentKind::CompileWithValue:
+    case ArgumentKind::PreprocessWithValue:
+      if (i + 1 == arguments.size() ||
+          (kind == ArgumentKind::CompileWithValue &&
+           !is_option_value(arguments[i + 1]))) {
+        return {};
+      }
+      preprocess.push_back(arg);
+      preprocess.push_back(arguments[i + 1]);
+      if (kind == ArgumentKind::CompileWithValue) {
+        command.compile.push_back(arg);
+        command.compile.push_back(arguments[i + 1]);
+      }
+      i++;
+      break;
+    case ArgumentKind::Unsupported:
+    default:
+      return {};
+    }
+  }
+  if (!compile_only || !output.has_value() || !input.has_value()) {
+    return {};
+  }
+  command.extension = preprocessed_extension(input.value());
+  if (command.extension.empty()) {
+    return {};
+  }
+
+  preprocess.push_back("-E");
+  preprocess.push_back(input.value());
+  const auto &working_directory = command_line.GetWorkingDirectory();
+  command.preprocess =
+      env::CommandLine(std::move(preprocess), working_directory);
+  command.output = output.value();
+  if (command.output.is_relative() && working_directory.has_value()) {
+    command.output = working_directory.value() / command.output;
+  }
+  return command;
+}
+
+// DistCompile
+
+bool DistCompile::Init(const std::vector<std::string> &workers,
+                       std::chrono::milliseconds timeout) {
+  Deinit();
+  std::vector<Worker> connected;
+  for (const auto &name : workers) {
+    const auto spec = parse_worker(name);
+    if (!spec.has_value() || !env::HttpClient(spec->url, timeout).IsValid()) {
+      return false;
+    }
+
+    env::HttpClient status_client(spec->url,
+                                  std::min(timeout, kStatusTimeout));
+    const auto status = status_client.Request("GET", kStatusPath);
+    const auto reported_slots =
+        status.has_value() && status->status == 200
+            ? parse_uint(status->body)
+            : env::optional<unsigned int>();
+    if (!reported_slots.has_value()) {
+      env::log_warning(__FUNCTION__,
+                       fmt::format("Worker {} is unreachable", name));
+      continue;
+    }
+
+    Worker worker;
+    worker.name = name;
+    worker.client = std::make_unique<env::HttpClient>(spec->url, timeout);
+    worker.slots = spec->slots.value_or(reported_slots.value());
+    if (worker.slots != 0) {
+      connected.push_back(std::move(worker));
+    }
+  }
+
+  auto &state = GetState();
+  unsigned int slots = 0;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.workers = std::move(connected);
+    state.stats = DistCompileStats();
+    state.stop = false;
+    for (const auto &worker : state.workers) {
+      slots += worker.slots;
+    }
+  }
+  // Every job queued holds a slot, a dispatch thread is always available
+  for (unsigned int i = 0; i < slots; i++) {
+    state.dispatchers.emplace_back(dispatch_loop);
+  }
+  state.enabled.store(slots != 0);
+  return true;
+}
+
+void DistCompile::Deinit() {
+  auto &state = GetState();
+  state.enabled.store(false);
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stop = true;
+  }
+  state.queued_cv.notify_all();
+  for (auto &dispatcher : state.dispatchers) {
+    dispatcher.join();
+  }
+  state.dispatchers.clear();
+  state.workers.clear();
+}
+
+bool DistCompile::IsEnabled() { return GetState().enabled.load(); }
+
+bool DistCompile::ExecuteAsync(const env::CommandLine &command_line,
+                               const env::Command::ExitCallback &on_exit,
+                               BuildContext *context) {
+  auto &state = GetState();
+  if (!state.enabled.load()) {
+    return false;
+  }
+  auto command = DistCompileCommand::Split(command_line);
+  if (!command.has_value()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  // Least loaded worker relative to its slots
+  std::size_t selected = state.workers.size();
+  for (std::size_t i = 0; i < state.workers.size(); i++) {
+    const Worker &worker = state.workers[i];
+    if (!worker.enabled || worker.busy >= worker.slots) {
+      continue;
+    }
+    if (selected == state.workers.size() ||
+        worker.busy * state.workers[selected].slots <
+            state.workers[selected].busy * worker.slots) {
+      selected = i;
+    }
+  }
+  if (selected == state.workers.size()) {
+    return false;
+  }
+
+  state.workers[selected].busy++;
+  state.jobs.push_back(Job{std::move(command.value()), command_line, on_exit,
+                           context, selected});
+  state.queued_cv.notify_one();
+  return true;
+}
+
+DistCompileStats DistCompile::GetStats() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.stats;
+}
+
+unsigned int DistCompile::GetSlots() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  unsigned int slots = 0;
+  for (const auto &worker : state.workers) {
+    if (worker.enabled) {
+      slots += worker.slots;
+    }
+  }
+  return slots;
+}
+
+// DistCompileWorker
+
+env::HttpResponse DistCompileWorker::Handle(const env::HttpRequest &request) {
+  if (request.path == kStatusPath && request.method == "GET") {
+    return {200, fmt::format("{} {}", slots_, busy_.load())};
+  }
+  if (request.path == kCompilePath && request.method == "POST") {
+    return Compile(request.body);
+  }
+  return {404, {}};
+}
+
+env::HttpResponse DistCompileWorker::Compile(const std::string &body) {
+  CompileRequest request;
+  if (!decode(body, request) || request.compile.empty() ||
+      (request.extension != ".i" && request.extension != ".ii")) {
+    return {400, "Invalid request"};
+  }
+  const std::string &compiler = request.compile.front();
+  if (!is_compiler_name(compiler) ||
+      std::find(compilers_.begin(), compilers_.end(), compiler) ==
+          compilers_.end()) {
+    return {403, fmt::format("Compiler {} is not allowed", compiler)};
+  }
+  for (std::size_t i = 1; i < request.compile.size(); i++) {
+    const ArgumentKind kind = classify(request.compile[i]);
+    if (kind == ArgumentKind::CompileWithValue &&
+        i + 1 < request.compile.size() &&
+        is_option_value(request.compile[i + 1])) {
+      i++;
+    } else if (kind != ArgumentKind::Compile) {
+      return {403, fmt::format("Argument {} is not allowed",
+                               request.compile[i])};
+    }
+  }
+  if (!env::ProcessReaper::IsEnabled()) {
+    return {500, "ProcessReaper is not enabled"};
+  }
+
+  if (busy_.fetch_add(1) >= slots_) {
+    busy_.fetch_sub(1);
+    return {503, "Busy"};
+  }
+  const fs::path dir = work_dir_ / fmt::format("{}", next_dir_.fetch_add(1));
+  CompileResponse response;
+  bool ran = false;
+  std::error_code errcode;
+  fs::remove_all(dir, errcode);
+  const std::string input = "input" + request.extension;
+  if (fs::create_directories(dir, errcode) &&
+      env::save_file(path_as_string(dir / input).c_str(), request.source,
+                     true)) {
+    std::vector<std::string> arguments = std::move(request.compile);
+    arguments.insert(arguments.end(), {"-c", input, "-o", kObjectName});
+
+    auto exited = std::make_shared<std::promise<env::ProcessExit>>();
+    auto future = exited->get_future();
+    // Written by the reaper thread before the exit is set
+    auto output = std::make_shared<CompileResponse>();
+    ran = env::ProcessReaper::Spawn(
+              arguments, path_as_string(dir),
+              [output](const char *bytes, std::size_t n) {
+                output->stdout_data.append(bytes, n);
+              },
+              [output](const char *bytes, std::size_t n) {
+                output->stderr_data.append(bytes, n);
+              },
+              [exited](const env::ProcessExit &exit) {
+                exited->set_value(exit);
+              }) >= 0;
+    if (ran) {
+      response.exit_status = future.get().exit_status;
+      response.stdout_data = std::move(output->stdout_data);
+      response.stderr_data = std::move(output->stderr_data);
+      if (response.exit_status == 0) {
+        ran = env::load_file(path_as_string(dir / kObjectName).c_str(), true,
+                             &response.object);
+      }
+    }
+  }
+  fs::remove_all(dir, errcode);
+  busy_.fetch_sub(1);
+  if (!ran) {
+    return {500, fmt::format("Could not run {}", compiler)};
+  }
+  compiles_++;
+  return {200, encode(response)};
+}
+
+} // namespace buildcc::internal
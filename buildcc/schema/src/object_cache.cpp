@@ -0,0 +1,718 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "schema/object_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <utility>
+
+#include "env/hash.h"
+#include "env/host_os.h"
+
+#include "schema/binary_stream.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// "BuildCC Manifest"
+constexpr const char *const kMagic = "BCCM";
+// NOTE, Update this when the binary layout or the cache key changes
+constexpr std::uint32_t kVersion = 3;
+
+// Every entry contains atleast the object name and the input count
+constexpr std::size_t kMinEntrySize = 8;
+// Every input contains atleast the path length and the hash
+constexpr std::size_t kMinInputSize = 12;
+
+constexpr const char *const kManifestFile = "manifest";
+constexpr const char *const kObjectExt = ".o";
+// Objects of a key compiled from different inputs (other branches, other
+// configurations of generated headers etc)
+constexpr std::size_t kMaxEntries = 16;
+// Trim evicts keys until the cache is below this fraction of its maximum size
+// so that every Store does not trim again
+constexpr double kTrimRatio = 0.9;
+// Replaces the base directory in keys
+constexpr const char *const kBaseDirToken = "{base_dir}";
+
+struct HashedInput {
+  std::string stamp;
+  std::uint64_t hash{0};
+};
+
+struct ObjectCacheState {
+  std::atomic<bool> enabled{false};
+  // Guards everything below
+  std::mutex mutex;
+  fs::path cache_dir;
+  std::uint64_t max_size_bytes{0};
+  buildcc::ObjectCacheLink link{buildcc::ObjectCacheLink::Reflink};
+  // Set independently of Init, see SetBaseDir
+  std::string base_dir;
+  buildcc::internal::ObjectCacheStats stats;
+  std::unordered_map<std::string, HashedInput> input_hashes;
+  std::unordered_map<std::string, std::string> compiler_identities;
+
+  // Serializes updates of manifests within the process
+  std::mutex manifest_mutex;
+  std::mutex trim_mutex;
+  std::atomic<std::uint64_t> temp_counter{0};
+};
+
+ObjectCacheState &GetState() {
+  static ObjectCacheState state;
+  return state;
+}
+
+std::string get_base_dir() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.base_dir;
+}
+
+bool is_separator(char c) { return c == '/' || c == '\\'; }
+
+// `base_dir` is only replaced when it is followed by a separator or ends the
+// path (`/src/a` must not match `/src/ab/c`)
+bool is_path_end(const std::string &data, std::size_t pos) {
+  return pos == data.size() || is_separator(data[pos]) || data[pos] == ' ' ||
+         data[pos] == '"' || data[pos] == '\'';
+}
+
+std::string replace_base_dir(const std::string &command,
+                             const std::string &base_dir) {
+  if (base_dir.empty()) {
+    return command;
+  }
+  std::string replaced;
+  std::size_t start = 0;
+  std::size_t pos = command.find(base_dir);
+  while (pos != std::string::npos) {
+    const std::size_t end = pos + base_dir.size();
+    if (is_path_end(command, end)) {
+      replaced.append(command, start, pos - start);
+      replaced += kBaseDirToken;
+      start = end;
+    }
+    pos = command.find(base_dir, end);
+  }
+  replaced.append(command, start, std::string::npos);
+  return replaced;
+}
+
+std::string relative_to_base_dir(const std::string &path,
+                                 const std::string &base_dir) {
+  if (base_dir.empty() || path.size() <= base_dir.size() + 1 ||
+      path.compare(0, base_dir.size(), base_dir) != 0 ||
+      !is_separator(path[base_dir.size()])) {
+    return path;
+  }
+  return path.substr(base_dir.size() + 1);
+}
+
+std::string absolute_from_base_dir(const std::string &path,
+                                   const std::string &base_dir) {
+  if (base_dir.empty() || !fs::path(path).is_relative()) {
+    return path;
+  }
+  return buildcc::path_as_string(fs::path(base_dir) / path);
+}
+
+fs::path key_dir(const fs::path &cache_dir, const std::string &key) {
+  return cache_dir / key.substr(0, 2) / key;
+}
+
+// Distinguishes the temporary files of processes sharing the cache
+std::uint64_t process_seed() {
+  static const std::uint64_t seed = []() {
+    std::random_device device;
+    return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+  }();
+  return seed;
+}
+
+fs::path temp_path(const fs::path &path) {
+  auto &state = GetState();
+  const std::uint64_t unique = process_seed() + state.temp_counter++;
+  return path.string() + fmt::format(".{:x}.tmp", unique);
+}
+
+std::string stamp_of(const fs::path &path) {
+  std::error_code errcode;
+  const auto last_write_time = fs::last_write_time(path, errcode);
+  if (errcode) {
+    return {};
+  }
+  const std::uintmax_t size = fs::file_size(path, errcode);
+  if (errcode) {
+    return {};
+  }
+  return fmt::format("{}:{}", last_write_time.time_since_epoch().count(),
+                     size);
+}
+
+// Content hash of an input, rehashed only when its stamp changes
+buildcc::env::optional<std::uint64_t> hash_input(const std::string &path) {
+  auto &state = GetState();
+  const std::string stamp = stamp_of(path);
+  if (stamp.empty()) {
+    return {};
+  }
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const auto iter = state.input_hashes.find(path);
+    if (iter != state.input_hashes.end() && iter->second.stamp == stamp) {
+      return iter->second.hash;
+    }
+  }
+
+  std::uint64_t hash{0};
+  if (!buildcc::env::hash_file(path.c_str(), &hash)) {
+    return {};
+  }
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.input_hashes.insert_or_assign(path, HashedInput{stamp, hash});
+  return hash;
+}
+
+// Searches PATH for compilers without a directory
+fs::path resolve_compiler(const std::string &compiler) {
+  const fs::path path(compiler);
+  if (path.has_parent_path() || compiler.empty()) {
+    return path;
+  }
+  const char *env_path = std::getenv("PATH");
+  if (env_path == nullptr) {
+    return path;
+  }
+
+  constexpr char kSeparator = buildcc::env::is_win() ? ';' : ':';
+  const std::string dirs(env_path);
+  std::size_t start = 0;
+  while (start <= dirs.size()) {
+    std::size_t end = dirs.find(kSeparator, start);
+    if (end == std::string::npos) {
+      end = dirs.size();
+    }
+    if (end != start) {
+      const fs::path dir(dirs.substr(start, end - start));
+      for (const char *ext : {"", ".exe"}) {
+        fs::path candidate = dir / (compiler + ext);
+        std::error_code errcode;
+        if (fs::is_regular_file(candidate, errcode)) {
+          return candidate;
+        }
+        if constexpr (!buildcc::env::is_win()) {
+          break;
+        }
+      }
+    }
+    start = end + 1;
+  }
+  return path;
+}
+
+std::string compiler_identity(const std::string &compiler) {
+  auto &state = GetState();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const auto iter = state.compiler_identities.find(compiler);
+    if (iter != state.compiler_identities.end()) {
+      return iter->second;
+    }
+  }
+
+  // Identified by its contents, the same compiler is installed at different
+  // times (and possibly paths) on other machines sharing the remote cache
+  // The name is kept, drivers such as clang / clang++ are the same binary
+  const fs::path resolved = resolve_compiler(compiler);
+  const auto hash = hash_input(buildcc::path_as_string(resolved));
+  std::string identity =
+      hash.has_value()
+          ? fmt::format("{}|{:016x}", resolved.filename().string(),
+                        hash.value())
+          : compiler;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.compiler_identities.try_emplace(compiler, std::move(identity))
+      .first->second;
+}
+
+#if defined(__linux__) && defined(FICLONE)
+bool reflink_file(const fs::path &from, const fs::path &to) {
+  const int source = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (source < 0) {
+    return false;
+  }
+  const int destination =
+      open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (destination < 0) {
+    close(source);
+    return false;
+  }
+  const bool cloned = ioctl(destination, FICLONE, source) == 0;
+  close(destination);
+  close(source);
+  if (!cloned) {
+    std::error_code errcode;
+    fs::remove(to, errcode);
+  }
+  return cloned;
+}
+#else
+bool reflink_file(const fs::path &from, const fs::path &to) {
+  (void)from;
+  (void)to;
+  return false;
+}
+#endif
+
+// Falls back to a copy when the link cannot be created
+bool place_file(const fs::path &from, const fs::path &to,
+                buildcc::ObjectCacheLink link) {
+  std::error_code errcode;
+  fs::remove(to, errcode);
+  switch (link) {
+  case buildcc::ObjectCacheLink::Hardlink:
+    fs::create_hard_link(from, to, errcode);
+    if (!errcode) {
+      return true;
+    }
+    break;
+  case buildcc::ObjectCacheLink::Reflink:
+    if (reflink_file(from, to)) {
+      return true;
+    }
+    break;
+  case buildcc::ObjectCacheLink::Copy:
+  default:
+    break;
+  }
+  errcode.clear();
+  return fs::copy_file(from, to, fs::copy_options::overwrite_existing,
+                       errcode) &&
+         !errcode;
+}
+
+// Written to a temporary file first, readers never see a partial file
+bool place_file_atomic(const fs::path &from, const fs::path &to,
+                       buildcc::ObjectCacheLink link) {
+  const fs::path temp = temp_path(to);
+  std::error_code errcode;
+  if (!place_file(from, temp, link)) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  fs::rename(temp, to, errcode);
+  if (errcode) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  return true;
+}
+
+std::uint64_t file_size_or_zero(const fs::path &path) {
+  std::error_code errcode;
+  const std::uintmax_t size = fs::file_size(path, errcode);
+  return errcode ? 0 : static_cast<std::uint64_t>(size);
+}
+
+struct KeyUsage {
+  fs::path dir;
+  fs::file_time_type last_used;
+  std::uint64_t size_bytes{0};
+};
+
+// Keys are used when their manifest is written or read
+std::vector<KeyUsage> scan_keys(const fs::path &cache_dir) {
+  std::vector<KeyUsage> keys;
+  std::error_code errcode;
+  for (const auto &prefix : fs::directory_iterator(cache_dir, errcode)) {
+    if (!prefix.is_directory(errcode)) {
+      continue;
+    }
+    for (const auto &key : fs::directory_iterator(prefix.path(), errcode)) {
+      if (!key.is_directory(errcode)) {
+        continue;
+      }
+      KeyUsage usage;
+      usage.dir = key.path();
+      usage.last_used =
+          fs::last_write_time(key.path() / kManifestFile, errcode);
+      if (errcode) {
+        usage.last_used = fs::file_time_type::min();
+      }
+      for (const auto &file : fs::directory_iterator(key.path(), errcode)) {
+        usage.size_bytes += file_size_or_zero(file.path());
+      }
+      keys.push_back(std::move(usage));
+    }
+  }
+  return keys;
+}
+
+} // namespace
+
+namespace buildcc::internal {
+
+// ObjectCacheManifest
+
+bool ObjectCacheManifest::Verify(std::string_view serialized_data) {
+  return BinaryReader::Verify(serialized_data, kMagic, kVersion);
+}
+
+bool ObjectCacheManifest::Load(std::string_view serialized_data) {
+  Entries load;
+  bool loaded = Deserialize(serialized_data, load);
+  if (loaded) {
+    load_ = std::move(load);
+  } else {
+    env::log_warning(__FUNCTION__, "Corrupted object cache manifest");
+  }
+  return loaded;
+}
+
+bool ObjectCacheManifest::Store(const fs::path &absolute_serialized_file) {
+  // Other processes may read the manifest concurrently
+  const fs::path temp = temp_path(absolute_serialized_file);
+  std::error_code errcode;
+  if (!env::save_file(path_as_string(temp).c_str(), Serialize(store_),
+                      true)) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  fs::rename(temp, absolute_serialized_file, errcode);
+  if (errcode) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  return true;
+}
+
+std::string ObjectCacheManifest::Serialize(const Entries &entries) {
+  BinaryWriter writer(kMagic, kVersion);
+  writer.WriteU32(static_cast<std::uint32_t>(entries.size()));
+  for (const auto &entry : entries) {
+    writer.WriteString(entry.object);
+    writer.WriteU32(static_cast<std::uint32_t>(entry.inputs.size()));
+    for (const auto &input : entry.inputs) {
+      writer.WriteString(input.path);
+      writer.WriteU64(input.hash);
+    }
+  }
+  return writer.Finish();
+}
+
+bool ObjectCacheManifest::Deserialize(std::string_view serialized_data,
+                                      Entries &entries) {
+  if (!BinaryReader::Verify(serialized_data, kMagic, kVersion)) {
+    return false;
+  }
+  BinaryReader reader(serialized_data);
+  Entries load;
+  const std::uint32_t count = reader.ReadCount(kMinEntrySize);
+  load.reserve(count);
+  for (std::uint32_t i = 0; i < count && reader.IsValid(); i++) {
+    ObjectCacheEntry entry;
+    reader.ReadString(entry.object);
+    const std::uint32_t inputs = reader.ReadCount(kMinInputSize);
+    for (std::uint32_t j = 0; j < inputs && reader.IsValid(); j++) {
+      ObjectCacheInput input;
+      reader.ReadString(input.path);
+      input.hash = reader.ReadU64();
+      entry.inputs.push_back(std::move(input));
+    }
+    load.push_back(std::move(entry));
+  }
+  if (!reader.IsValid() || !reader.IsEnd()) {
+    return false;
+  }
+  entries = std::move(load);
+  return true;
+}
+
+// ObjectCache
+
+void ObjectCache::Init(const fs::path &cache_dir, std::uint64_t max_size_bytes,
+                       ObjectCacheLink link) {
+  std::error_code errcode;
+  fs::create_directories(cache_dir, errcode);
+  env::assert_fatal(
+      !errcode, fmt::format("Could not create object cache {}", cache_dir));
+
+  std::uint64_t size_bytes = 0;
+  if (max_size_bytes != 0) {
+    for (const auto &key : scan_keys(cache_dir)) {
+      size_bytes += key.size_bytes;
+    }
+  }
+
+  auto &state = GetState();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.cache_dir = cache_dir;
+    state.max_size_bytes = max_size_bytes;
+    state.link = link;
+    state.stats = ObjectCacheStats();
+    state.stats.size_bytes = size_bytes;
+    state.input_hashes.clear();
+    state.compiler_identities.clear();
+  }
+  state.enabled.store(true);
+}
+
+void ObjectCache::Deinit() { GetState().enabled.store(false); }
+
+bool ObjectCache::IsEnabled() { return GetState().enabled.load(); }
+
+void ObjectCache::SetBaseDir(const fs::path &base_dir) {
+  std::string base =
+      base_dir.empty() ? std::string() : path_as_string(base_dir);
+  while (!base.empty() && is_separator(base.back())) {
+    base.pop_back();
+  }
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.base_dir = std::move(base);
+}
+
+std::string ObjectCache::ComputeKey(const std::string &compiler,
+                                    const std::string &command) {
+  const std::string data =
+      fmt::format("{}\n{}\n{}", kVersion, compiler_identity(compiler),
+                  replace_base_dir(command, get_base_dir()));
+  // Keys address shared caches, a collision reuses the wrong object
+  return env::sha256_hex(data);
+}
+
+env::optional<std::vector<std::string>>
+ObjectCache::Fetch(const std::string &key, const fs::path &object) {
+  auto &state = GetState();
+  if (!state.enabled.load()) {
+    return {};
+  }
+  fs::path cache_dir;
+  ObjectCacheLink link;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    cache_dir = state.cache_dir;
+    link = state.link;
+  }
+
+  const fs::path dir = key_dir(cache_dir, key);
+  ObjectCacheManifest manifest(dir / kManifestFile);
+  if (manifest.LoadFromFile()) {
+    for (const auto &entry : manifest.GetLoad()) {
+      if (!InputsUnchanged(entry.inputs) ||
+          !place_file(dir / entry.object, object, link)) {
+        continue;
+      }
+
+      // Least recently used keys are evicted first
+      std::error_code errcode;
+      fs::last_write_time(dir / kManifestFile,
+                          fs::file_time_type::clock::now(), errcode);
+      std::vector<std::string> inputs = InputPaths(entry.inputs);
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.stats.hits++;
+      return inputs;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.stats.misses++;
+  return {};
+}
+
+bool ObjectCache::Store(const std::string &key, const fs::path &object,
+                       const std::vector<std::string> &inputs) {
+  auto &state = GetState();
+  if (!state.enabled.load()) {
+    return false;
+  }
+  fs::path cache_dir;
+  ObjectCacheLink link;
+  std::uint64_t max_size_bytes;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    cache_dir = state.cache_dir;
+    link = state.link;
+    max_size_bytes = state.max_size_bytes;
+  }
+
+  auto hashed_inputs = HashInputs(inputs);
+  if (!hashed_inputs.has_value()) {
+    return false;
+  }
+  ObjectCacheEntry entry;
+  entry.inputs = std::move(hashed_inputs.value());
+  std::string digest;
+  for (const auto &input : entry.inputs) {
+    digest += fmt::format("{}\n{:016x}\n", input.path, input.hash);
+  }
+  entry.object =
+      fmt::format("{:016x}{}", env::hash_bytes(digest), kObjectExt);
+
+  const fs::path dir = key_dir(cache_dir, key);
+  std::int64_t size_delta = 0;
+  bool stored = false;
+  {
+    std::lock_guard<std::mutex> manifest_lock(state.manifest_mutex);
+    std::error_code errcode;
+    fs::create_directories(dir, errcode);
+    if (errcode || !place_file_atomic(object, dir / entry.object, link)) {
+      return false;
+    }
+    size_delta += static_cast<std::int64_t>(file_size_or_zero(object));
+
+    ObjectCacheManifest manifest(dir / kManifestFile);
+    ObjectCacheManifest::Entries entries;
+    if (manifest.LoadFromFile()) {
+      entries = manifest.GetLoad();
+    }
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const ObjectCacheEntry &e) {
+                                   return e.object == entry.object;
+                                 }),
+                  entries.end());
+    entries.insert(entries.begin(), std::move(entry));
+    while (entries.size() > kMaxEntries) {
+      const fs::path evicted = dir / entries.back().object;
+      size_delta -= static_cast<std::int64_t>(file_size_or_zero(evicted));
+      fs::remove(evicted, errcode);
+      entries.pop_back();
+    }
+    manifest.UpdateStore(entries);
+    stored = manifest.StoreToFile();
+  }
+
+  bool trim = false;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.size_bytes = static_cast<std::uint64_t>(std::max<std::int64_t>(
+        0, static_cast<std::int64_t>(state.stats.size_bytes) + size_delta));
+    if (stored) {
+      state.stats.stores++;
+    }
+    trim = max_size_bytes != 0 && state.stats.size_bytes > max_size_bytes;
+  }
+  if (trim) {
+    Trim();
+  }
+  return stored;
+}
+
+void ObjectCache::Trim() {
+  auto &state = GetState();
+  if (!state.enabled.load()) {
+    return;
+  }
+  std::lock_guard<std::mutex> trim_lock(state.trim_mutex);
+  fs::path cache_dir;
+  std::uint64_t max_size_bytes;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    cache_dir = state.cache_dir;
+    max_size_bytes = state.max_size_bytes;
+  }
+
+  std::vector<KeyUsage> keys = scan_keys(cache_dir);
+  std::uint64_t size_bytes = 0;
+  for (const auto &key : keys) {
+    size_bytes += key.size_bytes;
+  }
+
+  std::uint64_t evictions = 0;
+  if (max_size_bytes != 0 && size_bytes > max_size_bytes) {
+    const auto target_bytes = static_cast<std::uint64_t>(
+        static_cast<double>(max_size_bytes) * kTrimRatio);
+    std::sort(keys.begin(), keys.end(),
+              [](const KeyUsage &a, const KeyUsage &b) {
+                return a.last_used < b.last_used;
+              });
+    for (const auto &key : keys) {
+      if (size_bytes <= target_bytes) {
+        break;
+      }
+      std::error_code errcode;
+      fs::remove_all(key.dir, errcode);
+      if (!errcode) {
+        size_bytes -= key.size_bytes;
+        evictions++;
+        // Only removed once all keys of the prefix are evicted
+        fs::remove(key.dir.parent_path(), errcode);
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.stats.size_bytes = size_bytes;
+  state.stats.evictions += evictions;
+}
+
+ObjectCacheStats ObjectCache::GetStats() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.stats;
+}
+
+env::optional<std::vector<ObjectCacheInput>>
+ObjectCache::HashInputs(const std::vector<std::string> &inputs) {
+  const std::string base_dir = get_base_dir();
+  std::vector<ObjectCacheInput> hashed;
+  hashed.reserve(inputs.size());
+  for (const auto &path : inputs) {
+    const auto hash = hash_input(path);
+    if (!hash.has_value()) {
+      return {};
+    }
+    hashed.push_back({relative_to_base_dir(path, base_dir), hash.value()});
+  }
+  return hashed;
+}
+
+bool ObjectCache::InputsUnchanged(const std::vector<ObjectCacheInput> &inputs) {
+  const std::string base_dir = get_base_dir();
+  return std::all_of(inputs.begin(), inputs.end(),
+                     [&](const ObjectCacheInput &input) {
+                       const auto hash = hash_input(
+                           absolute_from_base_dir(input.path, base_dir));
+                       return hash.has_value() && hash.value() == input.hash;
+                     });
+}
+
+std::vector<std::string>
+ObjectCache::InputPaths(const std::vector<ObjectCacheInput> &inputs) {
+  const std::string base_dir = get_base_dir();
+  std::vector<std::string> paths;
+  paths.reserve(inputs.size());
+  for (const auto &input : inputs) {
+    paths.push_back(absolute_from_base_dir(input.path, base_dir));
+  }
+  return paths;
+}
+
+} // namespace buildcc::internal
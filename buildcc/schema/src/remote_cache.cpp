@@ -0,0 +1,398 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "schema/remote_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "env/hash.h"
+
+namespace {
+
+// NOTE, Update this when the manifest or the cache key changes
+constexpr std::uint32_t kVersion = 1;
+constexpr const char *const kActionPrefix = "/ac/";
+constexpr const char *const kCasPrefix = "/cas/";
+constexpr std::size_t kDigestSize = 64;
+
+// Objects of a key compiled from different inputs
+constexpr std::size_t kMaxEntries = 16;
+// Uploads are dropped while this many bytes are queued
+constexpr std::uint64_t kMaxQueuedBytes = 512ULL * 1024 * 1024;
+// The server is considered unreachable after these many consecutive errors
+constexpr std::uint32_t kMaxConsecutiveErrors = 3;
+
+using buildcc::internal::ObjectCacheEntry;
+using buildcc::internal::ObjectCacheInput;
+using buildcc::internal::ObjectCacheManifest;
+
+struct Upload {
+  std::string key;
+  std::vector<ObjectCacheInput> inputs;
+  std::string data;
+};
+
+struct RemoteCacheState {
+  std::atomic<bool> enabled{false};
+  std::unique_ptr<buildcc::env::HttpClient> client;
+  std::string url;
+  std::atomic<std::uint32_t> consecutive_errors{0};
+
+  // Guards everything below
+  std::mutex mutex;
+  buildcc::internal::RemoteCacheStats stats;
+  std::deque<Upload> uploads;
+  std::uint64_t queued_bytes{0};
+  bool uploading{false};
+  bool stop{false};
+  std::condition_variable queued_cv;
+  std::condition_variable done_cv;
+  std::thread uploader;
+};
+
+RemoteCacheState &GetState() {
+  static RemoteCacheState state;
+  return state;
+}
+
+bool is_digest(std::string_view data) {
+  return data.size() == kDigestSize &&
+         std::all_of(data.begin(), data.end(), [](char c) {
+           return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+         });
+}
+
+bool is_success(const buildcc::env::optional<buildcc::env::HttpResponse> &r) {
+  return r.has_value() && r->status >= 200 && r->status < 300;
+}
+
+// Disables the cache once the server is unreachable, every further request
+// would wait for the timeout
+buildcc::env::optional<buildcc::env::HttpResponse>
+request(const std::string &method, const std::string &path,
+        const std::string &body = {}) {
+  auto &state = GetState();
+  if (!state.enabled.load()) {
+    return {};
+  }
+  auto response = state.client->Request(method, path, body);
+  if (response.has_value()) {
+    state.consecutive_errors.store(0);
+    return response;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.errors++;
+  }
+  if (state.consecutive_errors.fetch_add(1) + 1 >= kMaxConsecutiveErrors &&
+      state.enabled.exchange(false)) {
+    buildcc::env::log_warning(
+        __FUNCTION__,
+        fmt::format("Remote cache {} is unreachable, disabled", state.url));
+  }
+  return response;
+}
+
+bool save_object(const fs::path &object, const std::string &data) {
+  // Never leaves a partial object behind
+  const fs::path temp = object.string() + ".remote.tmp";
+  std::error_code errcode;
+  if (!buildcc::env::save_file(buildcc::path_as_string(temp).c_str(), data,
+                               true)) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  fs::rename(temp, object, errcode);
+  if (errcode) {
+    fs::remove(temp, errcode);
+    return false;
+  }
+  return true;
+}
+
+bool same_inputs(const std::vector<ObjectCacheInput> &a,
+                 const std::vector<ObjectCacheInput> &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const ObjectCacheInput &x, const ObjectCacheInput &y) {
+                      return x.path == y.path && x.hash == y.hash;
+                    });
+}
+
+bool upload(const Upload &upload) {
+  using buildcc::internal::RemoteCache;
+  auto &state = GetState();
+  const std::string digest = buildcc::env::sha256_hex(upload.data);
+  const std::string cas_path = RemoteCache::GetCasPath(digest);
+
+  // Objects are often shared by keys (for example identical sources)
+  const auto exists = request("HEAD", cas_path);
+  if (!exists.has_value()) {
+    return false;
+  }
+  if (exists->status != 200) {
+    if (!is_success(request("PUT", cas_path, upload.data))) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.bytes_uploaded += upload.data.size();
+  }
+
+  // Entries uploaded concurrently by other machines may be lost, the object
+  // is uploaded again when it misses
+  const std::string action_path = RemoteCache::GetActionPath(upload.key);
+  const auto action = request("GET", action_path);
+  if (!action.has_value()) {
+    return false;
+  }
+  ObjectCacheManifest::Entries entries;
+  if (action->status != 200 ||
+      !ObjectCacheManifest::Deserialize(action->body, entries)) {
+    entries.clear();
+  }
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [&](const ObjectCacheEntry &entry) {
+                                 return same_inputs(entry.inputs,
+                                                    upload.inputs);
+                               }),
+                entries.end());
+  entries.insert(entries.begin(), ObjectCacheEntry{upload.inputs, digest});
+  if (entries.size() > kMaxEntries) {
+    entries.resize(kMaxEntries);
+  }
+  return is_success(
+      request("PUT", action_path, ObjectCacheManifest::Serialize(entries)));
+}
+
+void upload_loop() {
+  auto &state = GetState();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.queued_cv.wait(
+        lock, [&]() { return state.stop || !state.uploads.empty(); });
+    if (state.uploads.empty()) {
+      break;
+    }
+    Upload next = std::move(state.uploads.front());
+    state.uploads.pop_front();
+    state.uploading = true;
+
+    lock.unlock();
+    const bool uploaded = upload(next);
+    lock.lock();
+
+    state.uploading = false;
+    state.queued_bytes -= next.data.size();
+    if (uploaded) {
+      state.stats.uploads++;
+    } else {
+      state.stats.upload_failures++;
+    }
+    state.done_cv.notify_all();
+  }
+}
+
+} // namespace
+
+namespace buildcc::internal {
+
+// RemoteCache
+
+bool RemoteCache::Init(const std::string &url, bool upload,
+                       std::chrono::milliseconds timeout,
+                       std::chrono::milliseconds connect_timeout) {
+  Deinit();
+  auto client = std::make_unique<env::HttpClient>(
+      url, timeout, std::min(timeout, connect_timeout));
+  if (!client->IsValid()) {
+    return false;
+  }
+
+  auto &state = GetState();
+  state.client = std::move(client);
+  state.url = url;
+  state.consecutive_errors.store(0);
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats = RemoteCacheStats();
+    state.stop = false;
+  }
+  if (upload) {
+    state.uploader = std::thread(upload_loop);
+  }
+  state.enabled.store(true);
+  return true;
+}
+
+void RemoteCache::Deinit() {
+  auto &state = GetState();
+  if (state.uploader.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.stop = true;
+    }
+    state.queued_cv.notify_all();
+    state.uploader.join();
+  }
+  state.enabled.store(false);
+  state.client.reset();
+}
+
+bool RemoteCache::IsEnabled() { return GetState().enabled.load(); }
+
+env::optional<std::vector<std::string>>
+RemoteCache::Fetch(const std::string &key, const fs::path &object) {
+  auto &state = GetState();
+  if (!state.enabled.load()) {
+    return {};
+  }
+
+  const auto action = request("GET", GetActionPath(key));
+  ObjectCacheManifest::Entries entries;
+  if (action.has_value() && action->status == 200 &&
+      !ObjectCacheManifest::Deserialize(action->body, entries)) {
+    env::log_warning(__FUNCTION__, "Corrupted remote cache manifest");
+  }
+  for (const auto &entry : entries) {
+    if (!is_digest(entry.object) ||
+        !ObjectCache::InputsUnchanged(entry.inputs)) {
+      continue;
+    }
+    const auto contents = request("GET", GetCasPath(entry.object));
+    if (!contents.has_value() || contents->status != 200 ||
+        env::sha256_hex(contents->body) != entry.object ||
+        !save_object(object, contents->body)) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.hits++;
+    state.stats.bytes_downloaded += contents->body.size();
+    return ObjectCache::InputPaths(entry.inputs);
+  }
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.stats.misses++;
+  return {};
+}
+
+bool RemoteCache::Store(const std::string &key, const fs::path &object,
+                        const std::vector<std::string> &inputs) {
+  auto &state = GetState();
+  if (!state.enabled.load() || !state.uploader.joinable()) {
+    return false;
+  }
+  auto hashed_inputs = ObjectCache::HashInputs(inputs);
+  std::string data;
+  if (!hashed_inputs.has_value() ||
+      !env::load_file(path_as_string(object).c_str(), true, &data)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.queued_bytes + data.size() > kMaxQueuedBytes) {
+    state.stats.upload_failures++;
+    return false;
+  }
+  state.queued_bytes += data.size();
+  state.uploads.push_back(
+      Upload{key, std::move(hashed_inputs.value()), std::move(data)});
+  state.queued_cv.notify_one();
+  return true;
+}
+
+void RemoteCache::Flush() {
+  auto &state = GetState();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  state.done_cv.wait(lock, [&]() {
+    return state.uploads.empty() && !state.uploading;
+  });
+}
+
+RemoteCacheStats RemoteCache::GetStats() {
+  auto &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.stats;
+}
+
+std::string RemoteCache::GetActionPath(const std::string &key) {
+  return kActionPrefix +
+         env::sha256_hex(fmt::format("buildcc/{}\n{}", kVersion, key));
+}
+
+std::string RemoteCache::GetCasPath(const std::string &digest) {
+  return kCasPrefix + digest;
+}
+
+// RemoteCacheServer
+
+std::string RemoteCacheServer::GetUrl() const {
+  return fmt::format("http://127.0.0.1:{}", server_.GetPort());
+}
+
+std::size_t RemoteCacheServer::GetActionCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ac_.size();
+}
+
+std::size_t RemoteCacheServer::GetCasCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cas_.size();
+}
+
+env::HttpResponse
+RemoteCacheServer::Handle(const env::HttpRequest &request) {
+  std::string_view path(request.path);
+  std::unordered_map<std::string, std::string> *store = nullptr;
+  bool cas = false;
+  if (path.substr(0, 4) == kActionPrefix) {
+    store = &ac_;
+    path.remove_prefix(4);
+  } else if (path.substr(0, 5) == kCasPrefix) {
+    store = &cas_;
+    cas = true;
+    path.remove_prefix(5);
+  }
+  if (store == nullptr || !is_digest(path)) {
+    return {400, "Invalid key"};
+  }
+
+  const std::string key(path);
+  if (request.method == "GET" || request.method == "HEAD") {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto iter = store->find(key);
+    if (iter == store->end()) {
+      return {404, {}};
+    }
+    return {200, iter->second};
+  }
+  if (request.method == "PUT") {
+    if (cas && env::sha256_hex(request.body) != key) {
+      return {400, "Digest mismatch"};
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    store->insert_or_assign(key, request.body);
+    return {200, {}};
+  }
+  return {405, {}};
+}
+
+} // namespace buildcc::internal
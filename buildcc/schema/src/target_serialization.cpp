@@ -16,9 +16,30 @@
 
 #include "schema/target_serialization.h"
 
+#include <atomic>
+
+namespace {
+
+// "BuildCC Target"
+constexpr const char *const kMagic = "BCCT";
+// NOTE, Update this when TargetSchema binary layout changes
+constexpr std::uint32_t kVersion = 3;
+
+constexpr const char *const kJsonExportExtension = ".json";
+
+std::atomic<bool> json_export_{false};
+
+} // namespace
+
 namespace buildcc::internal {
 
 // PUBLIC
+void TargetSerialization::EnableJsonExport(bool enable) {
+  json_export_.store(enable);
+}
+
+bool TargetSerialization::IsJsonExportEnabled() { return json_export_.load(); }
+
 void TargetSerialization::UpdatePchCompiled(const TargetSchema &store) {
   store_.pchs = store.pchs;
   store_.pch_compiled = true;
@@ -31,6 +52,12 @@ void TargetSerialization::AddSource(const std::string &source,
   store_.sources.Emplace(source, hash);
 }
 
+void TargetSerialization::AddObjectInfo(const std::string &source,
+                                        const TargetSchema::ObjectInfo &info) {
+  std::scoped_lock guard(add_source_mutex);
+  store_.objects.insert_or_assign(source, info);
+}
+
 void TargetSerialization::UpdateTargetCompiled() {
   store_.target_linked = true;
 }
@@ -40,36 +67,46 @@ void TargetSerialization::UpdateStore(const TargetSchema &store) {
   temp.pchs = store_.pchs;
   temp.pch_compiled = store_.pch_compiled;
   temp.sources = store_.sources;
+  temp.objects = store_.objects;
   temp.target_linked = store_.target_linked;
   store_ = std::move(temp);
 }
 
 // PRIVATE
-bool TargetSerialization::Verify(const std::string &serialized_data) {
-  (void)serialized_data;
-  return true;
+bool TargetSerialization::Verify(std::string_view serialized_data) {
+  return BinaryReader::Verify(serialized_data, kMagic, kVersion);
 }
 
-bool TargetSerialization::Load(const std::string &serialized_data) {
-  json j = json::parse(serialized_data, nullptr, false);
-  bool loaded = !j.is_discarded();
+bool TargetSerialization::Load(std::string_view serialized_data) {
+  BinaryReader reader(serialized_data);
+  TargetSchema load;
+  from_binary(reader, load);
 
+  // Truncated or trailing data means the layout did not match
+  bool loaded = reader.IsValid() && reader.IsEnd();
   if (loaded) {
-    try {
-      load_ = j.get<TargetSchema>();
-    } catch (const std::exception &e) {
-      env::log_critical(__FUNCTION__, e.what());
-      loaded = false;
-    }
+    load_ = std::move(load);
+  } else {
+    env::log_critical(__FUNCTION__, "Corrupted binary target schema");
   }
   return loaded;
 }
 
 bool TargetSerialization::Store(const fs::path &absolute_serialized_file) {
-  json j = store_;
-  auto data = j.dump(4);
-  return env::save_file(path_as_string(absolute_serialized_file).c_str(), data,
-                        false);
+  BinaryWriter writer(kMagic, kVersion);
+  to_binary(writer, store_);
+  const std::string &data = writer.Finish();
+  bool stored = env::save_file(
+      path_as_string(absolute_serialized_file).c_str(), data, true);
+
+  if (stored && IsJsonExportEnabled()) {
+    json j = store_;
+    stored = env::save_file(
+        (path_as_string(absolute_serialized_file) + kJsonExportExtension)
+            .c_str(),
+        j.dump(4), false);
+  }
+  return stored;
 }
 
 } // namespace buildcc::internal
@@ -0,0 +1,144 @@
+#include "schema/build_log.h"
+
+#include "schema/binary_stream.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+#include "CppUTestExt/MockSupport.h"
+
+// clang-format off
+TEST_GROUP(BuildLogTestGroup)
+{
+    void teardown() {
+      buildcc::internal::BuildLog::Clear(buildcc::BuildContext::Global());
+      mock().clear();
+    }
+};
+// clang-format on
+
+TEST(BuildLogTestGroup, Record) {
+  using buildcc::internal::BuildLog;
+  const buildcc::BuildContext &context = buildcc::BuildContext::Global();
+
+  // Disabled by default
+  BuildLog::Record(context, "hello.o", 100);
+  CHECK_FALSE(BuildLog::GetDuration(context, "hello.o").has_value());
+
+  BuildLog::Enable(context, true);
+  BuildLog::Record(context, "hello.o", 100);
+  BuildLog::Record(context, "hello.o", 120);
+  BuildLog::Record(context, "hello.exe", 30);
+  CHECK_EQUAL(BuildLog::GetDuration(context, "hello.o").value(), 120);
+  CHECK_EQUAL(BuildLog::GetDuration(context, "hello.exe").value(), 30);
+  CHECK_FALSE(BuildLog::GetDuration(context, "world.o").has_value());
+
+  // Peak memory is optional
+  CHECK_FALSE(BuildLog::GetPeakMemory(context, "hello.o").has_value());
+  BuildLog::Record(context, "hello.o", 120, 4096);
+  CHECK_EQUAL(BuildLog::GetPeakMemory(context, "hello.o").value(), 4096);
+
+  BuildLog::Clear(context);
+  CHECK_FALSE(BuildLog::GetDuration(context, "hello.o").has_value());
+  CHECK_FALSE(BuildLog::GetPeakMemory(context, "hello.o").has_value());
+}
+
+TEST(BuildLogTestGroup, RoundTrip) {
+  using buildcc::internal::BuildLog;
+  const buildcc::BuildContext &context = buildcc::BuildContext::Global();
+  constexpr const char *const kLogFile = "dump/BuildLogRoundTrip.bin";
+
+  BuildLog::Enable(context, true);
+  BuildLog::Record(context, "hello.o", 1500, 1024 * 1024);
+  BuildLog::Record(context, "world.o", 20);
+  CHECK_TRUE(BuildLog::StoreToFile(context, kLogFile));
+
+  BuildLog::Clear(context);
+  CHECK_TRUE(BuildLog::LoadFromFile(context, kLogFile));
+  BuildLog::Enable(context, true);
+  CHECK_EQUAL(BuildLog::GetDuration(context, "hello.o").value(), 1500);
+  CHECK_EQUAL(BuildLog::GetDuration(context, "world.o").value(), 20);
+  CHECK_EQUAL(BuildLog::GetPeakMemory(context, "hello.o").value(), 1024 * 1024);
+  CHECK_FALSE(BuildLog::GetPeakMemory(context, "world.o").has_value());
+
+  // Entries that were not rebuilt are retained
+  BuildLog::Record(context, "world.o", 25);
+  CHECK_TRUE(BuildLog::StoreToFile(context, kLogFile));
+  CHECK_TRUE(BuildLog::LoadFromFile(context, kLogFile));
+  CHECK_EQUAL(BuildLog::GetDuration(context, "hello.o").value(), 1500);
+  CHECK_EQUAL(BuildLog::GetDuration(context, "world.o").value(), 25);
+}
+
+TEST(BuildLogTestGroup, Load_Failure) {
+  using buildcc::internal::BuildLog;
+  const buildcc::BuildContext &context = buildcc::BuildContext::Global();
+  constexpr const char *const kLogFile = "dump/BuildLogLoadFailure.bin";
+
+  BuildLog::Enable(context, true);
+  BuildLog::Record(context, "hello.o", 100);
+
+  // Missing file clears the previous entries
+  CHECK_FALSE(BuildLog::LoadFromFile(context, "dump/BuildLogNotFound.bin"));
+  CHECK_FALSE(BuildLog::GetDuration(context, "hello.o").has_value());
+
+  // Valid header, truncated payload
+  buildcc::internal::BinaryWriter writer("BCCL", 2);
+  writer.WriteU32(1);
+  writer.WriteString("hello.o");
+  writer.WriteU64(100);
+  buildcc::env::save_file(kLogFile, writer.Finish(), true);
+  CHECK_FALSE(BuildLog::LoadFromFile(context, kLogFile));
+
+  // Previous version without the peak memory
+  buildcc::internal::BinaryWriter version_writer("BCCL", 1);
+  version_writer.WriteU32(0);
+  buildcc::env::save_file(kLogFile, version_writer.Finish(), true);
+  CHECK_FALSE(BuildLog::LoadFromFile(context, kLogFile));
+}
+
+TEST(BuildLogTestGroup, SeparateContexts) {
+  using buildcc::internal::BuildLog;
+  constexpr const char *const kFirstFile = "dump/BuildLogFirstContext.bin";
+  constexpr const char *const kSecondFile = "dump/BuildLogSecondContext.bin";
+  buildcc::BuildContext first;
+  buildcc::BuildContext second;
+
+  BuildLog::Enable(first, true);
+  BuildLog::Record(first, "hello.o", 100);
+  CHECK_TRUE(BuildLog::StoreToFile(first, kFirstFile));
+  BuildLog::Record(first, "hello.o", 110);
+
+  // Loading and recording in one context does not clobber the other
+  BuildLog::Enable(second, true);
+  CHECK_FALSE(BuildLog::LoadFromFile(second, "dump/BuildLogNotFound.bin"));
+  BuildLog::Record(second, "world.o", 20);
+  CHECK_EQUAL(BuildLog::GetDuration(first, "hello.o").value(), 110);
+  CHECK_FALSE(BuildLog::GetDuration(first, "world.o").has_value());
+  CHECK_FALSE(BuildLog::GetDuration(second, "hello.o").has_value());
+
+  CHECK_TRUE(BuildLog::LoadFromFile(second, kFirstFile));
+  CHECK_EQUAL(BuildLog::GetDuration(second, "hello.o").value(), 100);
+  CHECK_EQUAL(BuildLog::GetDuration(first, "hello.o").value(), 110);
+
+  // Only the entries of the context are stored
+  BuildLog::Enable(first, false);
+  BuildLog::Record(first, "first.o", 1);
+  CHECK_FALSE(BuildLog::GetDuration(first, "first.o").has_value());
+  BuildLog::Record(second, "second.o", 2);
+  CHECK_TRUE(BuildLog::StoreToFile(second, kSecondFile));
+  BuildLog::Clear(second);
+  CHECK_FALSE(BuildLog::IsEnabled(second));
+  CHECK_TRUE(BuildLog::LoadFromFile(second, kSecondFile));
+  CHECK_EQUAL(BuildLog::GetDuration(second, "second.o").value(), 2);
+  CHECK_FALSE(BuildLog::GetDuration(second, "world.o").has_value());
+  CHECK_EQUAL(BuildLog::GetDuration(first, "hello.o").value(), 110);
+
+  BuildLog::Clear(first);
+  BuildLog::Clear(second);
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
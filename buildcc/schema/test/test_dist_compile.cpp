@@ -0,0 +1,422 @@
+#include "schema/dist_compile.h"
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
+#include "env/process_reaper.h"
+#include "env/util.h"
+#include "fmt/format.h"
+
+#include "schema/binary_stream.h"
+
+#include "expect_command.h"
+#include "mock_command_copier.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+#include "CppUTestExt/MockSupport.h"
+
+using buildcc::env::CommandLine;
+using buildcc::env::HttpClient;
+using buildcc::env::HttpRequest;
+using buildcc::env::HttpResponse;
+using buildcc::env::HttpServer;
+using buildcc::internal::DistCompile;
+using buildcc::internal::DistCompileCommand;
+using buildcc::internal::DistCompileWorker;
+
+// clang-format off
+TEST_GROUP(DistCompileTestGroup)
+{
+    void teardown() {
+      DistCompile::Deinit();
+      buildcc::env::ProcessReaper::Deinit();
+      mock().clear();
+    }
+};
+// clang-format on
+
+constexpr std::chrono::milliseconds kTimeout(5000);
+
+static fs::path TestDir(const char *name) {
+  const fs::path dir = fs::absolute("dump/dist_compile") / name;
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+static std::string Worker(std::uint16_t port, const char *slots = "") {
+  return fmt::format("127.0.0.1:{}{}", port, slots);
+}
+
+// Request of a client that does not filter the compile arguments
+static std::string CompileRequest(const std::vector<std::string> &compile) {
+  buildcc::internal::BinaryWriter writer("BDCQ", 1);
+  to_binary(writer, compile);
+  writer.WriteString(".i");
+  writer.WriteString("int main() { return 0; }\n");
+  return writer.Finish();
+}
+
+// Counts the jobs that exited
+class Exits {
+public:
+  buildcc::env::Command::ExitCallback Callback() {
+    return [this](bool success, const buildcc::env::CommandStats &) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      (success ? success_ : failure_)++;
+      cv_.notify_all();
+    };
+  }
+
+  void Wait(int exits) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() { return success_ + failure_ >= exits; });
+  }
+
+  int GetSuccess() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return success_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int success_{0};
+  int failure_{0};
+};
+
+// Worker that holds every compile request until it is released
+class BlockingWorker {
+public:
+  BlockingWorker(unsigned int slots)
+      : slots_(slots), server_([this](const HttpRequest &request) {
+          return Handle(request);
+        }) {
+    CHECK_TRUE(server_.Start());
+  }
+
+  std::uint16_t GetPort() const { return server_.GetPort(); }
+
+  void WaitRequests(int requests) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() { return requests_ >= requests; });
+  }
+
+  // Responds to one request with `status`
+  void Release(int status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    responses_.push_back(status);
+    cv_.notify_all();
+  }
+
+private:
+  HttpResponse Handle(const HttpRequest &request) {
+    if (request.path == "/status") {
+      return {200, fmt::format("{} 0", slots_)};
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    requests_++;
+    cv_.notify_all();
+    cv_.wait(lock, [&]() { return !responses_.empty(); });
+    const int status = responses_.front();
+    responses_.erase(responses_.begin());
+    return {status, {}};
+  }
+
+private:
+  unsigned int slots_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int requests_{0};
+  std::vector<int> responses_;
+
+  // Stopped first on destruction
+  HttpServer server_;
+};
+
+TEST(DistCompileTestGroup, Split) {
+  const auto command = DistCompileCommand::Split(CommandLine({
+      "/usr/bin/gcc", "-DNAME=1", "-I", "include", "-Isrc", "-std=c11",
+      "-O2", "-g", "-Wall", "-fPIC", "-march=x86-64", "-MD", "-MF",
+      "main.c.o.d", "-o", "main.c.o", "-c", "main.c"}));
+  CHECK_TRUE(command.has_value());
+  CHECK_TRUE(command->preprocess ==
+             CommandLine({"/usr/bin/gcc", "-DNAME=1", "-I", "include", "-Isrc",
+                          "-std=c11", "-O2", "-g", "-Wall", "-fPIC",
+                          "-march=x86-64", "-MD", "-MF", "main.c.o.d", "-E",
+                          "main.c"}));
+  CHECK_TRUE(command->compile ==
+             std::vector<std::string>({"gcc", "-std=c11", "-O2", "-g", "-Wall",
+                                       "-fPIC", "-march=x86-64"}));
+  STRCMP_EQUAL(command->extension.c_str(), ".i");
+  STRCMP_EQUAL(command->output.string().c_str(), "main.c.o");
+
+  // Outputs relative to the working directory
+  const auto cpp_command = DistCompileCommand::Split(
+      CommandLine({"clang++", "-c", "main.cpp", "-target", "x86_64-linux-gnu",
+                   "-o", "main.o"},
+                  fs::path("/build")));
+  CHECK_TRUE(cpp_command.has_value());
+  CHECK_TRUE(cpp_command->compile ==
+             std::vector<std::string>(
+                 {"clang++", "-target", "x86_64-linux-gnu"}));
+  STRCMP_EQUAL(cpp_command->extension.c_str(), ".ii");
+  CHECK_TRUE(cpp_command->output == fs::path("/build/main.o"));
+  CHECK_TRUE(cpp_command->preprocess.GetWorkingDirectory() ==
+             fs::path("/build"));
+}
+
+TEST(DistCompileTestGroup, Split_Unsupported) {
+  const std::vector<std::vector<std::string>> commands = {
+      {"gcc"},
+      {"gcc", "-o", "main", "main.c"},
+      {"gcc", "-c", "main.c"},
+      {"gcc", "-c", "main.s", "-o", "main.o"},
+      {"gcc", "-c", "a.c", "b.c", "-o", "main.o"},
+      {"gcc", "-S", "main.c", "-o", "main.s"},
+      {"gcc", "@args.rsp", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-save-temps", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "--coverage", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-x", "c", "-c", "main.txt", "-o", "main.o"},
+      {"gcc", "-fplugin=plugin.so", "-c", "main.c", "-o", "main.o"},
+      {"clang", "-include-pch", "a.pch", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-c", "main.c", "-o", "main.o", "-I"},
+      {"gcc", "-fpass-plugin=/x.so", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-fopt-info-all=/p", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-dumpdir", "/p", "-c", "main.c", "-o", "main.o"},
+      {"clang", "-mllvm", "-info-output-file=/p", "-c", "main.c", "-o",
+       "main.o"},
+      {"clang", "-target", "/p", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-Wa,-adhln=main.lst", "-c", "main.c", "-o", "main.o"},
+      {"gcc", "-gsplit-dwarf", "-c", "main.c", "-o", "main.o"},
+  };
+  for (const auto &arguments : commands) {
+    CHECK_FALSE(DistCompileCommand::Split(CommandLine(arguments)).has_value());
+  }
+}
+
+TEST(DistCompileTestGroup, Worker_Rejects) {
+  DistCompileWorker worker(2, {"gcc"}, TestDir("Worker_Rejects"));
+  CHECK_TRUE(worker.Start(0));
+  HttpClient client(fmt::format("http://127.0.0.1:{}", worker.GetPort()),
+                    kTimeout);
+
+  auto response = client.Request("GET", "/status");
+  CHECK_TRUE(response.has_value());
+  STRCMP_EQUAL(response->body.c_str(), "2 0");
+  CHECK_EQUAL(client.Request("POST", "/compile", "data")->status, 400);
+  CHECK_EQUAL(client.Request("GET", "/compile")->status, 404);
+
+  // Only allowed compilers are run, rejected jobs are compiled locally
+  CHECK_TRUE(DistCompile::Init({Worker(worker.GetPort())}, kTimeout));
+  CHECK_EQUAL(DistCompile::GetSlots(), 2);
+  std::vector<std::string> preprocessed = {"int main() { return 0; }\n"};
+  buildcc::env::m::CommandExpect_Execute(1, true, &preprocessed);
+  buildcc::env::m::CommandExpect_Execute(1, true);
+  Exits exits;
+  CHECK_TRUE(DistCompile::ExecuteAsync(
+      CommandLine({"clang", "-c", "main.c", "-o", "main.o"},
+                  TestDir("Worker_Rejects_Client")),
+      exits.Callback()));
+  exits.Wait(1);
+  mock().checkExpectations();
+  CHECK_EQUAL(exits.GetSuccess(), 1);
+  CHECK_EQUAL(DistCompile::GetStats().local_fallbacks, 1);
+  CHECK_EQUAL(DistCompile::GetStats().errors, 0);
+  CHECK_EQUAL(worker.GetCompiles(), 0);
+}
+
+TEST(DistCompileTestGroup, Worker_RejectsArguments) {
+  CHECK_TRUE(buildcc::env::ProcessReaper::Init(2));
+  DistCompileWorker worker(2, {"gcc"}, TestDir("Worker_RejectsArguments"));
+  CHECK_TRUE(worker.Start(0));
+  HttpClient client(fmt::format("http://127.0.0.1:{}", worker.GetPort()),
+                    kTimeout);
+
+  // Options that write files or load code, and values that look like paths
+  const std::vector<std::vector<std::string>> rejected = {
+      {"gcc", "-fpass-plugin=/x.so"},
+      {"gcc", "-fplugin=x.so"},
+      {"gcc", "-fopt-info-all=/path"},
+      {"gcc", "-foptimization-record-file=/path"},
+      {"gcc", "-fcallgraph-info", "-dumpdir", "/path"},
+      {"gcc", "-fcallgraph-info"},
+      {"gcc", "-mllvm", "-info-output-file=/path"},
+      {"gcc", "--save-temps"},
+      {"gcc", "-save-temps=obj"},
+      {"gcc", "-Wa,-adhln=/path"},
+      {"gcc", "-Wl,-Map=/path"},
+      {"gcc", "-gsplit-dwarf"},
+      {"gcc", "-march=/path"},
+      {"gcc", "-std=../path"},
+      {"gcc", "-target", "/path"},
+      {"gcc", "-arch"},
+      {"gcc", "-DNAME=1"},
+      {"gcc", "/path"},
+  };
+  for (const auto &compile : rejected) {
+    auto response = client.Request("POST", "/compile", CompileRequest(compile));
+    CHECK_TRUE(response.has_value());
+    CHECK_EQUAL(response->status, 403);
+  }
+  CHECK_EQUAL(worker.GetCompiles(), 0);
+
+  // Code generation options
+  auto response = client.Request(
+      "POST", "/compile",
+      CompileRequest({"gcc", "-O2", "-g", "-Wall", "-Wno-unused",
+                      "-Werror=return-type", "-std=c11", "-march=x86-64",
+                      "-fPIC", "-fno-strict-aliasing", "-pthread"}));
+  CHECK_TRUE(response.has_value());
+  CHECK_EQUAL(response->status, 200);
+  CHECK_EQUAL(worker.GetCompiles(), 1);
+}
+
+TEST(DistCompileTestGroup, Compile) {
+  CHECK_TRUE(buildcc::env::ProcessReaper::Init(4));
+  const fs::path dir = TestDir("Compile");
+  DistCompileWorker first(1, {"gcc"}, dir / "first");
+  DistCompileWorker second(1, {"gcc"}, dir / "second");
+  CHECK_TRUE(first.Start(0));
+  CHECK_TRUE(second.Start(0));
+  CHECK_TRUE(DistCompile::Init(
+      {Worker(first.GetPort()), Worker(second.GetPort(), "/2")}, kTimeout));
+  CHECK_EQUAL(DistCompile::GetSlots(), 3);
+
+  // Preprocessing is mocked
+  std::vector<std::string> preprocessed = {
+      "# 1 \"main.c\"\nint square(int x) { return x * x; }\n"};
+  buildcc::env::m::CommandExpect_Execute(1, true, &preprocessed);
+  Exits exits;
+  CHECK_TRUE(DistCompile::ExecuteAsync(
+      CommandLine({"gcc", "-O2", "-c", "main.c", "-o", "main.o"}, dir),
+      exits.Callback()));
+  exits.Wait(1);
+  mock().checkExpectations();
+  CHECK_EQUAL(exits.GetSuccess(), 1);
+  CHECK_EQUAL(DistCompile::GetStats().remote, 1);
+  CHECK_EQUAL(first.GetCompiles() + second.GetCompiles(), 1);
+
+  std::string object;
+  CHECK_TRUE(buildcc::env::load_file((dir / "main.o").string().c_str(), true,
+                                     &object));
+  CHECK_TRUE(object.substr(0, 4) == "\x7f"
+                                    "ELF");
+
+  // Compile errors are reported by the local compiler
+  preprocessed = {"int main( {\n"};
+  buildcc::env::m::CommandExpect_Execute(1, true, &preprocessed);
+  buildcc::env::m::CommandExpect_Execute(1, false);
+  CHECK_TRUE(DistCompile::ExecuteAsync(
+      CommandLine({"gcc", "-c", "error.c", "-o", "error.o"}, dir),
+      exits.Callback()));
+  exits.Wait(2);
+  mock().checkExpectations();
+  CHECK_EQUAL(exits.GetSuccess(), 1);
+  CHECK_EQUAL(DistCompile::GetStats().local_fallbacks, 1);
+  CHECK_FALSE(fs::exists(dir / "error.o"));
+}
+
+TEST(DistCompileTestGroup, Capacity) {
+  BlockingWorker first(2);
+  BlockingWorker second(1);
+  CHECK_TRUE(DistCompile::Init({Worker(first.GetPort()),
+                                Worker(second.GetPort())},
+                               kTimeout));
+  CHECK_EQUAL(DistCompile::GetSlots(), 3);
+
+  const fs::path dir = TestDir("Capacity");
+  std::vector<std::string> preprocessed = {"int main() { return 0; }\n"};
+  Exits exits;
+  auto submit = [&](const char *source) {
+    return DistCompile::ExecuteAsync(
+        CommandLine({"gcc", "-c", source, "-o", "main.o"}, dir),
+        exits.Callback());
+  };
+
+  // Least loaded worker first
+  buildcc::env::m::CommandExpect_Execute(3, true, &preprocessed);
+  CHECK_TRUE(submit("a.c"));
+  first.WaitRequests(1);
+  CHECK_TRUE(submit("b.c"));
+  second.WaitRequests(1);
+  CHECK_TRUE(submit("c.c"));
+  first.WaitRequests(2);
+  // Every slot is busy, compiled locally by the caller
+  CHECK_FALSE(submit("d.c"));
+
+  // Failed requests are compiled locally
+  buildcc::env::m::CommandExpect_Execute(3, true);
+  for (int i = 0; i < 2; i++) {
+    first.Release(500);
+    exits.Wait(i + 1);
+  }
+  second.Release(500);
+  exits.Wait(3);
+  mock().checkExpectations();
+  CHECK_EQUAL(exits.GetSuccess(), 3);
+  const auto stats = DistCompile::GetStats();
+  CHECK_EQUAL(stats.remote, 0);
+  CHECK_EQUAL(stats.local_fallbacks, 3);
+  CHECK_EQUAL(stats.errors, 3);
+  CHECK_EQUAL(DistCompile::GetSlots(), 3);
+}
+
+TEST(DistCompileTestGroup, Disabled) {
+  CHECK_FALSE(DistCompile::IsEnabled());
+  CHECK_FALSE(DistCompile::ExecuteAsync(
+      CommandLine({"gcc", "-c", "main.c", "-o", "main.o"}), nullptr));
+
+  // Invalid workers
+  CHECK_FALSE(DistCompile::Init({"127.0.0.1:1/0"}));
+  CHECK_FALSE(DistCompile::Init({"127.0.0.1:1/two"}));
+  CHECK_FALSE(DistCompile::Init({"/2"}));
+  CHECK_FALSE(DistCompile::Init({"127.0.0.1:port"}));
+
+  // Unreachable workers are skipped
+  std::uint16_t port = 0;
+  {
+    HttpServer server([](const HttpRequest &) { return HttpResponse{}; });
+    CHECK_TRUE(server.Start());
+    port = server.GetPort();
+  }
+  CHECK_TRUE(DistCompile::Init({Worker(port)}, kTimeout));
+  CHECK_FALSE(DistCompile::IsEnabled());
+  CHECK_EQUAL(DistCompile::GetSlots(), 0);
+}
+
+TEST(DistCompileTestGroup, Unreachable) {
+  auto worker = std::make_unique<BlockingWorker>(1);
+  CHECK_TRUE(DistCompile::Init({Worker(worker->GetPort())}, kTimeout));
+  const fs::path dir = TestDir("Unreachable");
+  std::vector<std::string> preprocessed = {"int main() { return 0; }\n"};
+  Exits exits;
+
+  // Disabled after consecutive errors
+  for (int i = 0; i < 3; i++) {
+    buildcc::env::m::CommandExpect_Execute(1, true, &preprocessed);
+    buildcc::env::m::CommandExpect_Execute(1, true);
+    CHECK_TRUE(DistCompile::ExecuteAsync(
+        CommandLine({"gcc", "-c", "main.c", "-o", "main.o"}, dir),
+        exits.Callback()));
+    worker->WaitRequests(i + 1);
+    worker->Release(500);
+    exits.Wait(i + 1);
+  }
+  mock().checkExpectations();
+  CHECK_EQUAL(DistCompile::GetSlots(), 0);
+  CHECK_FALSE(DistCompile::ExecuteAsync(
+      CommandLine({"gcc", "-c", "main.c", "-o", "main.o"}, dir),
+      exits.Callback()));
+}
+
+int main(int ac, char **av) {
+  buildcc::env::m::VectorStringCopier copier;
+  mock().installCopier(TEST_VECTOR_STRING_TYPE, copier);
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
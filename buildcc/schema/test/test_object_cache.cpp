@@ -0,0 +1,203 @@
+#include "schema/object_cache.h"
+
+#include "env/util.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+#include "CppUTestExt/MockSupport.h"
+
+using buildcc::ObjectCacheLink;
+using buildcc::internal::ObjectCache;
+
+// clang-format off
+TEST_GROUP(ObjectCacheTestGroup)
+{
+    void teardown() {
+      ObjectCache::Deinit();
+      mock().clear();
+    }
+};
+// clang-format on
+
+static void WriteFile(const fs::path &path, const std::string &data) {
+  CHECK_TRUE(buildcc::env::save_file(path.string().c_str(), data, true));
+}
+
+static std::string ReadFile(const fs::path &path) {
+  std::string data;
+  CHECK_TRUE(buildcc::env::load_file(path.string().c_str(), true, &data));
+  return data;
+}
+
+static fs::path InitCache(const char *name, std::uint64_t max_size_bytes,
+                          ObjectCacheLink link) {
+  const fs::path cache_dir = fs::path("dump/object_cache") / name;
+  fs::remove_all(cache_dir);
+  ObjectCache::Init(cache_dir, max_size_bytes, link);
+  return cache_dir;
+}
+
+TEST(ObjectCacheTestGroup, Disabled) {
+  CHECK_FALSE(ObjectCache::IsEnabled());
+  CHECK_FALSE(ObjectCache::Fetch("key", "dump/Disabled.o").has_value());
+  CHECK_FALSE(ObjectCache::Store("key", "dump/Disabled.o", {}));
+}
+
+TEST(ObjectCacheTestGroup, ComputeKey) {
+  (void)InitCache("ObjectCacheComputeKey", 0, ObjectCacheLink::Copy);
+  const std::string key = ObjectCache::ComputeKey("gcc", "gcc -c main.c");
+  CHECK_EQUAL(key.size(), 64);
+  STRCMP_EQUAL(key.c_str(),
+               ObjectCache::ComputeKey("gcc", "gcc -c main.c").c_str());
+  CHECK_FALSE(key == ObjectCache::ComputeKey("gcc", "gcc -O2 -c main.c"));
+  CHECK_FALSE(key == ObjectCache::ComputeKey("clang", "gcc -c main.c"));
+}
+
+TEST(ObjectCacheTestGroup, ComputeKey_BaseDir) {
+  const std::string key =
+      ObjectCache::ComputeKey("gcc", "gcc -I/a/proj/include -c /a/proj/x.c");
+  ObjectCache::SetBaseDir("/a/proj/");
+  const std::string relative_key =
+      ObjectCache::ComputeKey("gcc", "gcc -I/a/proj/include -c /a/proj/x.c");
+  CHECK_FALSE(key == relative_key);
+
+  ObjectCache::SetBaseDir("/b/proj");
+  STRCMP_EQUAL(
+      ObjectCache::ComputeKey("gcc", "gcc -I/b/proj/include -c /b/proj/x.c")
+          .c_str(),
+      relative_key.c_str());
+  // Only complete path components are replaced
+  CHECK_FALSE(ObjectCache::ComputeKey(
+                  "gcc", "gcc -I/b/project/include -c /b/proj/x.c") ==
+              relative_key);
+
+  // Inputs below the base directory are recorded relative to it
+  const fs::path source = fs::absolute("dump/object_cache/BaseDir.c");
+  WriteFile(source, "int main() {}");
+  ObjectCache::SetBaseDir(source.parent_path());
+  const auto inputs = ObjectCache::HashInputs({source.string()});
+  CHECK_TRUE(inputs.has_value());
+  STRCMP_EQUAL(inputs->at(0).path.c_str(), "BaseDir.c");
+  CHECK_TRUE(ObjectCache::InputsUnchanged(inputs.value()));
+  STRCMP_EQUAL(ObjectCache::InputPaths(inputs.value()).at(0).c_str(),
+               source.string().c_str());
+  ObjectCache::SetBaseDir("");
+}
+
+TEST(ObjectCacheTestGroup, StoreFetch) {
+  (void)InitCache("ObjectCacheStoreFetch", 0, ObjectCacheLink::Copy);
+  const fs::path source = "dump/object_cache/ObjectCacheStoreFetch.c";
+  const fs::path header = "dump/object_cache/ObjectCacheStoreFetch.h";
+  const fs::path object = "dump/object_cache/ObjectCacheStoreFetch.o";
+  const std::vector<std::string> inputs = {source.string(), header.string()};
+  WriteFile(source, "int main() {}");
+  WriteFile(header, "#define A 1");
+  WriteFile(object, "object 1");
+
+  const std::string key = ObjectCache::ComputeKey("gcc", "gcc -c main.c");
+  CHECK_FALSE(ObjectCache::Fetch(key, object).has_value());
+  CHECK_TRUE(ObjectCache::Store(key, object, inputs));
+
+  fs::remove(object);
+  const auto fetched = ObjectCache::Fetch(key, object);
+  CHECK_TRUE(fetched.has_value());
+  CHECK_TRUE(fetched.value() == inputs);
+  STRCMP_EQUAL(ReadFile(object).c_str(), "object 1");
+
+  // Header changed
+  WriteFile(header, "#define A 22");
+  CHECK_FALSE(ObjectCache::Fetch(key, object).has_value());
+  WriteFile(object, "object 2");
+  CHECK_TRUE(ObjectCache::Store(key, object, inputs));
+
+  // Header restored (for example switching back to a branch)
+  WriteFile(header, "#define A 1");
+  CHECK_TRUE(ObjectCache::Fetch(key, object).has_value());
+  STRCMP_EQUAL(ReadFile(object).c_str(), "object 1");
+
+  // Missing input
+  fs::remove(header);
+  CHECK_FALSE(ObjectCache::Fetch(key, object).has_value());
+
+  const auto stats = ObjectCache::GetStats();
+  CHECK_EQUAL(stats.hits, 2);
+  CHECK_EQUAL(stats.misses, 3);
+  CHECK_EQUAL(stats.stores, 2);
+  CHECK_EQUAL(stats.size_bytes, 16);
+}
+
+TEST(ObjectCacheTestGroup, Hardlink) {
+  (void)InitCache("ObjectCacheHardlink", 0, ObjectCacheLink::Hardlink);
+  const fs::path source = "dump/object_cache/ObjectCacheHardlink.c";
+  const fs::path object = "dump/object_cache/ObjectCacheHardlink.o";
+  const fs::path fetched_object =
+      "dump/object_cache/ObjectCacheHardlink_fetched.o";
+  WriteFile(source, "int main() {}");
+  WriteFile(object, "object");
+
+  const std::string key = ObjectCache::ComputeKey("gcc", "gcc -c main.c");
+  CHECK_TRUE(ObjectCache::Store(key, object, {source.string()}));
+  CHECK_TRUE(ObjectCache::Fetch(key, fetched_object).has_value());
+  CHECK_TRUE(fs::equivalent(object, fetched_object));
+}
+
+TEST(ObjectCacheTestGroup, CorruptedManifest) {
+  const fs::path cache_dir =
+      InitCache("ObjectCacheCorrupted", 0, ObjectCacheLink::Copy);
+  const fs::path source = "dump/object_cache/ObjectCacheCorrupted.c";
+  const fs::path object = "dump/object_cache/ObjectCacheCorrupted.o";
+  WriteFile(source, "int main() {}");
+  WriteFile(object, "object");
+
+  const std::string key = ObjectCache::ComputeKey("gcc", "gcc -c main.c");
+  CHECK_TRUE(ObjectCache::Store(key, object, {source.string()}));
+  WriteFile(cache_dir / key.substr(0, 2) / key / "manifest", "corrupted");
+  CHECK_FALSE(ObjectCache::Fetch(key, object).has_value());
+
+  // Stored again
+  CHECK_TRUE(ObjectCache::Store(key, object, {source.string()}));
+  CHECK_TRUE(ObjectCache::Fetch(key, object).has_value());
+}
+
+TEST(ObjectCacheTestGroup, Trim) {
+  const fs::path cache_dir =
+      InitCache("ObjectCacheTrim", 10000, ObjectCacheLink::Copy);
+  const fs::path source = "dump/object_cache/ObjectCacheTrim.c";
+  const fs::path object = "dump/object_cache/ObjectCacheTrim.o";
+  WriteFile(source, "int main() {}");
+  WriteFile(object, std::string(4000, 'o'));
+
+  const std::string old_key = ObjectCache::ComputeKey("gcc", "gcc -O0");
+  const std::string used_key = ObjectCache::ComputeKey("gcc", "gcc -O1");
+  const std::string new_key = ObjectCache::ComputeKey("gcc", "gcc -O2");
+  CHECK_TRUE(ObjectCache::Store(old_key, object, {source.string()}));
+  CHECK_TRUE(ObjectCache::Store(used_key, object, {source.string()}));
+
+  // Least recently used first
+  const auto manifest = [&](const std::string &key) {
+    return cache_dir / key.substr(0, 2) / key / "manifest";
+  };
+  const auto now = fs::file_time_type::clock::now();
+  fs::last_write_time(manifest(old_key), now - std::chrono::hours(2));
+  fs::last_write_time(manifest(used_key), now - std::chrono::hours(1));
+  CHECK_TRUE(ObjectCache::Fetch(used_key, object).has_value());
+
+  CHECK_TRUE(ObjectCache::Store(new_key, object, {source.string()}));
+  const auto stats = ObjectCache::GetStats();
+  CHECK_EQUAL(stats.evictions, 1);
+  CHECK_TRUE(stats.size_bytes <= 10000);
+  CHECK_FALSE(ObjectCache::Fetch(old_key, object).has_value());
+  CHECK_TRUE(ObjectCache::Fetch(used_key, object).has_value());
+  CHECK_TRUE(ObjectCache::Fetch(new_key, object).has_value());
+
+  // Size is computed on Init
+  ObjectCache::Init(cache_dir, 10000, ObjectCacheLink::Copy);
+  CHECK_EQUAL(ObjectCache::GetStats().size_bytes, stats.size_bytes);
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
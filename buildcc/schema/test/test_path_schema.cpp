@@ -2,6 +2,7 @@
 #include "schema/path.h"
 
 #include "env/host_os.h"
+#include "env/util.h"
 
 // NOTE, Make sure all these includes are AFTER the system and header includes
 #include "CppUTest/CommandLineTestRunner.h"
@@ -142,6 +143,159 @@ TEST(PathSchemaTestGroup, PathInfoList_GetChanged) {
   }
 }
 
+TEST(PathSchemaTestGroup, PathInfoList_ContentHashStrategy) {
+  constexpr const char *const FILENAME = "dump/PathContentHash.txt";
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, "Hello World", false));
+
+  buildcc::internal::PathInfoList::SetHashStrategy(
+      buildcc::PathHashStrategy::Content);
+
+  buildcc::internal::PathInfoList previous;
+  previous.Emplace(FILENAME, "");
+  previous.ComputeHashForAll();
+  const auto &previous_info = previous.GetPathInfos()[0];
+  CHECK_FALSE(previous_info.stamp.empty());
+
+  // Same content with a different last write time
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, "Hello World", false));
+  fs::last_write_time(FILENAME,
+                      fs::last_write_time(FILENAME) + std::chrono::seconds(1));
+  auto current_info =
+      buildcc::internal::PathInfoList::ComputePathInfo(FILENAME);
+  CHECK_TRUE(current_info == previous_info);
+  CHECK_FALSE(current_info.stamp == previous_info.stamp);
+
+  // Unchanged stamp reuses the previous hash without reading the file
+  buildcc::internal::PathInfo stale_info = current_info;
+  stale_info.hash = "stale";
+  buildcc::internal::PathInfoList current;
+  current.Emplace(FILENAME, "");
+  buildcc::internal::PathInfoList stale;
+  stale.Emplace(stale_info);
+  current.ComputeHashForAll(stale);
+  STRCMP_EQUAL(current.GetPathInfos()[0].hash.c_str(), "stale");
+
+  // Updated content
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, "Hello BuildCC", false));
+  current_info =
+      buildcc::internal::PathInfoList::ComputePathInfo(FILENAME, &stale_info);
+  CHECK_FALSE(current_info == previous_info);
+  CHECK_FALSE(current_info.hash == "stale");
+
+  buildcc::internal::PathInfoList::SetHashStrategy(
+      buildcc::PathHashStrategy::Timestamp);
+  current_info = buildcc::internal::PathInfoList::ComputePathInfo(FILENAME);
+  CHECK_TRUE(current_info.stamp.empty());
+}
+
+TEST(PathSchemaTestGroup, PathInfoList_AddHashJobs) {
+  constexpr const char *const FIRST = "dump/PathHashJobFirst.txt";
+  constexpr const char *const SECOND = "dump/PathHashJobSecond.txt";
+  CHECK_TRUE(buildcc::env::save_file(FIRST, "First", false));
+  CHECK_TRUE(buildcc::env::save_file(SECOND, "Second", false));
+
+  buildcc::internal::PathInfoList expected;
+  expected.Emplace(FIRST, "");
+  expected.Emplace(SECOND, "");
+  expected.ComputeHashForAll();
+
+  buildcc::internal::PathInfoList current;
+  current.Emplace(FIRST, "");
+  current.Emplace(SECOND, "");
+
+  std::vector<buildcc::internal::PathHashJob> jobs;
+  current.AddHashJobs(buildcc::internal::PathInfoList(), jobs);
+  CHECK_EQUAL(jobs.size(), 2);
+  CHECK_TRUE(jobs[0].previous == nullptr);
+
+  // Jobs can run in any order
+  jobs[1].Run();
+  jobs[0].Run();
+  CHECK_TRUE(current == expected);
+
+  // Previous path infos are attached to the matching jobs
+  jobs.clear();
+  current.AddHashJobs(expected, jobs);
+  CHECK_TRUE(jobs[0].previous == &expected.GetPathInfos()[0]);
+  CHECK_TRUE(jobs[1].previous == &expected.GetPathInfos()[1]);
+}
+
+TEST(PathSchemaTestGroup, PathHashCache) {
+  constexpr const char *const FILENAME = "dump/PathHashCache.txt";
+  constexpr const char *const MISSING = "dump/PathHashCacheMissing.txt";
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, "Cache", false));
+  fs::remove(MISSING);
+
+  buildcc::internal::PathHashCache::Clear();
+  buildcc::internal::PathHashCache::Enable(true);
+
+  const auto first = buildcc::internal::PathInfoList::ComputeHash(FILENAME);
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetMisses(), 1);
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetHits(), 0);
+
+  // Cached for the rest of the build
+  fs::last_write_time(FILENAME,
+                      fs::last_write_time(FILENAME) + std::chrono::seconds(1));
+  STRCMP_EQUAL(buildcc::internal::PathInfoList::ComputeHash(FILENAME).c_str(),
+               first.c_str());
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetMisses(), 1);
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetHits(), 1);
+
+  // Missing paths are not cached
+  buildcc::internal::PathInfo info;
+  CHECK_FALSE(buildcc::internal::PathInfoList::TryComputePathInfo(
+      MISSING, nullptr, info));
+  CHECK_TRUE(buildcc::env::save_file(MISSING, "Generated", false));
+  CHECK_TRUE(buildcc::internal::PathInfoList::TryComputePathInfo(
+      MISSING, nullptr, info));
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetMisses(), 3);
+
+  // Next build
+  buildcc::internal::PathHashCache::Clear();
+  CHECK_FALSE(buildcc::internal::PathInfoList::ComputeHash(FILENAME) == first);
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetMisses(), 1);
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetHits(), 0);
+
+  buildcc::internal::PathHashCache::Enable(false);
+  buildcc::internal::PathHashCache::Clear();
+}
+
+TEST(PathSchemaTestGroup, PathHashCache_OverlappingBuilds) {
+  constexpr const char *const FILENAME = "dump/PathHashCacheBuilds.txt";
+  CHECK_TRUE(buildcc::env::save_file(FILENAME, "Builds", false));
+
+  buildcc::internal::PathHashCache::BeginBuild();
+  CHECK_TRUE(buildcc::internal::PathHashCache::IsEnabled());
+  const auto first = buildcc::internal::PathInfoList::ComputeHash(FILENAME);
+
+  // A second build does not clear the entries of the first build
+  buildcc::internal::PathHashCache::BeginBuild();
+  fs::last_write_time(FILENAME,
+                      fs::last_write_time(FILENAME) + std::chrono::seconds(1));
+  STRCMP_EQUAL(buildcc::internal::PathInfoList::ComputeHash(FILENAME).c_str(),
+               first.c_str());
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetHits(), 1);
+
+  // Nor disables the cache when it ends first
+  buildcc::internal::PathHashCache::EndBuild();
+  CHECK_TRUE(buildcc::internal::PathHashCache::IsEnabled());
+  STRCMP_EQUAL(buildcc::internal::PathInfoList::ComputeHash(FILENAME).c_str(),
+               first.c_str());
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetHits(), 2);
+
+  buildcc::internal::PathHashCache::EndBuild();
+  CHECK_FALSE(buildcc::internal::PathHashCache::IsEnabled());
+  CHECK_FALSE(buildcc::internal::PathInfoList::ComputeHash(FILENAME) == first);
+
+  // The next build starts with an empty cache
+  buildcc::internal::PathHashCache::BeginBuild();
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetHits(), 0);
+  buildcc::internal::PathInfoList::ComputeHash(FILENAME);
+  CHECK_EQUAL(buildcc::internal::PathHashCache::GetMisses(), 1);
+  buildcc::internal::PathHashCache::EndBuild();
+  buildcc::internal::PathHashCache::Clear();
+}
+
 int main(int ac, char **av) {
   return CommandLineTestRunner::RunAllTests(ac, av);
 }
@@ -0,0 +1,288 @@
+#include "schema/remote_cache.h"
+
+#include "env/hash.h"
+#include "env/util.h"
+
+// NOTE, Make sure all these includes are AFTER the system and header includes
+#include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/Utest.h"
+#include "CppUTestExt/MockSupport.h"
+
+using buildcc::env::HttpClient;
+using buildcc::internal::ObjectCache;
+using buildcc::internal::RemoteCache;
+using buildcc::internal::RemoteCacheServer;
+
+// clang-format off
+TEST_GROUP(RemoteCacheTestGroup)
+{
+    void teardown() {
+      RemoteCache::Deinit();
+      ObjectCache::SetBaseDir("");
+      mock().clear();
+    }
+};
+// clang-format on
+
+constexpr std::chrono::milliseconds kTimeout(5000);
+
+static void WriteFile(const fs::path &path, const std::string &data) {
+  std::error_code errcode;
+  fs::create_directories(path.parent_path(), errcode);
+  CHECK_TRUE(buildcc::env::save_file(path.string().c_str(), data, true));
+}
+
+static std::string ReadFile(const fs::path &path) {
+  std::string data;
+  CHECK_TRUE(buildcc::env::load_file(path.string().c_str(), true, &data));
+  return data;
+}
+
+static fs::path TestDir(const char *name) {
+  const fs::path dir = fs::absolute("dump/remote_cache") / name;
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+TEST(RemoteCacheTestGroup, Server) {
+  RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  HttpClient client(server.GetUrl(), kTimeout);
+
+  const std::string data = "object";
+  const std::string digest = buildcc::env::sha256_hex(data);
+  CHECK_EQUAL(client.Request("GET", "/cas/" + digest)->status, 404);
+  CHECK_EQUAL(client.Request("PUT", "/cas/" + digest, data)->status, 200);
+  CHECK_EQUAL(client.Request("HEAD", "/cas/" + digest)->status, 200);
+  STRCMP_EQUAL(client.Request("GET", "/cas/" + digest)->body.c_str(),
+               "object");
+
+  // Contents must match their digest
+  const std::string other = buildcc::env::sha256_hex("other");
+  CHECK_EQUAL(client.Request("PUT", "/cas/" + other, data)->status, 400);
+  CHECK_EQUAL(client.Request("PUT", "/ac/" + other, data)->status, 200);
+
+  // Keys must be SHA-256 digests
+  CHECK_EQUAL(client.Request("GET", "/ac/key")->status, 400);
+  CHECK_EQUAL(client.Request("GET", "/ac/" + digest + "0")->status, 400);
+  CHECK_EQUAL(client.Request("GET", "/other/" + digest)->status, 400);
+  CHECK_EQUAL(client.Request("POST", "/ac/" + digest)->status, 405);
+
+  CHECK_EQUAL(server.GetActionCount(), 1);
+  CHECK_EQUAL(server.GetCasCount(), 1);
+}
+
+TEST(RemoteCacheTestGroup, Disabled) {
+  CHECK_FALSE(RemoteCache::Init("https://localhost"));
+  CHECK_FALSE(RemoteCache::IsEnabled());
+  CHECK_FALSE(RemoteCache::Fetch("key", "dump/Disabled.o").has_value());
+  CHECK_FALSE(RemoteCache::Store("key", "dump/Disabled.o", {}));
+}
+
+TEST(RemoteCacheTestGroup, CompilerIdentity) {
+  RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(RemoteCache::Init(server.GetUrl(), true, kTimeout));
+
+  const fs::path dir = TestDir("CompilerIdentity");
+  const fs::path compiler = dir / "first" / "gcc";
+  const fs::path object = dir / "main.o";
+  WriteFile(compiler, "compiler");
+  WriteFile(object, "object");
+  ObjectCache::Init(dir / "first_cache", 0, buildcc::ObjectCacheLink::Copy);
+  const std::string key =
+      ObjectCache::ComputeKey(compiler.string(), "gcc -c main.c");
+  CHECK_TRUE(RemoteCache::Store(key, object, {}));
+  RemoteCache::Flush();
+
+  // Same compiler installed at another time and path on a second machine
+  const fs::path other_compiler = dir / "second" / "gcc";
+  WriteFile(other_compiler, "compiler");
+  fs::last_write_time(other_compiler, fs::last_write_time(compiler) +
+                                          std::chrono::hours(1));
+  ObjectCache::Init(dir / "second_cache", 0, buildcc::ObjectCacheLink::Copy);
+  STRCMP_EQUAL(
+      ObjectCache::ComputeKey(other_compiler.string(), "gcc -c main.c")
+          .c_str(),
+      key.c_str());
+  fs::remove(object);
+  CHECK_TRUE(RemoteCache::Fetch(key, object).has_value());
+  STRCMP_EQUAL(ReadFile(object).c_str(), "object");
+
+  // Different compiler
+  WriteFile(other_compiler, "other compiler");
+  ObjectCache::Init(dir / "second_cache", 0, buildcc::ObjectCacheLink::Copy);
+  CHECK_FALSE(ObjectCache::ComputeKey(other_compiler.string(),
+                                      "gcc -c main.c") == key);
+  ObjectCache::Deinit();
+}
+
+TEST(RemoteCacheTestGroup, StoreFetch) {
+  RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(RemoteCache::Init(server.GetUrl(), true, kTimeout));
+  CHECK_TRUE(RemoteCache::IsEnabled());
+
+  const fs::path dir = TestDir("StoreFetch");
+  const fs::path source = dir / "main.c";
+  const fs::path header = dir / "main.h";
+  const fs::path object = dir / "main.o";
+  const std::vector<std::string> inputs = {source.string(), header.string()};
+  WriteFile(source, "int main() {}");
+  WriteFile(header, "#define A 1");
+  WriteFile(object, "object 1");
+
+  const std::string key = ObjectCache::ComputeKey("gcc", "gcc -c main.c");
+  CHECK_FALSE(RemoteCache::Fetch(key, object).has_value());
+  CHECK_TRUE(RemoteCache::Store(key, object, inputs));
+  // Read before returning
+  WriteFile(object, "modified");
+  RemoteCache::Flush();
+  CHECK_EQUAL(server.GetActionCount(), 1);
+  CHECK_EQUAL(server.GetCasCount(), 1);
+
+  fs::remove(object);
+  const auto fetched = RemoteCache::Fetch(key, object);
+  CHECK_TRUE(fetched.has_value());
+  CHECK_TRUE(fetched.value() == inputs);
+  STRCMP_EQUAL(ReadFile(object).c_str(), "object 1");
+
+  // Header changed
+  WriteFile(header, "#define A 2");
+  CHECK_FALSE(RemoteCache::Fetch(key, object).has_value());
+  WriteFile(object, "object 2");
+  CHECK_TRUE(RemoteCache::Store(key, object, inputs));
+  RemoteCache::Flush();
+  CHECK_EQUAL(server.GetActionCount(), 1);
+  CHECK_EQUAL(server.GetCasCount(), 2);
+
+  // Both entries are kept
+  WriteFile(header, "#define A 1");
+  CHECK_TRUE(RemoteCache::Fetch(key, object).has_value());
+  STRCMP_EQUAL(ReadFile(object).c_str(), "object 1");
+
+  // Objects are uploaded once
+  const std::string other_key =
+      ObjectCache::ComputeKey("gcc", "gcc -O2 -c main.c");
+  CHECK_TRUE(RemoteCache::Store(other_key, object, inputs));
+  RemoteCache::Flush();
+  CHECK_EQUAL(server.GetActionCount(), 2);
+  CHECK_EQUAL(server.GetCasCount(), 2);
+
+  const auto stats = RemoteCache::GetStats();
+  CHECK_EQUAL(stats.hits, 2);
+  CHECK_EQUAL(stats.misses, 2);
+  CHECK_EQUAL(stats.uploads, 3);
+  CHECK_EQUAL(stats.upload_failures, 0);
+  CHECK_EQUAL(stats.bytes_uploaded, 16);
+  CHECK_EQUAL(stats.bytes_downloaded, 16);
+  CHECK_EQUAL(stats.errors, 0);
+}
+
+TEST(RemoteCacheTestGroup, BaseDir) {
+  RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(RemoteCache::Init(server.GetUrl(), true, kTimeout));
+
+  // Same project checked out in two directories
+  const fs::path first = TestDir("BaseDir_First");
+  const fs::path second = TestDir("BaseDir_Second");
+  for (const auto &dir : {first, second}) {
+    WriteFile(dir / "src" / "main.c", "int main() {}");
+  }
+  const auto command = [](const fs::path &dir) {
+    return fmt::format("gcc -I{}/include -c {}/src/main.c", dir.string(),
+                       dir.string());
+  };
+
+  ObjectCache::SetBaseDir(first);
+  const std::string key = ObjectCache::ComputeKey("gcc", command(first));
+  WriteFile(first / "main.o", "object");
+  CHECK_TRUE(RemoteCache::Store(key, first / "main.o",
+                                {(first / "src" / "main.c").string()}));
+  RemoteCache::Flush();
+
+  ObjectCache::SetBaseDir(second);
+  STRCMP_EQUAL(ObjectCache::ComputeKey("gcc", command(second)).c_str(),
+               key.c_str());
+  const auto fetched = RemoteCache::Fetch(key, second / "main.o");
+  CHECK_TRUE(fetched.has_value());
+  CHECK_EQUAL(fetched->size(), 1);
+  STRCMP_EQUAL(fetched->at(0).c_str(),
+               (second / "src" / "main.c").string().c_str());
+  STRCMP_EQUAL(ReadFile(second / "main.o").c_str(), "object");
+
+  // Absolute paths without a base directory
+  ObjectCache::SetBaseDir("");
+  CHECK_FALSE(ObjectCache::ComputeKey("gcc", command(second)) == key);
+}
+
+TEST(RemoteCacheTestGroup, ReadOnly) {
+  RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(RemoteCache::Init(server.GetUrl(), false, kTimeout));
+
+  const fs::path dir = TestDir("ReadOnly");
+  WriteFile(dir / "main.c", "int main() {}");
+  WriteFile(dir / "main.o", "object");
+  CHECK_FALSE(RemoteCache::Store("key", dir / "main.o",
+                                 {(dir / "main.c").string()}));
+  CHECK_EQUAL(server.GetCasCount(), 0);
+}
+
+TEST(RemoteCacheTestGroup, CorruptedManifest) {
+  RemoteCacheServer server;
+  CHECK_TRUE(server.Start());
+  CHECK_TRUE(RemoteCache::Init(server.GetUrl(), true, kTimeout));
+
+  const std::string key = ObjectCache::ComputeKey("gcc", "gcc -c main.c");
+  HttpClient client(server.GetUrl(), kTimeout);
+  CHECK_EQUAL(
+      client.Request("PUT", RemoteCache::GetActionPath(key), "corrupted")
+          ->status,
+      200);
+
+  const fs::path dir = TestDir("CorruptedManifest");
+  WriteFile(dir / "main.c", "int main() {}");
+  WriteFile(dir / "main.o", "object");
+  CHECK_FALSE(RemoteCache::Fetch(key, dir / "main.o").has_value());
+
+  // Replaced by the next upload
+  CHECK_TRUE(RemoteCache::Store(key, dir / "main.o",
+                                {(dir / "main.c").string()}));
+  RemoteCache::Flush();
+  CHECK_TRUE(RemoteCache::Fetch(key, dir / "main.o").has_value());
+}
+
+TEST(RemoteCacheTestGroup, Unreachable) {
+  std::uint16_t port = 0;
+  {
+    RemoteCacheServer server;
+    CHECK_TRUE(server.Start());
+    port = server.GetPort();
+  }
+  CHECK_TRUE(RemoteCache::Init(fmt::format("http://127.0.0.1:{}", port),
+                               true, kTimeout));
+
+  const fs::path dir = TestDir("Unreachable");
+  WriteFile(dir / "main.c", "int main() {}");
+  WriteFile(dir / "main.o", "object");
+  CHECK_TRUE(RemoteCache::Store("key", dir / "main.o",
+                                {(dir / "main.c").string()}));
+  RemoteCache::Flush();
+  CHECK_EQUAL(RemoteCache::GetStats().upload_failures, 1);
+
+  // Disabled after consecutive errors
+  CHECK_FALSE(RemoteCache::Fetch("key", dir / "main.o").has_value());
+  CHECK_FALSE(RemoteCache::Fetch("key", dir / "main.o").has_value());
+  CHECK_FALSE(RemoteCache::IsEnabled());
+  CHECK_FALSE(RemoteCache::Fetch("key", dir / "main.o").has_value());
+  CHECK_EQUAL(RemoteCache::GetStats().errors, 3);
+}
+
+int main(int ac, char **av) {
+  return CommandLineTestRunner::RunAllTests(ac, av);
+}
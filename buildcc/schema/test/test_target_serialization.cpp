@@ -59,7 +59,7 @@ TEST(TargetSerializationTestGroup, TargetSerialization_TargetType) {
   {
     // Target Type executable
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetTypeTest.json");
+        "dump/TargetTypeTest.bin");
 
     buildcc::internal::TargetSchema schema;
     schema.type = buildcc::TargetType::Executable;
@@ -75,7 +75,7 @@ TEST(TargetSerializationTestGroup, TargetSerialization_TargetType) {
   {
     // Target Type static library
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetTypeTest.json");
+        "dump/TargetTypeTest.bin");
 
     buildcc::internal::TargetSchema schema;
     schema.type = buildcc::TargetType::StaticLibrary;
@@ -92,7 +92,7 @@ TEST(TargetSerializationTestGroup, TargetSerialization_TargetType) {
   {
     // Target Type dynamic library
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetTypeTest.json");
+        "dump/TargetTypeTest.bin");
 
     buildcc::internal::TargetSchema schema;
     schema.type = buildcc::TargetType::DynamicLibrary;
@@ -109,7 +109,7 @@ TEST(TargetSerializationTestGroup, TargetSerialization_TargetType) {
   {
     // Target Type undefined
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetTypeTest.json");
+        "dump/TargetTypeTest.bin");
 
     buildcc::internal::TargetSchema schema;
     schema.type = buildcc::TargetType::Undefined;
@@ -125,7 +125,7 @@ TEST(TargetSerializationTestGroup, TargetSerialization_TargetType) {
   {
     // Target Type random value
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetTypeTest.json");
+        "dump/TargetTypeTest.bin");
 
     buildcc::internal::TargetSchema schema;
     schema.type = (buildcc::TargetType)65535;
@@ -139,34 +139,216 @@ TEST(TargetSerializationTestGroup, TargetSerialization_TargetType) {
   }
 }
 
-TEST(TargetSerializationTestGroup, JsonParse_Failure) {
+TEST(TargetSerializationTestGroup, TargetSerialization_Objects) {
+  buildcc::internal::TargetSerialization serialization(
+      "dump/TargetObjectsTest.bin");
+
+  buildcc::internal::TargetSchema::ObjectInfo info;
+  info.headers.Emplace("include/hello.h", "1");
+  info.headers.Emplace("include/world.h", "2");
+  info.headers_tracked = true;
+  info.command_hash = "4";
+  serialization.AddSource("src/main.cpp", "3");
+  serialization.AddObjectInfo("src/main.cpp", info);
+
+  buildcc::internal::TargetSchema schema;
+  schema.link_command_hash = "5";
+  serialization.UpdateStore(schema);
+  bool store = serialization.StoreToFile();
+  CHECK_TRUE(store);
+
+  bool load = serialization.LoadFromFile();
+  CHECK_TRUE(load);
+
+  const auto &objects = serialization.GetLoad().objects;
+  CHECK_EQUAL(objects.size(), 1);
+  CHECK_TRUE(objects.at("src/main.cpp").headers == info.headers);
+  CHECK_TRUE(objects.at("src/main.cpp").headers_tracked);
+  STRCMP_EQUAL(objects.at("src/main.cpp").command_hash.c_str(), "4");
+  STRCMP_EQUAL(serialization.GetLoad().link_command_hash.c_str(), "5");
+}
+
+TEST(TargetSerializationTestGroup, TargetSerialization_Toolchain) {
+  buildcc::internal::TargetSerialization serialization(
+      "dump/TargetToolchainTest.bin");
+
+  buildcc::internal::TargetSchema schema;
+  schema.toolchain.assembler = "/usr/bin/as:1:2";
+  schema.toolchain.c_compiler = "/usr/bin/gcc:3:4";
+  schema.toolchain.cpp_compiler = "/usr/bin/g++:5:6";
+  schema.toolchain.archiver = "/usr/bin/ar:7:8";
+  schema.toolchain.linker = "/usr/bin/ld:9:10";
+  serialization.UpdateStore(schema);
+  CHECK_TRUE(serialization.StoreToFile());
+
+  buildcc::internal::TargetSerialization load("dump/TargetToolchainTest.bin");
+  CHECK_TRUE(load.LoadFromFile());
+  const auto &toolchain = load.GetLoad().toolchain;
+  STRCMP_EQUAL(toolchain.assembler.c_str(), "/usr/bin/as:1:2");
+  STRCMP_EQUAL(toolchain.c_compiler.c_str(), "/usr/bin/gcc:3:4");
+  STRCMP_EQUAL(toolchain.cpp_compiler.c_str(), "/usr/bin/g++:5:6");
+  STRCMP_EQUAL(toolchain.archiver.c_str(), "/usr/bin/ar:7:8");
+  STRCMP_EQUAL(toolchain.linker.c_str(), "/usr/bin/ld:9:10");
+}
+
+TEST(TargetSerializationTestGroup, Verify_Failure) {
   {
-    // JSON Parse fails
+    // Header missing
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetJsonParseFailure.json");
+        "dump/TargetVerifyFailure.bin");
 
     buildcc::env::save_file(serialization.GetSerializedFile().string().c_str(),
-                            std::string(""), false);
+                            std::string("BCCT"), true);
     bool loaded = serialization.LoadFromFile();
     CHECK_FALSE(loaded);
   }
 
   {
-    // Custom Generator Schema conversion fails
+    // JSON data is not accepted
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetJsonParseFailure.json");
+        "dump/TargetVerifyFailure.bin");
 
-    auto data = R"({"name": ""})";
+    auto data = R"({"name": "", "type": "executable"})";
     buildcc::env::save_file(serialization.GetSerializedFile().string().c_str(),
-                            data, false);
+                            data, true);
     bool loaded = serialization.LoadFromFile();
     CHECK_FALSE(loaded);
   }
+
+  {
+    // Payload modified after store
+    buildcc::internal::TargetSerialization serialization(
+        "dump/TargetVerifyFailure.bin");
+    buildcc::internal::TargetSchema schema;
+    schema.name = "verify";
+    serialization.UpdateStore(schema);
+    CHECK_TRUE(serialization.StoreToFile());
+    CHECK_TRUE(serialization.LoadFromFile());
+
+    std::string data;
+    buildcc::env::load_file(serialization.GetSerializedFile().string().c_str(),
+                            true, &data);
+    data.back() = static_cast<char>(data.back() ^ 0x1);
+    buildcc::env::save_file(serialization.GetSerializedFile().string().c_str(),
+                            data, true);
+
+    buildcc::internal::TargetSerialization modified(
+        "dump/TargetVerifyFailure.bin");
+    CHECK_FALSE(modified.LoadFromFile());
+  }
+
+  {
+    // Version mismatch
+    buildcc::internal::BinaryWriter writer("BCCT", 0);
+    buildcc::internal::TargetSerialization serialization(
+        "dump/TargetVerifyFailure.bin");
+    buildcc::env::save_file(serialization.GetSerializedFile().string().c_str(),
+                            writer.Finish(), true);
+    CHECK_FALSE(serialization.LoadFromFile());
+  }
+}
+
+TEST(TargetSerializationTestGroup, Load_Failure) {
+  // Valid header, truncated payload
+  buildcc::internal::BinaryWriter writer("BCCT", 3);
+  writer.WriteString("name");
+  writer.WriteU32(0);
+  writer.WriteU32(100);
+
+  buildcc::internal::TargetSerialization serialization(
+      "dump/TargetLoadFailure.bin");
+  buildcc::env::save_file(serialization.GetSerializedFile().string().c_str(),
+                          writer.Finish(), true);
+  CHECK_FALSE(serialization.LoadFromFile());
+}
+
+TEST(TargetSerializationTestGroup, BinaryRoundTrip) {
+  buildcc::internal::TargetSerialization serialization(
+      "dump/TargetBinaryRoundTrip.bin");
+
+  buildcc::internal::TargetSchema schema;
+  schema.name = "round_trip";
+  schema.type = buildcc::TargetType::DynamicLibrary;
+  schema.headers.Emplace("include/hello.h", "1");
+  schema.pchs.Emplace("include/pch.h", "2");
+  schema.libs.Emplace("libhello.a", "3");
+  schema.external_libs = {"-lpthread"};
+  schema.include_dirs.Emplace("include");
+  schema.lib_dirs.Emplace("lib");
+  schema.preprocessor_flags = {"-DHELLO"};
+  schema.common_compile_flags = {"-Wall", "-Wextra"};
+  schema.pch_compile_flags = {"-H"};
+  schema.pch_object_flags = {"-include"};
+  schema.asm_compile_flags = {"-x", "assembler"};
+  schema.c_compile_flags = {"-std=c11"};
+  schema.cpp_compile_flags = {"-std=c++17"};
+  schema.link_flags = {"-flto"};
+  schema.compile_dependencies.Emplace("compile.txt", "4");
+  schema.link_dependencies.Emplace("link.txt", "5");
+  serialization.UpdateStore(schema);
+  serialization.UpdatePchCompiled(schema);
+  serialization.AddSource("src/main.cpp", "6");
+  serialization.UpdateTargetCompiled();
+  CHECK_TRUE(serialization.StoreToFile());
+
+  CHECK_TRUE(serialization.LoadFromFile());
+  const auto &load = serialization.GetLoad();
+  const auto &store = serialization.GetStore();
+  STRCMP_EQUAL(load.name.c_str(), "round_trip");
+  CHECK_TRUE(load.type == buildcc::TargetType::DynamicLibrary);
+  CHECK_TRUE(load.sources == store.sources);
+  CHECK_TRUE(load.headers == store.headers);
+  CHECK_TRUE(load.pchs == store.pchs);
+  CHECK_TRUE(load.libs == store.libs);
+  CHECK_TRUE(load.external_libs == store.external_libs);
+  CHECK_TRUE(load.include_dirs == store.include_dirs);
+  CHECK_TRUE(load.lib_dirs == store.lib_dirs);
+  CHECK_TRUE(load.preprocessor_flags == store.preprocessor_flags);
+  CHECK_TRUE(load.common_compile_flags == store.common_compile_flags);
+  CHECK_TRUE(load.pch_compile_flags == store.pch_compile_flags);
+  CHECK_TRUE(load.pch_object_flags == store.pch_object_flags);
+  CHECK_TRUE(load.asm_compile_flags == store.asm_compile_flags);
+  CHECK_TRUE(load.c_compile_flags == store.c_compile_flags);
+  CHECK_TRUE(load.cpp_compile_flags == store.cpp_compile_flags);
+  CHECK_TRUE(load.link_flags == store.link_flags);
+  CHECK_TRUE(load.compile_dependencies == store.compile_dependencies);
+  CHECK_TRUE(load.link_dependencies == store.link_dependencies);
+  CHECK_TRUE(load.pch_compiled);
+  CHECK_TRUE(load.target_linked);
+}
+
+TEST(TargetSerializationTestGroup, JsonExport) {
+  buildcc::internal::TargetSerialization serialization(
+      "dump/TargetJsonExport.bin");
+  const std::string json_file =
+      serialization.GetSerializedFile().string() + ".json";
+  fs::remove(json_file);
+
+  buildcc::internal::TargetSchema schema;
+  schema.name = "json_export";
+  serialization.UpdateStore(schema);
+
+  CHECK_FALSE(buildcc::internal::TargetSerialization::IsJsonExportEnabled());
+  CHECK_TRUE(serialization.StoreToFile());
+  CHECK_FALSE(fs::exists(json_file));
+
+  buildcc::internal::TargetSerialization::EnableJsonExport(true);
+  CHECK_TRUE(serialization.StoreToFile());
+  buildcc::internal::TargetSerialization::EnableJsonExport(false);
+
+  std::string data;
+  CHECK_TRUE(buildcc::env::load_file(json_file.c_str(), false, &data));
+  json j = json::parse(data);
+  STRCMP_EQUAL(j["name"].get<std::string>().c_str(), "json_export");
+
+  // Binary file is still the one that is loaded
+  CHECK_TRUE(serialization.LoadFromFile());
+  STRCMP_EQUAL(serialization.GetLoad().name.c_str(), "json_export");
 }
 
 TEST(TargetSerializationTestGroup, FormatEmptyCheck) {
   buildcc::internal::TargetSerialization serialization(
-      "dump/TargetFormatEmptyCheck.json");
+      "dump/TargetFormatEmptyCheck.bin");
 
   bool stored = serialization.StoreToFile();
   CHECK_TRUE(stored);
@@ -178,13 +360,13 @@ TEST(TargetSerializationTestGroup, FormatEmptyCheck) {
 TEST(TargetSerializationTestGroup, EmptyFile_Failure) {
   {
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetEmptyFile.json");
+        "dump/TargetEmptyFile.bin");
     CHECK_FALSE(serialization.LoadFromFile());
   }
 
   {
     buildcc::internal::TargetSerialization serialization(
-        "dump/TargetEmptyFile.json");
+        "dump/TargetEmptyFile.bin");
     buildcc::env::save_file(serialization.GetSerializedFile().string().c_str(),
                             "", false);
     CHECK_FALSE(serialization.LoadFromFile());
@@ -34,12 +34,16 @@ constexpr const char *const kGccGenericPchCompileCommand =
     "{pch_compile_flags} {compile_flags} -o {output} -c {input}";
 constexpr const char *const kGccGenericCompileCommand =
     "{compiler} {preprocessor_flags} {include_dirs} {common_compile_flags} "
-    "{pch_object_flags} {compile_flags} -o {output} -c {input}";
+    "{pch_object_flags} {compile_flags} -MD -MF {dep_file} -o {output} -c "
+    "{input}";
 constexpr const char *const kGccExecutableLinkCommand =
     "{cpp_compiler} {link_flags} {compiled_sources} -o {output} "
     "{lib_dirs} {lib_deps}";
 constexpr const char *const kGccStaticLibLinkCommand =
     "{archiver} rcs {output} {compiled_sources}";
+// Thin archives only reference the objects on disk
+constexpr const char *const kGccThinStaticLibLinkCommand =
+    "{archiver} rcsT {output} {compiled_sources}";
 constexpr const char *const kGccDynamicLibLinkCommand =
     "{cpp_compiler} -shared {link_flags} {compiled_sources} -o {output}";
 
@@ -50,8 +54,18 @@ public:
                             kGccExecutableLinkCommand);
   }
   static TargetConfig StaticLib() {
-    return DefaultGccConfig(kGccStaticLibExt, kGccGenericCompileCommand,
-                            kGccStaticLibLinkCommand);
+    TargetConfig config =
+        DefaultGccConfig(kGccStaticLibExt, kGccGenericCompileCommand,
+                         kGccStaticLibLinkCommand);
+    config.archive_update_command = kGccStaticLibLinkCommand;
+    return config;
+  }
+  static TargetConfig ThinStaticLib() {
+    TargetConfig config =
+        DefaultGccConfig(kGccStaticLibExt, kGccGenericCompileCommand,
+                         kGccThinStaticLibLinkCommand);
+    config.archive_update_command = kGccThinStaticLibLinkCommand;
+    return config;
   }
   static TargetConfig DynamicLib() {
     return DefaultGccConfig(kGccDynamicLibExt, kGccGenericCompileCommand,
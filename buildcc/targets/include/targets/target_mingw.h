@@ -42,6 +42,7 @@ public:
   }
 
   static TargetConfig StaticLib() { return GccConfig::StaticLib(); }
+  static TargetConfig ThinStaticLib() { return GccConfig::ThinStaticLib(); }
 
   static TargetConfig DynamicLib() {
     return DefaultMingwConfig(kMingwDynamicLibExt, kGccGenericCompileCommand,
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2021-2022 Niket Naidu. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CLI/CLI.hpp"
+
+#include "buildcc.h"
+
+#include "env/process_reaper.h"
+
+#include "schema/dist_compile.h"
+
+using namespace buildcc;
+
+constexpr const char *const kTag = "BuildWorker";
+
+constexpr const char *const kPortParam = "--port";
+constexpr const char *const kPortDesc = "TCP port, 0 picks a free port";
+
+constexpr const char *const kListenParam = "--listen";
+constexpr const char *const kListenDesc =
+    "IPv4 address of the interface, only listen on trusted networks";
+
+constexpr const char *const kSlotsParam = "--slots";
+constexpr const char *const kSlotsDesc =
+    "Maximum number of concurrent compiles, number of hardware threads by "
+    "default";
+
+constexpr const char *const kAllowParam = "--allow";
+constexpr const char *const kAllowDesc =
+    "Names of the compilers that clients may run, found in PATH";
+
+constexpr const char *const kWorkDirParam = "--work_dir";
+constexpr const char *const kWorkDirDesc =
+    "Directory of the sources being compiled, a new directory below the "
+    "temporary directory by default";
+
+static std::atomic<bool> stop_{false};
+
+static void stop_handler(int signal) {
+  (void)signal;
+  stop_.store(true);
+}
+
+int main(int argc, char **argv) {
+  std::uint16_t port = internal::DistCompile::kDefaultPort;
+  std::string listen = "127.0.0.1";
+  unsigned int slots = std::max(std::thread::hardware_concurrency(), 1U);
+  std::vector<std::string> compilers = {"cc",  "c++",   "gcc",
+                                        "g++", "clang", "clang++"};
+  fs::path work_dir;
+
+  CLI::App app{"Compiles preprocessed sources for buildcc clients "
+               "(--dist_workers)"};
+  app.add_option(kPortParam, port, kPortDesc);
+  app.add_option(kListenParam, listen, kListenDesc);
+  app.add_option(kSlotsParam, slots, kSlotsDesc)
+      ->check(CLI::PositiveNumber);
+  app.add_option(kAllowParam, compilers, kAllowDesc);
+  app.add_option(kWorkDirParam, work_dir, kWorkDirDesc);
+  CLI11_PARSE(app, argc, argv);
+
+  // Several workers may run on the same host
+  if (work_dir.empty()) {
+    work_dir = fs::temp_directory_path() /
+               fmt::format("buildcc-worker-{:08x}", std::random_device()());
+  }
+  env::assert_fatal(env::ProcessReaper::Init(slots),
+                    "ProcessReaper is not supported on this host");
+
+  internal::DistCompileWorker worker(slots, compilers, work_dir);
+  env::assert_fatal(worker.Start(port, listen),
+                    fmt::format("Could not listen on {}:{}", listen, port));
+  env::log_info(kTag, fmt::format("Listening on {}:{} with {} slots", listen,
+                                  worker.GetPort(), slots));
+
+  std::signal(SIGINT, stop_handler);
+  std::signal(SIGTERM, stop_handler);
+  while (!stop_.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+
+  worker.Stop();
+  env::ProcessReaper::Deinit();
+  std::error_code errcode;
+  fs::remove_all(work_dir, errcode);
+  env::log_info(kTag, fmt::format("Compiled {} sources", worker.GetCompiles()));
+  return 0;
+}